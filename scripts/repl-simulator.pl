@@ -0,0 +1,274 @@
+#!/usr/bin/perl -w
+#
+## Copyright (C) 1996-2023 The Squid Software Foundation and contributors
+##
+## Squid software is distributed under GPLv2+ license and includes
+## contributions from numerous individuals and organizations.
+## Please see the COPYING and CONTRIBUTORS files for details.
+##
+
+=pod
+
+=head1 NAME
+
+repl-simulator.pl - estimates cache hit ratios of Squid removal policies
+
+=head1 SYNOPSIS
+
+repl-simulator.pl [--cache-size MB] [--policy NAME ...] access.log ...
+
+=head1 DESCRIPTION
+
+Replays GET requests from Squid access.log files (in the default "squid"
+logformat) against a simulated cache of the given size, once per removal
+policy, and reports object and byte hit ratios for each policy. The simulated
+cache admits every successful response, so the results compare replacement
+decisions rather than predict actual Squid hit ratios.
+
+Supported policies mimic their cache_replacement_policy namesakes:
+
+  lru         Squid's original list based LRU policy
+  slru[:N]    Segmented LRU with an N% (default 80%) protected segment
+  heap:GDSF   Greedy-Dual Size Frequency
+  heap:LFUDA  Least Frequently Used with Dynamic Aging
+  heap:LRU    LRU policy implemented using a heap
+
+=head1 OPTIONS
+
+=over 4
+
+=item B<--cache-size> MB
+
+The simulated cache capacity in megabytes. Defaults to 1024.
+
+=item B<--policy> NAME
+
+Simulate the named policy. May be repeated. Defaults to all policies.
+
+=back
+
+=cut
+
+use strict;
+use Getopt::Long;
+use Pod::Usage;
+
+my $CacheSizeMb = 1024;
+my @Policies = ();
+GetOptions(
+    'cache-size=f' => \$CacheSizeMb,
+    'policy=s' => \@Policies,
+    'help' => sub { pod2usage(1); },
+) or pod2usage(2);
+
+@Policies = ('lru', 'slru', 'heap:GDSF', 'heap:LFUDA', 'heap:LRU') unless @Policies;
+my $Capacity = $CacheSizeMb * 1024 * 1024;
+
+# load the trace once: [time, key, size] tuples
+my @Trace = ();
+while (my $line = <>) {
+    my @F = split(/\s+/, $line);
+    next unless @F >= 7;
+    my ($time, $code, $bytes, $method, $url) = @F[0, 3, 4, 5, 6];
+    next unless $method eq 'GET';
+    next unless $code =~ m@/200$@;
+    next unless $bytes > 0;
+    push @Trace, [$time, $url, $bytes];
+}
+die("no cachable GET transactions found\n") unless @Trace;
+
+printf("%-12s %10s %10s %12s %12s\n", 'policy', 'requests', 'hits', 'hit ratio', 'byte ratio');
+foreach my $name (@Policies) {
+    my $cache = &NewCache($name);
+    my ($hits, $hitBytes, $bytes) = (0, 0, 0);
+    foreach my $t (@Trace) {
+        my ($time, $key, $size) = @$t;
+        $bytes += $size;
+        if ($cache->{lookup}->($key, $time)) {
+            ++$hits;
+            $hitBytes += $size;
+        } elsif ($size <= $Capacity) {
+            $cache->{add}->($key, $size, $time);
+        }
+    }
+    printf("%-12s %10d %10d %11.2f%% %11.2f%%\n", $name, scalar(@Trace), $hits,
+           100.0 * $hits / @Trace, 100.0 * $hitBytes / $bytes);
+}
+
+exit(0);
+
+# creates a simulated cache using the named removal policy
+sub NewCache {
+    my ($name) = @_;
+    return &NewListCache(0) if $name eq 'lru';
+    return &NewListCache($1 || 80) if $name =~ /^slru(?::(\d+))?$/;
+    return &NewHeapCache($1) if $name =~ /^heap:(GDSF|LFUDA|LRU)$/;
+    die("unsupported policy: $name\n");
+}
+
+# A doubly linked list: {head, tail} with nodes {key, prev, next}.
+sub ListAddTail {
+    my ($list, $node) = @_;
+    $node->{prev} = $list->{tail};
+    $node->{next} = undef;
+    if ($list->{tail}) {
+        $list->{tail}->{next} = $node;
+    } else {
+        $list->{head} = $node;
+    }
+    $list->{tail} = $node;
+}
+
+sub ListDelete {
+    my ($list, $node) = @_;
+    if ($node->{prev}) { $node->{prev}->{next} = $node->{next}; } else { $list->{head} = $node->{next}; }
+    if ($node->{next}) { $node->{next}->{prev} = $node->{prev}; } else { $list->{tail} = $node->{prev}; }
+    $node->{prev} = $node->{next} = undef;
+}
+
+# lru (with zero protected percentage) and slru caches
+sub NewListCache {
+    my ($protectedPercent) = @_;
+    my %index = ();
+    my $probation = {};
+    my $protected = {};
+    my $protectedCount = 0;
+    my $size = 0;
+
+    my $rebalance = sub {
+        while ($protectedCount > int(scalar(keys %index) * $protectedPercent / 100)) {
+            my $node = $protected->{head};
+            &ListDelete($protected, $node);
+            --$protectedCount;
+            $node->{protected} = 0;
+            &ListAddTail($probation, $node);
+        }
+    };
+
+    return {
+        lookup => sub {
+            my ($key) = @_;
+            my $node = $index{$key} or return 0;
+            if ($node->{protected}) {
+                &ListDelete($protected, $node);
+                &ListAddTail($protected, $node);
+            } elsif ($protectedPercent) {
+                &ListDelete($probation, $node);
+                $node->{protected} = 1;
+                ++$protectedCount;
+                &ListAddTail($protected, $node);
+                $rebalance->();
+            } else {
+                &ListDelete($probation, $node);
+                &ListAddTail($probation, $node);
+            }
+            return 1;
+        },
+        add => sub {
+            my ($key, $objectSize) = @_;
+            while ($size + $objectSize > $Capacity) {
+                my $list = $probation->{head} ? $probation : $protected;
+                my $victim = $list->{head};
+                &ListDelete($list, $victim);
+                --$protectedCount if $victim->{protected};
+                $size -= $victim->{size};
+                delete $index{$victim->{key}};
+            }
+            my $node = { key => $key, size => $objectSize, protected => 0 };
+            $index{$key} = $node;
+            &ListAddTail($probation, $node);
+            $size += $objectSize;
+        },
+    };
+}
+
+# heap-based caches with lazily deleted stale heap items
+sub NewHeapCache {
+    my ($keyType) = @_;
+    my %index = (); # key => {size, refcount, lastref, version}
+    my @heap = (); # [heapKey, key, version]
+    my $age = 0.0;
+    my $size = 0;
+
+    my $heapKey = sub {
+        my ($e, $now) = @_;
+        if ($keyType eq 'GDSF') {
+            my $tie = $e->{lastref} > 1 ? 1.0 / $e->{lastref} : 1.0;
+            return $age + $e->{refcount} / $e->{size} - $tie;
+        }
+        if ($keyType eq 'LFUDA') {
+            my $tie = $now > $e->{lastref} ? 1.0 - exp(($e->{lastref} - $now) / 86400.0) : 0.0;
+            return $age + $e->{refcount} - $tie;
+        }
+        return $e->{lastref};
+    };
+
+    my $push = sub {
+        my ($item) = @_;
+        push @heap, $item;
+        my $i = $#heap;
+        while ($i > 0) {
+            my $parent = int(($i - 1) / 2);
+            last if $heap[$parent]->[0] <= $heap[$i]->[0];
+            @heap[$parent, $i] = @heap[$i, $parent];
+            $i = $parent;
+        }
+    };
+
+    my $pop = sub {
+        my $top = $heap[0];
+        my $last = pop @heap;
+        if (@heap) {
+            $heap[0] = $last;
+            my $i = 0;
+            while (1) {
+                my ($l, $r) = (2 * $i + 1, 2 * $i + 2);
+                my $min = $i;
+                $min = $l if $l < @heap && $heap[$l]->[0] < $heap[$min]->[0];
+                $min = $r if $r < @heap && $heap[$r]->[0] < $heap[$min]->[0];
+                last if $min == $i;
+                @heap[$min, $i] = @heap[$i, $min];
+                $i = $min;
+            }
+        }
+        return $top;
+    };
+
+    my $update = sub {
+        my ($key, $e, $now) = @_;
+        ++$e->{version};
+        $push->([$heapKey->($e, $now), $key, $e->{version}]);
+
+        # forget stale heap items when they dominate the heap
+        if (@heap > 4 * scalar(keys %index) + 1024) {
+            @heap = sort { $a->[0] <=> $b->[0] }
+                grep { my $x = $index{$_->[1]}; $x && $x->{version} == $_->[2] } @heap;
+        }
+    };
+
+    return {
+        lookup => sub {
+            my ($key, $now) = @_;
+            my $e = $index{$key} or return 0;
+            ++$e->{refcount};
+            $e->{lastref} = $now;
+            $update->($key, $e, $now);
+            return 1;
+        },
+        add => sub {
+            my ($key, $objectSize, $now) = @_;
+            while ($size + $objectSize > $Capacity) {
+                my $item = $pop->();
+                my $victim = $index{$item->[1]};
+                next unless $victim && $victim->{version} == $item->[2];
+                $age = $item->[0] if $keyType ne 'LRU';
+                $size -= $victim->{size};
+                delete $index{$item->[1]};
+            }
+            my $e = { size => $objectSize, refcount => 1, lastref => $now, version => 0 };
+            $index{$key} = $e;
+            $update->($key, $e, $now);
+            $size += $objectSize;
+        },
+    };
+}
@@ -16,10 +16,14 @@
 #include "PeerDigest.h"
 #include "PeerPoolMgr.h"
 #include "SquidConfig.h"
+#include "SquidMath.h"
 #include "util.h"
 
 CBDATA_CLASS_INIT(CachePeer);
 
+/// the number of recent samples dominating CachePeer::latency averages
+static const int PeerLatencyWindow = 16;
+
 CachePeer::CachePeer(const char * const hostname):
     name(xstrdup(hostname)),
     host(xstrdup(hostname))
@@ -69,6 +73,20 @@ CachePeer::noteSuccess()
     }
 }
 
+void
+CachePeer::noteConnectTime(const int msec)
+{
+    latency.connectTime = Math::doubleAverage(latency.connectTime, msec, ++latency.connectSamples, PeerLatencyWindow);
+}
+
+void
+CachePeer::noteResponseTime(const int msec, const Http::StatusCode code)
+{
+    latency.responseTime = Math::doubleAverage(latency.responseTime, msec, ++latency.responseSamples, PeerLatencyWindow);
+    const auto failed = (code >= Http::scInternalServerError) ? 1.0 : 0.0;
+    latency.errorRate = Math::doubleAverage(latency.errorRate, failed, ++latency.errorSamples, PeerLatencyWindow);
+}
+
 void
 CachePeer::noteFailure(const Http::StatusCode code)
 {
@@ -85,6 +103,7 @@ void
 CachePeer::countFailure()
 {
     stats.last_connect_failure = squid_curtime;
+    latency.errorRate = Math::doubleAverage(latency.errorRate, 1.0, ++latency.errorSamples, PeerLatencyWindow);
     if (tcp_up > 0)
         --tcp_up;
 
@@ -42,6 +42,13 @@ public:
     /// \param code a received response status code, if any
     void noteFailure(Http::StatusCode code);
 
+    /// accounts for a TCP connection to this cache_peer established in msec
+    void noteConnectTime(int msec);
+
+    /// accounts for a response header received from this cache_peer msec
+    /// after the corresponding request was sent
+    void noteResponseTime(int msec, Http::StatusCode);
+
     /// (re)configure cache_peer name=value
     void rename(const char *);
 
@@ -112,6 +119,7 @@ public:
         bool default_parent = false;
         bool roundrobin = false;
         bool weighted_roundrobin = false;
+        bool latency_aware = false;
         bool mcast_responder = false;
         bool closest_only = false;
 #if USE_HTCP
@@ -151,6 +159,21 @@ public:
     int weight = 1;
     int basetime = 0;
 
+    /// moving averages of observed transaction outcomes; used for
+    /// latency-aware cache_peer selection
+    struct {
+        double connectTime = 0.0; ///< TCP connection establishment time (msec)
+        int connectSamples = 0; ///< measurements in connectTime
+        double responseTime = 0.0; ///< request sending to response header time (msec)
+        int responseSamples = 0; ///< measurements in responseTime
+        double errorRate = 0.0; ///< failed transactions fraction, from 0 to 1
+        int errorSamples = 0; ///< outcomes in errorRate
+        int pending = 0; ///< requests sent without response completion
+        time_t ejectedUntil = 0; ///< when an outlier ejection ends (or 0)
+        int ejections = 0; ///< outlier ejections so far
+        int consecutiveEjections = 0; ///< ejections since the peer was healthy
+    } latency;
+
     struct {
         double avg_n_members = 0.0;
         int n_times_counted = 0;
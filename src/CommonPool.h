@@ -27,7 +27,8 @@ class CommonPool
     MEMPROXY_CLASS(CommonPool);
 
 public:
-    static CommonPool *Factory (unsigned char _class, CompositePoolNode::Pointer&);
+    /// \param poolNumber zero-based delay pool number
+    static CommonPool *Factory (unsigned char _class, CompositePoolNode::Pointer&, unsigned short poolNumber);
     const SBuf &classTypeLabel() const { return typeLabel; }
 
 protected:
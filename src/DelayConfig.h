@@ -26,6 +26,10 @@ public:
     void parsePoolRates();
     void parsePoolAccess(ConfigParser &parser);
     unsigned short initial;
+    int sharedBuckets; ///< delay_pool_shared_buckets
+    int ipv4NetworkBits; ///< delay_ipv4_network_bits
+    int ipv6NetworkBits; ///< delay_ipv6_network_bits
+    time_t bucketIdleTimeout; ///< delay_bucket_idle_timeout
 
 };
 
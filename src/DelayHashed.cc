@@ -0,0 +1,247 @@
+/*
+ * Copyright (C) 1996-2023 The Squid Software Foundation and contributors
+ *
+ * Squid software is distributed under GPLv2+ license and includes
+ * contributions from numerous individuals and organizations.
+ * Please see the COPYING and CONTRIBUTORS files for details.
+ */
+
+/* DEBUG: section 77    Delay Pools */
+
+#include "squid.h"
+
+#if USE_DELAY_POOLS
+#include "DelayHashed.h"
+#include "ip/tools.h"
+#include "SquidConfig.h"
+#include "Store.h"
+#include "time/gadgets.h"
+#if USE_AUTH
+#include "auth/User.h"
+#include "auth/UserRequest.h"
+#endif
+
+#include <algorithm>
+
+/// labels for DelayHashed::Level values
+static const char *const LevelLabels[] = { "Aggregate", "Network", "Individual", "User" };
+
+/// the number of seconds it takes to fill an empty bucket
+static double
+FillTime(const DelaySpec &spec)
+{
+    if (spec.restore_bps <= 0)
+        return -1; // never
+    return static_cast<double>(spec.max_bytes) / spec.restore_bps;
+}
+
+DelayHashedBucket::DelayHashedBucket(const SBuf &aLabel, const DelaySpec &spec, const double now):
+    label(aLabel),
+    level((static_cast<double>(spec.max_bytes) * Config.Delay.initial) / 100),
+    refilled(now),
+    used(now)
+{
+}
+
+void
+DelayHashedBucket::refill(const DelaySpec &spec, const double now)
+{
+    if (now > refilled && spec.restore_bps > 0 && level < spec.max_bytes)
+        level = std::min<double>(spec.max_bytes, level + (now - refilled) * spec.restore_bps);
+    refilled = now;
+}
+
+void
+DelayHashedBucket::stats(StoreEntry *entry, const double now) const
+{
+    storeAppendPrintf(entry, "\t\t\t" SQUIDSBUFPH ": level %.0f, %" PRIu64 " bytes, limited %" PRIu64 " times, idle %.0f seconds\n",
+                      SQUIDSBUFPRINT(label), level, bytes, limited, now - used);
+}
+
+DelayHashedBucket::Pointer
+DelayHashed::Buckets::get(const SBuf &label, const DelaySpec &spec, const double now)
+{
+    const auto found = index.find(label);
+    if (found != index.end())
+        return found->second;
+
+    DelayHashedBucket::Pointer bucket = new DelayHashedBucket(label, spec, now);
+    recency.push_front(bucket.getRaw());
+    bucket->position = recency.begin();
+    index.emplace(label, bucket);
+    return bucket;
+}
+
+void
+DelayHashed::Buckets::touch(DelayHashedBucket &bucket, const double now)
+{
+    bucket.used = now;
+    recency.splice(recency.begin(), recency, bucket.position);
+}
+
+void
+DelayHashed::Buckets::expire(const double idleSince)
+{
+    // buckets of ongoing transactions may be idle for a long time; each
+    // bucket is examined at most once so that they cannot keep us looping
+    for (auto examined = recency.size(); examined > 0 && !recency.empty(); --examined) {
+        const auto bucket = recency.back();
+        if (bucket->used >= idleSince)
+            break; // this and all other buckets were used recently
+
+        if (bucket->LockCount() > 1) {
+            recency.splice(recency.begin(), recency, bucket->position);
+            continue; // still used by some transaction
+        }
+
+        debugs(77, 5, "forgetting " << bucket->label);
+        recency.pop_back();
+        ++expired;
+        index.erase(bucket->label); // may destroy the bucket
+    }
+}
+
+DelayHashed::DelayHashed()
+{
+    DelayPools::registerForUpdates(this);
+}
+
+DelayHashed::~DelayHashed()
+{
+    DelayPools::deregisterForUpdates(this);
+}
+
+void
+DelayHashed::stats(StoreEntry * sentry)
+{
+    const auto now = current_dtime;
+    for (int level = levelAggregate; level < levelEnd; ++level) {
+        specs[level].stats(sentry, LevelLabels[level]);
+        if (!limits(static_cast<Level>(level)))
+            continue;
+
+        const auto &known = buckets[level];
+        storeAppendPrintf(sentry, "\t\tBuckets: %zu, forgotten: %" PRIu64 "\n", known.index.size(), known.expired);
+        for (const auto bucket: known.recency) {
+            bucket->refill(specs[level], now);
+            bucket->stats(sentry, now);
+        }
+        storeAppendPrintf(sentry, "\n");
+    }
+}
+
+void
+DelayHashed::dump(StoreEntry *entry) const
+{
+    for (const auto &spec: specs)
+        spec.dump(entry);
+}
+
+void
+DelayHashed::update(int)
+{
+    // buckets refill themselves when used, so we only need to forget idle
+    // buckets and retry reads deferred on the pool as a whole
+    const auto now = current_dtime;
+    for (int level = levelNetwork; level < levelEnd; ++level) {
+        const auto fillTime = FillTime(specs[level]);
+        if (fillTime < 0)
+            continue; // forgetting a bucket would give its owner more bytes
+        // forget only full buckets, equivalent to new ones
+        const auto idleTime = std::max<double>(Config.Delay.bucketIdleTimeout, fillTime);
+        buckets[level].expire(now - idleTime);
+    }
+
+    kickReads();
+}
+
+void
+DelayHashed::parse()
+{
+    for (auto &spec: specs)
+        spec.parse();
+}
+
+DelayIdComposite::Pointer
+DelayHashed::id(CompositeSelectionDetails &details)
+{
+    return new Id(this, details);
+}
+
+DelayHashed::Id::Id(const DelayHashed::Pointer &aPool, CompositeSelectionDetails &details): thePool(aPool)
+{
+    setBucket(levelAggregate, SBuf());
+
+    if (!details.src_addr.isAnyAddr()) {
+        char buf[MAX_IPSTRLEN];
+
+        auto network = details.src_addr;
+        const auto bits = network.isIPv4() ? Config.Delay.ipv4NetworkBits : Config.Delay.ipv6NetworkBits;
+        network.applyMask(bits, network.isIPv4() ? AF_INET : AF_INET6);
+        SBuf label(network.toStr(buf, sizeof(buf)));
+        label.appendf("/%d", bits);
+        setBucket(levelNetwork, label);
+
+        setBucket(levelIndividual, SBuf(details.src_addr.toStr(buf, sizeof(buf))));
+    }
+
+#if USE_AUTH
+    if (details.user && details.user->user() && details.user->user()->username()) {
+        // for rate limiting, user names are case insensitive
+        SBuf name(details.user->user()->username());
+        name.toLower();
+        setBucket(levelUser, name);
+    }
+#endif
+}
+
+/// finds or creates our bucket for the given level (if that level is limited)
+void
+DelayHashed::Id::setBucket(const Level level, const SBuf &label)
+{
+    if (thePool->limits(level))
+        theBuckets[level] = thePool->buckets[level].get(label, thePool->specs[level], current_dtime);
+}
+
+int
+DelayHashed::Id::bytesWanted(int minimum, int maximum) const
+{
+    const auto now = current_dtime;
+    int64_t nbytes = maximum;
+    for (int level = levelAggregate; level < levelEnd; ++level) {
+        const auto &bucket = theBuckets[level];
+        if (!bucket)
+            continue;
+        bucket->refill(thePool->specs[level], now);
+        thePool->buckets[level].touch(*bucket, now);
+        const auto available = static_cast<int64_t>(bucket->level);
+        if (available < nbytes) {
+            nbytes = available;
+            ++bucket->limited;
+        }
+    }
+
+    return std::max<int64_t>(minimum, nbytes);
+}
+
+void
+DelayHashed::Id::bytesIn(int qty)
+{
+    for (auto &bucket: theBuckets) {
+        if (!bucket)
+            continue;
+        bucket->level -= qty;
+        bucket->bytes += qty;
+    }
+
+    thePool->kickReads();
+}
+
+void
+DelayHashed::Id::delayRead(const AsyncCallPointer &aRead)
+{
+    thePool->delayRead(aRead);
+}
+
+#endif /* USE_DELAY_POOLS */
+
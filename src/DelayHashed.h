@@ -0,0 +1,131 @@
+/*
+ * Copyright (C) 1996-2023 The Squid Software Foundation and contributors
+ *
+ * Squid software is distributed under GPLv2+ license and includes
+ * contributions from numerous individuals and organizations.
+ * Please see the COPYING and CONTRIBUTORS files for details.
+ */
+
+/* DEBUG: section 77    Delay Pools */
+
+#ifndef SQUID_DELAYHASHED_H
+#define SQUID_DELAYHASHED_H
+
+#if USE_DELAY_POOLS
+
+#include "CompositePoolNode.h"
+#include "DelayIdComposite.h"
+#include "DelaySpec.h"
+#include "sbuf/Algorithms.h"
+#include "sbuf/SBuf.h"
+
+#include <list>
+#include <unordered_map>
+
+/// \ingroup DelayPoolsAPI
+/// a token bucket of a DelayHashed pool, refilled when used
+class DelayHashedBucket : public RefCountable
+{
+    MEMPROXY_CLASS(DelayHashedBucket);
+
+public:
+    typedef RefCount<DelayHashedBucket> Pointer;
+    typedef std::list<DelayHashedBucket *> Recency;
+
+    DelayHashedBucket(const SBuf &aLabel, const DelaySpec &, double now);
+
+    /// adds bytes accumulated since the last refill
+    void refill(const DelaySpec &, double now);
+
+    void stats(StoreEntry *, double now) const;
+
+    const SBuf label; ///< bucket owner: client address, network, or user
+    double level; ///< available bytes (may be negative)
+    double refilled; ///< the last refill time (current_dtime)
+    double used; ///< the last access time (current_dtime)
+    uint64_t bytes = 0; ///< the total number of bytes charged to this bucket
+    uint64_t limited = 0; ///< the number of times this bucket slowed a read
+    Recency::iterator position; ///< our place in the recency list
+};
+
+/// \ingroup DelayPoolsAPI
+/// A class 7 delay pool: class 4 aggregate, network, individual, and user
+/// limits with buckets kept in hash tables instead of fixed arrays. Works
+/// for IPv4 and IPv6 clients. Buckets are refilled when used rather than
+/// by visiting every bucket on each DelayPools::Update(), and buckets idle
+/// longer than delay_bucket_idle_timeout are forgotten.
+class DelayHashed : public CompositePoolNode
+{
+    MEMPROXY_CLASS(DelayHashed);
+
+public:
+    typedef RefCount<DelayHashed> Pointer;
+
+    /// bucket levels, in delay_parameters order; the aggregate level has
+    /// a single bucket
+    typedef enum {
+        levelAggregate,
+        levelNetwork,
+        levelIndividual,
+        levelUser,
+        levelEnd
+    } Level;
+
+    DelayHashed();
+    ~DelayHashed() override;
+
+    /* CompositePoolNode API */
+    void stats(StoreEntry * sentry) override;
+    void dump(StoreEntry *entry) const override;
+    void update(int incr) override;
+    void parse() override;
+    DelayIdComposite::Pointer id(CompositeSelectionDetails &) override;
+
+private:
+    /// same-level buckets indexed by their labels and ordered by recency
+    class Buckets
+    {
+    public:
+        /// \returns the (possibly new) bucket with the given label
+        DelayHashedBucket::Pointer get(const SBuf &label, const DelaySpec &, double now);
+
+        /// marks the bucket as the most recently used one
+        void touch(DelayHashedBucket &, double now);
+
+        /// forgets buckets that nobody uses and nobody used since the given time
+        void expire(double idleSince);
+
+        typedef std::unordered_map<SBuf, DelayHashedBucket::Pointer> Index;
+        Index index; ///< buckets by label; owns buckets
+        DelayHashedBucket::Recency recency; ///< index buckets, most recently used first
+        uint64_t expired = 0; ///< the number of forgotten buckets
+    };
+
+    /// \ingroup DelayPoolsInternal
+    class Id:public DelayIdComposite
+    {
+        MEMPROXY_CLASS(DelayHashed::Id);
+
+    public:
+        Id(const DelayHashed::Pointer &, CompositeSelectionDetails &);
+        int bytesWanted (int min, int max) const override;
+        void bytesIn(int qty) override;
+        void delayRead(const AsyncCallPointer &) override;
+
+    private:
+        void setBucket(Level, const SBuf &label);
+
+        DelayHashed::Pointer thePool;
+        DelayHashedBucket::Pointer theBuckets[levelEnd]; ///< nil for unlimited levels
+    };
+
+    /// whether the given level limits traffic
+    bool limits(const Level level) const { return specs[level].restore_bps != -1; }
+
+    DelaySpec specs[levelEnd]; ///< configured limits for each level
+    Buckets buckets[levelEnd]; ///< known buckets for each level
+};
+
+#endif /* USE_DELAY_POOLS */
+#endif /* SQUID_DELAYHASHED_H */
+
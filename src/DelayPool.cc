@@ -19,7 +19,7 @@
 
 DelayPool::DelayPool() : pool (nullptr), access (nullptr)
 {
-    pool = CommonPool::Factory(0, theComposite_);
+    pool = CommonPool::Factory(0, theComposite_, 0);
 }
 
 DelayPool::~DelayPool()
@@ -60,12 +60,12 @@ DelayPool::dump(StoreEntry *entry, unsigned int i) const
 }
 
 void
-DelayPool::createPool(u_char delay_class)
+DelayPool::createPool(u_char delay_class, unsigned short poolNumber)
 {
     if (pool)
         freeData();
 
-    pool = CommonPool::Factory(delay_class, theComposite_);
+    pool = CommonPool::Factory(delay_class, theComposite_, poolNumber);
 }
 
 void
@@ -27,7 +27,8 @@ public:
     DelayPool();
     ~DelayPool();
     void freeData();
-    void createPool(u_char delay_class);
+    /// \param poolNumber zero-based delay pool number
+    void createPool(u_char delay_class, unsigned short poolNumber);
     void parse();
     void dump (StoreEntry *, unsigned int poolNumberMinusOne) const;
     CommonPool *pool;
@@ -0,0 +1,308 @@
+/*
+ * Copyright (C) 1996-2023 The Squid Software Foundation and contributors
+ *
+ * Squid software is distributed under GPLv2+ license and includes
+ * contributions from numerous individuals and organizations.
+ * Please see the COPYING and CONTRIBUTORS files for details.
+ */
+
+/* DEBUG: section 77    Delay Pools */
+
+#include "squid.h"
+
+#if USE_DELAY_POOLS
+#include "base/RunnersRegistry.h"
+#include "CommonPool.h"
+#include "DelayPool.h"
+#include "DelayShared.h"
+#include "ipc/mem/Pointer.h"
+#include "NullDelayId.h"
+#include "sbuf/SBuf.h"
+#include "SquidConfig.h"
+#include "Store.h"
+#include "tools.h"
+#if USE_AUTH
+#include "auth/User.h"
+#include "auth/UserRequest.h"
+#endif
+
+#include <algorithm>
+#include <chrono>
+
+SharedDelayBuckets *DelayShared::Buckets = nullptr;
+
+/// the shared memory segment name for class 6 delay pool buckets
+static const char *const ShmLabel = "delay_buckets";
+
+/// labels for DelayShared::Level values
+static const char *const LevelLabels[] = { "Aggregate", "Network", "Individual", "User" };
+
+DelayShared::DelayShared(const unsigned short pool): poolNumber(pool)
+{
+    DelayPools::registerForUpdates(this);
+}
+
+DelayShared::~DelayShared()
+{
+    DelayPools::deregisterForUpdates(this);
+}
+
+SharedDelayBuckets::Microseconds
+DelayShared::Now()
+{
+    // a system-wide clock, comparable across SMP workers
+    const auto now = std::chrono::steady_clock::now().time_since_epoch();
+    return std::chrono::duration_cast<std::chrono::microseconds>(now).count();
+}
+
+SharedDelayBuckets::Rate
+DelayShared::rate(const Level level) const
+{
+    const auto &spec = specs[level];
+    SharedDelayBuckets::Rate r;
+    r.restoreBps = spec.restore_bps;
+    r.maxBytes = spec.max_bytes;
+    r.initialBytes = static_cast<int64_t>((static_cast<double>(spec.max_bytes) * Config.Delay.initial) / 100);
+    return r;
+}
+
+void
+DelayShared::stats(StoreEntry * sentry)
+{
+    for (int level = levelAggregate; level < levelEnd; ++level)
+        specs[level].stats(sentry, LevelLabels[level]);
+
+    if (!Buckets) {
+        storeAppendPrintf(sentry, "\tShared buckets: Not available.\n\n");
+        return;
+    }
+
+    if (limits(levelAggregate)) {
+        const auto key = SharedDelayBuckets::MakeKey(poolNumber, levelAggregate, nullptr, 0);
+        const auto index = Buckets->find(key, rate(levelAggregate), Now());
+        if (index != SharedDelayBuckets::NoBucket)
+            storeAppendPrintf(sentry, "\tAggregate Current: %" PRId64 "\n", Buckets->level(index, rate(levelAggregate), Now()));
+    }
+
+    storeAppendPrintf(sentry, "\tShared buckets (all class 6 pools): %u of %u used, %" PRIu64 " recycled, %" PRIu64 " evicted\n\n",
+                      Buckets->used(), Buckets->capacity(), Buckets->recycles(), Buckets->evictions());
+}
+
+void
+DelayShared::dump(StoreEntry *entry) const
+{
+    for (const auto &spec: specs)
+        spec.dump(entry);
+}
+
+void
+DelayShared::update(int)
+{
+    // buckets refill themselves when used, possibly by other workers, so we
+    // only need to retry reads deferred on the pool as a whole
+    kickReads();
+}
+
+void
+DelayShared::parse()
+{
+    for (auto &spec: specs)
+        spec.parse();
+}
+
+DelayIdComposite::Pointer
+DelayShared::id(CompositeSelectionDetails &details)
+{
+    // SharedDelayBucketsRr has reported this misconfiguration
+    if (!Buckets)
+        return new NullDelayId;
+
+    return new Id(this, details);
+}
+
+DelayShared::Id::Id(const DelayShared::Pointer &aPool, CompositeSelectionDetails &details): thePool(aPool)
+{
+    std::fill(std::begin(keys), std::end(keys), 0);
+    std::fill(std::begin(indices), std::end(indices), SharedDelayBuckets::NoBucket);
+
+    setKey(levelAggregate, nullptr, 0);
+
+    if (!details.src_addr.isAnyAddr()) {
+        auto network = details.src_addr;
+        if (network.isIPv4())
+            network.applyMask(Config.Delay.ipv4NetworkBits, AF_INET);
+        else
+            network.applyMask(Config.Delay.ipv6NetworkBits, AF_INET6);
+        struct in6_addr addr;
+        network.getInAddr(addr);
+        setKey(levelNetwork, &addr, sizeof(addr));
+
+        details.src_addr.getInAddr(addr);
+        setKey(levelIndividual, &addr, sizeof(addr));
+    }
+
+#if USE_AUTH
+    if (details.user && details.user->user() && details.user->user()->username()) {
+        // for rate limiting, user names are case insensitive
+        SBuf name(details.user->user()->username());
+        name.toLower();
+        setKey(levelUser, name.rawContent(), name.length());
+    }
+#endif
+}
+
+/// computes the bucket key for the given level (if that level is limited)
+void
+DelayShared::Id::setKey(const Level level, const void *data, const size_t size)
+{
+    if (thePool->limits(level))
+        keys[level] = SharedDelayBuckets::MakeKey(thePool->poolNumber, level, data, size);
+}
+
+/// \returns the current position of our bucket for the given level
+uint32_t
+DelayShared::Id::bucketAt(const Level level, const SharedDelayBuckets::Microseconds now) const
+{
+    auto &index = indices[level];
+    if (index == SharedDelayBuckets::NoBucket || !Buckets->owns(index, keys[level]))
+        index = Buckets->find(keys[level], thePool->rate(level), now);
+    return index;
+}
+
+int
+DelayShared::Id::bytesWanted(int minimum, int maximum) const
+{
+    if (!Buckets)
+        return maximum;
+
+    const auto now = Now();
+    int64_t nbytes = maximum;
+    for (int i = levelAggregate; i < levelEnd; ++i) {
+        const auto level = static_cast<Level>(i);
+        if (!keys[level])
+            continue;
+        const auto index = bucketAt(level, now);
+        if (index != SharedDelayBuckets::NoBucket)
+            nbytes = std::min(nbytes, Buckets->level(index, thePool->rate(level), now));
+    }
+
+    return std::max<int64_t>(minimum, nbytes);
+}
+
+void
+DelayShared::Id::bytesIn(int qty)
+{
+    if (!Buckets)
+        return;
+
+    const auto now = Now();
+    for (int i = levelAggregate; i < levelEnd; ++i) {
+        const auto level = static_cast<Level>(i);
+        if (!keys[level])
+            continue;
+        const auto index = bucketAt(level, now);
+        if (index != SharedDelayBuckets::NoBucket)
+            Buckets->consume(index, qty);
+    }
+
+    thePool->kickReads();
+}
+
+void
+DelayShared::Id::delayRead(const AsyncCallPointer &aRead)
+{
+    thePool->delayRead(aRead);
+}
+
+/// whether some delay pool is of class 6
+static bool
+SharedPoolsConfigured()
+{
+    for (unsigned short i = 0; i < DelayPools::pools(); ++i) {
+        const auto pool = DelayPools::delay_data[i].pool;
+        if (pool && pool->classTypeLabel().cmp("6") == 0)
+            return true;
+    }
+    return false;
+}
+
+/// whether some delay pool needs shared buckets
+static bool
+SharedBucketsNeeded()
+{
+    return Config.Delay.sharedBuckets > 0 && SharedPoolsConfigured();
+}
+
+/// reports class 6 pools that cannot limit traffic without shared buckets
+static void
+ReportPoolsWithoutBuckets()
+{
+    // only workers limit traffic
+    if (!IamWorkerProcess() || DelayShared::Buckets || !SharedPoolsConfigured())
+        return;
+
+    if (Config.Delay.sharedBuckets <= 0) {
+        debugs(77, DBG_CRITICAL, "ERROR: class 6 delay pools do not limit traffic" <<
+               Debug::Extra << "problem: delay_pool_shared_buckets is " << Config.Delay.sharedBuckets);
+    } else {
+        debugs(77, DBG_CRITICAL, "ERROR: class 6 delay pools do not limit traffic until Squid restarts" <<
+               Debug::Extra << "problem: the first class 6 pool was added during reconfiguration");
+    }
+}
+
+/// creates and opens the shared memory segment with class 6 pool buckets
+class SharedDelayBucketsRr: public Ipc::Mem::RegisteredRunner
+{
+public:
+    /* RegisteredRunner API */
+    ~SharedDelayBucketsRr() override { delete owner; }
+    void useConfig() override;
+    void syncConfig() override;
+
+protected:
+    void create() override;
+    void open() override;
+
+private:
+    Ipc::Mem::Owner<SharedDelayBuckets> *owner = nullptr;
+    Ipc::Mem::Pointer<SharedDelayBuckets> buckets; ///< keeps the segment attached
+};
+
+DefineRunnerRegistrator(SharedDelayBucketsRr);
+
+void
+SharedDelayBucketsRr::useConfig()
+{
+    Ipc::Mem::RegisteredRunner::useConfig();
+    ReportPoolsWithoutBuckets();
+}
+
+void
+SharedDelayBucketsRr::syncConfig()
+{
+    // the segment is not created or resized during reconfiguration
+    ReportPoolsWithoutBuckets();
+}
+
+void
+SharedDelayBucketsRr::create()
+{
+    if (!SharedBucketsNeeded())
+        return;
+
+    Must(!owner);
+    owner = shm_new(SharedDelayBuckets)(ShmLabel, static_cast<uint32_t>(Config.Delay.sharedBuckets));
+}
+
+void
+SharedDelayBucketsRr::open()
+{
+    if (!SharedBucketsNeeded())
+        return;
+
+    buckets = shm_old(SharedDelayBuckets)(ShmLabel);
+    DelayShared::Buckets = buckets.getRaw();
+}
+
+#endif /* USE_DELAY_POOLS */
+
@@ -0,0 +1,95 @@
+/*
+ * Copyright (C) 1996-2023 The Squid Software Foundation and contributors
+ *
+ * Squid software is distributed under GPLv2+ license and includes
+ * contributions from numerous individuals and organizations.
+ * Please see the COPYING and CONTRIBUTORS files for details.
+ */
+
+/* DEBUG: section 77    Delay Pools */
+
+#ifndef SQUID_DELAYSHARED_H
+#define SQUID_DELAYSHARED_H
+
+#if USE_DELAY_POOLS
+
+#include "CompositePoolNode.h"
+#include "DelayIdComposite.h"
+#include "DelaySpec.h"
+#include "SharedDelayBuckets.h"
+
+/// \ingroup DelayPoolsAPI
+/// A class 6 delay pool: class 4 aggregate, network, individual, and user
+/// limits, enforced across all SMP workers. Buckets live in shared memory
+/// (\see SharedDelayBuckets) and are refilled when used rather than by the
+/// periodic DelayPools::Update() event. Network buckets are keyed by
+/// delay_ipv4_network_bits and delay_ipv6_network_bits client prefixes;
+/// individual buckets are keyed by the full client address.
+class DelayShared : public CompositePoolNode
+{
+    MEMPROXY_CLASS(DelayShared);
+
+public:
+    typedef RefCount<DelayShared> Pointer;
+
+    /// bucket levels, in delay_parameters order
+    typedef enum {
+        levelAggregate,
+        levelNetwork,
+        levelIndividual,
+        levelUser,
+        levelEnd
+    } Level;
+
+    /// \param pool the zero-based delay pool number, for bucket keys
+    explicit DelayShared(unsigned short pool);
+    ~DelayShared() override;
+
+    /* CompositePoolNode API */
+    void stats(StoreEntry * sentry) override;
+    void dump(StoreEntry *entry) const override;
+    void update(int incr) override;
+    void parse() override;
+    DelayIdComposite::Pointer id(CompositeSelectionDetails &) override;
+
+    /// the shared buckets of all class 6 pools (if any are configured)
+    static SharedDelayBuckets *Buckets;
+
+private:
+    /// \ingroup DelayPoolsInternal
+    class Id:public DelayIdComposite
+    {
+        MEMPROXY_CLASS(DelayShared::Id);
+
+    public:
+        Id(const DelayShared::Pointer &, CompositeSelectionDetails &);
+        int bytesWanted (int min, int max) const override;
+        void bytesIn(int qty) override;
+        void delayRead(const AsyncCallPointer &) override;
+
+    private:
+        void setKey(Level, const void *data, size_t size);
+        uint32_t bucketAt(Level, SharedDelayBuckets::Microseconds now) const;
+
+        DelayShared::Pointer thePool;
+        /// bucket keys for each level; zero for unlimited levels
+        SharedDelayBuckets::Key keys[levelEnd];
+        /// cached bucket positions; rechecked because buckets may be reused
+        mutable uint32_t indices[levelEnd];
+    };
+
+    /// the bucket parameters for the given level
+    SharedDelayBuckets::Rate rate(Level) const;
+
+    /// whether the given level limits traffic
+    bool limits(const Level level) const { return specs[level].restore_bps != -1; }
+
+    static SharedDelayBuckets::Microseconds Now();
+
+    unsigned short poolNumber; ///< zero-based delay pool number
+    DelaySpec specs[levelEnd]; ///< configured limits for each level
+};
+
+#endif /* USE_DELAY_POOLS */
+#endif /* SQUID_DELAYSHARED_H */
+
@@ -14,6 +14,7 @@
 #include "ClientRequestContext.h"
 #include "Downloader.h"
 #include "fatal.h"
+#include "HttpHdrCc.h"
 #include "http/one/RequestParser.h"
 #include "http/Stream.h"
 
@@ -152,6 +153,13 @@ Downloader::buildRequest()
     request->my_addr.port(0);
     request->downloader = this;
 
+    if (revalidateOnly_) {
+        // make refreshCheckHTTP() treat any cached response as stale
+        HttpHdrCc cc;
+        cc.maxAge(0);
+        request->putCc(cc);
+    }
+
     debugs(11, 2, "HTTP Client Downloader " << this << "/" << id);
     debugs(11, 2, "HTTP Client REQUEST:\n---------\n" <<
            request->method << " " << url_ << " " << request->http_ver << "\n" <<
@@ -204,6 +212,15 @@ Downloader::handleReply(clientStreamNode * node, ClientHttpRequest *http, HttpRe
         return;
     }
 
+    if (revalidateOnly_) {
+        http->out.size += receivedData.length;
+        http->out.offset += receivedData.length;
+        // Keep reading until the end of the response: Without us, the
+        // quick_abort_* limits could abort the retrieval of an updated body.
+        handleStreamStatus(node, http);
+        return;
+    }
+
     const int64_t existingContent = reply ? reply->content_length : 0;
     const size_t maxSize = MaxObjectSize > SBuf::maxSize ? SBuf::maxSize : MaxObjectSize;
     const bool tooLarge = (existingContent > -1 && existingContent > static_cast<int64_t>(maxSize)) ||
@@ -219,6 +236,13 @@ Downloader::handleReply(clientStreamNode * node, ClientHttpRequest *http, HttpRe
     http->out.size += receivedData.length;
     http->out.offset += receivedData.length;
 
+    handleStreamStatus(node, http);
+}
+
+/// either requests more response data or finishes the download
+void
+Downloader::handleStreamStatus(clientStreamNode *node, ClientHttpRequest *http)
+{
     switch (clientStreamStatus(node, http)) {
     case STREAM_NONE: {
         debugs(33, 3, "Get more data");
@@ -58,6 +58,12 @@ public:
     /// The nested level of Downloader object (downloads inside downloads).
     unsigned int nestedLevel() const {return level_;}
 
+    /// Instead of downloading the resource, make Squid revalidate its cached
+    /// copy (if any). The response body is discarded rather than accumulated,
+    /// so MaxObjectSize does not apply, and a successful answer carries no
+    /// resource. Must be called before the job is started.
+    void revalidateOnly() { revalidateOnly_ = true; }
+
     void handleReply(clientStreamNode *, ClientHttpRequest *, HttpReply *, StoreIOBuffer);
 
 protected:
@@ -69,6 +75,7 @@ protected:
 private:
 
     bool buildRequest();
+    void handleStreamStatus(clientStreamNode *, ClientHttpRequest *);
     void callBack(Http::StatusCode const status);
 
     /// The maximum allowed object size.
@@ -81,6 +88,7 @@ private:
 
     SBuf object_; ///< the object body data
     const unsigned int level_; ///< holds the nested downloads level
+    bool revalidateOnly_ = false; ///< \copydoc revalidateOnly()
     MasterXactionPointer masterXaction_; ///< download transaction context
 
     /// Pointer to an object that stores the clientStream required info
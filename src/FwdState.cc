@@ -48,6 +48,7 @@
 #include "mgr/Registration.h"
 #include "neighbors.h"
 #include "pconn.h"
+#include "PconnWarmer.h"
 #include "PeerPoolMgr.h"
 #include "ResolvedPeers.h"
 #include "security/BlindPeerConnector.h"
@@ -877,6 +878,8 @@ FwdState::noteConnection(HappyConnOpener::Answer &answer)
         return;
     }
 
+    PconnWarmer::NoteConnectionUse(*request, answer.conn, answer.reused);
+
     if (answer.reused) {
         syncWithServerConn(answer.conn, request->url.host(), answer.reused);
         return dispatch();
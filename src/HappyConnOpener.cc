@@ -22,6 +22,8 @@
 #include "sbuf/Stream.h"
 #include "SquidConfig.h"
 
+#include <algorithm>
+
 CBDATA_CLASS_INIT(HappyConnOpener);
 
 // HappyOrderEnforcer optimizes enforcement of the "pause before opening a spare
@@ -44,9 +46,9 @@ CBDATA_CLASS_INIT(HappyConnOpener);
 //
 // This optimization is possible only where each job needs to pause for the same
 // amount of time, creating a naturally ordered list of jobs waiting to be
-// resumed. This is why two HappyOrderEnforcers are needed to efficiently honor
-// both happy_eyeballs_connect_timeout and happy_eyeballs_connect_gap
-// directives.
+// resumed. This is why three HappyOrderEnforcers are needed to efficiently
+// honor happy_eyeballs_connect_timeout, happy_eyeballs_connect_gap, and
+// happy_eyeballs_attempt_delay directives.
 
 /// Efficiently drains a FIFO HappyConnOpener queue while delaying each "pop"
 /// event by the time determined by the top element currently in the queue. Its
@@ -72,8 +74,11 @@ protected:
     virtual bool readyNow(const HappyConnOpener &) const = 0;
     virtual AsyncCall::Pointer notify(const CbcPointer<HappyConnOpener> &) = 0;
 
+    /// the job waiting state managed by this enforcer
+    virtual HappyOrderWait &waitOf(HappyConnOpener &job) const { return job.spareWaiting; }
+
     bool waiting() const { return waitEnd_ > 0; }
-    bool startedWaiting(const HappyAbsoluteTime lastStart, const int cfgTimeoutMsec) const;
+    bool startedWaiting(const HappyAbsoluteTime lastStart, const int cfgTimeoutMsec, const bool sharedByWorkers = true) const;
 
 private:
     static void NoteWaitOver(void *raw);
@@ -143,29 +148,47 @@ private:
     int concurrencyLevel = 0;
 };
 
+/// enforces happy_eyeballs_attempt_delay
+class AttemptStaggerer: public HappyOrderEnforcer
+{
+public:
+    AttemptStaggerer(): HappyOrderEnforcer("happy_eyeballs_attempt_delay enforcement") {}
+
+    /* HappyOrderEnforcer API */
+    bool readyNow(const HappyConnOpener &job) const override;
+
+private:
+    /* HappyOrderEnforcer API */
+    AsyncCall::Pointer notify(const CbcPointer<HappyConnOpener> &) override;
+    HappyOrderWait &waitOf(HappyConnOpener &job) const override { return job.staggerWaiting; }
+};
+
 PrimeChanceGiver ThePrimeChanceGiver;
 SpareAllowanceGiver TheSpareAllowanceGiver;
+AttemptStaggerer TheAttemptStaggerer;
 
 /* HappyOrderEnforcer */
 
 void
 HappyOrderEnforcer::enqueue(HappyConnOpener &job)
 {
-    Must(!job.spareWaiting.callback);
+    auto &wait = waitOf(job);
+    Must(!wait.callback);
     jobs_.emplace_back(&job);
-    job.spareWaiting.position = std::prev(jobs_.end());
-    job.spareWaiting.codeContext = CodeContext::Current();
+    wait.position = std::prev(jobs_.end());
+    wait.codeContext = CodeContext::Current();
 }
 
 void
 HappyOrderEnforcer::dequeue(HappyConnOpener &job)
 {
-    if (job.spareWaiting.callback) {
-        job.spareWaiting.callback->cancel("HappyOrderEnforcer::dequeue");
-        job.spareWaiting.callback = nullptr;
+    auto &wait = waitOf(job);
+    if (wait.callback) {
+        wait.callback->cancel("HappyOrderEnforcer::dequeue");
+        wait.callback = nullptr;
     } else {
         Must(!jobs_.empty());
-        jobs_.erase(job.spareWaiting.position);
+        jobs_.erase(wait.position);
     }
 }
 
@@ -177,16 +200,19 @@ HappyOrderEnforcer::checkpoint()
             auto &job = *jobPtr;
             if (!readyNow(job))
                 break; // the next job cannot be ready earlier (FIFO)
-            CallBack(job.spareWaiting.codeContext, [&] {
-                job.spareWaiting.callback = notify(jobPtr); // and fall through to the next job
+            auto &wait = waitOf(job);
+            CallBack(wait.codeContext, [&] {
+                wait.callback = notify(jobPtr); // and fall through to the next job
             });
         }
         jobs_.pop_front();
     }
 }
 
+/// \param sharedByWorkers whether the configured timeout limits the
+/// aggregated load of all SMP workers rather than individual jobs
 bool
-HappyOrderEnforcer::startedWaiting(const HappyAbsoluteTime lastStart, const int cfgTimeoutMsec) const
+HappyOrderEnforcer::startedWaiting(const HappyAbsoluteTime lastStart, const int cfgTimeoutMsec, const bool sharedByWorkers) const
 {
     // Normally, the job would not even be queued if there is no timeout. This
     // check handles reconfiguration that happened after this job was queued.
@@ -195,7 +221,8 @@ HappyOrderEnforcer::startedWaiting(const HappyAbsoluteTime lastStart, const int
 
     // convert to seconds and adjust for SMP workers to keep aggregated load in
     // check despite the lack of coordination among workers
-    const auto tout = static_cast<HappyAbsoluteTime>(cfgTimeoutMsec) * Config.workers / 1000.0;
+    const auto workers = sharedByWorkers ? Config.workers : 1;
+    const auto tout = static_cast<HappyAbsoluteTime>(cfgTimeoutMsec) * workers / 1000.0;
     const auto newWaitEnd = std::min(lastStart, current_dtime) + tout;
     if (newWaitEnd <= current_dtime)
         return false; // no need to wait
@@ -314,6 +341,25 @@ SpareAllowanceGiver::concurrencyLimitReached() const
     return aggregateLevel >= Config.happyEyeballs.connect_limit;
 }
 
+/* AttemptStaggerer */
+
+bool
+AttemptStaggerer::readyNow(const HappyConnOpener &job) const
+{
+    // The delay is a property of individual master transactions. A queued job
+    // may have started its last attempt long before it was queued (e.g., while
+    // waiting for more paths), but the jobs queued after it must not become
+    // ready before it does (FIFO).
+    const auto lastStart = job.staggerWaiting ? job.staggerWaiting.since : job.lastAttemptStart;
+    return !startedWaiting(lastStart, Config.happyEyeballs.attempt_delay, false);
+}
+
+AsyncCall::Pointer
+AttemptStaggerer::notify(const CbcPointer<HappyConnOpener> &job)
+{
+    return CallJobHere(17, 5, job, HappyConnOpener, noteAttemptDelayOver);
+}
+
 /* HappyConnOpenerAnswer */
 
 HappyConnOpenerAnswer::~HappyConnOpenerAnswer()
@@ -327,6 +373,14 @@ HappyConnOpenerAnswer::~HappyConnOpenerAnswer()
 
 /* HappyConnOpener */
 
+/// whether TCP Fast Open may be used for connections sending the request:
+/// the request is sent in a TCP SYN that the network may duplicate
+static bool
+FastOpenAllowed(const HttpRequest &request)
+{
+    return !request.body_pipe && (request.method.isHttpSafe() || request.method.isIdempotent());
+}
+
 HappyConnOpener::HappyConnOpener(const ResolvedPeers::Pointer &dests, const AsyncCallback<Answer> &callback, const HttpRequest::Pointer &request, const time_t aFwdStart, const int tries, const AccessLogEntry::Pointer &anAle):
     AsyncJob("HappyConnOpener"),
     fwdStart(aFwdStart),
@@ -373,7 +427,7 @@ HappyConnOpener::doneAll() const
     if (callback_->canceled())
         return true; // the requestor is gone or has lost interest
 
-    if (prime || spare)
+    if (prime || spare || staggering())
         return false;
 
     if (ranOutOfTimeOrAttempts())
@@ -396,6 +450,9 @@ HappyConnOpener::swanSong()
     if (spareWaiting)
         cancelSpareWait("HappyConnOpener object destructed");
 
+    if (staggerWaiting)
+        cancelStaggerWait("HappyConnOpener object destructed");
+
     // TODO: Find an automated, faster way to kill no-longer-needed jobs.
 
     if (prime) {
@@ -410,6 +467,12 @@ HappyConnOpener::swanSong()
         }
     }
 
+    for (auto &attempt: staggered) {
+        if (attempt)
+            cancelAttempt(attempt, "job finished during a staggered attempt");
+    }
+    staggered.clear();
+
     AsyncJob::swanSong();
 }
 
@@ -444,6 +507,8 @@ HappyConnOpener::status() const
         os << "prime:" << prime;
     if (spare)
         os << "spare:" << spare;
+    if (const auto count = attemptsInProgress() - (prime ? 1 : 0) - (spare ? 1 : 0))
+        os << " staggered:" << count;
     if (n_tries)
         os << " tries:" << n_tries;
     os << " dst:" << *destinations;
@@ -511,6 +576,7 @@ void
 HappyConnOpener::cancelAttempt(Attempt &attempt, const char *reason)
 {
     Must(attempt);
+    noteAttemptOutcome(attempt, "lost");
     destinations->reinstatePath(attempt.path); // before attempt.cancel() clears path
     attempt.cancel(reason);
 }
@@ -581,6 +647,9 @@ HappyConnOpener::openFreshConnection(Attempt &attempt, PeerConnectionPointer &de
     const auto conn = dest->cloneProfile();
     GetMarkingsToServer(cause.getRaw(), *conn);
 
+    if (Config.onoff.server_tcp_fastopen && FastOpenAllowed(*cause))
+        conn->flags |= COMM_FASTOPEN_CONNECT; // ignored by unsupported platforms
+
     typedef CommCbMemFunT<HappyConnOpener, CommConnectCbParams> Dialer;
     AsyncCall::Pointer callConnect = asyncCall(48, 5, attempt.callbackMethodName,
                                      Dialer(this, attempt.callbackMethod));
@@ -590,7 +659,15 @@ HappyConnOpener::openFreshConnection(Attempt &attempt, PeerConnectionPointer &de
         cs->setHost(host_);
 
     attempt.path = dest; // but not the being-opened conn!
+    attempt.opening = conn;
+    attempt.startTime = current_time;
+    lastAttemptStart = current_dtime;
     attempt.connWait.start(cs, callConnect);
+
+    // the next staggered attempt must wait for the full delay after this one;
+    // our caller will queue us again (at the end of the queue)
+    if (staggerWaiting)
+        cancelStaggerWait("started another attempt");
 }
 
 /// Comm::ConnOpener callback for the prime connection attempt
@@ -611,12 +688,30 @@ HappyConnOpener::noteSpareConnectDone(const CommConnectCbParams &params)
     handleConnOpenerAnswer(spare, params, "new spare connection");
 }
 
+/// Comm::ConnOpener callback for a staggered connection attempt
+void
+HappyConnOpener::noteStaggeredConnectDone(const CommConnectCbParams &params)
+{
+    const auto attempt = std::find_if(staggered.begin(), staggered.end(), [&params](const Attempt &candidate) {
+        return candidate.opening == params.conn;
+    });
+    Must(attempt != staggered.end());
+    handleConnOpenerAnswer(*attempt, params, "new staggered connection");
+    staggered.erase(attempt);
+}
+
 /// prime/spare-agnostic processing of a Comm::ConnOpener result
 void
 HappyConnOpener::handleConnOpenerAnswer(Attempt &attempt, const CommConnectCbParams &params, const char *what)
 {
     Must(params.conn);
 
+    noteAttemptOutcome(attempt, params.flag == Comm::OK ? "ok" : (params.flag == Comm::TIMEOUT ? "timeout" : "error"));
+
+    // A Fast Open connect(2) may succeed before the TCP handshake starts.
+    const auto measured = !(params.conn->flags & COMM_FASTOPEN_CONNECT);
+    const auto connectMsec = tvSubMsec(attempt.startTime, current_time);
+
     // finalize the previously selected path before attempt.finish() forgets it
     auto handledPath = attempt.path;
     handledPath.finalize(params.conn); // closed on errors
@@ -625,10 +720,17 @@ HappyConnOpener::handleConnOpenerAnswer(Attempt &attempt, const CommConnectCbPar
     ++n_tries;
 
     if (params.flag == Comm::OK) {
+        if (measured) {
+            if (const auto peer = params.conn->getPeer())
+                peer->noteConnectTime(connectMsec);
+            ResolvedPeers::NoteConnectOutcome(*params.conn, true, connectMsec);
+        }
         sendSuccess(handledPath, false, what);
         return;
     }
 
+    ResolvedPeers::NoteConnectOutcome(*params.conn, false, connectMsec);
+
     debugs(17, 8, what << " failed: " << params.conn);
 
     // remember the last failure (we forward it if we cannot connect anywhere)
@@ -640,7 +742,7 @@ HappyConnOpener::handleConnOpenerAnswer(Attempt &attempt, const CommConnectCbPar
 
     NoteOutgoingConnectionFailure(params.conn->getPeer(), lastError->httpStatus);
 
-    if (spareWaiting)
+    if (spareWaiting && !prime) // a prime (or staggered) attempt failure
         updateSpareWaitAfterPrimeFailure();
 
     checkForNewConnection();
@@ -701,13 +803,51 @@ HappyConnOpener::cancelSpareWait(const char *reason)
     spareWaiting.clear();
 }
 
+/// stops waiting for happy_eyeballs_attempt_delay to expire
+void
+HappyConnOpener::cancelStaggerWait(const char *reason)
+{
+    debugs(17, 5, "because " << reason);
+    Must(staggerWaiting);
+    TheAttemptStaggerer.dequeue(*this);
+    staggerWaiting.clear();
+}
+
+/// whether any of the staggered attempts is still in progress
+bool
+HappyConnOpener::staggering() const
+{
+    return std::any_of(staggered.begin(), staggered.end(), [](const Attempt &attempt) {
+        return static_cast<bool>(attempt);
+    });
+}
+
+/// the number of in-progress prime, spare, and staggered attempts
+int
+HappyConnOpener::attemptsInProgress() const
+{
+    const auto staggeredAttempts = std::count_if(staggered.begin(), staggered.end(), [](const Attempt &attempt) {
+        return static_cast<bool>(attempt);
+    });
+    return (prime ? 1 : 0) + (spare ? 1 : 0) + staggeredAttempts;
+}
+
+/// records the outcome of the given fresh connection attempt for %connect_attempts
+void
+HappyConnOpener::noteAttemptOutcome(const Attempt &attempt, const char *outcome)
+{
+    auto &log = cause->hier.connectAttempts;
+    log = ToSBuf(log, (log.isEmpty() ? "" : ","), attempt.path->remote, '/', outcome, '/',
+                 tvSubMsec(attempt.startTime, current_time));
+}
+
 /** Called when an external event changes initiator interest, destinations,
- * prime, spare, or spareWaiting. Leaves HappyConnOpener in one of these
- * mutually exclusive "stable" states:
+ * prime, spare, staggered, spareWaiting, or staggerWaiting. Leaves
+ * HappyConnOpener in one of these mutually exclusive "stable" states:
  *
  * 1. Processing a single peer: currentPeer && !done()
- *    1.1. Connecting: prime || spare
- *    1.2. Waiting for spare gap and/or paths: !prime && !spare
+ *    1.1. Connecting: prime || spare || staggering()
+ *    1.2. Waiting for spare gap and/or paths: !prime && !spare && !staggering()
  * 2. Waiting for a new peer: destinations->empty() && !destinations->destinationsFinalized && !currentPeer && !done()
  * 3. Terminating: done()
  */
@@ -727,7 +867,7 @@ HappyConnOpener::checkForNewConnection()
     }
 
     // update stale currentPeer and/or stale spareWaiting
-    if (currentPeer && !spare && !prime && destinations->doneWithPeer(*currentPeer)) {
+    if (currentPeer && !spare && !prime && !staggering() && destinations->doneWithPeer(*currentPeer)) {
         debugs(17, 7, "done with peer; " << *currentPeer);
         if (spareWaiting.forNewPeer)
             cancelSpareWait("done with peer");
@@ -748,6 +888,9 @@ HappyConnOpener::checkForNewConnection()
     if (!spare && !done())
         maybeOpenSpareConnection();
 
+    if (!done())
+        maybeOpenStaggeredConnection();
+
     // any state is possible at this point
 }
 
@@ -759,6 +902,14 @@ HappyConnOpener::noteGavePrimeItsChance()
     checkForNewConnection();
 }
 
+void
+HappyConnOpener::noteAttemptDelayOver()
+{
+    Must(staggerWaiting.forAttemptDelay);
+    staggerWaiting.clear();
+    checkForNewConnection();
+}
+
 void
 HappyConnOpener::noteSpareAllowance()
 {
@@ -775,6 +926,9 @@ HappyConnOpener::noteSpareAllowance()
 
     auto dest = destinations->extractSpare(*currentPeer); // ought to succeed
     startConnecting(spare, dest);
+
+    if (!done())
+        maybeOpenStaggeredConnection(); // restart happy_eyeballs_attempt_delay wait
 }
 
 /// starts a prime connection attempt if possible or does nothing otherwise
@@ -880,6 +1034,68 @@ HappyConnOpener::maybeOpenSpareConnection()
     // wait for more spare paths or their exhaustion
 }
 
+/// Starts another connection attempt if the in-progress attempts have been
+/// running for happy_eyeballs_attempt_delay, starts waiting for that delay to
+/// expire, or does nothing.
+void
+HappyConnOpener::maybeOpenStaggeredConnection()
+{
+    if (Config.happyEyeballs.attempt_delay <= 0)
+        return; // staggering is disabled
+
+    if (staggerWaiting)
+        return; // too early
+
+    const auto inProgress = attemptsInProgress();
+    if (!inProgress)
+        return; // the prime and spare tracks start the next attempt
+
+    Must(currentPeer);
+
+    if (inProgress >= Config.happyEyeballs.attempt_limit)
+        return; // checkForNewConnection() will call us when an attempt ends
+
+    if (ranOutOfTimeOrAttempts() || n_tries + inProgress >= Config.forward_max_tries)
+        return; // too late
+
+    if (destinations->empty())
+        return; // noteCandidatesChange() will call us when paths arrive
+
+    if (!TheAttemptStaggerer.readyNow(*this)) {
+        TheAttemptStaggerer.enqueue(*this);
+        staggerWaiting.forAttemptDelay = true;
+        staggerWaiting.since = current_dtime;
+        return;
+    }
+
+    auto dest = extractStaggeredPath();
+    if (!dest)
+        return; // wait for more paths or for the in-progress attempts to end
+
+    staggered.emplace_back(&HappyConnOpener::noteStaggeredConnectDone, "HappyConnOpener::noteStaggeredConnectDone");
+    startConnecting(staggered.back(), dest);
+    if (!staggered.back()) {
+        staggered.pop_back(); // reused a persistent connection
+        return;
+    }
+
+    maybeOpenStaggeredConnection(); // start waiting before the next attempt
+}
+
+/// \returns a path for the next staggered attempt (or nil)
+PeerConnectionPointer
+HappyConnOpener::extractStaggeredPath()
+{
+    if (auto dest = destinations->extractPrime(*currentPeer))
+        return dest;
+
+    // use spares only after the spare track has obeyed spare restrictions
+    if (spare || ignoreSpareRestrictions)
+        return destinations->extractSpare(*currentPeer);
+
+    return nullptr;
+}
+
 /// Check for maximum connection tries and forwarding time restrictions
 bool
 HappyConnOpener::ranOutOfTimeOrAttempts() const
@@ -913,6 +1129,7 @@ HappyConnOpener::Attempt::finish()
 {
     connWait.finish();
     path = nullptr;
+    opening = nullptr;
 }
 
 void
@@ -920,5 +1137,6 @@ HappyConnOpener::Attempt::cancel(const char *reason)
 {
     connWait.cancel(reason);
     path = nullptr;
+    opening = nullptr;
 }
 
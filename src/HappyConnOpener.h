@@ -32,23 +32,28 @@ typedef std::list< CbcPointer<HappyConnOpener> > HappySpareWaitList;
 /// absolute time in fractional seconds; compatible with current_timed
 typedef double HappyAbsoluteTime;
 
-/// keeps track of HappyConnOpener spare track waiting state
-class HappySpareWait {
+/// keeps track of HappyConnOpener waiting for its HappyOrderEnforcer turn
+class HappyOrderWait {
 public:
-    explicit operator bool() const { return toGivePrimeItsChance || forSpareAllowance || forPrimesToFail || forNewPeer; }
-
-    /// restores default-constructed state
-    /// nullifies but does not cancel the callback
-    void clear() { *this = HappySpareWait(); }
-
     CodeContext::Pointer codeContext; ///< requestor's context
 
-    /// a pending noteGavePrimeItsChance() or noteSpareAllowance() call
+    /// a pending noteGavePrimeItsChance(), noteSpareAllowance(), or
+    /// noteAttemptDelayOver() call
     AsyncCall::Pointer callback;
 
-    /// location on the toGivePrimeItsChance or forSpareAllowance wait list
+    /// location on the HappyOrderEnforcer wait list
     /// invalidated when the callback is set
     HappySpareWaitList::iterator position;
+};
+
+/// keeps track of HappyConnOpener spare track waiting state
+class HappySpareWait: public HappyOrderWait {
+public:
+    explicit operator bool() const { return toGivePrimeItsChance || forSpareAllowance || forPrimesToFail || forNewPeer; }
+
+    /// restores default-constructed state
+    /// nullifies but does not cancel the callback
+    void clear() { *this = HappySpareWait(); }
 
     /* The following four fields represent mutually exclusive wait reasons. */
 
@@ -71,6 +76,23 @@ public:
     bool forNewPeer = false;
 };
 
+/// keeps track of HappyConnOpener waiting to start a staggered attempt
+class HappyStaggerWait: public HappyOrderWait {
+public:
+    explicit operator bool() const { return forAttemptDelay; }
+
+    /// restores default-constructed state
+    /// nullifies but does not cancel the callback
+    void clear() { *this = HappyStaggerWait(); }
+
+    /// Honoring happy_eyeballs_attempt_delay since the last attempt start.
+    bool forAttemptDelay = false;
+
+    /// When the job was queued. Queued jobs wait for the attempt delay to
+    /// expire since that time, so that they become ready in the queue order.
+    HappyAbsoluteTime since = 0;
+};
+
 /// Final result (an open connection or an error) sent to the job initiator.
 class HappyConnOpenerAnswer
 {
@@ -101,7 +123,9 @@ std::ostream &operator <<(std::ostream &, const HappyConnOpenerAnswer &);
 
 /// A TCP connection opening algorithm based on Happy Eyeballs (RFC 8305).
 /// Maintains two concurrent connection opening tracks: prime and spare.
-/// Shares ResolvedPeers list with the job initiator.
+/// With happy_eyeballs_attempt_delay, also starts staggered attempts when
+/// the in-progress attempts are slow. Shares ResolvedPeers list with the
+/// job initiator.
 class HappyConnOpener: public AsyncJob
 {
     CBDATA_CHILD(HappyConnOpener);
@@ -130,9 +154,15 @@ public:
     /// reacts to satisfying happy_eyeballs_connect_gap and happy_eyeballs_connect_limit
     void noteSpareAllowance();
 
+    /// reacts to expired happy_eyeballs_attempt_delay
+    void noteAttemptDelayOver();
+
     /// the start of the first connection attempt for the currentPeer
     HappyAbsoluteTime primeStart = 0;
 
+    /// the start of the last fresh connection attempt
+    HappyAbsoluteTime lastAttemptStart = 0;
+
 private:
     /// a connection opening attempt in progress (or falsy)
     class Attempt {
@@ -152,6 +182,12 @@ private:
 
         PeerConnectionPointer path; ///< the destination we are connecting to
 
+        /// the being-opened connection (matches the ConnOpener answer)
+        Comm::ConnectionPointer opening;
+
+        /// when we started opening a fresh connection to the path
+        struct timeval startTime = {};
+
         /// waits for a connection to the peer to be established/opened
         JobWait<Comm::ConnOpener> connWait;
 
@@ -168,6 +204,8 @@ private:
 
     void maybeOpenPrimeConnection();
     void maybeOpenSpareConnection();
+    void maybeOpenStaggeredConnection();
+    PeerConnectionPointer extractStaggeredPath();
 
     void maybeGivePrimeItsChance();
     void stopGivingPrimeItsChance();
@@ -179,6 +217,7 @@ private:
 
     void notePrimeConnectDone(const CommConnectCbParams &);
     void noteSpareConnectDone(const CommConnectCbParams &);
+    void noteStaggeredConnectDone(const CommConnectCbParams &);
     void handleConnOpenerAnswer(Attempt &, const CommConnectCbParams &, const char *connDescription);
 
     void checkForNewConnection();
@@ -186,6 +225,11 @@ private:
     void updateSpareWaitAfterPrimeFailure();
 
     void cancelSpareWait(const char *reason);
+    void cancelStaggerWait(const char *reason);
+
+    bool staggering() const;
+    int attemptsInProgress() const;
+    void noteAttemptOutcome(const Attempt &, const char *outcome);
 
     bool ranOutOfTimeOrAttempts() const;
 
@@ -209,6 +253,10 @@ private:
     /// current connection opening attempt on the spare track (if any)
     Attempt spare;
 
+    /// additional attempts started because earlier attempts were taking
+    /// longer than happy_eyeballs_attempt_delay (finished ones are falsy)
+    std::list<Attempt> staggered;
+
     /// CachePeer and IP address family of the peer we are trying to connect
     /// to now (or, if we are just waiting for paths to a new peer, nil)
     Comm::ConnectionPointer currentPeer;
@@ -217,6 +265,10 @@ private:
     HappySpareWait spareWaiting;
     friend class HappyOrderEnforcer;
 
+    /// preconditions for an attempt to open a staggered connection
+    HappyStaggerWait staggerWaiting;
+    friend class AttemptStaggerer;
+
     AccessLogEntryPointer ale; ///< transaction details
 
     ErrorState *lastError = nullptr; ///< last problem details (or nil)
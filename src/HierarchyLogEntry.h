@@ -16,6 +16,7 @@
 #include "lookup_t.h"
 #include "PingData.h"
 #include "rfc2181.h"
+#include "sbuf/SBuf.h"
 
 /// Maintains peer selection details and peer I/O stats.
 /// Here, "peer" is an origin server or CachePeer.
@@ -70,6 +71,10 @@ public:
     Comm::ConnectionPointer tcpServer; ///< TCP/IP level details of the last peer/server connection
     int64_t bodyBytesRead;  ///< number of body bytes received from the next hop or -1
 
+    /// fresh connection attempts details (for %connect_attempts); see
+    /// HappyConnOpener::noteAttemptOutcome()
+    SBuf connectAttempts;
+
 private:
     void clearPeerNotes();
 
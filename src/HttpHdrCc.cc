@@ -41,6 +41,7 @@ static LookupTable<HttpHdrCcType>::Record CcAttrs[] = {
     {"only-if-cached", HttpHdrCcType::CC_ONLY_IF_CACHED},
     {"stale-if-error", HttpHdrCcType::CC_STALE_IF_ERROR},
     {"immutable", HttpHdrCcType::CC_IMMUTABLE},
+    {"stale-while-revalidate", HttpHdrCcType::CC_STALE_WHILE_REVALIDATE},
     {"Other,", HttpHdrCcType::CC_OTHER}, /* ',' will protect from matches */
     {nullptr, HttpHdrCcType::CC_ENUM_END}
 };
@@ -172,6 +173,15 @@ HttpHdrCc::parse(const String & str)
             }
             break;
 
+        case HttpHdrCcType::CC_STALE_WHILE_REVALIDATE:
+            if (!p || !httpHeaderParseInt(p, &stale_while_revalidate) || stale_while_revalidate < 0) {
+                debugs(65, 2, "cc: invalid stale-while-revalidate specs near '" << item << "'");
+                clearStaleWhileRevalidate();
+            } else {
+                setMask(type,true);
+            }
+            break;
+
         case HttpHdrCcType::CC_PRIVATE: {
             String temp;
             if (!p)  {
@@ -303,6 +313,9 @@ HttpHdrCc::packInto(Packable * p) const
                 break;
             case HttpHdrCcType::CC_IMMUTABLE:
                 break;
+            case HttpHdrCcType::CC_STALE_WHILE_REVALIDATE:
+                p->appendf("=%d", stale_while_revalidate);
+                break;
             case HttpHdrCcType::CC_OTHER:
             case HttpHdrCcType::CC_ENUM_END:
                 // done below after the loop
@@ -32,6 +32,7 @@ enum HttpHdrCcType : unsigned char {
     CC_ONLY_IF_CACHED,
     CC_STALE_IF_ERROR,
     CC_IMMUTABLE, /* RFC 8246 */
+    CC_STALE_WHILE_REVALIDATE, /* RFC 5861 */
     CC_OTHER,
     CC_ENUM_END /* also used to mean "invalid" */
 };
@@ -53,11 +54,12 @@ public:
     static const int32_t MAX_STALE_ANY=0x7fffffff;
     static const int32_t STALE_IF_ERROR_UNKNOWN=-1; //stale_if_error is unset
     static const int32_t MIN_FRESH_UNKNOWN=-1; //min_fresh is unset
+    static const int32_t STALE_WHILE_REVALIDATE_UNKNOWN=-1; //stale_while_revalidate is unset
 
     HttpHdrCc() :
         mask(0), max_age(MAX_AGE_UNKNOWN), s_maxage(S_MAXAGE_UNKNOWN),
         max_stale(MAX_STALE_UNKNOWN), stale_if_error(STALE_IF_ERROR_UNKNOWN),
-        min_fresh(MIN_FRESH_UNKNOWN) {}
+        min_fresh(MIN_FRESH_UNKNOWN), stale_while_revalidate(STALE_WHILE_REVALIDATE_UNKNOWN) {}
 
     /// reset data-members to default state
     void clear();
@@ -156,6 +158,11 @@ public:
     void Immutable(bool v) {setMask(HttpHdrCcType::CC_IMMUTABLE,v);}
     void clearImmutable() {setMask(HttpHdrCcType::CC_IMMUTABLE,false);}
 
+    //manipulation for Cache-Control: stale-while-revalidate header
+    bool hasStaleWhileRevalidate(int32_t *val = nullptr) const { return hasDirective(HttpHdrCcType::CC_STALE_WHILE_REVALIDATE, stale_while_revalidate, val); }
+    void staleWhileRevalidate(int32_t v) {setValue(stale_while_revalidate,v,HttpHdrCcType::CC_STALE_WHILE_REVALIDATE); }
+    void clearStaleWhileRevalidate() {setValue(stale_while_revalidate,STALE_WHILE_REVALIDATE_UNKNOWN,HttpHdrCcType::CC_STALE_WHILE_REVALIDATE,false);}
+
     /// check whether the attribute value supplied by id is set
     bool isSet(HttpHdrCcType id) const {
         assert(id < HttpHdrCcType::CC_ENUM_END);
@@ -176,6 +183,7 @@ private:
     int32_t max_stale;
     int32_t stale_if_error;
     int32_t min_fresh;
+    int32_t stale_while_revalidate;
     String private_; ///< List of headers sent as value for CC:private="...". May be empty/undefined if the value is missing.
     String no_cache; ///< List of headers sent as value for CC:no-cache="...". May be empty/undefined if the value is missing.
 
@@ -0,0 +1,259 @@
+/*
+ * Copyright (C) 1996-2023 The Squid Software Foundation and contributors
+ *
+ * Squid software is distributed under GPLv2+ license and includes
+ * contributions from numerous individuals and organizations.
+ * Please see the COPYING and CONTRIBUTORS files for details.
+ */
+
+/* DEBUG: section 48    Persistent Connections */
+
+#ifndef SQUID_SRC_IDLECONNINDEX_H
+#define SQUID_SRC_IDLECONNINDEX_H
+
+#include "base/RefCount.h"
+#include "ip/Address.h"
+
+#include <cstring>
+#include <unordered_map>
+#include <utility>
+
+/// a hash of the IP address and port, for unordered containers
+inline size_t
+IdleConnAddressHash(const Ip::Address &address)
+{
+    struct in6_addr raw;
+    address.getInAddr(raw);
+    uint64_t words[2];
+    static_assert(sizeof(words) == sizeof(raw), "in6_addr fits two words");
+    memcpy(words, &raw, sizeof(words));
+    const auto h = words[0] ^ (words[1] * 0x9E3779B97F4A7C15ULL) ^ address.port();
+    return static_cast<size_t>(h ^ (h >> 29));
+}
+
+template <class Connection> class IdleConnIndex;
+
+/// IdleConnIndex bookkeeping embedded in every connection that may become
+/// idle, so that indexing a connection does not allocate memory
+template <class Connection>
+class IdleConnLinks
+{
+private:
+    friend class IdleConnIndex<Connection>;
+
+    /// the index listing the connection (or nil)
+    const IdleConnIndex<Connection> *owner = nullptr;
+
+    /// keeps the connection alive while it is listed
+    RefCount<Connection> self;
+
+    /// neighbors among all listed connections
+    Connection *newer = nullptr;
+    Connection *older = nullptr;
+
+    /// neighbors among listed connections bound to the same local IP address
+    Connection *newerLocal = nullptr;
+    Connection *olderLocal = nullptr;
+
+    /// the head of the list of connections bound to our local IP address
+    Connection **newestLocal = nullptr;
+
+    /// IdleConnIndex::id of the index that listed us last (or zero); while
+    /// that index exists, its newestLocal pointer remains valid, so that a
+    /// reused and then re-listed connection skips local address lookups
+    uint64_t indexId = 0;
+};
+
+/// Idle connections to a single destination, indexed for constant-time
+/// operations. Connections are stacked in LIFO order so that the most
+/// recently used (and least likely to be closed by the server) connection
+/// is reused first, while the oldest connection is evicted first. Each
+/// connection is also stacked with other connections bound to the same local
+/// IP address, so that lookups with a specific outgoing address do not visit
+/// connections bound to other addresses.
+///
+/// The stacks are linked through the IdleConnLinks idleLinks member of each
+/// Connection, so that push, pop, and removal operations do not allocate.
+/// Connection also has an open descriptor (the fd member) and the local
+/// address it is bound to (the local member).
+template <class Connection>
+class IdleConnIndex
+{
+public:
+    using Pointer = RefCount<Connection>;
+
+    IdleConnIndex() = default;
+    IdleConnIndex(IdleConnIndex &&) = delete; // connections point to us
+    ~IdleConnIndex() { while (popOldest()) {} }
+
+    /// adds the given connection, not listed anywhere, as the newest one
+    void push(const Pointer &);
+
+    /// Removes the newest connection that can be used for the given outgoing
+    /// address and that the usable(connection) predicate accepts.
+    /// Disregards local addresses that are "any" and zero local ports.
+    /// \returns the removed connection or nil
+    template <class Predicate>
+    Pointer popNewest(const Ip::Address &local, Predicate usable);
+
+    /// removes the oldest connection
+    /// \returns the removed connection or nil
+    Pointer popOldest();
+
+    /// removes the given connection if it is listed here
+    /// \returns whether the connection was removed
+    bool remove(const Pointer &);
+
+    size_t size() const { return count; }
+    bool empty() const { return !count; }
+
+private:
+    /// the local IP address of the connection (without its port)
+    static Ip::Address LocalKey(const Ip::Address &local) {
+        auto key = local;
+        key.port(0);
+        return key;
+    }
+
+    /// std::hash replacement for Ip::Address keys
+    class AddressHash
+    {
+    public:
+        size_t operator()(const Ip::Address &address) const { return IdleConnAddressHash(address); }
+    };
+
+    /// \returns a new unique id value
+    static uint64_t NextId() {
+        static uint64_t LastId = 0;
+        return ++LastId;
+    }
+
+    Pointer unlink(Connection &);
+
+    /// distinguishes us from other indexes, including destroyed ones
+    const uint64_t id = NextId();
+
+    Connection *newest = nullptr; ///< the most recently pushed connection
+    Connection *oldest = nullptr; ///< the least recently pushed connection
+
+    size_t count = 0; ///< the number of listed connections
+
+    /// The newest connection for each local IP address. Emptied entries are
+    /// kept for reuse, so that IdleConnLinks::newestLocal pointers stay valid
+    /// and a busy index does not allocate. Their number is bounded by the
+    /// number of local addresses used to connect to our destination.
+    std::unordered_map<Ip::Address, Connection*, AddressHash> newestLocal;
+};
+
+template <class Connection>
+void
+IdleConnIndex<Connection>::push(const Pointer &conn)
+{
+    auto &links = conn->idleLinks;
+    assert(!links.owner);
+    links.owner = this;
+    links.self = conn;
+    ++count;
+
+    links.newer = nullptr;
+    links.older = newest;
+    if (newest)
+        newest->idleLinks.newer = conn.getRaw();
+    newest = conn.getRaw();
+    if (!oldest)
+        oldest = conn.getRaw();
+
+    if (links.indexId != id) {
+        links.newestLocal = &newestLocal[LocalKey(conn->local)];
+        links.indexId = id;
+    }
+    auto &head = *links.newestLocal;
+    links.newerLocal = nullptr;
+    links.olderLocal = head;
+    if (head)
+        head->idleLinks.newerLocal = conn.getRaw();
+    head = conn.getRaw();
+}
+
+template <class Connection>
+template <class Predicate>
+typename IdleConnIndex<Connection>::Pointer
+IdleConnIndex<Connection>::popNewest(const Ip::Address &local, Predicate usable)
+{
+    const auto checkAddr = !local.isAnyAddr();
+    const auto checkPort = local.port() > 0;
+
+    Connection *conn = newest;
+    if (checkAddr) {
+        const auto found = newestLocal.find(LocalKey(local));
+        conn = found == newestLocal.end() ? nullptr : found->second;
+    }
+
+    // Usually, the very first candidate is usable. Unusable connections are
+    // about to be closed and removed by their (already scheduled) handlers.
+    for (; conn; conn = checkAddr ? conn->idleLinks.olderLocal : conn->idleLinks.older) {
+        if (checkPort && local.port() != conn->local.port())
+            continue;
+        if (!usable(conn->idleLinks.self))
+            continue;
+        return unlink(*conn);
+    }
+
+    return Pointer();
+}
+
+template <class Connection>
+typename IdleConnIndex<Connection>::Pointer
+IdleConnIndex<Connection>::popOldest()
+{
+    return oldest ? unlink(*oldest) : Pointer();
+}
+
+template <class Connection>
+bool
+IdleConnIndex<Connection>::remove(const Pointer &conn)
+{
+    if (conn->idleLinks.owner != this)
+        return false;
+    unlink(*conn);
+    return true;
+}
+
+/// forgets the connection
+/// \returns the forgotten connection
+template <class Connection>
+typename IdleConnIndex<Connection>::Pointer
+IdleConnIndex<Connection>::unlink(Connection &conn)
+{
+    auto &links = conn.idleLinks;
+    assert(links.owner == this);
+
+    if (links.newer)
+        links.newer->idleLinks.older = links.older;
+    else
+        newest = links.older;
+
+    if (links.older)
+        links.older->idleLinks.newer = links.newer;
+    else
+        oldest = links.newer;
+
+    if (links.olderLocal)
+        links.olderLocal->idleLinks.newerLocal = links.newerLocal;
+
+    if (links.newerLocal) {
+        links.newerLocal->idleLinks.olderLocal = links.olderLocal;
+    } else {
+        assert(*links.newestLocal == &conn);
+        *links.newestLocal = links.olderLocal;
+    }
+
+    links.newer = links.older = nullptr;
+    links.newerLocal = links.olderLocal = nullptr;
+    links.owner = nullptr;
+    --count;
+
+    return std::move(links.self);
+}
+
+#endif /* SQUID_SRC_IDLECONNINDEX_H */
@@ -205,6 +205,12 @@ public:
         int32_t index = -1; ///< entry position inside the memory cache
         int64_t offset = 0; ///< bytes written/read to/from the memory cache so far
 
+        /// The last entry slice written/read to/from the memory cache (or -1).
+        /// Lets large entries grow and readers consume newly published slices
+        /// without rescanning the slice chain from its start.
+        int32_t slice = -1;
+        int64_t sliceOffset = 0; ///< entry offset of the first byte in the slice
+
         Io io = ioUndecided; ///< current I/O state
     };
     MemCache memCache; ///< current [shared] memory caching state for the entry
@@ -21,6 +21,8 @@
 #include "sbuf/Stream.h"
 #include "SquidConfig.h"
 #include "SquidMath.h"
+#include "store/Admission.h"
+#include "store_digest.h"
 #include "StoreStats.h"
 #include "tools.h"
 
@@ -198,6 +200,7 @@ MemStore::init()
     Must(!map);
     map = new MemStoreMap(MapLabel);
     map->cleaner = this;
+    map->digester = storeDigestMemDigester();
 }
 
 void
@@ -248,6 +251,8 @@ MemStore::stat(StoreEntry &e) const
                 stats.dump(e);
             }
         }
+
+        map->evictionStats().dump(e);
     }
 }
 
@@ -474,9 +479,11 @@ MemStore::copyFromShm(StoreEntry &e, const sfileno index, const Ipc::StoreMapAnc
 
     // emulate the usual Store code but w/o inapplicable checks and callbacks:
 
-    Ipc::StoreMapSliceId sid = anchor.start; // optimize: remember the last sid
+    // resume from the slice we stopped at during the previous call (if any)
+    auto &memCache = e.mem_obj->memCache;
+    Ipc::StoreMapSliceId sid = memCache.slice >= 0 ? memCache.slice : anchor.start.load();
     bool wasEof = anchor.complete() && sid < 0;
-    int64_t sliceOffset = 0;
+    int64_t sliceOffset = memCache.slice >= 0 ? memCache.sliceOffset : 0;
 
     SBuf httpHeaderParsingBuffer;
     while (sid >= 0) {
@@ -529,6 +536,11 @@ MemStore::copyFromShm(StoreEntry &e, const sfileno index, const Ipc::StoreMapAnc
         }
     }
 
+    if (sid >= 0) {
+        memCache.slice = sid;
+        memCache.sliceOffset = sliceOffset;
+    }
+
     if (!wasEof) {
         debugs(20, 7, "mem-loaded " << e.mem_obj->endOffset() << '/' <<
                anchor.basics.swap_file_sz << " bytes of " << e);
@@ -640,6 +652,11 @@ MemStore::shouldCache(StoreEntry &e) const
         return false;
     }
 
+    if (!Store::Admission::AdmitToMemory(e)) {
+        debugs(20, 5, "not popular enough: " << e);
+        return false;
+    }
+
     return true;
 }
 
@@ -687,10 +704,10 @@ MemStore::copyToShm(StoreEntry &e)
     const int32_t index = e.mem_obj->memCache.index;
     assert(index >= 0);
     Ipc::StoreMapAnchor &anchor = map->writeableEntry(index);
-    lastWritingSlice = anchor.start;
+    // continue with the last slice we wrote to; large entries have long chains
+    lastWritingSlice = e.mem_obj->memCache.slice >= 0 ? e.mem_obj->memCache.slice : anchor.start.load();
 
     // fill, skip slices that are already full
-    // Optimize: remember lastWritingSlice in e.mem_obj
     while (e.mem_obj->memCache.offset < eSize) {
         Ipc::StoreMap::Slice &slice = nextAppendableSlice(
                                           e.mem_obj->memCache.index, lastWritingSlice);
@@ -698,6 +715,7 @@ MemStore::copyToShm(StoreEntry &e)
             anchor.start = lastWritingSlice;
         copyToShmSlice(e, anchor, slice);
     }
+    e.mem_obj->memCache.slice = lastWritingSlice;
 
     debugs(20, 7, "mem-cached available " << eSize << " bytes of " << e);
 }
@@ -892,6 +910,7 @@ MemStore::completeWriting(StoreEntry &e)
     debugs(20, 5, "mem-cached all " << e.mem_obj->memCache.offset << " bytes of " << e);
 
     e.mem_obj->memCache.index = -1;
+    e.mem_obj->memCache.slice = -1;
     e.mem_obj->memCache.io = MemObject::ioDone;
     map->closeForWriting(index);
 
@@ -934,6 +953,7 @@ MemStore::disconnect(StoreEntry &e)
         if (mem_obj.memCache.io == MemObject::ioWriting) {
             map->abortWriting(mem_obj.memCache.index);
             mem_obj.memCache.index = -1;
+            mem_obj.memCache.slice = -1;
             mem_obj.memCache.io = MemObject::ioDone;
             CollapsedForwarding::Broadcast(e);
             e.storeWriterDone();
@@ -941,6 +961,7 @@ MemStore::disconnect(StoreEntry &e)
             assert(mem_obj.memCache.io == MemObject::ioReading);
             map->closeForReading(mem_obj.memCache.index);
             mem_obj.memCache.index = -1;
+            mem_obj.memCache.slice = -1;
             mem_obj.memCache.io = MemObject::ioDone;
         }
     }
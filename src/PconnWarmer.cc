@@ -0,0 +1,435 @@
+/*
+ * Copyright (C) 1996-2023 The Squid Software Foundation and contributors
+ *
+ * Squid software is distributed under GPLv2+ license and includes
+ * contributions from numerous individuals and organizations.
+ * Please see the COPYING and CONTRIBUTORS files for details.
+ */
+
+/* DEBUG: section 48    Persistent Connections */
+
+#include "squid.h"
+#include "base/AsyncCallbacks.h"
+#include "base/AsyncJob.h"
+#include "base/JobWait.h"
+#include "base/RunnersRegistry.h"
+#include "comm/Connection.h"
+#include "comm/ConnOpener.h"
+#include "debug/Stream.h"
+#include "event.h"
+#include "fd.h"
+#include "fde.h"
+#include "FwdState.h"
+#include "globals.h"
+#include "HttpRequest.h"
+#include "MasterXaction.h"
+#include "mgr/Registration.h"
+#include "neighbors.h"
+#include "pconn.h"
+#include "PconnWarmer.h"
+#include "sbuf/Algorithms.h"
+#include "sbuf/Stream.h"
+#include "security/BlindPeerConnector.h"
+#include "SquidConfig.h"
+#include "Store.h"
+
+#include <algorithm>
+#include <unordered_map>
+#include <vector>
+
+namespace PconnWarmer
+{
+
+/// connection statistics of a single origin server
+class Destination
+{
+public:
+    SBuf key; ///< scheme, host, and port
+    SBuf host; ///< the origin server name (i.e. the idle pool domain)
+    Ip::Address address; ///< the last used origin server address and port
+    bool tls = false; ///< whether connections to the server are encrypted
+
+    double demand = 0; ///< aged connection use count
+    int recentUses = 0; ///< connection uses since the last maintenance
+
+    uint64_t fresh = 0; ///< newly opened connections used for forwarding
+    uint64_t reused = 0; ///< idle pool connections used for forwarding
+    uint64_t warmed = 0; ///< connections we added to the idle pool
+    uint64_t failures = 0; ///< our failed connection attempts
+    int opening = 0; ///< our connection attempts in progress
+};
+
+/// opens (and, for HTTPS origin servers, secures) a connection to an origin
+/// server and adds it to the idle pool of server connections
+class Opener: public AsyncJob
+{
+    CBDATA_CHILD(Opener);
+
+public:
+    explicit Opener(const Destination &);
+
+protected:
+    /* AsyncJob API */
+    void start() override;
+    bool doneAll() const override;
+    void swanSong() override;
+
+private:
+    void handleOpenedConnection(const CommConnectCbParams &);
+    void handleSecuredConnection(Security::EncryptorAnswer &);
+    void pushConnection(const Comm::ConnectionPointer &);
+    Destination *destination() const;
+
+    const SBuf key; ///< Destination::key
+    SBuf host; ///< Destination::host (not const because of SBuf::c_str())
+    const Ip::Address address; ///< Destination::address
+    const bool tls; ///< Destination::tls
+
+    /// a fake request for outgoing address selection and TLS negotiation
+    HttpRequest::Pointer request;
+
+    /// waits for a transport connection to the server to be established
+    JobWait<Comm::ConnOpener> transportWait;
+
+    /// waits for the established transport connection to be secured
+    JobWait<Security::BlindPeerConnector> encryptionWait;
+};
+
+} // namespace PconnWarmer
+
+/// how often demand is aged and idle connections are replenished (seconds)
+static const double MaintenancePeriod = 1.0;
+
+/// The share of demand remembered after each maintenance period. Gives
+/// connection uses a half-life of about 35 seconds.
+static const double DemandDecay = 0.98;
+
+/// destinations with lower demand are not pre-warmed
+static const double MinWarmDemand = 1.0;
+
+/// destinations with lower demand are forgotten
+static const double MinDemand = 0.01;
+
+/// the minimum number of remembered destinations (see DestinationsLimit())
+static const size_t MinDestinationsLimit = 1024;
+
+typedef std::unordered_map<SBuf, PconnWarmer::Destination> Destinations;
+
+/// remembered origin servers indexed by their Destination::key
+static Destinations TheDestinations;
+
+/// whether Maintain() is scheduled to run
+static bool MaintenanceScheduled = false;
+
+static EVH Maintain;
+static OBJH Report;
+
+/// the maximum number of remembered destinations
+static size_t
+DestinationsLimit()
+{
+    return std::max(MinDestinationsLimit, static_cast<size_t>(Config.pconnWarmup.destinations) * 64);
+}
+
+static void
+ScheduleMaintenance()
+{
+    if (MaintenanceScheduled)
+        return;
+    eventAdd("PconnWarmer::Maintain", &Maintain, nullptr, MaintenancePeriod, 0, false);
+    MaintenanceScheduled = true;
+}
+
+/// a connection to the destination with the pool key of its idle connections
+static Comm::ConnectionPointer
+DestinationConnection(const PconnWarmer::Destination &d)
+{
+    Comm::ConnectionPointer conn = new Comm::Connection;
+    conn->remote = d.address;
+    return conn;
+}
+
+/// starts opening enough connections to the destination to keep
+/// server_pconn_warmup_connections of them idle
+static void
+Warm(PconnWarmer::Destination &d)
+{
+    if (d.tls && !Config.pconnWarmup.tls)
+        return;
+
+    const auto idle = fwdPconnPool->count(DestinationConnection(d), d.host.c_str());
+    const auto missing = Config.pconnWarmup.connections - idle - d.opening;
+    debugs(48, 7, d.key << " needs " << missing << " with " << idle << " idle and " << d.opening << " opening");
+    for (int i = 0; i < missing; ++i) {
+        ++d.opening;
+        AsyncJob::Start(new PconnWarmer::Opener(d));
+    }
+}
+
+/// ages demand, forgets unpopular destinations, and pre-warms popular ones
+static void
+Maintain(void *)
+{
+    MaintenanceScheduled = false;
+
+    if (!PconnWarmer::Enabled() || shutting_down) {
+        TheDestinations.clear();
+        return;
+    }
+
+    std::vector<PconnWarmer::Destination*> candidates;
+    for (auto i = TheDestinations.begin(); i != TheDestinations.end();) {
+        auto &d = i->second;
+        d.demand = d.demand * DemandDecay + d.recentUses;
+        d.recentUses = 0;
+        if (d.demand < MinDemand && !d.opening) {
+            i = TheDestinations.erase(i);
+            continue;
+        }
+        if (d.demand >= MinWarmDemand)
+            candidates.push_back(&d);
+        ++i;
+    }
+
+    if (!TheDestinations.empty())
+        ScheduleMaintenance();
+
+    if (fdUsageHigh()) {
+        debugs(48, 3, "not enough free file descriptors to pre-warm connections");
+        return;
+    }
+
+    const auto top = std::min(candidates.size(), static_cast<size_t>(Config.pconnWarmup.destinations));
+    std::partial_sort(candidates.begin(), candidates.begin() + top, candidates.end(),
+    [](const PconnWarmer::Destination *a, const PconnWarmer::Destination *b) {
+        return a->demand > b->demand;
+    });
+    for (size_t i = 0; i < top; ++i)
+        Warm(*candidates[i]);
+}
+
+/// cache manager report on remembered destinations, busiest first
+static void
+Report(StoreEntry *e)
+{
+    std::vector<const PconnWarmer::Destination*> destinations;
+    for (const auto &i: TheDestinations)
+        destinations.push_back(&i.second);
+    std::sort(destinations.begin(), destinations.end(),
+    [](const PconnWarmer::Destination *a, const PconnWarmer::Destination *b) {
+        return a->demand > b->demand;
+    });
+
+    storeAppendPrintf(e, "Pre-warmed destinations: %d\n", Config.pconnWarmup.destinations);
+    storeAppendPrintf(e, "Idle connections per destination: %d\n\n", Config.pconnWarmup.connections);
+    storeAppendPrintf(e, "%-48s %10s %10s %10s %8s %10s %10s %6s %8s\n",
+                      "Destination", "Demand", "Fresh", "Reused", "Reuse%",
+                      "Warmed", "Failures", "Idle", "Opening");
+    for (const auto d: destinations) {
+        const auto uses = d->fresh + d->reused;
+        SBuf host(d->host);
+        storeAppendPrintf(e, "%-48s %10.2f %10" PRIu64 " %10" PRIu64 " %8.2f %10" PRIu64 " %10" PRIu64 " %6d %8d\n",
+                          SBuf(d->key).c_str(),
+                          d->demand,
+                          d->fresh,
+                          d->reused,
+                          uses ? 100.0 * d->reused / uses : 0.0,
+                          d->warmed,
+                          d->failures,
+                          fwdPconnPool->count(DestinationConnection(*d), host.c_str()),
+                          d->opening);
+    }
+}
+
+bool
+PconnWarmer::Enabled()
+{
+    return Config.pconnWarmup.destinations > 0 && Config.pconnWarmup.connections > 0 &&
+           Config.onoff.server_pconns;
+}
+
+void
+PconnWarmer::NoteConnectionUse(const HttpRequest &request, const Comm::ConnectionPointer &conn, const bool reused)
+{
+    if (!Enabled() || conn->getPeer())
+        return;
+
+    // connections for tunnels, SslBump, and pinning are never pooled
+    if (request.method == Http::METHOD_CONNECT || request.flags.sslPeek ||
+            request.flags.sslBumped || request.flags.pinned)
+        return;
+
+    const auto scheme = request.url.getScheme();
+    if (scheme != AnyP::PROTO_HTTP && scheme != AnyP::PROTO_HTTPS)
+        return;
+
+    const auto tls = (scheme == AnyP::PROTO_HTTPS);
+    const auto key = ToSBuf(scheme.image(), "://", request.url.host(), ':', conn->remote.port());
+    auto i = TheDestinations.find(key);
+    if (i == TheDestinations.end()) {
+        if (TheDestinations.size() >= DestinationsLimit()) {
+            debugs(48, 5, "too many destinations to remember " << key);
+            return;
+        }
+        i = TheDestinations.emplace(key, Destination()).first;
+        i->second.key = key;
+        i->second.host = SBuf(request.url.host());
+        i->second.tls = tls;
+    }
+
+    auto &d = i->second;
+    d.address = conn->remote; // the last used address is the likeliest to be reused
+    ++d.recentUses;
+    ++(reused ? d.reused : d.fresh);
+    debugs(48, 7, key << (reused ? " reused " : " fresh ") << conn);
+
+    ScheduleMaintenance();
+}
+
+/* PconnWarmer::Opener */
+
+CBDATA_NAMESPACED_CLASS_INIT(PconnWarmer, Opener);
+
+PconnWarmer::Opener::Opener(const Destination &d):
+    AsyncJob("PconnWarmer::Opener"),
+    key(d.key),
+    host(d.host),
+    address(d.address),
+    tls(d.tls)
+{
+}
+
+PconnWarmer::Destination *
+PconnWarmer::Opener::destination() const
+{
+    const auto i = TheDestinations.find(key);
+    return i == TheDestinations.end() ? nullptr : &i->second;
+}
+
+void
+PconnWarmer::Opener::start()
+{
+    AsyncJob::start();
+
+    const auto mx = MasterXaction::MakePortless<XactionInitiator::initOriginPool>();
+    // ErrorState, getOutgoingAddress(), and TLS negotiation require a request
+    request = new HttpRequest(Http::METHOD_OPTIONS, tls ? AnyP::PROTO_HTTPS : AnyP::PROTO_HTTP,
+                              tls ? "https" : "http", "*", mx);
+    request->url.host(host.c_str());
+    request->url.port(address.port());
+
+    Comm::ConnectionPointer conn = new Comm::Connection;
+    conn->remote = address;
+    getOutgoingAddress(request.getRaw(), conn);
+    GetMarkingsToServer(request.getRaw(), *conn);
+
+    typedef CommCbMemFunT<Opener, CommConnectCbParams> Dialer;
+    AsyncCall::Pointer callback = JobCallback(48, 5, Dialer, this, Opener::handleOpenedConnection);
+    const auto cs = new Comm::ConnOpener(conn, callback, Config.Timeout.connect);
+    transportWait.start(cs, callback);
+}
+
+bool
+PconnWarmer::Opener::doneAll() const
+{
+    return !transportWait && !encryptionWait && AsyncJob::doneAll();
+}
+
+void
+PconnWarmer::Opener::swanSong()
+{
+    // the destination may have been forgotten and learned again since start()
+    if (const auto d = destination(); d && d->opening > 0)
+        --d->opening;
+    AsyncJob::swanSong();
+}
+
+void
+PconnWarmer::Opener::handleOpenedConnection(const CommConnectCbParams &params)
+{
+    transportWait.finish();
+
+    if (params.flag != Comm::OK) {
+        debugs(48, 3, "failed to connect to " << key);
+        if (const auto d = destination())
+            ++d->failures;
+        return;
+    }
+
+    Must(params.conn != nullptr);
+
+    if (tls) {
+        // XXX: Exceptions orphan params.conn
+        const auto callback = asyncCallback(48, 4, PconnWarmer::Opener::handleSecuredConnection, this);
+        const int timeUsed = squid_curtime - params.conn->startTime();
+        // Use positive timeout when less than one second is left for conn.
+        const int timeLeft = positiveTimeout(Config.Timeout.connect - timeUsed);
+        const auto connector = new Security::BlindPeerConnector(request, params.conn, callback, nullptr, timeLeft);
+        encryptionWait.start(connector, callback);
+        return;
+    }
+
+    pushConnection(params.conn);
+}
+
+void
+PconnWarmer::Opener::handleSecuredConnection(Security::EncryptorAnswer &answer)
+{
+    encryptionWait.finish();
+
+    assert(!answer.tunneled);
+    if (answer.error.get()) {
+        assert(!answer.conn);
+        debugs(48, 3, "failed to secure a connection to " << key);
+        if (const auto d = destination())
+            ++d->failures;
+        return;
+    }
+
+    assert(answer.conn);
+
+    // The socket could get closed while our callback was queued. Sync
+    // Connection. XXX: Connection::fd may already be stale/invalid here.
+    if (answer.conn->isOpen() && fd_table[answer.conn->fd].closing()) {
+        answer.conn->noteClosure();
+        return;
+    }
+
+    pushConnection(answer.conn);
+}
+
+void
+PconnWarmer::Opener::pushConnection(const Comm::ConnectionPointer &conn)
+{
+    Must(Comm::IsConnOpen(conn));
+    if (const auto d = destination())
+        ++d->warmed;
+    debugs(48, 3, "pre-warmed " << conn << " to " << key);
+    fwdPconnPool->push(conn, host.c_str());
+}
+
+/// starts pre-warming when enabled and registers the cache manager report
+class PconnWarmerRr: public RegisteredRunner
+{
+public:
+    /* RegisteredRunner API */
+    void useConfig() override;
+    void syncConfig() override;
+};
+
+DefineRunnerRegistrator(PconnWarmerRr);
+
+void
+PconnWarmerRr::useConfig()
+{
+    Mgr::RegisterAction("pconn_warmup", "Pre-warmed Origin Server Connections", &Report, 0, 1);
+    syncConfig();
+}
+
+void
+PconnWarmerRr::syncConfig()
+{
+    if (!PconnWarmer::Enabled())
+        TheDestinations.clear(); // our Openers will notice
+}
+
@@ -0,0 +1,37 @@
+/*
+ * Copyright (C) 1996-2023 The Squid Software Foundation and contributors
+ *
+ * Squid software is distributed under GPLv2+ license and includes
+ * contributions from numerous individuals and organizations.
+ * Please see the COPYING and CONTRIBUTORS files for details.
+ */
+
+/* DEBUG: section 48    Persistent Connections */
+
+#ifndef SQUID_SRC_PCONNWARMER_H
+#define SQUID_SRC_PCONNWARMER_H
+
+#include "comm/forward.h"
+
+class HttpRequest;
+
+/// Learns which origin servers need connections most often and keeps idle
+/// connections to the busiest ones open (and, for HTTPS origin servers,
+/// TLS-encrypted) in the shared pool of server connections, so that future
+/// requests to those servers do not wait for connection establishment.
+/// Cache_peer standby pools are maintained by PeerPoolMgr instead.
+namespace PconnWarmer
+{
+
+/// whether server_pconn_warmup_destinations enables pre-warming
+bool Enabled();
+
+/// Accounts for a connection about to be used for forwarding the given
+/// request, learning origin server demand. Ignores cache_peer connections.
+/// \param reused whether the connection came from the idle connection pool
+void NoteConnectionUse(const HttpRequest &, const Comm::ConnectionPointer &, bool reused);
+
+} // namespace PconnWarmer
+
+#endif /* SQUID_SRC_PCONNWARMER_H */
+
@@ -0,0 +1,246 @@
+/*
+ * Copyright (C) 1996-2023 The Squid Software Foundation and contributors
+ *
+ * Squid software is distributed under GPLv2+ license and includes
+ * contributions from numerous individuals and organizations.
+ * Please see the COPYING and CONTRIBUTORS files for details.
+ */
+
+/* DEBUG: section 39    Peer selection hashing */
+
+#include "squid.h"
+#include "CachePeer.h"
+#include "debug/Stream.h"
+#include "neighbors.h"
+#include "PeerHashTable.h"
+#include "SquidConfig.h"
+#include "Store.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+/// the minimum number of table slots; a prime
+static const size_t MinTableSize = 65537;
+
+/// table slots per peer, for large peer groups
+static const size_t SlotsPerPeer = 100;
+
+/// marks a slot not yet claimed by any peer while the table is built
+static const uint16_t NoPeer = std::numeric_limits<uint16_t>::max();
+
+static bool
+IsPrime(const size_t n)
+{
+    if (n < 2)
+        return false;
+    for (size_t d = 2; d * d <= n; ++d) {
+        if (n % d == 0)
+            return false;
+    }
+    return true;
+}
+
+/// the smallest prime not less than n
+static size_t
+NextPrime(size_t n)
+{
+    while (!IsPrime(n))
+        ++n;
+    return n;
+}
+
+/// a name hash with good low bits (FNV-1a with a 32-bit finalizer)
+static uint32_t
+NameHash(const char *name, uint32_t seed)
+{
+    for (const char *c = name; *c; ++c) {
+        seed ^= static_cast<unsigned char>(*c);
+        seed *= 16777619U;
+    }
+    seed ^= seed >> 16;
+    seed *= 0x85ebca6bU;
+    seed ^= seed >> 13;
+    seed *= 0xc2b2ae35U;
+    seed ^= seed >> 16;
+    return seed;
+}
+
+/// spreads the bits of a CARP-style key hash before it is mapped to a slot
+static uint32_t
+MixKeyHash(uint32_t h)
+{
+    h ^= h >> 16;
+    h *= 0x7feb352dU;
+    h ^= h >> 15;
+    h *= 0x846ca68bU;
+    h ^= h >> 16;
+    return h;
+}
+
+bool
+PeerHashTable::Enabled()
+{
+    return Config.peerHash.algorithm == PeerHashAlgorithm::consistent;
+}
+
+void
+PeerHashTable::clear()
+{
+    peers.clear();
+    totalWeight = 0;
+    slots.clear();
+    slotCounts.clear();
+}
+
+void
+PeerHashTable::reset(const RawCachePeers &rawPeers)
+{
+    clear();
+
+    std::vector<CachePeer*> usable;
+    int maxWeight = 0;
+    for (const auto p: rawPeers) {
+        if (p->weight <= 0)
+            continue;
+        usable.push_back(p);
+        totalWeight += p->weight;
+        maxWeight = std::max(maxWeight, p->weight);
+    }
+
+    if (usable.empty())
+        return;
+
+    const auto peerCount = usable.size();
+    Must(peerCount < NoPeer);
+    const auto size = NextPrime(std::max(MinTableSize, peerCount * SlotsPerPeer));
+
+    // each peer visits slots in its own order: offset, offset + skip, ...
+    std::vector<size_t> offset(peerCount);
+    std::vector<size_t> skip(peerCount);
+    std::vector<size_t> visited(peerCount, 0);
+    std::vector<int> credit(peerCount, 0);
+    for (size_t i = 0; i < peerCount; ++i) {
+        offset[i] = NameHash(usable[i]->name, 2166136261U) % size;
+        skip[i] = NameHash(usable[i]->name, 0x62531965U) % (size - 1) + 1;
+    }
+
+    slots.assign(size, NoPeer);
+    slotCounts.assign(peerCount, 0);
+
+    // In every round, the heaviest peers claim one slot each while other
+    // peers accumulate weight credit to claim slots in later rounds.
+    size_t filled = 0;
+    while (filled < size) {
+        for (size_t i = 0; i < peerCount && filled < size; ++i) {
+            credit[i] += usable[i]->weight;
+            while (credit[i] >= maxWeight && filled < size) {
+                credit[i] -= maxWeight;
+                size_t slot;
+                do {
+                    slot = (offset[i] + visited[i] * skip[i]) % size;
+                    ++visited[i];
+                } while (slots[slot] != NoPeer);
+                slots[slot] = static_cast<uint16_t>(i);
+                ++slotCounts[i];
+                ++filled;
+            }
+        }
+    }
+
+    peers.assign(usable.begin(), usable.end());
+    debugs(39, 3, "distributed " << size << " slots among " << peerCount << " peers");
+}
+
+bool
+PeerHashTable::overloaded(const CachePeer &peer, int &totalPending) const
+{
+    const auto limit = Config.peerHash.loadLimit;
+    if (limit <= 0)
+        return false;
+
+    // an idle peer can always take a request; this avoids summing up loads
+    // in the common case
+    if (peer.latency.pending <= 0)
+        return false;
+
+    if (totalPending < 0) {
+        totalPending = 0;
+        for (const auto &p: peers) {
+            if (const auto peerPtr = p.get())
+                totalPending += std::max(peerPtr->latency.pending, 0);
+        }
+    }
+
+    // the peer share of all pending requests (including the new one),
+    // inflated by the configured limit
+    const auto capacity = std::ceil(limit / 100.0 * (totalPending + 1) * peer.weight / totalWeight);
+    return peer.latency.pending + 1 > capacity;
+}
+
+CachePeer *
+PeerHashTable::select(const unsigned int keyHash, PeerSelector *ps) const
+{
+    if (slots.empty())
+        return nullptr;
+
+    const auto size = slots.size();
+    auto slot = MixKeyHash(keyHash) % size;
+
+    CachePeer *fallback = nullptr; // the first usable but overloaded peer
+    int totalPending = -1; // not computed yet
+    std::vector<bool> tried; // allocated if the first candidate is rejected
+    size_t triedCount = 0;
+    for (;; slot = (slot + 1) % size) {
+        const auto index = slots[slot];
+        if (!tried.empty() && tried[index])
+            continue;
+
+        const auto p = peers[index].get();
+        if (p && peerHTTPOkay(p, ps)) {
+            if (!overloaded(*p, totalPending)) {
+                debugs(39, 3, "slot " << slot << " maps to " << *p);
+                return p;
+            }
+            debugs(39, 3, "skipping overloaded " << *p << " with " << p->latency.pending << " pending requests");
+            if (!fallback)
+                fallback = p;
+        }
+
+        if (tried.empty())
+            tried.resize(peers.size(), false);
+        tried[index] = true;
+        if (++triedCount == peers.size())
+            break;
+    }
+
+    // all usable peers are overloaded; honor the hash rather than the bound
+    if (fallback)
+        debugs(39, 3, "all peers are overloaded; using " << *fallback);
+    return fallback;
+}
+
+void
+PeerHashTable::dump(StoreEntry *sentry) const
+{
+    if (slots.empty())
+        return;
+
+    storeAppendPrintf(sentry, "\nConsistent hashing table with %zu slots, load limit %d%%:\n",
+                      slots.size(), Config.peerHash.loadLimit);
+    storeAppendPrintf(sentry, "%24s %10s %10s\n",
+                      "Hostname",
+                      "Share",
+                      "Pending");
+
+    for (size_t i = 0; i < peers.size(); ++i) {
+        const auto p = peers[i].get();
+        if (!p)
+            continue;
+        storeAppendPrintf(sentry, "%24s %10f %10d\n",
+                          p->name,
+                          static_cast<double>(slotCounts[i]) / slots.size(),
+                          p->latency.pending);
+    }
+}
+
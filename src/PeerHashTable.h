@@ -0,0 +1,74 @@
+/*
+ * Copyright (C) 1996-2023 The Squid Software Foundation and contributors
+ *
+ * Squid software is distributed under GPLv2+ license and includes
+ * contributions from numerous individuals and organizations.
+ * Please see the COPYING and CONTRIBUTORS files for details.
+ */
+
+/* DEBUG: section 39    Peer selection hashing */
+
+#ifndef SQUID_SRC_PEERHASHTABLE_H
+#define SQUID_SRC_PEERHASHTABLE_H
+
+#include "CachePeers.h"
+
+#include <vector>
+
+class PeerSelector;
+class StoreEntry;
+
+/// A consistent hashing lookup table for a group of hash-based cache_peers
+/// (e.g., carp or sourcehash parents). Each table slot names a peer; a key
+/// is mapped to a slot and, hence, to a peer in constant time. Slots are
+/// filled Maglev-style: every peer walks its own name-seeded permutation of
+/// slots, claiming free slots at a rate proportional to its weight. Adding
+/// or removing a peer remaps only a small share of keys.
+///
+/// With bounded loads, a peer with too many pending requests is skipped in
+/// favor of the peer in the next slot, so that a few popular keys cannot
+/// overload a single peer.
+class PeerHashTable
+{
+public:
+    /// whether cache_peer_hash_algorithm selects consistent hashing
+    static bool Enabled();
+
+    /// forgets the current table, if any
+    void clear();
+
+    /// (re)builds the table for the given peers with positive weights
+    void reset(const RawCachePeers &);
+
+    bool isEmpty() const { return slots.empty(); }
+
+    /// the first (in configuration order) table peer, if it is still valid
+    CachePeer *firstPeer() const { return peers.empty() ? nullptr : peers.front().get(); }
+
+    /// the usable peer responsible for the given key hash, honoring
+    /// cache_peer_hash_load_limit; nil if no peers are usable
+    CachePeer *select(unsigned int keyHash, PeerSelector *) const;
+
+    /// reports per-peer table shares and loads (for cache manager pages)
+    void dump(StoreEntry *) const;
+
+private:
+    /// Whether the peer has too many pending requests to take another one.
+    /// Computes the total number of pending requests if it is negative.
+    bool overloaded(const CachePeer &, int &totalPending) const;
+
+    /// peers in their configuration order
+    SelectedCachePeers peers;
+
+    /// the sum of peer weights
+    int totalWeight = 0;
+
+    /// indexes into peers; the table size is a prime number
+    std::vector<uint16_t> slots;
+
+    /// the number of slots owned by each peer
+    std::vector<size_t> slotCounts;
+};
+
+#endif /* SQUID_SRC_PEERHASHTABLE_H */
+
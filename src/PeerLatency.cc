@@ -0,0 +1,97 @@
+/*
+ * Copyright (C) 1996-2023 The Squid Software Foundation and contributors
+ *
+ * Squid software is distributed under GPLv2+ license and includes
+ * contributions from numerous individuals and organizations.
+ * Please see the COPYING and CONTRIBUTORS files for details.
+ */
+
+/* DEBUG: section 15    Neighbor Routines */
+
+#include "squid.h"
+#include "CachePeer.h"
+#include "debug/Stream.h"
+#include "PeerLatency.h"
+#include "time/gadgets.h"
+
+#include <algorithm>
+
+/// the number of responses sufficient to judge a latency-aware cache_peer
+static const int PeerLatencyMinSamples = 10;
+
+/// latency-aware cache_peers failing more often are ejected
+static const double PeerLatencyMaxErrorRate = 0.5;
+
+/// latency-aware cache_peers that many times slower than the median are ejected
+static const double PeerLatencyOutlierFactor = 3.0;
+
+/// the first ejection duration; doubled for each consecutive ejection
+static const time_t PeerLatencyEjectionTime = 30;
+
+/// the maximum ejection duration
+static const time_t PeerLatencyMaxEjectionTime = 5 * 60;
+
+double
+peerLatencyDelay(const CachePeer &p)
+{
+    return p.latency.connectTime + p.latency.responseTime;
+}
+
+double
+peerLatencyCost(const CachePeer &p)
+{
+    if (!p.latency.responseSamples)
+        return 0;
+
+    const auto errorPenalty = 1.0 + 4 * p.latency.errorRate;
+    return (1.0 + peerLatencyDelay(p)) * (1 + p.latency.pending) * errorPenalty / p.weight;
+}
+
+void
+peerLatencyEjectOutliers(std::vector<CachePeer *> &candidates, const size_t alreadyEjected)
+{
+    std::vector<double> delays;
+    for (const auto p: candidates) {
+        if (p->latency.responseSamples >= PeerLatencyMinSamples)
+            delays.push_back(peerLatencyDelay(*p));
+    }
+    if (delays.empty())
+        return;
+
+    // the lower median, so that the slower of two peers can be an outlier
+    const auto middle = delays.begin() + (delays.size() - 1) / 2;
+    std::nth_element(delays.begin(), middle, delays.end());
+    const auto median = *middle;
+
+    auto ejected = alreadyEjected;
+    const auto maxEjected = (candidates.size() + alreadyEjected) / 2;
+    for (auto it = candidates.begin(); it != candidates.end();) {
+        const auto p = *it;
+        if (p->latency.responseSamples < PeerLatencyMinSamples) {
+            ++it;
+            continue;
+        }
+
+        const auto delay = peerLatencyDelay(*p);
+        const auto failing = p->latency.errorRate >= PeerLatencyMaxErrorRate;
+        const auto slow = delays.size() > 1 && delay > PeerLatencyOutlierFactor * median;
+        if ((!failing && !slow) || ejected >= maxEjected) {
+            if (!failing && !slow && p->latency.errorRate < PeerLatencyMaxErrorRate / 2)
+                p->latency.consecutiveEjections = 0;
+            ++it;
+            continue;
+        }
+
+        const auto multiplier = time_t(1) << std::min(p->latency.consecutiveEjections, 4);
+        const auto duration = std::min(PeerLatencyEjectionTime * multiplier, PeerLatencyMaxEjectionTime);
+        p->latency.ejectedUntil = squid_curtime + duration;
+        ++p->latency.consecutiveEjections;
+        ++p->latency.ejections;
+        ++ejected;
+        debugs(15, DBG_IMPORTANT, "WARNING: Ejecting " << (failing ? "failing" : "slow") <<
+               " cache_peer " << *p << " for " << duration << " seconds" <<
+               Debug::Extra << "average response time: " << delay << " msec; median: " << median << " msec" <<
+               Debug::Extra << "error rate: " << (100 * p->latency.errorRate) << "%");
+        it = candidates.erase(it);
+    }
+}
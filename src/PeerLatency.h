@@ -0,0 +1,31 @@
+/*
+ * Copyright (C) 1996-2023 The Squid Software Foundation and contributors
+ *
+ * Squid software is distributed under GPLv2+ license and includes
+ * contributions from numerous individuals and organizations.
+ * Please see the COPYING and CONTRIBUTORS files for details.
+ */
+
+/* DEBUG: section 15    Neighbor Routines */
+
+#ifndef SQUID_SRC_PEERLATENCY_H
+#define SQUID_SRC_PEERLATENCY_H
+
+#include <vector>
+
+class CachePeer;
+
+/// the average time to get a response from the given cache_peer (msec)
+double peerLatencyDelay(const CachePeer &);
+
+/// the relative cost of sending the next request to the given cache_peer;
+/// peers without measurements have no cost so that they are tried soon
+double peerLatencyCost(const CachePeer &);
+
+/// Stops selecting latency-aware candidates with high error rates or with
+/// response times much higher than the median of their peers. Keeps at least
+/// half of all latency-aware cache_peers selectable.
+/// \param alreadyEjected the number of latency-aware peers ejected earlier
+void peerLatencyEjectOutliers(std::vector<CachePeer *> &candidates, size_t alreadyEjected);
+
+#endif /* SQUID_SRC_PEERLATENCY_H */
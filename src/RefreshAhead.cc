@@ -0,0 +1,164 @@
+/*
+ * Copyright (C) 1996-2023 The Squid Software Foundation and contributors
+ *
+ * Squid software is distributed under GPLv2+ license and includes
+ * contributions from numerous individuals and organizations.
+ * Please see the COPYING and CONTRIBUTORS files for details.
+ */
+
+/* DEBUG: section 22    Refresh Calculation */
+
+#include "squid.h"
+#include "base/AsyncCallbacks.h"
+#include "base/PackableStream.h"
+#include "base/RunnersRegistry.h"
+#include "Downloader.h"
+#include "HttpRequest.h"
+#include "MasterXaction.h"
+#include "MemObject.h"
+#include "mgr/Registration.h"
+#include "RefreshAhead.h"
+#include "sbuf/Algorithms.h"
+#include "SquidConfig.h"
+#include "Store.h"
+
+#include <unordered_set>
+
+namespace RefreshAhead
+{
+
+/// a single background revalidation transaction
+class Revalidation
+{
+    CBDATA_CLASS(Revalidation);
+
+public:
+    explicit Revalidation(const SBuf &anId): id(anId) {}
+
+    /// handles Downloader results; destroys this object
+    void noteAnswer(DownloaderAnswer &);
+
+    const SBuf id; ///< Store ID of the entry being revalidated
+};
+
+/// background revalidation statistics for the refresh_ahead report
+static struct {
+    uint64_t started = 0; ///< revalidations initiated
+    uint64_t succeeded = 0; ///< revalidations that received a complete response
+    uint64_t failed = 0; ///< revalidations that did not
+    uint64_t overLimit = 0; ///< revalidations not initiated due to refresh_ahead_limit
+} Stats;
+
+/// Store IDs of entries being revalidated
+static std::unordered_set<SBuf> &
+InProgress()
+{
+    static const auto ids = new std::unordered_set<SBuf>();
+    return *ids;
+}
+
+static OBJH Report;
+
+} // namespace RefreshAhead
+
+CBDATA_NAMESPACED_CLASS_INIT(RefreshAhead, Revalidation);
+
+void
+RefreshAhead::Revalidation::noteAnswer(DownloaderAnswer &answer)
+{
+    debugs(22, 3, id << ' ' << answer);
+
+    if (answer.outcome == Http::scOkay)
+        ++Stats.succeeded;
+    else
+        ++Stats.failed;
+
+    InProgress().erase(id);
+    delete this;
+}
+
+bool
+RefreshAhead::Start(const StoreEntry &entry, const HttpRequest &request)
+{
+    if (!entry.mem_obj)
+        return false;
+
+    // our internal request lacks the client headers that select a variant
+    if (request.method != Http::METHOD_GET || !entry.mem_obj->vary_headers.isEmpty()) {
+        debugs(22, 5, "cannot revalidate " << request.method << ' ' << entry);
+        return false;
+    }
+
+    if (entry.store_status != STORE_OK) {
+        debugs(22, 5, "still receiving " << entry);
+        return false;
+    }
+
+    const SBuf id(entry.mem_obj->storeId());
+    auto &ids = InProgress();
+    if (ids.find(id) != ids.end()) {
+        debugs(22, 5, "already revalidating " << id);
+        return true;
+    }
+
+    if (ids.size() >= static_cast<size_t>(Config.refreshAhead.limit)) {
+        debugs(22, 3, "refresh_ahead_limit reached; not revalidating " << id);
+        ++Stats.overLimit;
+        return false;
+    }
+
+    debugs(22, 3, "revalidating " << id << " of " << entry);
+    ids.insert(id);
+    ++Stats.started;
+
+    const auto revalidation = new Revalidation(id);
+    const auto callback = asyncCallback(22, 5, Revalidation::noteAnswer, revalidation);
+    const auto downloader = new Downloader(request.effectiveRequestUri(), callback,
+                                           MasterXaction::MakePortless<XactionInitiator::initRefreshAhead>());
+    downloader->revalidateOnly();
+    AsyncJob::Start(downloader);
+    return true;
+}
+
+bool
+RefreshAhead::StartForHit(const StoreEntry &entry, const HttpRequest &request)
+{
+    if (!request.flags.refreshAhead)
+        return true;
+
+    if (Start(entry, request))
+        return true;
+
+    // a fresh hit may be served without revalidation, but a stale one may not
+    return !request.flags.staleWhileRevalidate;
+}
+
+/// reports background revalidation statistics
+void
+RefreshAhead::Report(StoreEntry *sentry)
+{
+    PackableStream os(*sentry);
+    os << "Background revalidations (refresh_ahead_limit " << Config.refreshAhead.limit << "):\n" <<
+       "\tin progress:\t" << InProgress().size() << "\n" <<
+       "\tstarted:\t" << Stats.started << "\n" <<
+       "\tsucceeded:\t" << Stats.succeeded << "\n" <<
+       "\tfailed:\t" << Stats.failed << "\n" <<
+       "\tskipped due to the limit:\t" << Stats.overLimit << "\n";
+}
+
+/// registers the refresh_ahead cache manager report
+class RefreshAheadRr: public RegisteredRunner
+{
+public:
+    /* RegisteredRunner API */
+    void useConfig() override;
+};
+
+DefineRunnerRegistrator(RefreshAheadRr);
+
+void
+RefreshAheadRr::useConfig()
+{
+    Mgr::RegisterAction("refresh_ahead", "Background Revalidation Statistics", RefreshAhead::Report, 0, 1);
+}
+
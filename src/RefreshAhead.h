@@ -0,0 +1,40 @@
+/*
+ * Copyright (C) 1996-2023 The Squid Software Foundation and contributors
+ *
+ * Squid software is distributed under GPLv2+ license and includes
+ * contributions from numerous individuals and organizations.
+ * Please see the COPYING and CONTRIBUTORS files for details.
+ */
+
+/* DEBUG: section 22    Refresh Calculation */
+
+#ifndef SQUID_SRC_REFRESHAHEAD_H
+#define SQUID_SRC_REFRESHAHEAD_H
+
+#include "http/forward.h"
+#include "store/forward.h"
+
+/// Background revalidation of cached responses that are about to become stale
+/// (or that the origin server allows to be served stale while they are being
+/// revalidated), so that clients do not wait when a popular object expires.
+/// \sa refresh_ahead_limit and refreshCheckHTTP()
+namespace RefreshAhead
+{
+
+/// Starts revalidating the given cache hit for the given request in the
+/// background unless its revalidation is already in progress, the entry
+/// cannot be revalidated without other client request details, or the
+/// refresh_ahead_limit concurrency budget has been exhausted.
+/// \returns whether the entry is being revalidated
+bool Start(const StoreEntry &, const HttpRequest &);
+
+/// Starts the background revalidation that refreshCheckHTTP() has requested
+/// for the given cache hit (if any).
+/// \returns false for stale-while-revalidate hits that could not be
+/// revalidated in the background and, hence, must be revalidated before use
+bool StartForHit(const StoreEntry &, const HttpRequest &);
+
+} // namespace RefreshAhead
+
+#endif /* SQUID_SRC_REFRESHAHEAD_H */
+
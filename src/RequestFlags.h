@@ -52,6 +52,12 @@ public:
     bool failOnValidationError = false;
     /** reply is stale if it is a hit */
     bool staleIfHit = false;
+    /// whether a hit should trigger a background revalidation of the cached
+    /// response (see refresh_ahead_limit)
+    bool refreshAhead = false;
+    /// whether a hit is stale but may be served while it is being revalidated
+    /// in the background (RFC 5861 stale-while-revalidate)
+    bool staleWhileRevalidate = false;
     /** request to override no-cache directives
      *
      * always use noCacheHack() for reading.
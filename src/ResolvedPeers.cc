@@ -12,6 +12,94 @@
 #include "comm/ConnOpener.h"
 #include "ResolvedPeers.h"
 #include "SquidConfig.h"
+#include "time/gadgets.h"
+
+#include <map>
+
+/// connection establishment history of a peer IP address
+class PathHistory
+{
+public:
+    /// smoothed connection establishment time in milliseconds (or -1)
+    double connectTime = -1;
+
+    /// the number of consecutive failed connection attempts
+    int failures = 0;
+
+    time_t lastFailure = 0; ///< when the last connection attempt failed
+    time_t lastUpdate = 0; ///< when this history was last updated
+};
+
+/// PathHistory objects indexed by peer IP addresses (without ports)
+typedef std::map<Ip::Address, PathHistory> PathHistories;
+
+/// the maximum number of remembered PathHistories
+static const size_t MaxPathHistories = 10000;
+
+/// how long to remember a PathHistory that is not updated (seconds)
+static const time_t PathHistoryTtl = 3600;
+
+static PathHistories &
+ThePathHistories()
+{
+    static const auto histories = new PathHistories();
+    return *histories;
+}
+
+/// the ThePathHistories() key for the given path
+static Ip::Address
+PathHistoryKey(const Comm::Connection &path)
+{
+    auto key = path.remote;
+    key.port(0);
+    return key;
+}
+
+/// how long to avoid an address after the given number of consecutive
+/// connection failures (seconds)
+static time_t
+FailurePenalty(const int failures)
+{
+    return std::min<time_t>(10 << std::min(failures - 1, 5), 300);
+}
+
+/// Ranks the path using its PathHistory; smaller ranks are preferred. Paths
+/// with known connection establishment times come first (faster ones first),
+/// followed by paths without history, followed by recently failed paths
+/// (paths that failed longer ago first).
+static std::pair<int, double>
+PathRank(const Comm::Connection &path)
+{
+    const auto &histories = ThePathHistories();
+    const auto found = histories.find(PathHistoryKey(path));
+    if (found == histories.end())
+        return std::make_pair(1, 0.0);
+
+    const auto &history = found->second;
+    if (history.failures > 0 && history.lastFailure + FailurePenalty(history.failures) > squid_curtime)
+        return std::make_pair(2, static_cast<double>(history.lastFailure));
+
+    if (history.connectTime >= 0)
+        return std::make_pair(0, history.connectTime);
+
+    return std::make_pair(1, 0.0);
+}
+
+/// makes room for a new PathHistory
+static void
+ForgetOldPathHistories(PathHistories &histories)
+{
+    for (auto i = histories.begin(); i != histories.end();) {
+        if (i->second.lastUpdate + PathHistoryTtl <= squid_curtime)
+            i = histories.erase(i);
+        else
+            ++i;
+    }
+
+    // too many recently used addresses; start learning from scratch
+    if (histories.size() >= MaxPathHistories)
+        histories.clear();
+}
 
 ResolvedPeers::ResolvedPeers()
 {
@@ -107,11 +195,40 @@ ResolvedPeers::findPeer(const Comm::Connection &currentPeer)
     return makeFinding(path, foundNext);
 }
 
+/// \returns the given found path or, if path ranking is enabled, the
+/// best-ranked available path among the found path and the same-peer
+/// same-family paths that follow it
+ResolvedPeers::Paths::iterator
+ResolvedPeers::preferredPath(const Paths::iterator &found)
+{
+    if (Config.happyEyeballs.attempt_delay <= 0 || ThePathHistories().empty())
+        return found;
+
+    const auto &foundPath = *found->connection;
+    auto best = found;
+    auto bestRank = PathRank(foundPath);
+    for (auto candidate = found + 1; candidate != paths_.end(); ++candidate) {
+        if (!candidate->available)
+            continue;
+        const auto &candidatePath = *candidate->connection;
+        if (candidatePath.getPeer() != foundPath.getPeer())
+            break; // the paths of the next peer
+        if (ConnectionFamily(candidatePath) != ConnectionFamily(foundPath))
+            continue;
+        const auto rank = PathRank(candidatePath);
+        if (rank < bestRank) {
+            best = candidate;
+            bestRank = rank;
+        }
+    }
+    return best;
+}
+
 PeerConnectionPointer
 ResolvedPeers::extractFront()
 {
     Must(!empty());
-    return extractFound("first: ", start());
+    return extractFound("first: ", preferredPath(start()));
 }
 
 PeerConnectionPointer
@@ -119,7 +236,7 @@ ResolvedPeers::extractPrime(const Comm::Connection &currentPeer)
 {
     const auto found = findPrime(currentPeer).first;
     if (found != paths_.end())
-        return extractFound("same-peer same-family match: ", found);
+        return extractFound("same-peer same-family match: ", preferredPath(found));
 
     debugs(17, 7, "no same-peer same-family paths");
     return nullptr;
@@ -130,7 +247,7 @@ ResolvedPeers::extractSpare(const Comm::Connection &currentPeer)
 {
     const auto found = findSpare(currentPeer).first;
     if (found != paths_.end())
-        return extractFound("same-peer different-family match: ", found);
+        return extractFound("same-peer different-family match: ", preferredPath(found));
 
     debugs(17, 7, "no same-peer different-family paths");
     return nullptr;
@@ -193,6 +310,32 @@ ResolvedPeers::doneWithPeer(const Comm::Connection &currentPeer)
     return doneWith(findPeer(currentPeer));
 }
 
+void
+ResolvedPeers::NoteConnectOutcome(const Comm::Connection &path, const bool established, const int connectMsec)
+{
+    if (Config.happyEyeballs.attempt_delay <= 0)
+        return;
+
+    auto &histories = ThePathHistories();
+    const auto key = PathHistoryKey(path);
+    if (histories.size() >= MaxPathHistories && histories.find(key) == histories.end())
+        ForgetOldPathHistories(histories);
+
+    auto &history = histories[key];
+    history.lastUpdate = squid_curtime;
+    if (established) {
+        const auto sample = static_cast<double>(std::max(connectMsec, 0));
+        history.connectTime = (history.connectTime < 0) ? sample : (3*history.connectTime + sample)/4;
+        history.failures = 0;
+    } else {
+        if (history.failures < std::numeric_limits<int>::max())
+            ++history.failures;
+        history.lastFailure = squid_curtime;
+    }
+    debugs(17, 7, path.remote << (established ? " connected" : " failed") <<
+           "; connect time: " << history.connectTime << " failures: " << history.failures);
+}
+
 int
 ResolvedPeers::ConnectionFamily(const Comm::Connection &conn)
 {
@@ -78,6 +78,13 @@ public:
     /// the current number of candidate paths
     size_type size() const { return availablePaths; }
 
+    /// Remembers whether and how quickly a connection to the given path was
+    /// established, so that future extract*() calls can prefer faster
+    /// same-peer same-family paths to slower and recently failed ones.
+    /// Does nothing unless happy_eyeballs_attempt_delay is enabled.
+    /// \param connectMsec connection establishment time (ignored on failures)
+    static void NoteConnectOutcome(const Comm::Connection &, bool established, int connectMsec);
+
     /// whether all of the available candidate paths received from DNS
     bool destinationsFinalized = false;
 
@@ -96,6 +103,7 @@ private:
     Finding findSpare(const Comm::Connection &currentPeer);
     Finding findPrime(const Comm::Connection &currentPeer);
     Finding findPeer(const Comm::Connection &currentPeer);
+    Paths::iterator preferredPath(const Paths::iterator &found);
     PeerConnectionPointer extractFound(const char *description, const Paths::iterator &found);
     Finding makeFinding(const Paths::iterator &found, bool foundOther);
 
@@ -0,0 +1,215 @@
+/*
+ * Copyright (C) 1996-2023 The Squid Software Foundation and contributors
+ *
+ * Squid software is distributed under GPLv2+ license and includes
+ * contributions from numerous individuals and organizations.
+ * Please see the COPYING and CONTRIBUTORS files for details.
+ */
+
+/* DEBUG: section 77    Delay Pools */
+
+#include "squid.h"
+#include "debug/Stream.h"
+#include "SharedDelayBuckets.h"
+
+#include <algorithm>
+#include <limits>
+
+/// marks a slot being (re)initialized for a new key
+static const SharedDelayBuckets::Key ClaimedKey = std::numeric_limits<SharedDelayBuckets::Key>::max();
+
+static const SharedDelayBuckets::Microseconds MicrosecondsPerSecond = 1000000;
+
+SharedDelayBuckets::Microseconds
+SharedDelayBuckets::Rate::fillTime() const
+{
+    if (restoreBps <= 0)
+        return std::numeric_limits<Microseconds>::max();
+    return (std::max<int64_t>(maxBytes, 0) * MicrosecondsPerSecond + restoreBps - 1) / restoreBps;
+}
+
+SharedDelayBuckets::SharedDelayBuckets(const uint32_t aCapacity):
+    capacity_(std::max<uint32_t>(aCapacity, 1)),
+    evictions_(0),
+    recycles_(0),
+    buckets(capacity_)
+{
+}
+
+SharedDelayBuckets::Key
+SharedDelayBuckets::MakeKey(const unsigned int pool, const unsigned int level, const void *data, const size_t size)
+{
+    // FNV-1a
+    uint64_t hash = 14695981039346656037ULL;
+    const auto mix = [&hash](const void *bytes, const size_t len) {
+        const auto p = static_cast<const unsigned char *>(bytes);
+        for (size_t i = 0; i < len; ++i) {
+            hash ^= p[i];
+            hash *= 1099511628211ULL;
+        }
+    };
+    mix(&pool, sizeof(pool));
+    mix(&level, sizeof(level));
+    mix(data, size);
+
+    // FNV-1a low bits are poorly mixed for short inputs; we need them well
+    // mixed for table positions (splitmix64 finalizer)
+    hash ^= hash >> 30;
+    hash *= 0xbf58476d1ce4e5b9ULL;
+    hash ^= hash >> 27;
+    hash *= 0x94d049bb133111ebULL;
+    hash ^= hash >> 31;
+
+    // avoid our special key values
+    if (hash == 0 || hash == ClaimedKey)
+        hash = 1;
+    return hash;
+}
+
+uint32_t
+SharedDelayBuckets::find(const Key key, const Rate &rate, const Microseconds now)
+{
+    const auto probes = std::min(MaxProbes, capacity_);
+    const auto start = static_cast<uint32_t>(key % capacity_);
+
+    for (;;) {
+        auto victim = NoBucket;
+        auto victimUsed = std::numeric_limits<Microseconds>::max();
+
+        for (uint32_t probe = 0; probe < probes; ++probe) {
+            const auto index = (start + probe) % capacity_;
+            auto &b = bucket(index);
+            const auto owner = b.key.load();
+
+            if (owner == key) {
+                b.used = now;
+                return index;
+            }
+
+            if (!owner) {
+                // slots never become empty again, so the key is not further
+                if (claim(index, 0, key, rate, now))
+                    return index;
+                if (b.key.load() == key)
+                    return index; // another worker has just added our key
+                continue;
+            }
+
+            if (owner == ClaimedKey)
+                continue;
+
+            const auto used = b.used.load();
+            if (used < victimUsed) {
+                victim = index;
+                victimUsed = used;
+            }
+        }
+
+        if (victim == NoBucket)
+            return NoBucket; // all probed slots are being claimed
+
+        const auto oldKey = bucket(victim).key.load();
+        if (oldKey == ClaimedKey || oldKey == key)
+            continue; // lost a race; look again
+        if (claim(victim, oldKey, key, rate, now)) {
+            if (now - victimUsed >= std::max(rate.fillTime(), MicrosecondsPerSecond))
+                ++recycles_;
+            else
+                ++evictions_;
+            debugs(77, 7, "reused bucket " << victim << " for " << key);
+            return victim;
+        }
+        // else another worker changed the victim; look again
+    }
+}
+
+/// gives the slot at the given index to a new owner
+bool
+SharedDelayBuckets::claim(const uint32_t index, Key oldKey, const Key newKey, const Rate &rate, const Microseconds now)
+{
+    auto &b = bucket(index);
+    if (!b.key.compare_exchange_strong(oldKey, ClaimedKey))
+        return false;
+
+    b.level = std::min(rate.initialBytes, rate.maxBytes);
+    b.refilled = now;
+    b.used = now;
+    b.key = newKey;
+    return true;
+}
+
+/// adds tokens accumulated since the last refill
+void
+SharedDelayBuckets::refill(Bucket &b, const Rate &rate, const Microseconds now)
+{
+    if (rate.restoreBps <= 0)
+        return;
+
+    auto last = b.refilled.load();
+    while (now > last) {
+        const auto elapsed = now - last;
+        // the tokens that fill the bucket up, paying off any debt first
+        const auto missing = rate.maxBytes - std::min(b.level.load(), rate.maxBytes);
+        const auto fillTime = (missing * MicrosecondsPerSecond + rate.restoreBps - 1) / rate.restoreBps;
+        int64_t tokens = 0;
+        Microseconds spent = 0;
+        if (elapsed >= fillTime) {
+            tokens = missing;
+            spent = elapsed;
+        } else {
+            tokens = elapsed * rate.restoreBps / MicrosecondsPerSecond;
+            if (!tokens)
+                return; // too early; keep accumulating time
+            // the time that the whole tokens correspond to (rounded up)
+            spent = (tokens * MicrosecondsPerSecond + rate.restoreBps - 1) / rate.restoreBps;
+        }
+
+        // only the worker that advances the refill time adds tokens
+        if (b.refilled.compare_exchange_weak(last, last + spent)) {
+            auto current = b.level.load();
+            while (current < rate.maxBytes &&
+                    !b.level.compare_exchange_weak(current, std::min(current + tokens, rate.maxBytes))) {}
+            return;
+        }
+    }
+}
+
+int64_t
+SharedDelayBuckets::level(const uint32_t index, const Rate &rate, const Microseconds now)
+{
+    auto &b = bucket(index);
+    refill(b, rate, now);
+    b.used = now;
+    return b.level.load();
+}
+
+void
+SharedDelayBuckets::consume(const uint32_t index, const int64_t bytes)
+{
+    bucket(index).level -= bytes;
+}
+
+uint32_t
+SharedDelayBuckets::used() const
+{
+    uint32_t count = 0;
+    for (uint32_t i = 0; i < capacity_; ++i) {
+        const auto owner = bucket(i).key.load();
+        if (owner && owner != ClaimedKey)
+            ++count;
+    }
+    return count;
+}
+
+size_t
+SharedDelayBuckets::sharedMemorySize() const
+{
+    return SharedMemorySize(capacity_);
+}
+
+size_t
+SharedDelayBuckets::SharedMemorySize(const uint32_t capacity)
+{
+    return sizeof(SharedDelayBuckets) + std::max<uint32_t>(capacity, 1) * sizeof(Bucket);
+}
+
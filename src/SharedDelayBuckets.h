@@ -0,0 +1,114 @@
+/*
+ * Copyright (C) 1996-2023 The Squid Software Foundation and contributors
+ *
+ * Squid software is distributed under GPLv2+ license and includes
+ * contributions from numerous individuals and organizations.
+ * Please see the COPYING and CONTRIBUTORS files for details.
+ */
+
+/* DEBUG: section 77    Delay Pools */
+
+#ifndef SQUID_SHAREDDELAYBUCKETS_H
+#define SQUID_SHAREDDELAYBUCKETS_H
+
+#include "ipc/mem/FlexibleArray.h"
+
+#include <atomic>
+#include <cstdint>
+
+/// A fixed-capacity table of token buckets that SMP workers share. Buckets
+/// are found by hashing a caller-supplied key into an open-addressing table
+/// and are refilled lazily, when accessed, based on the time elapsed since
+/// their last refill; there is no periodic sweep over all buckets. Buckets
+/// that stayed idle long enough to be full again are recycled for new keys.
+///
+/// All methods may be called concurrently by several SMP workers. Token
+/// accounting uses atomic operations only; no locks are involved.
+class SharedDelayBuckets
+{
+public:
+    typedef uint64_t Key;
+    typedef int64_t Microseconds;
+
+    /// token bucket parameters of a single bucket level
+    class Rate
+    {
+    public:
+        int64_t restoreBps = 0; ///< bytes added per second
+        int64_t maxBytes = 0; ///< bucket capacity
+        int64_t initialBytes = 0; ///< the level of a new bucket
+
+        /// the time it takes to refill an empty bucket
+        Microseconds fillTime() const;
+    };
+
+    /// a shared bucket slot
+    class Bucket
+    {
+    public:
+        Bucket(): key(0), level(0), refilled(0), used(0) {}
+
+        std::atomic<Key> key; ///< bucket owner; zero for unused slots
+        std::atomic<int64_t> level; ///< available bytes (may be negative)
+        std::atomic<Microseconds> refilled; ///< the last refill time
+        std::atomic<Microseconds> used; ///< the last access time
+    };
+
+    /// an unknown/invalid bucket index
+    static constexpr uint32_t NoBucket = UINT32_MAX;
+
+    /// the maximum number of table slots examined when looking for a key
+    static constexpr uint32_t MaxProbes = 32;
+
+    explicit SharedDelayBuckets(uint32_t capacity);
+
+    /// Creates a well-mixed, non-zero bucket key.
+    /// \param pool the delay pool number
+    /// \param level the bucket level (e.g., aggregate or per-user) in the pool
+    /// \param data the level-specific bucket owner identity (e.g., user name)
+    static Key MakeKey(unsigned int pool, unsigned int level, const void *data, size_t size);
+
+    /// \returns the index of the bucket for the given key, creating (or
+    /// reusing the least recently used probed bucket) as needed
+    /// \retval NoBucket if all probed slots are being claimed by others
+    uint32_t find(Key, const Rate &, Microseconds now);
+
+    /// \returns whether the given bucket still belongs to the given key
+    bool owns(uint32_t index, Key key) const { return bucket(index).key.load() == key; }
+
+    /// refills the bucket and \returns the number of available bytes
+    int64_t level(uint32_t index, const Rate &, Microseconds now);
+
+    /// removes the given number of bytes from the bucket
+    void consume(uint32_t index, int64_t bytes);
+
+    uint32_t capacity() const { return capacity_; }
+
+    /// the number of buckets with an owner
+    uint32_t used() const;
+
+    /// the number of times a busy (i.e. not yet refilled) bucket was reused
+    uint64_t evictions() const { return evictions_.load(); }
+    /// the number of times an idle bucket was given to another key
+    uint64_t recycles() const { return recycles_.load(); }
+
+    size_t sharedMemorySize() const;
+    static size_t SharedMemorySize(uint32_t capacity);
+
+private:
+    Bucket &bucket(const uint32_t index) { return buckets[index]; }
+    const Bucket &bucket(const uint32_t index) const { return const_cast<SharedDelayBuckets*>(this)->buckets[index]; }
+
+    bool claim(uint32_t index, Key oldKey, Key newKey, const Rate &, Microseconds now);
+    void refill(Bucket &, const Rate &, Microseconds now);
+
+    const uint32_t capacity_; ///< the maximum number of buckets
+
+    std::atomic<uint64_t> evictions_; ///< reused busy buckets
+    std::atomic<uint64_t> recycles_; ///< reused idle buckets
+
+    Ipc::Mem::FlexibleArray<Bucket> buckets; ///< the table slots
+};
+
+#endif /* SQUID_SHAREDDELAYBUCKETS_H */
+
@@ -59,6 +59,9 @@ namespace AnyP
 class PortCfg;
 }
 
+/// cache_peer_hash_algorithm values
+enum class PeerHashAlgorithm { carp, consistent };
+
 namespace Store {
 class DiskConfig {
 public:
@@ -98,6 +101,11 @@ public:
     int64_t readAheadGap;
     RemovalPolicySettings *replPolicy;
     RemovalPolicySettings *memPolicy;
+
+    struct {
+        int64_t entries; ///< cache_admission_entries
+        int memMinFrequency; ///< memory_cache_min_frequency
+    } admission;
 #if USE_HTTP_VIOLATIONS
     time_t negativeTtl;
 #endif
@@ -266,6 +274,7 @@ public:
         int64_t maxObjectSize;
         int64_t minObjectSize;
         size_t maxInMemObjSize;
+        int64_t sendfileMinSize; ///< disk_hits_sendfile_min_size or 0
     } Store;
 
     struct {
@@ -334,9 +343,11 @@ public:
         int WIN32_IpAddrChangeMonitor;
         int memory_cache_first;
         int memory_cache_disk;
+        int memory_hits_zero_copy;
         int hostStrictVerify;
         int client_dst_passthru;
         int dns_mdns;
+        int server_tcp_fastopen;
 #if USE_OPENSSL
         bool logTlsServerHelloDetails;
 #endif
@@ -351,6 +362,17 @@ public:
     int forward_max_tries;
     int connect_retries;
 
+    struct {
+        PeerHashAlgorithm algorithm; ///< cache_peer_hash_algorithm
+        int loadLimit; ///< cache_peer_hash_load_limit (percent)
+    } peerHash;
+
+    struct {
+        int destinations; ///< server_pconn_warmup_destinations
+        int connections; ///< server_pconn_warmup_connections
+        int tls; ///< server_pconn_warmup_tls
+    } pconnWarmup;
+
     std::chrono::nanoseconds paranoid_hit_validation;
 
     class ACL *aclList;
@@ -479,6 +501,7 @@ public:
         time_t rewrite_period;
         size_t swapout_chunk_size;
         int rebuild_chunk_percentage;
+        int incremental;
     } digest;
 #endif
 #if USE_OPENSSL
@@ -488,6 +511,11 @@ public:
         char *ssl_engine;
         int session_ttl;
         size_t sessionCacheSize;
+        size_t certCacheSize; ///< sslproxy_cert_shared_cache_size
+        size_t originSessionCacheSize; ///< sslproxy_origin_session_cache_size
+        time_t ticketKeyLifetime; ///< sslproxy_session_ticket_key_lifetime
+        int certGenThreads; ///< sslproxy_cert_gen_threads
+        int certGenKeyPool; ///< sslproxy_cert_gen_key_pool
         char *certSignHash;
     } SSL;
 #endif
@@ -543,7 +571,15 @@ public:
         int connect_limit;
         int connect_gap;
         int connect_timeout;
+        int attempt_delay;
+        int attempt_limit;
     } happyEyeballs;
+
+    struct {
+        int limit; ///< maximum number of concurrent background revalidations
+        int hits; ///< minimum number of hits that make an entry popular
+        time_t window; ///< how long before expiration to revalidate
+    } refreshAhead;
 };
 
 extern SquidConfig Config;
@@ -63,6 +63,11 @@ public:
         } all, http, ftp, other;
     } server;
 
+    struct {
+        ByteCounter kbytes_out; ///< application data sent on TLS connections
+        ByteCounter ktls_kbytes_out; ///< the kbytes_out portion encrypted by the kernel
+    } tls;
+
     struct {
         int pkts_sent = 0;
         int queries_sent = 0;
@@ -245,6 +245,14 @@ public:
 
     swap_status_t swap_status:3;
 
+    /// whether the incremental store digest counts this entry in the shard
+    /// of its (non-shared) cache_dir; see storeDigestAddDiskEntry()
+    bool digestedOnDisk:1;
+
+    /// whether the incremental store digest counts this entry in the shard
+    /// of the (non-shared) memory cache; see storeDigestAddMemEntry()
+    bool digestedInMemory:1;
+
 public:
     static size_t inUseCount();
 
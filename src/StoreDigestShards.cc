@@ -0,0 +1,168 @@
+/*
+ * Copyright (C) 1996-2023 The Squid Software Foundation and contributors
+ *
+ * Squid software is distributed under GPLv2+ license and includes
+ * contributions from numerous individuals and organizations.
+ * Please see the COPYING and CONTRIBUTORS files for details.
+ */
+
+/* DEBUG: section 71    Store Digest Manager */
+
+#include "squid.h"
+
+#if USE_CACHE_DIGESTS
+#include "CacheDigest.h"
+#include "debug/Stream.h"
+#include "StoreDigestShards.h"
+
+#include <cstring>
+
+/// the number of bits in a counter
+static const unsigned int CounterBits = 4;
+
+/// the maximum (i.e. saturated) counter value
+static const uint32_t CounterMax = (1U << CounterBits) - 1;
+
+StoreDigestShards::StoreDigestShards(const uint32_t aShardCount, const uint64_t aCapacity, const uint8_t bpe):
+    shardCount_(aShardCount),
+    capacity_(aCapacity),
+    bitsPerEntry_(bpe),
+    maskSize_(CacheDigest::CalcMaskSize(aCapacity, bpe)),
+    words(aShardCount * maskSize_)
+{
+    assert(shardCount_ > 0 && shardCount_ <= MaxShards);
+    assert(maskSize_ > 0);
+    for (uint32_t i = 0; i < shardCount_ * maskSize_; ++i)
+        words[i] = 0;
+}
+
+size_t
+StoreDigestShards::sharedMemorySize() const
+{
+    return SharedMemorySize(shardCount_, capacity_, bitsPerEntry_);
+}
+
+size_t
+StoreDigestShards::SharedMemorySize(const uint32_t aShardCount, const uint64_t aCapacity, const uint8_t bpe)
+{
+    const size_t wordCount = static_cast<size_t>(aShardCount) * CacheDigest::CalcMaskSize(aCapacity, bpe);
+    return sizeof(StoreDigestShards) + wordCount * sizeof(Word);
+}
+
+/// mimics cacheDigestHashKey() so that exported digests work with CacheDigest
+void
+StoreDigestShards::hashKey(const cache_key *key, uint32_t bits[4]) const
+{
+    const uint32_t bitCount = maskSize_ * 8;
+    unsigned int keyWords[4];
+    /* we must memcpy to ensure alignment */
+    memcpy(keyWords, key, sizeof(keyWords));
+    for (int i = 0; i < 4; ++i)
+        bits[i] = htonl(keyWords[i]) % bitCount;
+}
+
+StoreDigestShards::Word &
+StoreDigestShards::word(const uint32_t shard, const uint32_t bit)
+{
+    assert(shard < shardCount_);
+    return words[shard * maskSize_ + bit / 8];
+}
+
+void
+StoreDigestShards::add(const uint32_t shard, const cache_key *key)
+{
+    uint32_t bits[4];
+    hashKey(key, bits);
+    for (const auto bit: bits) {
+        auto &w = word(shard, bit);
+        const auto shift = (bit % 8) * CounterBits;
+        auto value = w.load();
+        for (;;) {
+            const auto counter = (value >> shift) & CounterMax;
+            if (counter == CounterMax)
+                break; // saturated; stays set forever
+            if (w.compare_exchange_weak(value, value + (1U << shift))) {
+                if (counter + 1 == CounterMax)
+                    ++stats_[shard].saturations;
+                break;
+            }
+        }
+    }
+    ++stats_[shard].entries;
+    ++stats_[shard].additions;
+}
+
+void
+StoreDigestShards::remove(const uint32_t shard, const cache_key *key)
+{
+    uint32_t bits[4];
+    hashKey(key, bits);
+    for (const auto bit: bits) {
+        auto &w = word(shard, bit);
+        const auto shift = (bit % 8) * CounterBits;
+        auto value = w.load();
+        for (;;) {
+            const auto counter = (value >> shift) & CounterMax;
+            if (counter == CounterMax)
+                break; // saturated counters may count other keys
+            if (!counter) {
+                ++stats_[shard].underflows;
+                debugs(71, DBG_IMPORTANT, "ERROR: Squid BUG: removing a key missing from store digest shard " << shard);
+                break;
+            }
+            if (w.compare_exchange_weak(value, value - (1U << shift)))
+                break;
+        }
+    }
+    --stats_[shard].entries;
+    ++stats_[shard].removals;
+}
+
+bool
+StoreDigestShards::contains(const cache_key *key) const
+{
+    uint32_t bits[4];
+    hashKey(key, bits);
+    for (const auto bit: bits) {
+        const auto shift = (bit % 8) * CounterBits;
+        bool found = false;
+        for (uint32_t shard = 0; shard < shardCount_ && !found; ++shard)
+            found = (word(shard, bit).load() >> shift) & CounterMax;
+        if (!found)
+            return false;
+    }
+    return true;
+}
+
+void
+StoreDigestShards::exportMask(char *mask, const uint32_t offset, const uint32_t size) const
+{
+    assert(offset <= maskSize_ && size <= maskSize_ - offset);
+    for (uint32_t byte = offset; byte < offset + size; ++byte) {
+        uint32_t nonZero = 0;
+        for (uint32_t shard = 0; shard < shardCount_; ++shard) {
+            // set the lowest bit of each non-zero 4-bit counter
+            auto value = word(shard, byte * 8).load();
+            value |= value >> 1;
+            value |= value >> 2;
+            nonZero |= value & 0x11111111;
+        }
+        // gather the lowest counter bits into one byte, in counter order
+        nonZero = (nonZero | nonZero >> 3) & 0x03030303;
+        nonZero = (nonZero | nonZero >> 6) & 0x000F000F;
+        nonZero = (nonZero | nonZero >> 12) & 0xFF;
+        mask[byte] = static_cast<char>(nonZero);
+    }
+}
+
+uint64_t
+StoreDigestShards::entries() const
+{
+    int64_t total = 0;
+    for (uint32_t shard = 0; shard < shardCount_; ++shard)
+        total += stats_[shard].entries.load();
+    return total > 0 ? total : 0;
+}
+
+#endif /* USE_CACHE_DIGESTS */
+
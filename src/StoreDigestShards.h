@@ -0,0 +1,103 @@
+/*
+ * Copyright (C) 1996-2023 The Squid Software Foundation and contributors
+ *
+ * Squid software is distributed under GPLv2+ license and includes
+ * contributions from numerous individuals and organizations.
+ * Please see the COPYING and CONTRIBUTORS files for details.
+ */
+
+/* DEBUG: section 71    Store Digest Manager */
+
+#ifndef SQUID_STOREDIGESTSHARDS_H
+#define SQUID_STOREDIGESTSHARDS_H
+
+#include "ipc/mem/FlexibleArray.h"
+#include "store_key_md5.h"
+
+#include <atomic>
+#include <cstdint>
+
+/// Counting Bloom filters (a.k.a. shards) with Cache Digest geometry, one
+/// per cache_dir plus one for the memory cache. Shards are updated as entries
+/// are cached and evicted, without periodic rebuilds. Each exported Cache
+/// Digest bit is set if any shard counts at least one key hashed to that bit,
+/// so the shards of all caches can be merged on demand.
+///
+/// Every Cache Digest bit has a 4-bit counter in each shard. A counter that
+/// reaches its maximum value is never decremented again (i.e. it saturates).
+///
+/// All methods may be called concurrently by several SMP kids. Counters use
+/// atomic operations only; no locks are involved.
+class StoreDigestShards
+{
+public:
+    /// the maximum number of shards
+    static const uint32_t MaxShards = 128;
+
+    /// approximate statistics of a single shard
+    class Stats
+    {
+    public:
+        Stats(): entries(0), additions(0), removals(0), saturations(0), underflows(0) {}
+
+        std::atomic<int64_t> entries; ///< currently counted entries
+        std::atomic<uint64_t> additions; ///< add() calls
+        std::atomic<uint64_t> removals; ///< remove() calls
+        std::atomic<uint64_t> saturations; ///< counters that reached their maximum
+        std::atomic<uint64_t> underflows; ///< decrements of zero counters (bugs)
+    };
+
+    StoreDigestShards(uint32_t shardCount, uint64_t capacity, uint8_t bitsPerEntry);
+
+    /// counts the key in the given shard
+    void add(uint32_t shard, const cache_key *);
+
+    /// stops counting the previously add()ed key in the given shard
+    void remove(uint32_t shard, const cache_key *);
+
+    /// whether any shard counts the given key (or its false positives)
+    bool contains(const cache_key *) const;
+
+    /// Sets the Cache Digest mask bytes [offset, offset + size) to match the
+    /// union of all shards. The mask must have maskSize() bytes.
+    void exportMask(char *mask, uint32_t offset, uint32_t size) const;
+
+    uint32_t shardCount() const { return shardCount_; }
+    /// the exported Cache Digest capacity
+    uint64_t capacity() const { return capacity_; }
+    /// the exported Cache Digest bits_per_entry
+    uint8_t bitsPerEntry() const { return bitsPerEntry_; }
+    /// the exported Cache Digest mask size in bytes
+    uint32_t maskSize() const { return maskSize_; }
+
+    const Stats &stats(const uint32_t shard) const { return stats_[shard]; }
+
+    /// the number of entries counted by all shards
+    uint64_t entries() const;
+
+    size_t sharedMemorySize() const;
+    static size_t SharedMemorySize(uint32_t shardCount, uint64_t capacity, uint8_t bitsPerEntry);
+
+private:
+    /// eight 4-bit counters for eight consecutive Cache Digest bits
+    typedef std::atomic<uint32_t> Word;
+
+    /// the positions of the Cache Digest bits for the given key
+    void hashKey(const cache_key *, uint32_t bits[4]) const;
+
+    Word &word(uint32_t shard, uint32_t bit);
+    const Word &word(const uint32_t shard, const uint32_t bit) const { return const_cast<StoreDigestShards*>(this)->word(shard, bit); }
+
+    const uint32_t shardCount_;
+    const uint64_t capacity_;
+    const uint8_t bitsPerEntry_;
+    const uint32_t maskSize_;
+
+    Stats stats_[MaxShards];
+
+    /// maskSize_ counter words for each shard, shard after shard
+    Ipc::Mem::FlexibleArray<Word> words;
+};
+
+#endif /* SQUID_STOREDIGESTSHARDS_H */
+
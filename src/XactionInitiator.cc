@@ -33,6 +33,8 @@ XactionInitiator::ParseInitiators(const char *name)
         {"adaptation", initAdaptation},
         {"icon", initIcon},
         {"peer-mcast", initPeerMcast},
+        {"refresh-ahead", initRefreshAhead},
+        {"origin-pool", initOriginPool},
         {"internal", InternalInitiators()},
         {"all", AllInitiators()}
     };
@@ -29,6 +29,8 @@ public:
         initIcon = 1 << 11, ///< internal icons
         initPeerMcast = 1 << 12, ///< neighbor multicast
         initServer = 1 << 13, ///< HTTP/2 push request (not yet supported by Squid)
+        initRefreshAhead = 1 << 14, ///< background revalidation of cached responses
+        initOriginPool = 1 << 15, ///< pre-warming of idle origin server connections
 
         initAdaptationOrphan_ = 1 << 31 ///< eCAP-created HTTP message w/o an associated HTTP transaction (not ACL-detectable)
     };
@@ -48,7 +50,7 @@ public:
 
     /// internally generated requests
     static Initiators InternalInitiators() {
-        return initPeerPool | initCertFetcher | initEsi | initCacheDigest | initIcp | initIcmp | initIpc | initAdaptation | initIcon | initPeerMcast;
+        return initPeerPool | initCertFetcher | initEsi | initCacheDigest | initIcp | initIcmp | initIpc | initAdaptation | initIcon | initPeerMcast | initRefreshAhead | initOriginPool;
     }
 
     /// all initiators
@@ -30,6 +30,8 @@ int Adaptation::Config::service_iteration_limit = 16;
 int Adaptation::Config::send_client_ip = false;
 int Adaptation::Config::send_username = false;
 int Adaptation::Config::use_indirect_client = true;
+time_t Adaptation::Config::verdict_cache_ttl = 0;
+size_t Adaptation::Config::verdict_cache_size = 1024*1024;
 static const char *protectedFieldNamesRaw[] = {
     "Allow",
     "Date",
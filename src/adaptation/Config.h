@@ -47,6 +47,8 @@ public:
     static int send_client_ip;
     static int send_username;
     static int use_indirect_client;
+    static time_t verdict_cache_ttl;
+    static size_t verdict_cache_size;
 
     // Options below are accessed via Icap::TheConfig or Ecap::TheConfig
     // TODO: move ICAP-specific options to Icap::Config and add TheConfig
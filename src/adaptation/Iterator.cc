@@ -15,6 +15,7 @@
 #include "adaptation/Service.h"
 #include "adaptation/ServiceFilter.h"
 #include "adaptation/ServiceGroups.h"
+#include "adaptation/VerdictCache.h"
 #include "base/TextException.h"
 #include "HttpReply.h"
 #include "sbuf/StringConvert.h"
@@ -105,6 +106,16 @@ void Adaptation::Iterator::step()
         ah->recordAdaptationService(uid);
     }
 
+    // RESPMOD services need not see responses they have approved before
+    if (const auto reply = dynamic_cast<const HttpReply*>(theMsg)) {
+        if (theCause && VerdictCache::Approved(*service, *theCause, *reply)) {
+            debugs(93,3, "skipping " << service->cfg().key << " that approved this response earlier");
+            thePlan.next(filter());
+            step();
+            return;
+        }
+    }
+
     theLauncher = initiateAdaptation(
                       service->makeXactLauncher(theMsg, theCause, al));
     Must(initiated(theLauncher));
@@ -15,6 +15,7 @@
 #include "adaptation/ServiceConfig.h"
 #include "base/RefCount.h"
 #include "http/forward.h"
+#include "sbuf/SBuf.h"
 #include "SquidString.h"
 
 // TODO: Move src/ICAP/ICAPServiceRep.h API comments here and update them
@@ -48,6 +49,14 @@ public:
     // called by transactions to report service failure
     virtual void noteFailure() = 0;
 
+    /// identifies the service state that cached verdicts depend on (e.g., an
+    /// ICAP ISTag); a changed tag invalidates them \sa Adaptation::VerdictCache
+    virtual SBuf verdictTag() const { return SBuf(); }
+
+    /// the maximum lifetime (in seconds) of verdicts cached now or,
+    /// if the service does not limit verdict caching, a negative value
+    virtual time_t verdictTtl() const { return -1; }
+
     const ServiceConfig &cfg() const { return *theConfig; }
 
     virtual void finalize(); // called after creation
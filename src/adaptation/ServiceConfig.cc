@@ -19,7 +19,7 @@
 
 Adaptation::ServiceConfig::ServiceConfig():
     port(-1), method(methodNone), point(pointNone),
-    bypass(false), maxConn(-1), onOverload(srvWait),
+    bypass(false), maxConn(-1), standby(0), onOverload(srvWait),
     routing(false), ipv6(false)
 {}
 
@@ -136,6 +136,8 @@ Adaptation::ServiceConfig::parse()
                 debugs(3, DBG_PARSE_NOTE(DBG_IMPORTANT), "WARNING: IPv6 is disabled. ICAP service option ignored.");
         } else if (strcmp(name, "max-conn") == 0)
             grokked = grokLong(maxConn, name, value);
+        else if (strcmp(name, "standby") == 0)
+            grokked = grokLong(standby, name, value);
         else if (strcmp(name, "on-overload") == 0) {
             grokked = grokOnOverload(onOverload, value);
             onOverloadSet = true;
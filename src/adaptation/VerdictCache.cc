@@ -0,0 +1,214 @@
+/*
+ * Copyright (C) 1996-2023 The Squid Software Foundation and contributors
+ *
+ * Squid software is distributed under GPLv2+ license and includes
+ * contributions from numerous individuals and organizations.
+ * Please see the COPYING and CONTRIBUTORS files for details.
+ */
+
+/* DEBUG: section 93    Adaptation */
+
+#include "squid.h"
+#include "adaptation/Config.h"
+#include "adaptation/Service.h"
+#include "adaptation/VerdictCache.h"
+#include "base/ClpMap.h"
+#include "base/PackableStream.h"
+#include "base/RunnersRegistry.h"
+#include "HttpReply.h"
+#include "HttpRequest.h"
+#include "mgr/Registration.h"
+#include "sbuf/Algorithms.h"
+#include "sbuf/SBuf.h"
+#include "sbuf/Stream.h"
+#include "Store.h"
+
+#include <algorithm>
+#include <ostream>
+
+namespace Adaptation
+{
+namespace VerdictCache
+{
+
+/// the memory used by a cached verdict
+static uint64_t
+MemoryUsedByVerdict(const SBuf &tag)
+{
+    return sizeof(tag) + tag.length();
+}
+
+/// cached service approvals, indexed by service and response identities;
+/// a value is the service state tag in effect when the approval was given
+using Approvals = ClpMap<SBuf, SBuf, MemoryUsedByVerdict>;
+
+/// this worker verdict cache (if enabled)
+static Approvals *TheApprovals = nullptr;
+
+/// this worker statistics for the adaptation_verdicts report
+static struct {
+    uint64_t hits = 0; ///< skipped adaptations
+    uint64_t misses = 0; ///< adaptations without a cached verdict
+    uint64_t stale = 0; ///< verdicts invalidated by service state changes
+    uint64_t stores = 0; ///< cached verdicts
+    uint64_t uncacheable = 0; ///< responses without validators
+} Stats;
+
+static OBJH ReportAction;
+
+/// Computes the cache key for the service verdict on the given response.
+/// \returns an empty key for responses that cannot be identified reliably
+static SBuf
+MakeKey(const Service &service, HttpRequest &request, const HttpReply &reply)
+{
+    if (reply.sline.status() != Http::scOkay)
+        return SBuf();
+
+    const auto etag = reply.header.getStr(Http::HdrType::ETAG);
+    if (!etag && reply.last_modified < 0)
+        return SBuf(); // no validators to detect content changes
+
+    SBufStream key;
+    key << service.cfg().key << ' ' << request.method << ' ' << request.storeId() << ' ';
+    if (etag)
+        key << "etag=" << etag;
+    else
+        key << "lm=" << reply.last_modified;
+    key << " cl=" << reply.content_length;
+    return key.buf();
+}
+
+} // namespace VerdictCache
+} // namespace Adaptation
+
+bool
+Adaptation::VerdictCache::Approved(const Service &service, HttpRequest &request, const HttpReply &reply)
+{
+    if (!TheApprovals)
+        return false;
+
+    const auto key = MakeKey(service, request, reply);
+    if (key.isEmpty()) {
+        ++Stats.uncacheable;
+        return false;
+    }
+
+    const auto tag = TheApprovals->get(key);
+    if (!tag) {
+        ++Stats.misses;
+        return false;
+    }
+
+    if (*tag != service.verdictTag()) {
+        debugs(93, 5, "service state changed since " << key << " approval");
+        TheApprovals->del(key);
+        ++Stats.stale;
+        return false;
+    }
+
+    debugs(93, 5, "cached approval: " << key);
+    ++Stats.hits;
+    return true;
+}
+
+void
+Adaptation::VerdictCache::NoteApproval(const Service &service, HttpRequest &request, const HttpReply &reply)
+{
+    if (!TheApprovals)
+        return;
+
+    const auto key = MakeKey(service, request, reply);
+    if (key.isEmpty())
+        return;
+
+    auto ttl = Config::verdict_cache_ttl;
+    const auto serviceTtl = service.verdictTtl();
+    if (serviceTtl >= 0)
+        ttl = std::min(ttl, serviceTtl);
+    if (ttl <= 0)
+        return;
+
+    if (TheApprovals->add(key, service.verdictTag(), static_cast<Approvals::Ttl>(ttl))) {
+        debugs(93, 5, "caching approval for " << ttl << "s: " << key);
+        ++Stats.stores;
+    }
+}
+
+void
+Adaptation::VerdictCache::Report(std::ostream &os)
+{
+    if (!TheApprovals) {
+        os << "Adaptation verdict cache is disabled.\n";
+        return;
+    }
+
+    os << "Adaptation verdict cache:\n" <<
+       "\tcached verdicts:\t" << TheApprovals->entries() << "\n" <<
+       "\tmemory used:\t" << TheApprovals->memoryUsed() << " of " << TheApprovals->memLimit() << " bytes\n" <<
+       "\tskipped adaptations:\t" << Stats.hits << "\n" <<
+       "\tmisses:\t" << Stats.misses << "\n" <<
+       "\tstale verdicts:\t" << Stats.stale << "\n" <<
+       "\tstored verdicts:\t" << Stats.stores << "\n" <<
+       "\tuncacheable responses:\t" << Stats.uncacheable << "\n";
+}
+
+void
+Adaptation::VerdictCache::ReportAction(StoreEntry *sentry)
+{
+    PackableStream os(*sentry);
+    Report(os);
+}
+
+/// manages the adaptation verdict cache lifetime
+class AdaptationVerdictsRr: public RegisteredRunner
+{
+public:
+    /* RegisteredRunner API */
+    void useConfig() override;
+    void syncConfig() override;
+    void finishShutdown() override;
+
+private:
+    /// (re)creates or resizes the cache to match the current configuration
+    void sync();
+};
+
+DefineRunnerRegistrator(AdaptationVerdictsRr);
+
+void
+AdaptationVerdictsRr::useConfig()
+{
+    Mgr::RegisterAction("adaptation_verdicts", "Adaptation verdict cache", Adaptation::VerdictCache::ReportAction, 0, 1);
+    sync();
+}
+
+void
+AdaptationVerdictsRr::syncConfig()
+{
+    sync();
+}
+
+void
+AdaptationVerdictsRr::finishShutdown()
+{
+    delete Adaptation::VerdictCache::TheApprovals;
+    Adaptation::VerdictCache::TheApprovals = nullptr;
+}
+
+void
+AdaptationVerdictsRr::sync()
+{
+    using namespace Adaptation::VerdictCache;
+
+    if (Adaptation::Config::verdict_cache_ttl <= 0 || !Adaptation::Config::verdict_cache_size) {
+        delete TheApprovals;
+        TheApprovals = nullptr;
+        return;
+    }
+
+    if (TheApprovals)
+        TheApprovals->setMemLimit(Adaptation::Config::verdict_cache_size);
+    else
+        TheApprovals = new Approvals(Adaptation::Config::verdict_cache_size);
+}
+
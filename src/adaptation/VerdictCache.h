@@ -0,0 +1,43 @@
+/*
+ * Copyright (C) 1996-2023 The Squid Software Foundation and contributors
+ *
+ * Squid software is distributed under GPLv2+ license and includes
+ * contributions from numerous individuals and organizations.
+ * Please see the COPYING and CONTRIBUTORS files for details.
+ */
+
+#ifndef SQUID_ADAPTATION_VERDICTCACHE_H
+#define SQUID_ADAPTATION_VERDICTCACHE_H
+
+#include "adaptation/forward.h"
+#include "http/forward.h"
+
+#include <iosfwd>
+
+namespace Adaptation
+{
+
+/// Remembers which RESPMOD services left which responses unmodified (e.g.,
+/// ICAP 204 No Content), so that later transactions delivering the same
+/// response (e.g., cache hits of an already scanned object) can skip those
+/// services. Responses are identified by their store ID and validators.
+/// Verdicts expire after adaptation_verdict_cache_ttl or when the service
+/// state changes (e.g., when an ICAP OPTIONS response changes the ISTag).
+namespace VerdictCache
+{
+
+/// whether the service is known to leave the given response unmodified
+bool Approved(const Service &, HttpRequest &, const HttpReply &);
+
+/// remembers that the service has left the given response unmodified
+void NoteApproval(const Service &, HttpRequest &, const HttpReply &);
+
+/// reports cache state and statistics
+void Report(std::ostream &);
+
+} // namespace VerdictCache
+
+} // namespace Adaptation
+
+#endif /* SQUID_ADAPTATION_VERDICTCACHE_H */
+
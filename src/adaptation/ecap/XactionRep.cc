@@ -18,6 +18,7 @@
 #include "adaptation/ecap/Config.h"
 #include "adaptation/ecap/XactionRep.h"
 #include "adaptation/Initiator.h"
+#include "adaptation/VerdictCache.h"
 #include "base/AsyncJobCalls.h"
 #include "base/TextException.h"
 #include "format/Format.h"
@@ -400,6 +401,11 @@ Adaptation::Ecap::XactionRep::useVirgin()
 
     preserveVb("useVirgin");
 
+    if (const auto reply = dynamic_cast<const HttpReply*>(theVirginRep.raw().header)) {
+        if (const auto request = theCauseRep ? dynamic_cast<HttpRequest*>(theCauseRep->raw().header) : nullptr)
+            VerdictCache::NoteApproval(service(), *request, *reply);
+    }
+
     Http::Message *clone = theVirginRep.raw().header->clone();
     // check that clone() copies the pipe so that we do not have to
     Must(!theVirginRep.raw().header->body_pipe == !clone->body_pipe);
@@ -30,6 +30,7 @@ public:
     int preview_enable;
     int preview_size;
     int allow206_enable;
+    time_t postview204_ttl; ///< icap_allow204_cache_ttl in squid.conf
     time_t connect_timeout_raw;
     time_t io_timeout_raw;
     int reuse_connections;
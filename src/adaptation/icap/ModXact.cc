@@ -18,7 +18,9 @@
 #include "adaptation/icap/Launcher.h"
 #include "adaptation/icap/ModXact.h"
 #include "adaptation/icap/ServiceRep.h"
+#include "adaptation/icap/Stats.h"
 #include "adaptation/Initiator.h"
+#include "adaptation/VerdictCache.h"
 #include "auth/UserRequest.h"
 #include "base/TextException.h"
 #include "base64.h"
@@ -81,6 +83,8 @@ Adaptation::Icap::ModXact::ModXact(Http::Message *virginHeader,
     icapReply = new HttpReply;
     icapReply->protoPrefix = "ICAP/"; // TODO: make an IcapReply class?
 
+    memset(&previewWaitStart, 0, sizeof(previewWaitStart));
+
     debugs(93,7, "initialized." << status());
 }
 
@@ -293,9 +297,10 @@ void Adaptation::Icap::ModXact::decideWritingAfterPreview(const char *kind)
 {
     if (preview.ieof()) // nothing more to write
         stopWriting(true);
-    else if (state.parsing == State::psIcapHeader) // did not get a reply yet
+    else if (state.parsing == State::psIcapHeader) { // did not get a reply yet
         state.writing = State::writingPaused; // wait for the ICAP server reply
-    else
+        previewWaitStart = current_time;
+    } else
         stopWriting(true); // ICAP server reply implies no post-preview writing
 
     debugs(93, 6, "decided on writing after " << kind << " preview" <<
@@ -793,6 +798,13 @@ void Adaptation::Icap::ModXact::parseIcapHead()
     if (!parseHead(icapReply.getRaw()))
         return;
 
+    if (previewWaitStart.tv_sec) {
+        Stats::NoteLatency(icapMethod(), Stats::stgPreview, previewWaitStart);
+        memset(&previewWaitStart, 0, sizeof(previewWaitStart));
+        // remember whether the service needed more than the Preview
+        service().notePreviewOutcome(virginRequest().url.path(), icapReply->sline.status() != Http::scContinue);
+    }
+
     if (expectIcapTrailers()) {
         Must(!trailerParser);
         trailerParser = new TrailerParser;
@@ -923,6 +935,10 @@ void Adaptation::Icap::ModXact::handle200Ok()
 void Adaptation::Icap::ModXact::handle204NoContent()
 {
     stopParsing();
+    if (const auto reply = dynamic_cast<const HttpReply*>(virgin.header)) {
+        if (virgin.cause)
+            VerdictCache::NoteApproval(service(), *virgin.cause, *reply);
+    }
     prepEchoing();
 }
 
@@ -1648,6 +1664,13 @@ void Adaptation::Icap::ModXact::decideOnPreview()
         return;
     }
 
+    // Previews of similar messages were followed by 100 Continue: Save a
+    // round trip by sending everything and allowing a 204 outside preview.
+    if (service().prefersPostview204(urlPath) && shouldAllow204()) {
+        debugs(93, 5, "skipping preview for " << urlPath << " in favor of 204 outside preview");
+        return;
+    }
+
     // we decided to do preview, now compute its size
 
     // cannot preview more than we can backup
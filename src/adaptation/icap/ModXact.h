@@ -299,6 +299,7 @@ private:
     VirginBodyAct virginBodySending;  // virgin body sending state
     uint64_t virginConsumed;        // virgin data consumed so far
     Preview preview; // use for creating (writing) the preview
+    timeval previewWaitStart; ///< when we started waiting for a Preview response
 
     Http1::TeChunkedParser *bodyParser; // ICAP response body parser
 
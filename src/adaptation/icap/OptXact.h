@@ -43,6 +43,7 @@ protected:
     bool doneReading() const override { return commEof || readAll; }
 
     void swanSong() override;
+    Adaptation::Method icapMethod() const override { return methodOptions; }
 
 private:
     void finalizeLogInfo() override;
@@ -15,16 +15,26 @@
 #include "adaptation/icap/Options.h"
 #include "adaptation/icap/OptXact.h"
 #include "adaptation/icap/ServiceRep.h"
+#include "base/AsyncCallbacks.h"
 #include "base/TextException.h"
 #include "comm/Connection.h"
+#include "comm/ConnOpener.h"
+#include "CommCalls.h"
 #include "ConfigParser.h"
 #include "debug/Stream.h"
+#include "event.h"
 #include "fde.h"
+#include "FwdState.h"
 #include "globals.h"
 #include "HttpReply.h"
 #include "ip/tools.h"
+#include "ipcache.h"
+#include "sbuf/StringConvert.h"
 #include "SquidConfig.h"
 
+#include <algorithm>
+#include <ostream>
+
 #define DEFAULT_ICAP_PORT   1344
 #define DEFAULT_ICAPS_PORT 11344
 
@@ -40,7 +50,11 @@ Adaptation::Icap::ServiceRep::ServiceRep(const ServiceConfigPointer &svcCfg):
     isSuspended(nullptr), notifying(false),
     updateScheduled(false),
     wasAnnouncedUp(true), // do not announce an "up" service at startup
-    isDetached(false)
+    isDetached(false),
+    standbyLookup(false),
+    standbyCheckScheduled(false),
+    standbyOpened(0),
+    previewsSkipped(0)
 {
     setMaxConnections();
     theIdleConns = new IdleConnList("ICAP Service", nullptr);
@@ -139,6 +153,7 @@ Adaptation::Icap::ServiceRep::getIdleConnection(const bool retriableXact)
 
     ++theBusyConns;
     debugs(93,3, "got connection: " << connection);
+    maintainStandby();
     return connection;
 }
 
@@ -234,6 +249,181 @@ int Adaptation::Icap::ServiceRep::excessConnections() const
         return 0;
 }
 
+/// how often we check whether standby connections were closed while idle
+static const time_t StandbyCheckInterval = 5; // seconds
+
+static void
+ServiceRep_noteTimeToCheckStandby(void *data)
+{
+    const auto service = static_cast<Adaptation::Icap::ServiceRep*>(data);
+    Must(service);
+    service->noteTimeToCheckStandby();
+}
+
+void
+Adaptation::Icap::ServiceRep::scheduleStandbyCheck()
+{
+    if (standbyCheckScheduled || cfg().standby <= 0 || detached())
+        return;
+
+    eventAdd("Adaptation::Icap::ServiceRep::noteTimeToCheckStandby",
+             &ServiceRep_noteTimeToCheckStandby, this, StandbyCheckInterval, 0, true);
+    standbyCheckScheduled = true;
+}
+
+void
+Adaptation::Icap::ServiceRep::noteTimeToCheckStandby()
+{
+    standbyCheckScheduled = false;
+    maintainStandby();
+    scheduleStandbyCheck();
+}
+
+static void
+ServiceRep_noteStandbyLookupDone(const ipcache_addrs *ia, const Dns::LookupDetails &, void *data)
+{
+    const auto service = static_cast<Adaptation::Icap::ServiceRep*>(data);
+    const auto addr = ia ? std::optional<Ip::Address>(ia->current()) : std::optional<Ip::Address>();
+    CallJobHere1(93, 5, CbcPointer<Adaptation::Icap::ServiceRep>(service), Adaptation::Icap::ServiceRep, noteStandbyAddress, addr);
+}
+
+void
+Adaptation::Icap::ServiceRep::maintainStandby()
+{
+    if (cfg().standby <= 0 || detached() || !up())
+        return;
+
+    // like cache_peer standby=N, open one connection at a time
+    if (standbyLookup || standbyWait)
+        return;
+
+    if (theIdleConns->count() >= cfg().standby)
+        return;
+
+    if (theMaxConnections >= 0 && theBusyConns + theIdleConns->count() >= theMaxConnections)
+        return;
+
+    debugs(93, 5, "opening a standby connection; idle: " << theIdleConns->count() << '/' << cfg().standby);
+    standbyLookup = true;
+    ipcache_nbgethostbyname(cfg().host.termedBuf(), ServiceRep_noteStandbyLookupDone, this);
+}
+
+void
+Adaptation::Icap::ServiceRep::noteStandbyAddress(const std::optional<Ip::Address> addr)
+{
+    standbyLookup = false;
+
+    if (!addr.has_value()) {
+        debugs(93, 3, "cannot resolve " << cfg().host << " for a standby connection");
+        return; // the next periodic check will retry
+    }
+
+    const Comm::ConnectionPointer conn = new Comm::Connection();
+    conn->remote = addr.value();
+    conn->remote.port(cfg().port);
+    getOutgoingAddress(nullptr, conn);
+
+    typedef CommCbMemFunT<Adaptation::Icap::ServiceRep, CommConnectCbParams> ConnectDialer;
+    AsyncCall::Pointer callback = JobCallback(93, 3, ConnectDialer, this, Adaptation::Icap::ServiceRep::noteStandbyConnected);
+    const auto cs = new Comm::ConnOpener(conn, callback, TheConfig.connect_timeout(cfg().bypass));
+    cs->setHost(cfg().host.termedBuf());
+    standbyWait.start(cs, callback);
+}
+
+void
+Adaptation::Icap::ServiceRep::noteStandbyConnected(const CommConnectCbParams &io)
+{
+    standbyWait.finish();
+
+    if (io.flag != Comm::OK) {
+        debugs(93, 3, "failed to open a standby connection: " << io.conn);
+        return; // the next periodic check will retry
+    }
+
+    if (detached() || excessConnections() > 0) {
+        io.conn->close();
+        return;
+    }
+
+    // transactions secure (TLS) connections lacking TLS state themselves
+    debugs(93, 5, "pooling standby connection " << io.conn);
+    theIdleConns->push(io.conn);
+    ++standbyOpened;
+
+    busyCheckpoint();
+    maintainStandby();
+}
+
+SBuf
+Adaptation::Icap::ServiceRep::PreviewPattern(const SBuf &urlPath)
+{
+    // Like ICAP Transfer-* OPTIONS headers, group URLs by their extension.
+    auto path = urlPath;
+    const auto query = path.find('?');
+    if (query != SBuf::npos)
+        path.chop(0, query);
+    const auto slash = path.rfind('/');
+    const auto dot = path.rfind('.');
+    if (dot == SBuf::npos || (slash != SBuf::npos && dot < slash))
+        return SBuf();
+    return path.substr(dot + 1);
+}
+
+bool
+Adaptation::Icap::ServiceRep::prefersPostview204(const SBuf &urlPath) const
+{
+    if (TheConfig.postview204_ttl <= 0 || thePostview204Patterns.empty())
+        return false;
+
+    const auto found = thePostview204Patterns.find(PreviewPattern(urlPath));
+    if (found == thePostview204Patterns.end() || found->second < squid_curtime)
+        return false;
+
+    ++previewsSkipped;
+    return true;
+}
+
+void
+Adaptation::Icap::ServiceRep::notePreviewOutcome(const SBuf &urlPath, const bool previewSufficed)
+{
+    if (TheConfig.postview204_ttl <= 0)
+        return;
+
+    const auto pattern = PreviewPattern(urlPath);
+    if (previewSufficed) {
+        thePostview204Patterns.erase(pattern);
+        return;
+    }
+
+    // bound memory usage; expired entries are purged when we run out of space
+    const size_t maxPatterns = 1000;
+    if (thePostview204Patterns.size() >= maxPatterns) {
+        for (auto i = thePostview204Patterns.begin(); i != thePostview204Patterns.end();) {
+            if (i->second < squid_curtime)
+                i = thePostview204Patterns.erase(i);
+            else
+                ++i;
+        }
+        if (thePostview204Patterns.size() >= maxPatterns && !thePostview204Patterns.count(pattern))
+            return;
+    }
+
+    debugs(93, 5, "will skip previews of ." << pattern << " URLs for " << TheConfig.postview204_ttl << "s");
+    thePostview204Patterns[pattern] = squid_curtime + TheConfig.postview204_ttl;
+}
+
+void
+Adaptation::Icap::ServiceRep::reportStats(std::ostream &os) const
+{
+    os << '\t' << cfg().key << ' ' << cfg().uri << ' ' << status() << "\n" <<
+       "\t\tbusy connections:\t" << theBusyConns << "\n" <<
+       "\t\tidle connections:\t" << theIdleConns->count() << "\n" <<
+       "\t\tstandby connections wanted:\t" << cfg().standby << "\n" <<
+       "\t\tstandby connections opened:\t" << standbyOpened << "\n" <<
+       "\t\tURL patterns skipping Preview:\t" << thePostview204Patterns.size() << "\n" <<
+       "\t\tskipped Previews:\t" << previewsSkipped << "\n";
+}
+
 void Adaptation::Icap::ServiceRep::noteGoneWaiter()
 {
     --theAllWaiters;
@@ -355,6 +545,22 @@ bool Adaptation::Icap::ServiceRep::allows206() const
     return false;
 }
 
+SBuf
+Adaptation::Icap::ServiceRep::verdictTag() const
+{
+    // the ISTag changes when the service changes its adaptation logic
+    return hasOptions() ? StringToSBuf(theOptions->istag) : SBuf();
+}
+
+time_t
+Adaptation::Icap::ServiceRep::verdictTtl() const
+{
+    // do not trust verdicts beyond the Options-TTL that promised the ISTag
+    if (!hasOptions())
+        return 0;
+    return std::max(static_cast<time_t>(0), theOptions->expire() - squid_curtime);
+}
+
 static
 void ServiceRep_noteTimeToUpdate(void *data)
 {
@@ -591,6 +797,9 @@ void Adaptation::Icap::ServiceRep::handleNewOptions(Adaptation::Icap::Options *n
     }
 
     scheduleNotification();
+
+    maintainStandby();
+    scheduleStandbyCheck();
 }
 
 void Adaptation::Icap::ServiceRep::startGettingOptions()
@@ -14,11 +14,19 @@
 #include "adaptation/Initiator.h"
 #include "adaptation/Service.h"
 #include "base/AsyncJobCalls.h"
+#include "base/JobWait.h"
 #include "cbdata.h"
 #include "comm.h"
+#include "comm/forward.h"
 #include "FadingCounter.h"
+#include "ip/Address.h"
 #include "pconn.h"
+#include "sbuf/SBuf.h"
+
 #include <deque>
+#include <iosfwd>
+#include <map>
+#include <optional>
 
 namespace Adaptation
 {
@@ -92,11 +100,22 @@ public:
     void noteConnectionFailed(const char *comment);
 
     void noteFailure() override; // called by transactions to report service failure
+    SBuf verdictTag() const override;
+    time_t verdictTtl() const override;
 
     void noteNewWaiter() {theAllWaiters++;} ///< New xaction waiting for service to be up or available
     void noteGoneWaiter(); ///< An xaction is not waiting any more for service to be available
     bool existWaiters() const {return (theAllWaiters > 0);} ///< if there are xactions waiting for the service to be available
 
+    /// whether recent Previews of similar messages were insufficient for
+    /// the service, making a 204 outside preview the better choice
+    bool prefersPostview204(const SBuf &urlPath) const;
+    /// remembers whether the service response to a Preview was final
+    void notePreviewOutcome(const SBuf &urlPath, bool previewSufficed);
+
+    /// reports service connections and Preview statistics
+    void reportStats(std::ostream &) const;
+
     //AsyncJob virtual methods
     bool doneAll() const override { return Adaptation::Initiator::doneAll() && false;}
     void callException(const std::exception &e) override;
@@ -107,6 +126,9 @@ public:
 public: // treat these as private, they are for callbacks only
     void noteTimeToUpdate();
     void noteTimeToNotify();
+    void noteTimeToCheckStandby();
+    void noteStandbyAddress(std::optional<Ip::Address>);
+    void noteStandbyConnected(const CommConnectCbParams &);
 
     // receive either an ICAP OPTIONS response header or an abort message
     void noteAdaptationAnswer(const Answer &answer) override;
@@ -183,10 +205,31 @@ private:
      */
     void busyCheckpoint();
 
+    /// opens a standby connection if we have fewer idle connections than
+    /// the standby=N service option requires
+    void maintainStandby();
+    /// schedules a periodic maintainStandby() call
+    void scheduleStandbyCheck();
+
+    /// the Preview-related key for the given HTTP request URL path
+    static SBuf PreviewPattern(const SBuf &urlPath);
+
     const char *status() const override;
 
     mutable bool wasAnnouncedUp; // prevent sequential same-state announcements
     bool isDetached;
+
+    /// waits for a standby connection to the service to be opened
+    JobWait<Comm::ConnOpener> standbyWait;
+    bool standbyLookup; ///< waiting for a standby connection address
+    bool standbyCheckScheduled; ///< a periodic standby check is pending
+    uint64_t standbyOpened; ///< the number of opened standby connections
+
+    /// When previews of requests with a given URL path extension stop
+    /// being skipped, indexed by that extension. A Preview answered with
+    /// 100 Continue adds (or refreshes) an entry; a final answer removes it.
+    std::map<SBuf, time_t> thePostview204Patterns;
+    mutable uint64_t previewsSkipped; ///< the number of prefersPostview204() hits
 };
 
 class ModXact;
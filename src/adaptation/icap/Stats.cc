@@ -0,0 +1,148 @@
+/*
+ * Copyright (C) 1996-2023 The Squid Software Foundation and contributors
+ *
+ * Squid software is distributed under GPLv2+ license and includes
+ * contributions from numerous individuals and organizations.
+ * Please see the COPYING and CONTRIBUTORS files for details.
+ */
+
+/* DEBUG: section 93    ICAP (RFC 3507) Client */
+
+#include "squid.h"
+#include "adaptation/icap/ServiceRep.h"
+#include "adaptation/icap/Stats.h"
+#include "adaptation/Service.h"
+#include "base/PackableStream.h"
+#include "base/RunnersRegistry.h"
+#include "mgr/Registration.h"
+#include "StatHist.h"
+#include "Store.h"
+#include "time/gadgets.h"
+
+#include <iomanip>
+
+namespace Adaptation
+{
+namespace Icap
+{
+namespace Stats
+{
+
+/// the number of ICAP methods we collect statistics for
+static const int Methods = methodOptions + 1;
+
+static const char *StageNames[stgEnd] = {
+    "connect",
+    "preview",
+    "response",
+    "transaction"
+};
+
+/// latencies of one ICAP method
+class MethodStats
+{
+public:
+    StatHist latencies[stgEnd]; ///< milliseconds spent in each Stage
+    uint64_t reusedConnections = 0; ///< transactions using idle connections
+};
+
+static MethodStats TheStats[Methods];
+
+/// an empty histogram with the same bins as TheStats histograms; needed to
+/// compute TheStats percentiles with StatHist::deltaPctile()
+static StatHist Empty;
+
+static OBJH Report;
+
+/// initializes histograms (once)
+static void
+Init()
+{
+    static bool initialized = false;
+    if (initialized)
+        return;
+    initialized = true;
+
+    // from 0 to 1 minute, with denser bins for smaller latencies
+    Empty.logInit(300, 0.0, 60000.0);
+    for (auto &method: TheStats) {
+        for (auto &hist: method.latencies)
+            hist.logInit(300, 0.0, 60000.0);
+    }
+}
+
+} // namespace Stats
+} // namespace Icap
+} // namespace Adaptation
+
+void
+Adaptation::Icap::Stats::NoteLatency(const Method method, const Stage stage, const timeval &start)
+{
+    if (method <= methodNone || method >= Methods || stage >= stgEnd)
+        return;
+    Init();
+    TheStats[method].latencies[stage].count(tvSubDsec(start, current_time) * 1000);
+}
+
+void
+Adaptation::Icap::Stats::NoteConnectionReuse(const Method method)
+{
+    if (method <= methodNone || method >= Methods)
+        return;
+    ++TheStats[method].reusedConnections;
+}
+
+/// reports ICAP latency histograms and service connection statistics
+void
+Adaptation::Icap::Stats::Report(StoreEntry *sentry)
+{
+    Init();
+
+    {
+        PackableStream os(*sentry);
+        os << "ICAP services:\n";
+        for (const auto &service: Adaptation::AllServices()) {
+            if (const auto icapService = dynamic_cast<const ServiceRep *>(service.getRaw()))
+                icapService->reportStats(os);
+        }
+    }
+
+    for (int m = methodReqmod; m < Methods; ++m) {
+        const auto &stats = TheStats[m];
+        {
+            PackableStream os(*sentry);
+            os << "\n" << methodStr(static_cast<Method>(m)) << " transactions:\n" <<
+               "\treused idle connections:\t" << stats.reusedConnections << "\n" <<
+               "\tlatency (milliseconds):\tp50\tp90\tp99\n" << std::fixed << std::setprecision(2);
+            for (int s = 0; s < stgEnd; ++s) {
+                const auto &hist = stats.latencies[s];
+                os << '\t' << StageNames[s] << ":\t" <<
+                   Empty.deltaPctile(hist, 0.50) << '\t' <<
+                   Empty.deltaPctile(hist, 0.90) << '\t' <<
+                   Empty.deltaPctile(hist, 0.99) << "\n";
+            }
+        }
+
+        for (int s = 0; s < stgEnd; ++s) {
+            storeAppendPrintf(sentry, "%s %s latency histogram:\n", methodStr(static_cast<Method>(m)), StageNames[s]);
+            stats.latencies[s].dump(sentry, nullptr);
+        }
+    }
+}
+
+/// registers the "icap" cache manager page
+class IcapStatsRr: public RegisteredRunner
+{
+public:
+    /* RegisteredRunner API */
+    void useConfig() override;
+};
+
+DefineRunnerRegistrator(IcapStatsRr);
+
+void
+IcapStatsRr::useConfig()
+{
+    Mgr::RegisterAction("icap", "ICAP services and transaction latencies", Adaptation::Icap::Stats::Report, 0, 1);
+}
+
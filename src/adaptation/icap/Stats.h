@@ -0,0 +1,45 @@
+/*
+ * Copyright (C) 1996-2023 The Squid Software Foundation and contributors
+ *
+ * Squid software is distributed under GPLv2+ license and includes
+ * contributions from numerous individuals and organizations.
+ * Please see the COPYING and CONTRIBUTORS files for details.
+ */
+
+#ifndef SQUID_SRC_ADAPTATION_ICAP_STATS_H
+#define SQUID_SRC_ADAPTATION_ICAP_STATS_H
+
+#include "adaptation/icap/Elements.h"
+
+namespace Adaptation
+{
+namespace Icap
+{
+
+/// ICAP transaction latency statistics reported on the "icap" cache
+/// manager page, collected separately for each ICAP method
+namespace Stats
+{
+
+/// measured parts of an ICAP transaction
+typedef enum {
+    stgConnect, ///< opening (and securing) a new connection to the service
+    stgPreview, ///< waiting for the service response to a Preview
+    stgResponse, ///< from the first request byte to the first response byte
+    stgTransaction, ///< the entire transaction
+    stgEnd
+} Stage;
+
+/// records the time passed since the given start of the given stage
+void NoteLatency(Method, Stage, const timeval &start);
+
+/// counts a transaction that reused an idle persistent connection
+void NoteConnectionReuse(Method);
+
+} // namespace Stats
+
+} // namespace Icap
+} // namespace Adaptation
+
+#endif /* SQUID_SRC_ADAPTATION_ICAP_STATS_H */
+
@@ -12,6 +12,7 @@
 #include "acl/FilledChecklist.h"
 #include "adaptation/icap/Config.h"
 #include "adaptation/icap/Launcher.h"
+#include "adaptation/icap/Stats.h"
 #include "adaptation/icap/Xaction.h"
 #include "base/AsyncCallbacks.h"
 #include "base/IoManip.h"
@@ -82,7 +83,8 @@ Adaptation::Icap::Xaction::Xaction(const char *aTypeName, Adaptation::Icap::Serv
     ignoreLastWrite(false),
     waitingForDns(false),
     alep(new AccessLogEntry),
-    al(*alep)
+    al(*alep),
+    reusedConnection(false)
 {
     debugs(93,3, typeName << " constructed, this=" << this <<
            " [icapx" << id << ']'); // we should not call virtual status() here
@@ -92,6 +94,7 @@ Adaptation::Icap::Xaction::Xaction(const char *aTypeName, Adaptation::Icap::Serv
     icap_tr_start = current_time;
     memset(&icap_tio_start, 0, sizeof(icap_tio_start));
     memset(&icap_tio_finish, 0, sizeof(icap_tio_finish));
+    memset(&icap_connect_start, 0, sizeof(icap_connect_start));
 }
 
 Adaptation::Icap::Xaction::~Xaction()
@@ -108,6 +111,12 @@ Adaptation::Icap::Xaction::masterLogEntry()
     return nil;
 }
 
+Adaptation::Method
+Adaptation::Icap::Xaction::icapMethod() const
+{
+    return theService->cfg().method;
+}
+
 Adaptation::Icap::ServiceRep &
 Adaptation::Icap::Xaction::service()
 {
@@ -134,22 +143,6 @@ void Adaptation::Icap::Xaction::start()
     Adaptation::Initiate::start();
 }
 
-// TODO: Make reusable by moving this (and the printing operator from
-// ip/Address.h that this code is calling) into ip/print.h or similar.
-namespace Ip {
-
-inline std::ostream &
-operator <<(std::ostream &os, const std::optional<Address> &optional)
-{
-    if (optional.has_value())
-        os << optional.value();
-    else
-        os << "[no IP]";
-    return os;
-}
-
-}
-
 static void
 icapLookupDnsResults(const ipcache_addrs *ia, const Dns::LookupDetails &, void *data)
 {
@@ -169,7 +162,9 @@ Adaptation::Icap::Xaction::openConnection()
     if (!TheConfig.reuse_connections)
         disableRetries(); // this will also safely drain pconn pool
 
+    icap_connect_start = current_time;
     if (const auto pconn = s.getIdleConnection(isRetriable)) {
+        reusedConnection = true;
         useTransportConnection(pconn);
         return;
     }
@@ -297,6 +292,11 @@ Adaptation::Icap::Xaction::useIcapConnection(const Comm::ConnectionPointer &conn
     connection = conn;
     service().noteConnectionUse(connection);
 
+    if (reusedConnection)
+        Stats::NoteConnectionReuse(icapMethod());
+    else
+        Stats::NoteLatency(icapMethod(), Stats::stgConnect, icap_connect_start);
+
     typedef CommCbMemFunT<Adaptation::Icap::Xaction, CommCloseCbParams> CloseDialer;
     closer =  asyncCall(93, 5, "Adaptation::Icap::Xaction::noteCommClosed",
                         CloseDialer(this,&Adaptation::Icap::Xaction::noteCommClosed));
@@ -451,6 +451,8 @@ void Adaptation::Icap::Xaction::noteCommRead(const CommIoCbParams &io)
         return;
 
     case Comm::OK:
+        if (!al.icap.bytesRead && icap_tio_start.tv_sec)
+            Stats::NoteLatency(icapMethod(), Stats::stgResponse, icap_tio_start);
         al.icap.bytesRead += rd.size;
 
         updateTimeout();
@@ -584,6 +586,8 @@ void Adaptation::Icap::Xaction::swanSong()
 
     tellQueryAborted();
 
+    Stats::NoteLatency(icapMethod(), Stats::stgTransaction, icap_tr_start);
+
     maybeLog();
 
     Adaptation::Initiate::swanSong();
@@ -117,6 +117,8 @@ public:
     /// clear stored error details, if any; used for retries/repeats
     virtual void clearError() {}
     virtual AccessLogEntry::Pointer masterLogEntry();
+    /// the ICAP method of the request we send
+    virtual Adaptation::Method icapMethod() const;
     void dnsLookupDone(std::optional<Ip::Address>);
 
 protected:
@@ -154,6 +156,7 @@ protected:
     timeval icap_tr_start;     /*time when the ICAP transaction was created */
     timeval icap_tio_start;    /*time when the first ICAP request byte was scheduled for sending*/
     timeval icap_tio_finish;   /*time when the last byte of the ICAP responsewas received*/
+    timeval icap_connect_start; ///< when we started looking for a connection
 
 private:
     /// waits for a transport connection to the ICAP server to be established/opened
@@ -165,6 +168,9 @@ private:
     /// open and, if necessary, secured connection to the ICAP server (or nil)
     Comm::ConnectionPointer connection;
 
+    /// whether the connection came from the idle connection pool
+    bool reusedConnection;
+
     AsyncCall::Pointer closer;
 };
 
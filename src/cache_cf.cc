@@ -87,6 +87,7 @@
 #include "ssl/support.h"
 #endif
 #if USE_SQUID_ESI
+#include "esi/Esi.h"
 #include "esi/Parser.h"
 #endif
 #if SQUID_SNMP
@@ -2242,6 +2243,11 @@ parse_peer(CachePeers **peers)
             p->options.roundrobin = true;
         } else if (!strcmp(token, "weighted-round-robin")) {
             p->options.weighted_roundrobin = true;
+        } else if (!strcmp(token, "latency-aware")) {
+            if (p->type != PEER_PARENT)
+                throw TextException(ToSBuf("non-parent latency-aware cache_peer ", *p), Here());
+
+            p->options.latency_aware = true;
 #if USE_HTCP
         } else if (!strcmp(token, "htcp")) {
             p->options.htcp = true;
@@ -3209,6 +3215,35 @@ dump_uri_whitespace(StoreEntry * entry, const char *name, int var)
     storeAppendPrintf(entry, "%s %s\n", name, s);
 }
 
+static void
+parse_peer_hash_algorithm(PeerHashAlgorithm *var)
+{
+    const auto token = ConfigParser::NextToken();
+    if (!token) {
+        self_destruct();
+        return;
+    }
+
+    if (!strcmp(token, "carp"))
+        *var = PeerHashAlgorithm::carp;
+    else if (!strcmp(token, "consistent"))
+        *var = PeerHashAlgorithm::consistent;
+    else
+        throw TextException(ToSBuf("unsupported cache_peer_hash_algorithm ", token, "; expected carp or consistent"), Here());
+}
+
+static void
+dump_peer_hash_algorithm(StoreEntry *entry, const char *name, const PeerHashAlgorithm var)
+{
+    storeAppendPrintf(entry, "%s %s\n", name, var == PeerHashAlgorithm::consistent ? "consistent" : "carp");
+}
+
+static void
+free_peer_hash_algorithm(PeerHashAlgorithm *var)
+{
+    *var = PeerHashAlgorithm::carp;
+}
+
 static void
 free_removalpolicy(RemovalPolicySettings ** settings)
 {
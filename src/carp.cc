@@ -15,6 +15,7 @@
 #include "HttpRequest.h"
 #include "mgr/Registration.h"
 #include "neighbors.h"
+#include "PeerHashTable.h"
 #include "PeerSelectState.h"
 #include "SquidConfig.h"
 #include "Store.h"
@@ -31,6 +32,14 @@ CarpPeers()
     return *carpPeers;
 }
 
+/// consistent hashing table for CARP cache_peers (if enabled)
+static auto &
+CarpTable()
+{
+    static const auto carpTable = new PeerHashTable();
+    return *carpTable;
+}
+
 static OBJH carpCachemgr;
 
 static int
@@ -56,6 +65,7 @@ carpInit(void)
     /* Clean up */
 
     CarpPeers().clear();
+    CarpTable().clear();
 
     /* initialize cache manager before we have a chance to leave the execution path */
     carpRegisterWithCacheManager();
@@ -82,6 +92,11 @@ carpInit(void)
     if (rawCarpPeers.empty())
         return;
 
+    if (PeerHashTable::Enabled()) {
+        CarpTable().reset(rawCarpPeers);
+        debugs(39, DBG_IMPORTANT, "Using consistent hashing for " << rawCarpPeers.size() << " CARP cache_peer(s)");
+    }
+
     /* calculate hashes and load factors */
     for (const auto p: rawCarpPeers) {
         /* calculate this peers hash */
@@ -134,6 +149,64 @@ carpInit(void)
     CarpPeers().assign(rawCarpPeers.begin(), rawCarpPeers.end());
 }
 
+/// the CARP key of the request for the given peer (or its effective URI)
+static SBuf
+carpKey(const CachePeer *tp, const HttpRequest &request)
+{
+    SBuf key;
+    if (tp && tp->options.carp_key.set) {
+        // this code follows URI syntax pattern.
+        // corner cases should use the full effective request URI
+        if (tp->options.carp_key.scheme) {
+            key.append(request.url.getScheme().image());
+            if (key.length()) //if the scheme is not empty
+                key.append("://");
+        }
+        if (tp->options.carp_key.host) {
+            key.append(request.url.host());
+        }
+        if (tp->options.carp_key.port) {
+            key.appendf(":%hu", request.url.port().value_or(0));
+        }
+        if (tp->options.carp_key.path) {
+            // XXX: fix when path and query are separate
+            key.append(request.url.path().substr(0,request.url.path().find('?'))); // 0..N
+        }
+        if (tp->options.carp_key.params) {
+            // XXX: fix when path and query are separate
+            SBuf::size_type pos;
+            if ((pos=request.url.path().find('?')) != SBuf::npos)
+                key.append(request.url.path().substr(pos)); // N..npos
+        }
+    }
+    // if the url-based key is empty, e.g. because the user is
+    // asking to balance on the path but the request doesn't supply any,
+    // then fall back to the effective request URI
+
+    if (key.isEmpty())
+        key=request.effectiveRequestUri();
+
+    return key;
+}
+
+/// selects a CARP parent using the consistent hashing table
+static CachePeer *
+carpSelectConsistentParent(PeerSelector *ps)
+{
+    // all table peers share the carp-key of the first configured one
+    const auto key = carpKey(CarpTable().firstPeer(), *ps->request);
+
+    unsigned int user_hash = 0;
+    for (const char *c = key.rawContent(), *e=key.rawContent()+key.length(); c < e; ++c)
+        user_hash += ROTATE_LEFT(user_hash, 19) + *c;
+
+    debugs(39, 3, "key=" << key << " hash=" << user_hash);
+    const auto p = CarpTable().select(user_hash, ps);
+    if (p)
+        debugs(39, 2, "selected " << *p);
+    return p;
+}
+
 CachePeer *
 carpSelectParent(PeerSelector *ps)
 {
@@ -149,6 +222,9 @@ carpSelectParent(PeerSelector *ps)
     if (CarpPeers().empty())
         return nullptr;
 
+    if (!CarpTable().isEmpty())
+        return carpSelectConsistentParent(ps);
+
     /* calculate hash key */
     debugs(39, 2, "carpSelectParent: Calculating hash for " << request->effectiveRequestUri());
 
@@ -157,38 +233,7 @@ carpSelectParent(PeerSelector *ps)
         if (!tp)
             continue; // peer gone
 
-        SBuf key;
-        if (tp->options.carp_key.set) {
-            // this code follows URI syntax pattern.
-            // corner cases should use the full effective request URI
-            if (tp->options.carp_key.scheme) {
-                key.append(request->url.getScheme().image());
-                if (key.length()) //if the scheme is not empty
-                    key.append("://");
-            }
-            if (tp->options.carp_key.host) {
-                key.append(request->url.host());
-            }
-            if (tp->options.carp_key.port) {
-                key.appendf(":%hu", request->url.port().value_or(0));
-            }
-            if (tp->options.carp_key.path) {
-                // XXX: fix when path and query are separate
-                key.append(request->url.path().substr(0,request->url.path().find('?'))); // 0..N
-            }
-            if (tp->options.carp_key.params) {
-                // XXX: fix when path and query are separate
-                SBuf::size_type pos;
-                if ((pos=request->url.path().find('?')) != SBuf::npos)
-                    key.append(request->url.path().substr(pos)); // N..npos
-            }
-        }
-        // if the url-based key is empty, e.g. because the user is
-        // asking to balance on the path but the request doesn't supply any,
-        // then fall back to the effective request URI
-
-        if (key.isEmpty())
-            key=request->effectiveRequestUri();
+        const auto key = carpKey(tp.get(), *request);
 
         for (const char *c = key.rawContent(), *e=key.rawContent()+key.length(); c < e; ++c)
             user_hash += ROTATE_LEFT(user_hash, 19) + *c;
@@ -237,5 +282,7 @@ carpCachemgr(StoreEntry * sentry)
                           p->carp.load_factor,
                           sumfetches ? (double) p->stats.fetches / sumfetches : -1.0);
     }
+
+    CarpTable().dump(sentry);
 }
 
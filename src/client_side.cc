@@ -130,11 +130,13 @@
 #endif
 #if USE_OPENSSL
 #include "ssl/bio.h"
+#include "ssl/CertGenerator.h"
 #include "ssl/context_storage.h"
 #include "ssl/gadgets.h"
 #include "ssl/helper.h"
 #include "ssl/ProxyCerts.h"
 #include "ssl/ServerBump.h"
+#include "ssl/SharedCertificates.h"
 #include "ssl/support.h"
 #endif
 
@@ -2292,7 +2294,9 @@ static bool
 httpsCreate(const ConnStateData *connState, const Security::ContextPointer &ctx)
 {
     const auto conn = connState->clientConnection;
-    if (Security::CreateServerSession(ctx, conn, connState->port->secure, "client https start")) {
+    // SslBump needs Squid BIO to inspect TLS handshakes
+    const auto mayUseKernelTls = !connState->port->flags.tunnelSslBumping;
+    if (Security::CreateServerSession(ctx, conn, connState->port->secure, "client https start", mayUseKernelTls)) {
         debugs(33, 5, "will negotiate TLS on " << conn);
         return true;
     }
@@ -2574,21 +2578,7 @@ ConnStateData::sslCrtdHandleReply(const Helper::Reply &reply)
                 debugs(33, 5, "Certificate for " << tlsConnectHostOrIp << " cannot be generated. ssl_crtd response: " << reply_message.getBody());
             } else {
                 debugs(33, 5, "Certificate for " << tlsConnectHostOrIp << " was successfully received from ssl_crtd");
-                if (sslServerBump && (sslServerBump->act.step1 == Ssl::bumpPeek || sslServerBump->act.step1 == Ssl::bumpStare)) {
-                    doPeekAndSpliceStep();
-                    auto ssl = fd_table[clientConnection->fd].ssl.get();
-                    bool ret = Ssl::configureSSLUsingPkeyAndCertFromMemory(ssl, reply_message.getBody().c_str(), *port);
-                    if (!ret)
-                        debugs(33, 5, "Failed to set certificates to ssl object for PeekAndSplice mode");
-
-                    Security::ContextPointer ctx(Security::GetFrom(fd_table[clientConnection->fd].ssl));
-                    Ssl::configureUnconfiguredSslContext(ctx, signAlgorithm, *port);
-                } else {
-                    Security::ContextPointer ctx(Ssl::GenerateSslContextUsingPkeyAndCertFromMemory(reply_message.getBody().c_str(), port->secure, (signAlgorithm == Ssl::algSignTrusted)));
-                    if (ctx && !sslBumpCertKey.isEmpty())
-                        storeTlsContextToCache(sslBumpCertKey, ctx);
-                    getSslContextDone(ctx);
-                }
+                useGeneratedCertificate(reply_message.getBody().c_str());
                 return;
             }
         }
@@ -2597,6 +2587,54 @@ ConnStateData::sslCrtdHandleReply(const Helper::Reply &reply)
     getSslContextDone(nil);
 }
 
+void
+ConnStateData::sslCertGeneratorDoneWrapper(void *data, const std::string &certAndKey)
+{
+    const auto state_data = static_cast<ConnStateData *>(data);
+    state_data->sslCertGeneratorDone(certAndKey);
+}
+
+void
+ConnStateData::sslCertGeneratorDone(const std::string &certAndKey)
+{
+    if (!isOpen()) {
+        debugs(33, 3, "Connection gone while waiting for certificate generator threads");
+        return;
+    }
+
+    if (certAndKey.empty()) {
+        debugs(33, 5, "Certificate for " << tlsConnectHostOrIp << " cannot be generated in-process");
+        Security::ContextPointer nil;
+        getSslContextDone(nil);
+        return;
+    }
+
+    debugs(33, 5, "Certificate for " << tlsConnectHostOrIp << " was successfully generated in-process");
+    useGeneratedCertificate(certAndKey.c_str());
+}
+
+void
+ConnStateData::useGeneratedCertificate(const char *certAndKey)
+{
+    if (sslServerBump && (sslServerBump->act.step1 == Ssl::bumpPeek || sslServerBump->act.step1 == Ssl::bumpStare)) {
+        doPeekAndSpliceStep();
+        auto ssl = fd_table[clientConnection->fd].ssl.get();
+        bool ret = Ssl::configureSSLUsingPkeyAndCertFromMemory(ssl, certAndKey, *port);
+        if (!ret)
+            debugs(33, 5, "Failed to set certificates to ssl object for PeekAndSplice mode");
+
+        Security::ContextPointer ctx(Security::GetFrom(fd_table[clientConnection->fd].ssl));
+        Ssl::configureUnconfiguredSslContext(ctx, signAlgorithm, *port);
+    } else {
+        Security::ContextPointer ctx(Ssl::GenerateSslContextUsingPkeyAndCertFromMemory(certAndKey, port->secure, (signAlgorithm == Ssl::algSignTrusted)));
+        if (ctx && !sslBumpCertKey.isEmpty()) {
+            Ssl::SharedCertificates::Remember(sslBumpCertKey, ctx);
+            storeTlsContextToCache(sslBumpCertKey, ctx);
+        }
+        getSslContextDone(ctx);
+    }
+}
+
 void ConnStateData::buildSslCertGenerationParams(Ssl::CertificateProperties &certProperties)
 {
     certProperties.commonName = sslCommonName_.isEmpty() ? tlsConnectHostOrIp.c_str() : sslCommonName_.c_str();
@@ -2690,6 +2728,22 @@ ConnStateData::getTlsContextFromCache(const SBuf &cacheKey, const Ssl::Certifica
     return Security::ContextPointer(nullptr);
 }
 
+Security::ContextPointer
+ConnStateData::getTlsContextFromSharedCache(const SBuf &cacheKey, const Ssl::CertificateProperties &certProperties)
+{
+    if (!Ssl::SharedCertificates::Enabled())
+        return Security::ContextPointer(nullptr);
+
+    debugs(33, 5, "Finding SSL certificate for " << cacheKey << " in shared cache");
+    const auto ctx = Ssl::SharedCertificates::Find(cacheKey, port->secure, (signAlgorithm == Ssl::algSignTrusted));
+    if (ctx && !Ssl::verifySslCertificate(ctx, certProperties)) {
+        debugs(33, 5, "Shared SSL certificate for " << certProperties.commonName << " is out of date. Delete this certificate from shared cache");
+        Ssl::SharedCertificates::Forget(cacheKey);
+        return Security::ContextPointer(nullptr);
+    }
+    return ctx;
+}
+
 void
 ConnStateData::storeTlsContextToCache(const SBuf &cacheKey, Security::ContextPointer &ctx)
 {
@@ -2718,6 +2772,19 @@ ConnStateData::getSslContextStart()
                 getSslContextDone(ctx);
                 return;
             }
+
+            ctx = getTlsContextFromSharedCache(sslBumpCertKey, certProperties);
+            if (ctx) {
+                storeTlsContextToCache(sslBumpCertKey, ctx);
+                getSslContextDone(ctx);
+                return;
+            }
+        }
+
+        if (Ssl::CertGenerator::Enabled()) {
+            debugs(33, 5, "Generating SSL certificate for " << certProperties.commonName << " using generator threads.");
+            Ssl::CertGenerator::Submit(certProperties, sslCertGeneratorDoneWrapper, this);
+            return;
         }
 
 #if USE_SSL_CRTD
@@ -2749,8 +2816,10 @@ ConnStateData::getSslContextStart()
             Ssl::configureUnconfiguredSslContext(ctx, certProperties.signAlgorithm, *port);
         } else {
             Security::ContextPointer dynCtx(Ssl::GenerateSslContext(certProperties, port->secure, (signAlgorithm == Ssl::algSignTrusted)));
-            if (dynCtx && !sslBumpCertKey.isEmpty())
+            if (dynCtx && !sslBumpCertKey.isEmpty()) {
+                Ssl::SharedCertificates::Remember(sslBumpCertKey, dynCtx);
                 storeTlsContextToCache(sslBumpCertKey, dynCtx);
+            }
             getSslContextDone(dynCtx);
         }
         return;
@@ -279,6 +279,14 @@ public:
     /// Process response from ssl_crtd.
     void sslCrtdHandleReply(const Helper::Reply &reply);
 
+    /// Callback function. It is called when in-process certificate generation ends.
+    static void sslCertGeneratorDoneWrapper(void *data, const std::string &certAndKey);
+    /// Process in-process certificate generation results.
+    void sslCertGeneratorDone(const std::string &certAndKey);
+
+    /// configures TLS using the given generated certificate and private key (PEM)
+    void useGeneratedCertificate(const char *certAndKey);
+
     void switchToHttps(ClientHttpRequest *, Ssl::BumpMode bumpServerMode);
     void parseTlsHandshake();
     bool switchedToHttps() const { return switchedToHttps_; }
@@ -457,6 +465,9 @@ private:
     /// \returns a pointer to the matching cached TLS context or nil
     Security::ContextPointer getTlsContextFromCache(const SBuf &cacheKey, const Ssl::CertificateProperties &certProperties);
 
+    /// \returns a TLS context for the matching SMP-shared certificate or nil
+    Security::ContextPointer getTlsContextFromSharedCache(const SBuf &cacheKey, const Ssl::CertificateProperties &certProperties);
+
     /// Attempts to add a given TLS context to the cache, replacing the old
     /// same-key context, if any
     void storeTlsContextToCache(const SBuf &cacheKey, Security::ContextPointer &ctx);
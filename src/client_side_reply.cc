@@ -31,10 +31,12 @@
 #include "mime_header.h"
 #include "neighbors.h"
 #include "refresh.h"
+#include "RefreshAhead.h"
 #include "RequestFlags.h"
 #include "SquidConfig.h"
 #include "SquidMath.h"
 #include "Store.h"
+#include "store/Admission.h"
 #include "StrList.h"
 #include "tools.h"
 #if USE_AUTH
@@ -617,7 +619,7 @@ clientReplyContext::cacheHit(const StoreIOBuffer result)
         http->updateLoggingTags(LOG_TCP_MISS);
         processMiss();
         return;
-    } else if (!r->flags.internal && refreshCheckHTTP(e, r)) {
+    } else if (!r->flags.internal && (refreshCheckHTTP(e, r) || !RefreshAhead::StartForHit(*e, *r))) {
         debugs(88, 5, "clientCacheHit: in refreshCheck() block");
         /*
          * We hold a stale copy; it needs to be validated
@@ -1478,6 +1480,7 @@ clientReplyContext::identifyStoreObject()
     // the opposite condition, but the condition itself should be adjusted
     // (e.g., to honor flags.noCache in cache manager requests).
     if (!r->flags.noCache || r->flags.internal) {
+        Store::Admission::NoteRequest(*r);
         const auto e = storeGetPublicByRequest(r);
         identifyFoundObject(e, storeLookupString(bool(e)));
     } else {
@@ -82,6 +82,9 @@ static void commSetNoLinger(int);
 #ifdef TCP_NODELAY
 static void commSetTcpNoDelay(int);
 #endif
+#if defined(TCP_FASTOPEN_CONNECT)
+static void commSetTcpFastOpenConnect(int);
+#endif
 static void commSetTcpRcvbuf(int, int);
 
 bool
@@ -538,6 +541,11 @@ comm_apply_flags(int new_socket,
 
 #endif
 
+#if defined(TCP_FASTOPEN_CONNECT)
+    if ((flags & COMM_FASTOPEN_CONNECT) && sock_type == SOCK_STREAM)
+        commSetTcpFastOpenConnect(new_socket);
+#endif
+
     if (Config.tcpRcvBufsz > 0 && sock_type == SOCK_STREAM)
         commSetTcpRcvbuf(new_socket, Config.tcpRcvBufsz);
 
@@ -1168,6 +1176,24 @@ commSetTcpNoDelay(int fd)
 
 #endif
 
+#if defined(TCP_FASTOPEN_CONNECT)
+/// makes connect(2) succeed without waiting for the TCP handshake when the
+/// kernel has a Fast Open cookie for the server; the handshake then carries
+/// the first written bytes
+static void
+commSetTcpFastOpenConnect(int fd)
+{
+    int on = 1;
+
+    if (setsockopt(fd, IPPROTO_TCP, TCP_FASTOPEN_CONNECT, &on, sizeof(on)) < 0) {
+        // not fatal: the connection is opened without Fast Open
+        int xerrno = errno;
+        debugs(50, 3, "FD " << fd << ": " << xstrerr(xerrno));
+    }
+}
+
+#endif
+
 void
 comm_init(void)
 {
@@ -1789,6 +1815,11 @@ comm_open_uds(int sock_type,
 
 #endif
 
+#if defined(TCP_FASTOPEN_CONNECT)
+    if ((flags & COMM_FASTOPEN_CONNECT) && sock_type == SOCK_STREAM)
+        commSetTcpFastOpenConnect(new_socket);
+#endif
+
     if (Config.tcpRcvBufsz > 0 && sock_type == SOCK_STREAM)
         commSetTcpRcvbuf(new_socket, Config.tcpRcvBufsz);
 
@@ -20,6 +20,7 @@
 #include "eui/Eui64.h"
 #endif
 #include "hier_code.h"
+#include "IdleConnIndex.h"
 #include "ip/Address.h"
 #include "ip/forward.h"
 #include "mem/forward.h"
@@ -54,6 +55,8 @@ namespace Comm
 #define COMM_ORPHANED           0x80
 /// Internal Comm optimization: Keep the source port unassigned until connect(2)
 #define COMM_DOBIND_PORT_LATER 0x100
+/// send the first written bytes in the TCP SYN packet (RFC 7413 TCP Fast Open)
+#define COMM_FASTOPEN_CONNECT 0x200
 
 /**
  * Store data about the physical and logical attributes of a connection.
@@ -182,6 +185,9 @@ public:
 
     InstanceId<Connection, uint64_t> id;
 
+    /// IdleConnList position while this connection is idle in a pconn pool
+    IdleConnLinks<Connection> idleLinks;
+
 private:
     /** cache_peer data object (if any) */
     CachePeer *peer_;
@@ -10,7 +10,9 @@
 #include "ClientInfo.h"
 #include "comm/Connection.h"
 #include "comm/IoCallback.h"
+#include "comm/IoVector.h"
 #include "comm/Loops.h"
+#include "comm/SendableFile.h"
 #include "comm/Write.h"
 #include "CommCalls.h"
 #include "fde.h"
@@ -37,6 +39,8 @@ Comm::CallbackTableDestruct()
     for (int pos = 0; pos < Squid_MaxFD; ++pos) {
         iocb_table[pos].readcb.conn = nullptr;
         iocb_table[pos].writecb.conn = nullptr;
+        iocb_table[pos].writecb.vector = nullptr;
+        iocb_table[pos].writecb.file = nullptr;
     }
     safe_free(iocb_table);
 }
@@ -65,6 +69,26 @@ Comm::IoCallback::setCallback(Comm::iocb_type t, AsyncCall::Pointer &cb, char *b
     offset = 0;
 }
 
+/// Configure Comm::Callback for a vectored write. The buffers are not freed
+/// by Comm; they are released when the last IoVector reference is gone.
+void
+Comm::IoCallback::setCallback(Comm::iocb_type t, AsyncCall::Pointer &cb, const IoVectorPointer &aVector)
+{
+    assert(aVector);
+    setCallback(t, cb, nullptr, nullptr, aVector->size());
+    vector = aVector;
+}
+
+/// Configure Comm::Callback for a file write. The file is not closed by Comm.
+void
+Comm::IoCallback::setCallback(Comm::iocb_type t, AsyncCall::Pointer &cb, const SendableFilePointer &aFile, const off_t anOffset, const int sz)
+{
+    assert(aFile);
+    setCallback(t, cb, nullptr, nullptr, sz);
+    file = aFile;
+    fileOffset = anOffset;
+}
+
 void
 Comm::IoCallback::selectOrQueueWrite()
 {
@@ -93,6 +117,9 @@ void
 Comm::IoCallback::reset()
 {
     conn = nullptr;
+    vector = nullptr; // may release borrowed buffers
+    file = nullptr; // may close the file
+    fileOffset = 0;
     if (freefunc) {
         freefunc(buf);
         buf = nullptr;
@@ -33,6 +33,9 @@ public:
     Comm::ConnectionPointer conn;
     AsyncCall::Pointer callback;
     char *buf;
+    IoVectorPointer vector; ///< buffers of a vectored write (instead of buf)
+    SendableFilePointer file; ///< the file exported by a file write (instead of buf)
+    off_t fileOffset; ///< the file offset of the first file byte to write
     FREE *freefunc;
     int size;
     int offset;
@@ -44,6 +47,10 @@ public:
 
     bool active() const { return callback != nullptr; }
     void setCallback(iocb_type type, AsyncCall::Pointer &cb, char *buf, FREE *func, int sz);
+    /// configures a vectored write of all the given buffers
+    void setCallback(iocb_type type, AsyncCall::Pointer &cb, const IoVectorPointer &);
+    /// configures a write of sz bytes of the given file, starting at offset
+    void setCallback(iocb_type type, AsyncCall::Pointer &cb, const SendableFilePointer &, off_t offset, int sz);
 
     /// called when fd needs to write but may need to wait in line for its quota
     void selectOrQueueWrite();
@@ -0,0 +1,59 @@
+/*
+ * Copyright (C) 1996-2023 The Squid Software Foundation and contributors
+ *
+ * Squid software is distributed under GPLv2+ license and includes
+ * contributions from numerous individuals and organizations.
+ * Please see the COPYING and CONTRIBUTORS files for details.
+ */
+
+#ifndef SQUID_SRC_COMM_IOVECTOR_H
+#define SQUID_SRC_COMM_IOVECTOR_H
+
+#include "base/RefCount.h"
+#include "compat/cmsg.h"
+
+#if HAVE_SYS_UIO_H
+#include <sys/uio.h>
+#endif
+#include <vector>
+
+namespace Comm
+{
+
+/// A sequence of buffers exported with a single Comm::Write() call, without
+/// copying them into a contiguous buffer first. The buffers are not owned by
+/// this class; they must stay valid and unchanged while the object exists.
+/// Kids may keep borrowed buffers alive (e.g., pinned) until destruction.
+class IoVector: public RefCountable
+{
+public:
+    typedef RefCount<IoVector> Pointer;
+
+    ~IoVector() override {}
+
+    /// adds a buffer to the end of the sequence
+    void append(const char *buf, const size_t bufSize) {
+        iovec segment;
+        segment.iov_base = const_cast<char *>(buf);
+        segment.iov_len = bufSize;
+        segments_.push_back(segment);
+        size_ += bufSize;
+    }
+
+    /// the buffers, in write order
+    const std::vector<iovec> &segments() const { return segments_; }
+
+    /// the total number of bytes in all buffers
+    size_t size() const { return size_; }
+
+    bool isEmpty() const { return !size_; }
+
+private:
+    std::vector<iovec> segments_;
+    size_t size_ = 0; ///< cached sum of segment lengths
+};
+
+} // namespace Comm
+
+#endif /* SQUID_SRC_COMM_IOVECTOR_H */
+
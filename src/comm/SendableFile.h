@@ -0,0 +1,38 @@
+/*
+ * Copyright (C) 1996-2023 The Squid Software Foundation and contributors
+ *
+ * Squid software is distributed under GPLv2+ license and includes
+ * contributions from numerous individuals and organizations.
+ * Please see the COPYING and CONTRIBUTORS files for details.
+ */
+
+#ifndef SQUID_SRC_COMM_SENDABLEFILE_H
+#define SQUID_SRC_COMM_SENDABLEFILE_H
+
+#include "base/RefCount.h"
+
+namespace Comm
+{
+
+/// An open file with content exported by Comm::Write() without copying it
+/// into Squid memory (i.e. using sendfile(2)). This class does not own the
+/// descriptor; it must stay open while the object exists. Kids that own the
+/// descriptor may close it upon destruction.
+class SendableFile: public RefCountable
+{
+public:
+    typedef RefCount<SendableFile> Pointer;
+
+    explicit SendableFile(const int aFd): fd(aFd) {}
+    ~SendableFile() override {}
+
+    /// whether Comm::Write() can export files in this environment
+    static bool Supported();
+
+    const int fd; ///< the file descriptor to export content from
+};
+
+} // namespace Comm
+
+#endif /* SQUID_SRC_COMM_SENDABLEFILE_H */
+
@@ -10,7 +10,9 @@
 #include "cbdata.h"
 #include "comm/Connection.h"
 #include "comm/IoCallback.h"
+#include "comm/IoVector.h"
 #include "comm/Loops.h"
+#include "comm/SendableFile.h"
 #include "comm/Write.h"
 #include "fd.h"
 #include "fde.h"
@@ -21,7 +23,14 @@
 #include "ClientInfo.h"
 #endif
 
+#include <algorithm>
 #include <cerrno>
+#if HAVE_SYS_SENDFILE_H
+#include <sys/sendfile.h>
+#endif
+
+/// the maximum number of buffers given to a single writev(2) call
+static const size_t MaxWriteSegments = 64;
 
 void
 Comm::Write(const Comm::ConnectionPointer &conn, MemBuf *mb, AsyncCall::Pointer &callback)
@@ -47,6 +56,110 @@ Comm::Write(const Comm::ConnectionPointer &conn, const char *buf, int size, Asyn
     ccb->selectOrQueueWrite();
 }
 
+void
+Comm::Write(const Comm::ConnectionPointer &conn, const IoVectorPointer &buffers, AsyncCall::Pointer &callback)
+{
+    debugs(5, 5, conn << ": sz " << buffers->size() << " in " << buffers->segments().size() << " buffers: asynCall " << callback);
+
+    /* Make sure we are open, not closing, and not writing */
+    assert(fd_table[conn->fd].flags.open);
+    assert(!fd_table[conn->fd].closing());
+    Comm::IoCallback *ccb = COMMIO_FD_WRITECB(conn->fd);
+    assert(!ccb->active());
+
+    fd_table[conn->fd].writeStart = squid_curtime;
+    ccb->conn = conn;
+    /* Queue the write */
+    ccb->setCallback(IOCB_WRITE, callback, buffers);
+    ccb->selectOrQueueWrite();
+}
+
+bool
+Comm::SendableFile::Supported()
+{
+#if HAVE_SENDFILE && HAVE_SYS_SENDFILE_H
+    return true;
+#else
+    return false;
+#endif
+}
+
+void
+Comm::Write(const Comm::ConnectionPointer &conn, const SendableFilePointer &file, const off_t offset, const int size, AsyncCall::Pointer &callback)
+{
+    debugs(5, 5, conn << ": sz " << size << " from FD " << file->fd << " at " << offset << ": asynCall " << callback);
+
+    /* Make sure we are open, not closing, and not writing */
+    assert(fd_table[conn->fd].flags.open);
+    assert(!fd_table[conn->fd].closing());
+    assert(fd_table[conn->fd].writesDirectly());
+    Comm::IoCallback *ccb = COMMIO_FD_WRITECB(conn->fd);
+    assert(!ccb->active());
+
+    fd_table[conn->fd].writeStart = squid_curtime;
+    ccb->conn = conn;
+    /* Queue the write */
+    ccb->setCallback(IOCB_WRITE, callback, file, offset, size);
+    ccb->selectOrQueueWrite();
+}
+
+/// writes up to maxSize not yet written bytes of a file write
+/// \returns the result of the underlying system call
+static int
+WriteFile(const int fd, const Comm::SendableFile &file, const off_t offset, const size_t maxSize)
+{
+#if HAVE_SENDFILE && HAVE_SYS_SENDFILE_H
+    off_t nextOffset = offset;
+    const auto result = sendfile(fd, file.fd, &nextOffset, maxSize);
+    if (result > 0)
+        ++statCounter.syscalls.disk.reads;
+    return result;
+#else
+    (void)fd;
+    (void)file;
+    (void)offset;
+    (void)maxSize;
+    errno = ENOSYS;
+    return -1;
+#endif
+}
+
+/// writes up to maxSize not yet written bytes of a vectored write
+/// \returns the result of the underlying system call
+static int
+WriteVector(const int fd, const Comm::IoVector &buffers, size_t skip, size_t maxSize)
+{
+    iovec segments[MaxWriteSegments];
+    size_t count = 0;
+    for (const auto &segment: buffers.segments()) {
+        if (skip >= segment.iov_len) {
+            skip -= segment.iov_len; // already written
+            continue;
+        }
+
+        if (count >= MaxWriteSegments || !maxSize)
+            break;
+
+        const auto length = std::min(segment.iov_len - skip, maxSize);
+        segments[count].iov_base = static_cast<char *>(segment.iov_base) + skip;
+        segments[count].iov_len = length;
+        ++count;
+        skip = 0;
+        maxSize -= length;
+    }
+
+    if (!count)
+        return 0;
+
+#if !_SQUID_WINDOWS_
+    if (fd_table[fd].writesDirectly())
+        return writev(fd, segments, count);
+#endif
+
+    // the write method may transform (e.g., encrypt) the data it is given
+    return FD_WRITE_METHOD(fd, static_cast<const char *>(segments[0].iov_base), segments[0].iov_len);
+}
+
 /** Write to FD.
  * This function is used by the lowest level of IO loop which only has access to FD numbers.
  * We have to use the comm iocb_table to map FD numbers to waiting data and Comm::Connections.
@@ -80,7 +193,12 @@ Comm::HandleWrite(int fd, void *data)
 
     /* actually WRITE data */
     int xerrno = errno = 0;
-    len = FD_WRITE_METHOD(fd, state->buf + state->offset, nleft);
+    if (state->vector)
+        len = WriteVector(fd, *state->vector, state->offset, nleft);
+    else if (state->file)
+        len = nleft ? WriteFile(fd, *state->file, state->fileOffset + state->offset, nleft) : 0;
+    else
+        len = FD_WRITE_METHOD(fd, state->buf + state->offset, nleft);
     xerrno = errno;
     debugs(5, 5, "write() returns " << len);
 
@@ -31,6 +31,25 @@ void Write(const Comm::ConnectionPointer &conn, const char *buf, int size, Async
  */
 void Write(const Comm::ConnectionPointer &conn, MemBuf *mb, AsyncCall::Pointer &callback);
 
+/**
+ * Queue a vectored write of all the given buffers. callback is scheduled
+ * when the write completes, on error, or on file descriptor close.
+ *
+ * Plain TCP connections write the buffers with writev(2), without copying
+ * them. Other connections (e.g., TLS) write one buffer at a time.
+ */
+void Write(const Comm::ConnectionPointer &conn, const IoVectorPointer &buffers, AsyncCall::Pointer &callback);
+
+/**
+ * Queue a write of size bytes of the given file, starting at the given file
+ * offset, using sendfile(2). callback is scheduled when the write completes,
+ * on error, or on file descriptor close.
+ *
+ * \pre SendableFile::Supported()
+ * \pre the connection is a plain TCP connection (see fde::writesDirectly())
+ */
+void Write(const Comm::ConnectionPointer &conn, const SendableFilePointer &file, off_t offset, int size, AsyncCall::Pointer &callback);
+
 /// Cancel the write pending on FD. No action if none pending.
 void WriteCancel(const Comm::ConnectionPointer &conn, const char *reason);
 
@@ -23,9 +23,13 @@ namespace Comm
 
 class Connection;
 class ConnOpener;
+class IoVector;
+class SendableFile;
 class TcpKeepAlive;
 
 typedef RefCount<Comm::Connection> ConnectionPointer;
+typedef RefCount<Comm::IoVector> IoVectorPointer;
+typedef RefCount<Comm::SendableFile> SendableFilePointer;
 
 bool IsConnOpen(const Comm::ConnectionPointer &conn);
 
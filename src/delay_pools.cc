@@ -22,9 +22,11 @@
 #include "CompositePoolNode.h"
 #include "ConfigParser.h"
 #include "DelayBucket.h"
+#include "DelayHashed.h"
 #include "DelayId.h"
 #include "DelayPool.h"
 #include "DelayPools.h"
+#include "DelayShared.h"
 #include "DelaySpec.h"
 #include "DelayTagged.h"
 #include "DelayUser.h"
@@ -245,7 +247,7 @@ Aggregate::AggregateId::delayRead(const AsyncCall::Pointer &aRead)
 }
 
 CommonPool *
-CommonPool::Factory(unsigned char _class, CompositePoolNode::Pointer& compositeCopy)
+CommonPool::Factory(unsigned char _class, CompositePoolNode::Pointer& compositeCopy, unsigned short poolNumber)
 {
     CommonPool *result = new CommonPool;
 
@@ -299,6 +301,16 @@ CommonPool::Factory(unsigned char _class, CompositePoolNode::Pointer& compositeC
         compositeCopy = new DelayTagged;
         break;
 
+    case 6:
+        result->typeLabel = SBuf("6");
+        compositeCopy = new DelayShared(poolNumber);
+        break;
+
+    case 7:
+        result->typeLabel = SBuf("7");
+        compositeCopy = new DelayHashed;
+        break;
+
     default:
         fatal ("unknown delay pool class");
         return nullptr;
@@ -17,6 +17,7 @@
 
 #include "client_side_request.h"
 #include "esi/Context.h"
+#include "esi/TemplateCache.h"
 #include "http/Stream.h"
 #include "Store.h"
 
@@ -44,6 +45,7 @@ ESIContext::updateCachedAST()
         http->storeEntry()->cachedESITree->finish();
 
     http->storeEntry()->cachedESITree = treeToCache;
+    Esi::TemplateCache::Remember(*http->storeEntry(), treeToCache);
 
     treeToCache = nullptr;
 }
@@ -65,6 +67,22 @@ ESIContext::hasCachedAST() const
     }
 }
 
+void
+ESIContext::findCachedAST()
+{
+    if (triedTemplateCache)
+        return;
+
+    triedTemplateCache = true;
+
+    if (hasCachedAST())
+        return;
+
+    // the template may have been parsed for another StoreEntry object
+    // of the same response in this worker
+    http->storeEntry()->cachedESITree = Esi::TemplateCache::Find(*http->storeEntry());
+}
+
 void
 ESIContext::getCachedAST()
 {
@@ -41,6 +41,7 @@ public:
         pos(0),
         varState(nullptr),
         cachedASTInUse(false),
+        triedTemplateCache(false),
         reading_(true),
         processing(false) {
         memset(&flags, 0, sizeof(flags));
@@ -139,6 +140,7 @@ public:
     bool failed() const {return flags.error != 0;}
 
     bool cachedASTInUse;
+    bool triedTemplateCache; ///< whether findCachedAST() was called
 
 private:
     void fail ();
@@ -153,6 +155,8 @@ private:
     void parseOneBuffer();
     void updateCachedAST();
     bool hasCachedAST() const;
+    /// adopts a matching parsed template from Esi::TemplateCache (if any)
+    void findCachedAST();
     void getCachedAST();
     void start(const char *el, const char **attr, size_t attrCount) override;
     void end(const char *el) override;
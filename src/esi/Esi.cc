@@ -1293,6 +1293,8 @@ ESIContext::process ()
 
     assert (!flags.error);
 
+    findCachedAST();
+
     if (!hasCachedAST())
         parse();
     else if (!flags.finishedtemplate)
@@ -26,6 +26,12 @@ int esiEnableProcessing (HttpReply *);
 namespace Esi
 {
 
+/// esi_template_cache_size in squid.conf
+extern size_t TemplateCacheSize;
+
+/// esi_include_fanout in squid.conf
+extern int IncludeFanOut;
+
 typedef SBuf ErrorDetail;
 /// prepare an Esi::ErrorDetail for throw on ESI parser internal errors
 inline Esi::ErrorDetail Error(const char *msg) { return ErrorDetail(msg); }
@@ -14,6 +14,7 @@
 
 #include "client_side.h"
 #include "client_side_request.h"
+#include "esi/Esi.h"
 #include "esi/Include.h"
 #include "esi/VarState.h"
 #include "fatal.h"
@@ -177,6 +178,8 @@ esiBufferRecipient (clientStreamNode *node, ClientHttpRequest *http, HttpReply *
 
 }
 
+int Esi::IncludeFanOut = 0;
+
 /* esiStream functions */
 ESIStreamContext::~ESIStreamContext()
 {
@@ -246,7 +249,9 @@ ESIInclude::ESIInclude(ESIInclude const &old) :
     alturl(nullptr),
     parent(nullptr),
     started(false),
-    sent(false)
+    sent(false),
+    deferred(false),
+    fetching(false)
 {
     memset(&flags, 0, sizeof(flags));
     flags.onerrorcontinue = old.flags.onerrorcontinue;
@@ -296,7 +301,9 @@ ESIInclude::ESIInclude(esiTreeParentPtr aParent, int attrcount, char const **att
     alturl(nullptr),
     parent(aParent),
     started(false),
-    sent(false)
+    sent(false),
+    deferred(false),
+    fetching(false)
 {
     assert (aContext);
     memset(&flags, 0, sizeof(flags));
@@ -347,9 +354,21 @@ ESIInclude::start()
     if (started)
         return;
 
+    if (src.getRaw() && cbdataReferenceValid(varState) && !varState->mayStartInclude()) {
+        if (!deferred) {
+            deferred = true;
+            varState->deferInclude(this);
+        }
+        return;
+    }
+
     started = true;
 
     if (src.getRaw()) {
+        if (cbdataReferenceValid(varState)) {
+            varState->noteIncludeStarted();
+            fetching = true;
+        }
         Start (src, srcurl, varState);
         Start (alt, alturl, varState);
     } else {
@@ -419,6 +438,29 @@ ESIInclude::process(int)
     return ESI_PROCESS_COMPLETE;
 }
 
+/// lets deferred includes use our esi_include_fanout slot
+void
+ESIInclude::finishFetching()
+{
+    if (!fetching)
+        return;
+
+    fetching = false;
+
+    if (!cbdataReferenceValid(varState))
+        return;
+
+    varState->noteIncludeFinished();
+    while (const auto next = varState->nextDeferredInclude()) {
+        if (next->started || !next->parent)
+            continue; // already started or no longer needed
+        debugs(86, 5, "starting deferred " << next.getRaw());
+        next->deferred = false;
+        next->start();
+        return;
+    }
+}
+
 void
 ESIInclude::includeFail (ESIStreamContext::Pointer stream)
 {
@@ -491,6 +533,8 @@ ESIInclude::subRequestDone (ESIStreamContext::Pointer stream, bool success)
     }
 
     if (flags.finished || flags.failed) {
+        finishFetching();
+
         /* Kick ESI Processor */
         debugs (86, 5, "ESIInclude " << this <<
                 " SubRequest " << stream.getRaw() <<
@@ -65,8 +65,11 @@ private:
     void Start (ESIStreamContext::Pointer, char const *, ESIVarState *);
     esiTreeParentPtr parent;
     void start();
+    void finishFetching();
     bool started;
     bool sent;
+    bool deferred; ///< waits for other includes due to esi_include_fanout
+    bool fetching; ///< counted as an active include by varState
     ESIInclude(ESIInclude const &);
     bool dataNeeded() const;
     void prepareRequestHeaders(HttpHeader &tempheaders, ESIVarState *vars);
@@ -0,0 +1,208 @@
+/*
+ * Copyright (C) 1996-2023 The Squid Software Foundation and contributors
+ *
+ * Squid software is distributed under GPLv2+ license and includes
+ * contributions from numerous individuals and organizations.
+ * Please see the COPYING and CONTRIBUTORS files for details.
+ */
+
+/* DEBUG: section 86    ESI processing */
+
+#include "squid.h"
+
+#if (USE_SQUID_ESI == 1)
+
+#include "base/ClpMap.h"
+#include "base/PackableStream.h"
+#include "base/RunnersRegistry.h"
+#include "esi/Esi.h"
+#include "esi/TemplateCache.h"
+#include "HttpReply.h"
+#include "MemObject.h"
+#include "mgr/Registration.h"
+#include "sbuf/Algorithms.h"
+#include "sbuf/Stream.h"
+#include "Store.h"
+#include "store_key_md5.h"
+
+#include <algorithm>
+
+size_t Esi::TemplateCacheSize = 8*1024*1024;
+
+namespace Esi
+{
+namespace TemplateCache
+{
+
+/// a remembered template tree
+class Template
+{
+public:
+    ESIElement::Pointer tree; ///< cacheable (i.e. not request-specific) tree
+    uint64_t size = 0; ///< template size, our memory use approximation
+};
+
+/// the memory used by a remembered template
+static uint64_t
+MemoryUsedByTemplate(const Template &t)
+{
+    return sizeof(t) + t.size;
+}
+
+using Templates = ClpMap<SBuf, Template, MemoryUsedByTemplate>;
+
+/// this worker template cache (if enabled)
+static Templates *TheTemplates = nullptr;
+
+/// this worker statistics for the esi_templates report
+static struct {
+    uint64_t hits = 0; ///< parsing avoided
+    uint64_t misses = 0; ///< templates we had to parse
+    uint64_t stores = 0; ///< remembered templates
+} Stats;
+
+static OBJH Report;
+
+/// Computes the cache key for the given template entry.
+/// \returns an empty key for entries that cannot be identified reliably
+static SBuf
+MakeKey(const StoreEntry &entry)
+{
+    const auto key = entry.publicKey();
+    const auto reply = entry.hasFreshestReply();
+    if (!key || !reply)
+        return SBuf();
+
+    const auto etag = reply->header.getStr(Http::HdrType::ETAG);
+    if (!etag && reply->last_modified < 0)
+        return SBuf(); // no validators to detect template changes
+
+    SBufStream os;
+    os << storeKeyText(key) << ' ';
+    if (etag)
+        os << "etag=" << etag;
+    else
+        os << "lm=" << reply->last_modified;
+    return os.buf();
+}
+
+} // namespace TemplateCache
+} // namespace Esi
+
+ESIElement::Pointer
+Esi::TemplateCache::Find(const StoreEntry &entry)
+{
+    if (!TheTemplates)
+        return nullptr;
+
+    const auto key = MakeKey(entry);
+    if (key.isEmpty())
+        return nullptr;
+
+    if (const auto t = TheTemplates->get(key)) {
+        debugs(86, 5, "found parsed template " << key);
+        ++Stats.hits;
+        return t->tree;
+    }
+
+    ++Stats.misses;
+    return nullptr;
+}
+
+void
+Esi::TemplateCache::Remember(const StoreEntry &entry, const ESIElement::Pointer &tree)
+{
+    if (!TheTemplates || !tree)
+        return;
+
+    const auto key = MakeKey(entry);
+    if (key.isEmpty())
+        return;
+
+    Template t;
+    t.tree = tree;
+    t.size = entry.mem_obj ? std::max(entry.mem_obj->endOffset(), int64_t(0)) : 0;
+    if (TheTemplates->add(key, t)) {
+        debugs(86, 5, "remembered parsed template " << key);
+        ++Stats.stores;
+    }
+}
+
+void
+Esi::TemplateCache::Report(StoreEntry *sentry)
+{
+    PackableStream os(*sentry);
+
+    if (!TheTemplates) {
+        os << "ESI template cache is disabled.\n";
+        return;
+    }
+
+    os << "ESI template cache:\n" <<
+       "\tcached templates:\t" << TheTemplates->entries() << "\n" <<
+       "\tmemory used:\t" << TheTemplates->memoryUsed() << " of " << TheTemplates->memLimit() << " bytes\n" <<
+       "\thits:\t" << Stats.hits << "\n" <<
+       "\tmisses:\t" << Stats.misses << "\n" <<
+       "\tstores:\t" << Stats.stores << "\n";
+}
+
+namespace Esi
+{
+
+/// manages the parsed ESI template cache lifetime
+class TemplateCacheRr: public RegisteredRunner
+{
+public:
+    /* RegisteredRunner API */
+    void useConfig() override;
+    void syncConfig() override;
+    void finishShutdown() override;
+
+private:
+    /// (re)creates or resizes the cache to match the current configuration
+    void sync();
+};
+
+} // namespace Esi
+
+DefineRunnerRegistratorIn(Esi, TemplateCacheRr);
+
+void
+Esi::TemplateCacheRr::useConfig()
+{
+    Mgr::RegisterAction("esi_templates", "Parsed ESI template cache", TemplateCache::Report, 0, 1);
+    sync();
+}
+
+void
+Esi::TemplateCacheRr::syncConfig()
+{
+    sync();
+}
+
+void
+Esi::TemplateCacheRr::finishShutdown()
+{
+    delete TemplateCache::TheTemplates;
+    TemplateCache::TheTemplates = nullptr;
+}
+
+void
+Esi::TemplateCacheRr::sync()
+{
+    using TemplateCache::TheTemplates;
+
+    if (!TemplateCacheSize) {
+        delete TheTemplates;
+        TheTemplates = nullptr;
+        return;
+    }
+
+    if (TheTemplates)
+        TheTemplates->setMemLimit(TemplateCacheSize);
+    else
+        TheTemplates = new TemplateCache::Templates(TemplateCacheSize);
+}
+
+#endif /* USE_SQUID_ESI == 1 */
+
@@ -0,0 +1,41 @@
+/*
+ * Copyright (C) 1996-2023 The Squid Software Foundation and contributors
+ *
+ * Squid software is distributed under GPLv2+ license and includes
+ * contributions from numerous individuals and organizations.
+ * Please see the COPYING and CONTRIBUTORS files for details.
+ */
+
+#ifndef SQUID_ESI_TEMPLATECACHE_H
+#define SQUID_ESI_TEMPLATECACHE_H
+
+#include "esi/Element.h"
+
+class StoreEntry;
+
+namespace Esi
+{
+
+/// Parsed ESI templates (i.e. cacheable ESIElement trees) indexed by the
+/// public store key and validators of the cached template response. Unlike
+/// StoreEntry::cachedESITree, remembered trees survive StoreEntry object
+/// destruction, so that memory and disk cache hits (including hits on
+/// entries shared among SMP workers) do not have to parse the template
+/// again. Each request still gets its own tree (see ESIElement::makeUsable())
+/// to evaluate against its variables.
+/// \sa esi_template_cache_size
+namespace TemplateCache
+{
+
+/// \returns a cacheable tree parsed from the given template entry or nil
+ESIElement::Pointer Find(const StoreEntry &);
+
+/// remembers a cacheable tree parsed from the given template entry
+void Remember(const StoreEntry &, const ESIElement::Pointer &);
+
+} // namespace TemplateCache
+
+} // namespace Esi
+
+#endif /* SQUID_ESI_TEMPLATECACHE_H */
+
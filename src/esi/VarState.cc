@@ -9,6 +9,8 @@
 /* DEBUG: section 86    ESI processing */
 
 #include "squid.h"
+#include "esi/Esi.h"
+#include "esi/Include.h"
 #include "esi/VarState.h"
 #include "fatal.h"
 #include "HttpReply.h"
@@ -241,7 +243,8 @@ ESIVariableQuery::~ESIVariableQuery()
 
 ESIVarState::ESIVarState(HttpHeader const *aHeader, char const *uri) :
     output(nullptr),
-    hdr(hoReply)
+    hdr(hoReply),
+    activeIncludes(0)
 {
     memset(&flags, 0, sizeof(flags));
 
@@ -263,6 +266,37 @@ ESIVarState::ESIVarState(HttpHeader const *aHeader, char const *uri) :
     addVariable ("QUERY_STRING", 12, new ESIVariableQuery(uri));
 }
 
+bool
+ESIVarState::mayStartInclude() const
+{
+    return Esi::IncludeFanOut <= 0 || activeIncludes < Esi::IncludeFanOut;
+}
+
+void
+ESIVarState::deferInclude(const ESIIncludePtr &include)
+{
+    debugs(86, 5, "deferring " << include.getRaw() << " after " << activeIncludes << " active includes");
+    deferredIncludes.push_back(include);
+}
+
+void
+ESIVarState::noteIncludeFinished()
+{
+    assert(activeIncludes > 0);
+    --activeIncludes;
+}
+
+ESIIncludePtr
+ESIVarState::nextDeferredInclude()
+{
+    if (deferredIncludes.empty())
+        return nullptr;
+
+    const auto include = deferredIncludes.front();
+    deferredIncludes.pop_front();
+    return include;
+}
+
 void
 ESIVarState::removeVariable (String const &name)
 {
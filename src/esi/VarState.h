@@ -9,12 +9,15 @@
 #ifndef SQUID_ESIVARSTATE_H
 #define SQUID_ESIVARSTATE_H
 
+#include "base/RefCount.h"
 #include "esi/Segment.h"
 #include "HttpHeader.h"
 #include "libTrie/Trie.h"
 
+#include <deque>
 #include <vector>
 
+class ESIInclude;
 class HttpReply;
 
 /* esi variable replacement logic */
@@ -57,6 +60,16 @@ public:
     ESISegment::Pointer &getOutput();
     HttpHeader &header();
 
+    /* For esi:include fetching limits (esi_include_fanout) */
+    /// whether another esi:include may start fetching now
+    bool mayStartInclude() const;
+    /// remembers an esi:include waiting for mayStartInclude()
+    void deferInclude(const RefCount<ESIInclude> &);
+    void noteIncludeStarted() { ++activeIncludes; }
+    void noteIncludeFinished();
+    /// forgets and returns the oldest deferred esi:include (if any)
+    RefCount<ESIInclude> nextDeferredInclude();
+
 private:
     ESISegment::Pointer input;
     ESISegment::Pointer output;
@@ -70,6 +83,9 @@ private:
         unsigned int useragent:1;
     } flags;
 
+    int activeIncludes; ///< the number of esi:include fetches in progress
+    std::deque< RefCount<ESIInclude> > deferredIncludes; ///< esi:includes waiting for mayStartInclude()
+
 public:
 
     class Variable
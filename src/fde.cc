@@ -59,6 +59,16 @@ fde::useBufferedIo(READ_HANDLER *bufferingReader, WRITE_HANDLER *bufferingWriter
     writeMethod_ = bufferingWriter;
 }
 
+bool
+fde::writesDirectly() const
+{
+#if _SQUID_WINDOWS_
+    return false; // socket_write_method() uses send(2)
+#else
+    return writeMethod_ == &default_write_method;
+#endif
+}
+
 bool
 fde::readPending(int fdNumber) const
 {
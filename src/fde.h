@@ -87,6 +87,10 @@ public:
     int read(int fd, char *buf, int len) { return readMethod_(fd, buf, len); }
     int write(int fd, const char *buf, int len) { return writeMethod_(fd, buf, len); }
 
+    /// whether written bytes go to the descriptor as is, so that callers may
+    /// use system calls like writev(2) instead of write()
+    bool writesDirectly() const;
+
     /* NOTE: memset is used on fdes today. 20030715 RBC */
     static void DumpStats(StoreEntry *);
 
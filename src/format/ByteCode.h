@@ -176,6 +176,7 @@ typedef enum {
     LFT_SQUID_ERROR_DETAIL,
     LFT_SQUID_HIERARCHY,
     LFT_SQUID_REQUEST_ATTEMPTS,
+    LFT_SQUID_CONNECT_ATTEMPTS,
 
     LFT_MIME_TYPE,
     LFT_TAG,
@@ -1028,6 +1028,13 @@ Format::Format::assemble(MemBuf &mb, const AccessLogEntry::Pointer &al, int logS
             doint = 1;
             break;
 
+        case LFT_SQUID_CONNECT_ATTEMPTS:
+            if (!al->hier.connectAttempts.isEmpty()) {
+                sb = al->hier.connectAttempts;
+                out = sb.c_str();
+            }
+            break;
+
         case LFT_MIME_TYPE:
             out = al->http.content_type;
             break;
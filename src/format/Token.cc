@@ -150,6 +150,7 @@ static TokenTableEntry TokenTableMisc[] = {
     TokenTableEntry("err_code", LFT_SQUID_ERROR ),
     TokenTableEntry("err_detail", LFT_SQUID_ERROR_DETAIL ),
     TokenTableEntry("request_attempts", LFT_SQUID_REQUEST_ATTEMPTS),
+    TokenTableEntry("connect_attempts", LFT_SQUID_CONNECT_ATTEMPTS),
     TokenTableEntry("note", LFT_NOTE ),
     TokenTableEntry("credentials", LFT_CREDENTIALS),
     TokenTableEntry("master_xaction", LFT_MASTER_XACTION),
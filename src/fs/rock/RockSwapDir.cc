@@ -27,6 +27,7 @@
 #include "Parsing.h"
 #include "SquidConfig.h"
 #include "SquidMath.h"
+#include "store_digest.h"
 #include "tools.h"
 
 #include <cstdlib>
@@ -291,6 +292,7 @@ Rock::SwapDir::init()
     Must(!map);
     map = new DirMap(inodeMapPath());
     map->cleaner = this;
+    map->digester = storeDigestDirDigester(index);
 
     const char *ioModule = needsDiskStrand() ? "IpcIo" : "Blocking";
     if (DiskIOModule *m = DiskIOModule::Find(ioModule)) {
@@ -1077,6 +1079,7 @@ Rock::SwapDir::statfs(StoreEntry &e) const
             map->updateStats(stats);
             stats.dump(e);
         }
+        map->evictionStats().dump(e);
     }
 
     storeAppendPrintf(&e, "Pending operations: %d out of %d\n",
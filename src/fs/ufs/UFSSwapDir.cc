@@ -27,6 +27,7 @@
 #include "SquidMath.h"
 #include "StatCounters.h"
 #include "store_key_md5.h"
+#include "store_digest.h"
 #include "StoreSwapLogData.h"
 #include "tools.h"
 #include "UFSSwapDir.h"
@@ -818,6 +819,7 @@ Fs::Ufs::UFSSwapDir::addDiskRestore(const cache_key * key,
     ++n_disk_objects;
     e->hashInsert(key);
     replacementAdd (e);
+    storeDigestAddDiskEntry(*e);
     return e;
 }
 
@@ -1252,6 +1254,25 @@ Fs::Ufs::UFSSwapDir::fullPath(sfileno filn, char *fullpath) const
     return fullpath;
 }
 
+int
+Fs::Ufs::UFSSwapDir::openForSending(const StoreEntry &e) const
+{
+    assert(e.swap_dirn == index);
+    const auto fd = file_open(fullPath(e.swap_filen, nullptr), O_RDONLY | O_BINARY);
+    if (fd < 0)
+        return -1;
+
+    // do not export a file that has been truncated or replaced behind our back
+    struct stat sb;
+    if (fstat(fd, &sb) != 0 || static_cast<uint64_t>(sb.st_size) != e.swap_file_sz) {
+        debugs(47, 3, "unexpected size of " << e << " file");
+        file_close(fd);
+        return -1;
+    }
+
+    return fd;
+}
+
 int
 Fs::Ufs::UFSSwapDir::callback()
 {
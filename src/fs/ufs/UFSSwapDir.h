@@ -76,6 +76,7 @@ public:
     /// as long as ufs relies on the global store_table to index entries,
     /// it is wrong to ask individual ufs cache_dirs whether they have an entry
     bool hasReadableEntry(const StoreEntry &) const override { return false; }
+    int openForSending(const StoreEntry &) const override;
 
     void unlinkFile(sfileno f);
     // move down when unlink is a virtual method
@@ -32,6 +32,7 @@ typedef enum {
     ANY_OLD_PARENT,
     USERHASH_PARENT,
     SOURCEHASH_PARENT,
+    LATENCY_PARENT,
     PINNED,
     ORIGINAL_DST,
     STANDBY_POOL,
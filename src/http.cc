@@ -91,6 +91,8 @@ HttpStateData::HttpStateData(FwdState *theFwdState) :
     flags.toOrigin = (!_peer || _peer->options.originserver || request->flags.sslBumped);
 
     if (_peer) {
+        ++_peer->latency.pending;
+
         /*
          * This NEIGHBOR_PROXY_ONLY check probably shouldn't be here.
          * We might end up getting the object from somewhere else if,
@@ -121,6 +123,8 @@ HttpStateData::~HttpStateData()
     if (httpChunkDecoder)
         delete httpChunkDecoder;
 
+    if (_peer && cbdataReferenceValid(_peer))
+        --_peer->latency.pending;
     cbdataReferenceDone(_peer);
 
     delete upgradeHeaderOut;
@@ -693,6 +697,11 @@ HttpStateData::processReplyHeader()
     }
 
     /* We know the whole response is in parser now */
+    if (_peer && requestSent.tv_sec) {
+        _peer->noteResponseTime(tvSubMsec(requestSent, current_time), hp->messageStatus());
+        requestSent = timeval(); // ignore any final response after 1xx
+    }
+
     debugs(11, 2, "HTTP Server " << serverConnection);
     debugs(11, 2, "HTTP Server RESPONSE:\n---------\n" <<
            hp->messageProtocol() << " " << hp->messageStatus() << " " << hp->reasonPhrase() << "\n" <<
@@ -1724,6 +1733,7 @@ HttpStateData::wroteLast(const CommIoCbParams &io)
         return;
     }
 
+    requestSent = current_time;
     sendComplete();
 }
 
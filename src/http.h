@@ -64,6 +64,8 @@ public:
     ReuseDecision::Answers reusableReply(ReuseDecision &decision);
 
     CachePeer *_peer = nullptr;       /* CachePeer request made to */
+    /// when we finished sending the request (or zero after a response header)
+    struct timeval requestSent = {};
     int eof = 0;            /* reached end-of-object? */
     int lastChunk = 0;      /* reached last chunk of a chunk-encoded reply */
     Http::StateFlags flags;
@@ -8,15 +8,21 @@
 
 #include "squid.h"
 #include "client_side_request.h"
+#include "comm/SendableFile.h"
+#include "fde.h"
+#include "fs_io.h"
 #include "http/Stream.h"
 #include "HttpHdrContRange.h"
 #include "HttpHeaderTools.h"
+#include "MemObject.h"
+#include "SquidConfig.h"
+#include "stmem.h"
 #include "Store.h"
+#include "store/Disk.h"
 #include "TimeOrTag.h"
 #if USE_DELAY_POOLS
 #include "acl/FilledChecklist.h"
 #include "ClientInfo.h"
-#include "fde.h"
 #include "MessageDelayPools.h"
 #endif
 
@@ -105,11 +111,32 @@ Http::Stream::writeComplete(size_t size)
     }
 }
 
+/// the maximum number of body bytes in one sendBodyFromMemory() write
+static const size_t MaxMemoryBodyWrite = 64*1024;
+
+/// the maximum number of body bytes in one sendBodyFromDisk() write
+static const int64_t MaxDiskBodyWrite = 1024*1024;
+
+namespace Http {
+
+/// a cache_dir file opened by Store::Disk::openForSending()
+class SwapFile: public Comm::SendableFile
+{
+public:
+    explicit SwapFile(const int aFd): Comm::SendableFile(aFd) {}
+    ~SwapFile() override { file_close(fd); }
+};
+
+} // namespace Http
+
 void
 Http::Stream::pullData()
 {
     debugs(33, 5, reply << " written " << http->out.size << " into " << clientConnection);
 
+    if (sendBodyFromMemory() || sendBodyFromDisk())
+        return;
+
     /* More data will be coming from the stream. */
     StoreIOBuffer readBuffer;
     /* XXX: Next requested byte in the range sequence */
@@ -121,6 +148,99 @@ Http::Stream::pullData()
     clientStreamRead(getTail(), http, readBuffer);
 }
 
+/// \returns the complete cache entry with the remaining response body bytes
+/// that may be written without the client stream help or nil
+StoreEntry *
+Http::Stream::directlyWritableEntry() const
+{
+    // only HTTP/1 bodies sent as is qualify; reply is set by sendStartOfMessage()
+    if (startOfOutput() || !reply || reply->contentRange() ||
+            http->request->range || http->request->flags.chunkedReply ||
+            http->request->flags.streamError ||
+            http->request->method == Http::METHOD_HEAD)
+        return nullptr;
+
+    // other client stream nodes (e.g., ESI) may alter the body
+    if (http->client_stream.tail->prev != http->client_stream.head)
+        return nullptr;
+
+    // other write methods (e.g., TLS) cannot use writev(2) or sendfile(2)
+    if (!fd_table[clientConnection->fd].writesDirectly())
+        return nullptr;
+
+    const auto entry = http->storeEntry();
+    if (!entry || !entry->mem_obj || entry->store_status != STORE_OK ||
+            EBIT_TEST(entry->flags, ENTRY_ABORTED) ||
+            EBIT_TEST(entry->flags, ENTRY_BAD_LENGTH))
+        return nullptr;
+
+    return entry;
+}
+
+bool
+Http::Stream::sendBodyFromMemory()
+{
+    if (!Config.onoff.memory_hits_zero_copy)
+        return false;
+
+    const auto entry = directlyWritableEntry();
+    if (!entry)
+        return false;
+
+    const auto bodyStart = entry->mem().baseReply().hdr_sz;
+    const auto bodySize = entry->objectLen() - bodyStart;
+    if (http->out.offset >= bodySize)
+        return false; // let the client stream detect the end of the response
+
+    const auto maxSize = std::min<int64_t>(bodySize - http->out.offset, MaxMemoryBodyWrite);
+    const auto loan = entry->mem_obj->data_hdr.lend(bodyStart + http->out.offset, maxSize);
+    if (loan->isEmpty())
+        return false; // not in memory; the client stream may read it from disk
+
+    debugs(33, 5, "writing " << loan->size() << " body bytes at " << http->out.offset <<
+           " from " << loan->segments().size() << " memory pages of " << *entry);
+    noteSentBodyBytes(loan->size());
+    getConn()->write(loan);
+    return true;
+}
+
+bool
+Http::Stream::sendBodyFromDisk()
+{
+    if (Config.Store.sendfileMinSize <= 0 || !Comm::SendableFile::Supported())
+        return false;
+
+    const auto entry = directlyWritableEntry();
+    if (!entry || entry->objectLen() < Config.Store.sendfileMinSize)
+        return false;
+
+    // the disk file must be complete, with known metadata size
+    const auto swapHdrSz = entry->mem_obj->swap_hdr_sz;
+    if (!entry->swappedOut() || !entry->hasDisk() || !swapHdrSz ||
+            entry->swap_file_sz != swapHdrSz + static_cast<uint64_t>(entry->objectLen()))
+        return false;
+
+    const auto bodyStart = entry->mem().baseReply().hdr_sz;
+    const auto bodySize = entry->objectLen() - bodyStart;
+    if (http->out.offset >= bodySize)
+        return false; // let the client stream detect the end of the response
+
+    if (!swapFile_) {
+        const auto fd = INDEXSD(entry->swap_dirn)->openForSending(*entry);
+        if (fd < 0)
+            return false; // e.g., rock cache_dirs do not store entries in files
+        swapFile_ = new SwapFile(fd);
+    }
+
+    const auto size = std::min(bodySize - http->out.offset, MaxDiskBodyWrite);
+    const auto offset = swapHdrSz + bodyStart + http->out.offset;
+    debugs(33, 5, "writing " << size << " body bytes at " << http->out.offset <<
+           " from " << *entry << " file at " << offset);
+    noteSentBodyBytes(size);
+    getConn()->write(swapFile_, offset, size);
+    return true;
+}
+
 bool
 Http::Stream::multipartRangeRequest() const
 {
@@ -93,6 +93,16 @@ public:
     /// get more data to send
     void pullData();
 
+    /// Writes the next response body bytes straight from Store memory
+    /// pages, bypassing the client stream and its copying into reqbuf.
+    /// \returns whether a write was scheduled
+    bool sendBodyFromMemory();
+
+    /// Writes the next response body bytes straight from the cache_dir file
+    /// using sendfile(2), bypassing the client stream and Store reads.
+    /// \returns whether a write was scheduled
+    bool sendBodyFromDisk();
+
     /// \return true if the HTTP request is for multiple ranges
     bool multipartRangeRequest() const;
 
@@ -164,9 +174,11 @@ private:
     void packChunk(const StoreIOBuffer &bodyData, MemBuf &);
     void packRange(StoreIOBuffer const &, MemBuf *);
     void doClose();
+    StoreEntry *directlyWritableEntry() const;
 
     bool mayUseConnection_; /* This request may use the connection. Don't read anymore requests for now */
     bool connRegistered_;
+    Comm::SendableFilePointer swapFile_; ///< the cache_dir file exported by sendBodyFromDisk()
 #if USE_DELAY_POOLS
     MessageBucket::Pointer writeQuotaHandler; ///< response write limiter, if configured
 #endif
@@ -14,6 +14,7 @@
 #include "ip/forward.h"
 
 #include <iosfwd>
+#include <optional>
 #include <ostream>
 #if HAVE_SYS_SOCKET_H
 #include <sys/socket.h>
@@ -364,6 +365,16 @@ operator << (std::ostream &os, const Address &ipa)
     return os;
 }
 
+inline std::ostream &
+operator <<(std::ostream &os, const std::optional<Address> &optional)
+{
+    if (optional.has_value())
+        os << optional.value();
+    else
+        os << "[no IP]";
+    return os;
+}
+
 // WAS _sockaddr_in_list in an earlier incarnation
 class Address_list
 {
@@ -52,7 +52,7 @@ Ipc::StoreMap::Init(const SBuf &path, const int sliceLimit)
     return owner;
 }
 
-Ipc::StoreMap::StoreMap(const SBuf &aPath): cleaner(nullptr), path(aPath),
+Ipc::StoreMap::StoreMap(const SBuf &aPath): cleaner(nullptr), digester(nullptr), path(aPath),
     fileNos(shm_old(FileNos)(StoreMapFileNosId(path).c_str())),
     anchors(shm_old(Anchors)(StoreMapAnchorsId(path).c_str())),
     slices(shm_old(Slices)(StoreMapSlicesId(path).c_str())),
@@ -203,6 +203,7 @@ Ipc::StoreMap::closeForWriting(const sfileno fileno)
     Anchor &s = anchorAt(fileno);
     assert(s.writing());
     // TODO: assert(!s.empty()); // i.e., unlocked s becomes s.complete()
+    noteReadable(s);
     s.lock.unlockExclusive();
     debugs(54, 5, "closed entry " << fileno << " for writing " << path);
     // cannot assert completeness here because we have no lock
@@ -214,6 +215,7 @@ Ipc::StoreMap::switchWritingToReading(const sfileno fileno)
     debugs(54, 5, "switching entry " << fileno << " from writing to reading " << path);
     Anchor &s = anchorAt(fileno);
     assert(s.writing());
+    noteReadable(s);
     s.lock.switchExclusiveToShared();
     assert(s.complete());
 }
@@ -376,6 +378,8 @@ Ipc::StoreMap::freeChain(const sfileno fileno, Anchor &inode, const bool keepLoc
 {
     debugs(54, 7, "freeing entry " << fileno <<
            " in " << path);
+    if (inode.digested.exchange(false) && digester)
+        digester->noteFreedEntry(inode);
     if (!inode.empty())
         freeChainAt(inode.start, inode.splicingPoint);
     inode.rewind();
@@ -386,6 +390,14 @@ Ipc::StoreMap::freeChain(const sfileno fileno, Anchor &inode, const bool keepLoc
     debugs(54, 5, "freed entry " << fileno << " in " << path);
 }
 
+/// tells the digester (if any) about a write-locked entry becoming readable
+void
+Ipc::StoreMap::noteReadable(Anchor &inode)
+{
+    if (!inode.digested)
+        inode.digested = digester && !inode.empty() && digester->noteReadableEntry(inode);
+}
+
 /// unconditionally frees an already locked chain of slots; no anchor maintenance
 void
 Ipc::StoreMap::freeChainAt(SliceId sliceId, const SliceId splicingPoint)
@@ -489,6 +501,9 @@ Ipc::StoreMap::openForReadingAt(const sfileno fileno, const cache_key *const key
         return nullptr;
     }
 
+    if (!s.referenced)
+        s.referenced = true; // avoid needless writes of this shared flag
+
     debugs(54, 5, "opened entry " << fileno << " for reading " << path);
     return &s;
 }
@@ -629,6 +644,7 @@ Ipc::StoreMap::closeForUpdating(Update &update)
     // either way, fresh chain uses the stale chain suffix now
 
     // make the fresh anchor/chain readable for everybody
+    noteReadable(*update.fresh.anchor);
     update.fresh.anchor->lock.switchExclusiveToShared();
     // but the fresh anchor is still invisible to anybody but us
 
@@ -701,12 +717,23 @@ Ipc::StoreMap::visitVictims(const NameFilter visitor)
 bool
 Ipc::StoreMap::purgeOne()
 {
-    return visitVictims([&](const sfileno name) {
+    // CLOCK-like eviction: The shared anchors->victim "hand" sweeps entries,
+    // clearing reference bits of recently read entries instead of purging
+    // them. Second chances are limited so that we still find a victim when
+    // most entries are hot.
+    const int secondChanceLimit = min(10000, entryLimit()) / 2;
+    int secondChances = 0;
+    const auto purged = visitVictims([&](const sfileno name) {
         const sfileno fileno = fileNoByName(name);
         Anchor &s = anchorAt(fileno);
         if (s.lock.lockExclusive()) {
             // the caller wants a free slice; empty anchor is not enough
             if (!s.empty() && s.start >= 0) {
+                if (s.referenced.exchange(0) && !s.waitingToBeFreed && secondChances < secondChanceLimit) {
+                    ++secondChances;
+                    s.lock.unlockExclusive();
+                    return false;
+                }
                 // this entry may be marked for deletion, and that is OK
                 freeChain(fileno, s, false);
                 debugs(54, 5, "purged entry " << fileno << " from " << path);
@@ -716,6 +743,13 @@ Ipc::StoreMap::purgeOne()
         }
         return false;
     });
+
+    evictionStats_.secondChances += secondChances;
+    if (purged)
+        ++evictionStats_.evictions;
+    else
+        ++evictionStats_.failures;
+    return purged;
 }
 
 void
@@ -1009,6 +1043,8 @@ Ipc::StoreMapAnchor::rewind()
     basics.clear();
     waitingToBeFreed = false;
     writerHalted = false;
+    referenced = false;
+    digested = false;
     // but keep the lock
 }
 
@@ -1033,6 +1069,16 @@ Ipc::StoreMapUpdate::~StoreMapUpdate()
     entry->unlock("Ipc::StoreMapUpdate");
 }
 
+/* Ipc::StoreMap::EvictionStats */
+
+void
+Ipc::StoreMap::EvictionStats::dump(StoreEntry &e) const
+{
+    storeAppendPrintf(&e, "Evictions: %" PRIu64 "\n", evictions);
+    storeAppendPrintf(&e, "Eviction second chances: %" PRIu64 "\n", secondChances);
+    storeAppendPrintf(&e, "Eviction failures: %" PRIu64 "\n", failures);
+}
+
 /* Ipc::StoreMap::Owner */
 
 Ipc::StoreMap::Owner::Owner():
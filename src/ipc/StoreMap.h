@@ -81,6 +81,11 @@ public:
     std::atomic<uint8_t> waitingToBeFreed; ///< may be accessed w/o a lock
     /// whether StoreMap::abortWriting() was called for a read-locked entry
     std::atomic<uint8_t> writerHalted;
+    /// whether the entry was opened for reading since the last time the
+    /// StoreMap::purgeOne() "clock hand" passed it; may be accessed w/o a lock
+    std::atomic<uint8_t> referenced;
+    /// whether StoreMapDigester added this readable entry to its summary
+    std::atomic<uint8_t> digested;
 
     // fields marked with [app] can be modified when appending-while-reading
     // fields marked with [update] can be modified when updating-while-reading
@@ -210,6 +215,7 @@ public:
 };
 
 class StoreMapCleaner;
+class StoreMapDigester;
 
 /// Manages shared Store index (e.g., locking/unlocking/freeing entries) using
 /// StoreMapFileNos indexed by hashed entry keys (a.k.a. entry names),
@@ -228,6 +234,17 @@ public:
     typedef StoreMapUpdate Update;
 
 public:
+    /// this worker purgeOne() statistics
+    class EvictionStats
+    {
+    public:
+        void dump(StoreEntry &) const;
+
+        uint64_t evictions = 0; ///< entries purged
+        uint64_t secondChances = 0; ///< recently read entries skipped
+        uint64_t failures = 0; ///< purgeOne() calls that found no victim
+    };
+
     /// aggregates anchor and slice owners for Init() caller convenience
     class Owner
     {
@@ -336,9 +353,13 @@ public:
     /// stop writing the entry, freeing its slot for others to use if possible
     void abortWriting(const sfileno fileno);
 
-    /// either finds and frees an entry with at least 1 slice or returns false
+    /// Either finds and frees an entry with at least 1 slice or returns false.
+    /// Gives entries read since the previous visit a second chance (CLOCK).
     bool purgeOne();
 
+    /// purgeOne() statistics for this worker
+    const EvictionStats &evictionStats() const { return evictionStats_; }
+
     /// validates locked hit metadata and calls freeEntry() for invalid entries
     /// \returns whether hit metadata is correct
     bool validateHit(const sfileno);
@@ -359,6 +380,7 @@ public:
     void updateStats(ReadWriteLockStats &stats) const;
 
     StoreMapCleaner *cleaner; ///< notified before a readable entry is freed
+    StoreMapDigester *digester; ///< notified when entries become readable or are freed
 
 protected:
     const SBuf path; ///< cache_dir path or similar cache name; for logging
@@ -387,10 +409,13 @@ private:
     bool visitVictims(const NameFilter filter);
 
     void freeChain(const sfileno fileno, Anchor &inode, const bool keepLock);
+    void noteReadable(Anchor &inode);
     void freeChainAt(SliceId sliceId, const SliceId splicingPoint);
 
     /// whether paranoid_hit_validation should be performed
     bool hitValidation;
+
+    EvictionStats evictionStats_; ///< purgeOne() statistics for this worker
 };
 
 /// API for adjusting external state when dirty map slice is being freed
@@ -403,6 +428,20 @@ public:
     virtual void noteFreeMapSlice(const StoreMapSliceId sliceId) = 0;
 };
 
+/// StoreMap API for summarizing (e.g., digesting) readable entry keys
+class StoreMapDigester
+{
+public:
+    virtual ~StoreMapDigester() {}
+
+    /// Called when a writer makes the still locked entry readable.
+    /// \returns whether the entry was added to the summary
+    virtual bool noteReadableEntry(const StoreMapAnchor &) = 0;
+
+    /// Called before a locked entry previously added to the summary is freed.
+    virtual void noteFreedEntry(const StoreMapAnchor &) = 0;
+};
+
 } // namespace Ipc
 
 // We do not reuse FileMap because we cannot control its size,
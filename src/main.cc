@@ -1451,8 +1451,10 @@ RegisterModules()
     CallRunnerRegistrator(CollapsedForwardingRr);
     CallRunnerRegistrator(MemStoreRr);
     CallRunnerRegistrator(PeerPoolMgrsRr);
+    CallRunnerRegistrator(RefreshAheadRr);
     CallRunnerRegistrator(SharedMemPagesRr);
     CallRunnerRegistrator(SharedSessionCacheRr);
+    CallRunnerRegistrator(StoreAdmissionRr);
     CallRunnerRegistrator(TransientsRr);
     CallRunnerRegistratorIn(Dns, ConfigRr);
 
@@ -1464,10 +1466,30 @@ RegisterModules()
     CallRunnerRegistrator(NtlmAuthRr);
 #endif
 
+#if USE_ADAPTATION
+    CallRunnerRegistrator(AdaptationVerdictsRr);
+#endif
+
+#if ICAP_CLIENT
+    CallRunnerRegistrator(IcapStatsRr);
+#endif
+
+#if USE_DELAY_POOLS
+    CallRunnerRegistrator(SharedDelayBucketsRr);
+#endif
+
 #if USE_OPENSSL
+    CallRunnerRegistrator(CertGeneratorRr);
+    CallRunnerRegistrator(SharedCertificatesRr);
+    CallRunnerRegistrator(SharedOriginSessionsRr);
+    CallRunnerRegistrator(SharedTicketKeysRr);
     CallRunnerRegistrator(sslBumpCfgRr);
 #endif
 
+#if USE_SQUID_ESI
+    CallRunnerRegistratorIn(Esi, TemplateCacheRr);
+#endif
+
 #if USE_SQUID_ESI && HAVE_LIBEXPAT
     CallRunnerRegistratorIn(Esi, ExpatRr);
 #endif
@@ -46,7 +46,9 @@ memNodeWriteComplete(void* d)
 
 mem_node::mem_node(int64_t offset) :
     nodeBuffer(0,offset,data),
-    write_pending(false)
+    write_pending(false),
+    borrowers(0),
+    orphaned(false)
 {
     *data = 0;
 }
@@ -36,6 +36,11 @@ public:
     /* Private */
     char data[SM_PAGE_SIZE];
     bool write_pending;
+    /// the number of MemLoan objects using our data
+    uint32_t borrowers;
+    /// whether our mem_hdr has forgotten us while we were borrowed;
+    /// the last borrower destroys orphaned nodes
+    bool orphaned;
 };
 
 inline std::ostream &
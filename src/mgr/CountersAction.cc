@@ -51,6 +51,8 @@ Mgr::CountersActionData::operator += (const CountersActionData& stats)
     server_other_errors += stats.server_other_errors;
     server_other_kbytes_in += stats.server_other_kbytes_in;
     server_other_kbytes_out += stats.server_other_kbytes_out;
+    tls_kbytes_out += stats.tls_kbytes_out;
+    tls_ktls_kbytes_out += stats.tls_ktls_kbytes_out;
     icp_pkts_sent += stats.icp_pkts_sent;
     icp_pkts_recv += stats.icp_pkts_recv;
     icp_queries_sent += stats.icp_queries_sent;
@@ -47,6 +47,8 @@ public:
     double server_other_errors;
     double server_other_kbytes_in;
     double server_other_kbytes_out;
+    double tls_kbytes_out;
+    double tls_ktls_kbytes_out;
     double icp_pkts_sent;
     double icp_pkts_recv;
     double icp_queries_sent;
@@ -14,6 +14,7 @@
 #include "base/EnumIterator.h"
 #include "base/IoManip.h"
 #include "base/PackableStream.h"
+#include "base/Random.h"
 #include "CacheDigest.h"
 #include "CachePeer.h"
 #include "CachePeers.h"
@@ -38,6 +39,7 @@
 #include "NeighborTypeDomainList.h"
 #include "pconn.h"
 #include "PeerDigest.h"
+#include "PeerLatency.h"
 #include "PeerPoolMgr.h"
 #include "PeerSelectState.h"
 #include "RequestFlags.h"
@@ -48,6 +50,10 @@
 #include "store_key_md5.h"
 #include "tools.h"
 
+#include <algorithm>
+#include <random>
+#include <vector>
+
 /* count mcast group peers every 15 minutes */
 #define MCAST_COUNT_RATE 900
 
@@ -404,6 +410,69 @@ getWeightedRoundRobinParent(PeerSelector *ps)
     return q;
 }
 
+/// Selects a latency-aware parent using the "power of two choices" algorithm:
+/// Picks two random candidates and returns the one with the lower expected
+/// cost, based on observed response times, error rates, pending requests,
+/// and the configured weight.
+CachePeer *
+getLatencyAwareParent(PeerSelector *ps)
+{
+    assert(ps);
+    HttpRequest *request = ps->request;
+
+    std::vector<CachePeer *> candidates;
+    size_t ejected = 0;
+
+    for (const auto &peer: CurrentCachePeers()) {
+        const auto p = peer.get();
+
+        if (!p->options.latency_aware)
+            continue;
+
+        if (neighborType(p, request->url) != PEER_PARENT)
+            continue;
+
+        if (!peerHTTPOkay(p, ps))
+            continue;
+
+        if (p->weight == 0)
+            continue;
+
+        if (p->latency.ejectedUntil > squid_curtime) {
+            ++ejected;
+            continue;
+        }
+
+        if (p->latency.ejectedUntil) {
+            debugs(15, 2, "ejection ended for " << *p);
+            p->latency.ejectedUntil = 0;
+            // judge the returning peer by its new transactions only
+            p->latency.responseSamples = 0;
+            p->latency.errorSamples = 0;
+            p->latency.errorRate = 0;
+        }
+
+        candidates.push_back(p);
+    }
+
+    peerLatencyEjectOutliers(candidates, ejected);
+
+    CachePeer *q = nullptr;
+    if (candidates.size() == 1) {
+        q = candidates.front();
+    } else if (candidates.size() > 1) {
+        static std::mt19937 rng(RandomSeed32());
+        const auto first = std::uniform_int_distribution<size_t>(0, candidates.size() - 1)(rng);
+        const auto offset = std::uniform_int_distribution<size_t>(1, candidates.size() - 1)(rng);
+        const auto a = candidates[first];
+        const auto b = candidates[(first + offset) % candidates.size()];
+        q = peerLatencyCost(*a) <= peerLatencyCost(*b) ? a : b;
+    }
+
+    debugs(15, 3, "returning " << RawPointer(q).orNil());
+    return q;
+}
+
 /**
  * This gets called every 5 minutes to clear the round-robin counter.
  * The exact timing is an arbitrary default, set on estimate timing of a
@@ -1404,6 +1473,9 @@ dump_peer_options(StoreEntry * sentry, CachePeer * p)
     if (p->options.weighted_roundrobin)
         os << " weighted-round-robin";
 
+    if (p->options.latency_aware)
+        os << " latency-aware";
+
     if (p->options.mcast_responder)
         os << " multicast-responder";
 
@@ -1533,6 +1605,17 @@ dump_peers(StoreEntry *sentry, CachePeers *peers)
         storeAppendPrintf(sentry, "FETCHES    : %d\n", e->stats.fetches);
         storeAppendPrintf(sentry, "OPEN CONNS : %d\n", e->stats.conn_open);
         storeAppendPrintf(sentry, "AVG RTT    : %d msec\n", e->stats.rtt);
+        storeAppendPrintf(sentry, "AVG CONNECT: %.1f msec\n", e->latency.connectTime);
+        storeAppendPrintf(sentry, "AVG RESPONS: %.1f msec\n", e->latency.responseTime);
+        storeAppendPrintf(sentry, "ERROR RATE : %.1f%%\n", 100 * e->latency.errorRate);
+        storeAppendPrintf(sentry, "PENDING    : %d\n", e->latency.pending);
+
+        if (e->options.latency_aware) {
+            storeAppendPrintf(sentry, "EJECTIONS  : %d\n", e->latency.ejections);
+            if (e->latency.ejectedUntil > squid_curtime)
+                storeAppendPrintf(sentry, "EJECTED FOR: %d seconds\n",
+                                  static_cast<int>(e->latency.ejectedUntil - squid_curtime));
+        }
 
         if (!e->options.no_query) {
             storeAppendPrintf(sentry, "LAST QUERY : %8d seconds ago\n",
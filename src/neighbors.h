@@ -47,6 +47,7 @@ CachePeer *findCachePeerByName(const char *);
 CachePeer *getDefaultParent(PeerSelector*);
 CachePeer *getRoundRobinParent(PeerSelector*);
 CachePeer *getWeightedRoundRobinParent(PeerSelector*);
+CachePeer *getLatencyAwareParent(PeerSelector*);
 void peerClearRRStart(void);
 void peerClearRR(void);
 
@@ -20,31 +20,53 @@
 #include "neighbors.h"
 #include "pconn.h"
 #include "PeerPoolMgr.h"
+#include "sbuf/Algorithms.h"
 #include "SquidConfig.h"
 #include "Store.h"
 
-#define PCONN_FDS_SZ    8   /* pconn set size, increase for better memcache hit rate */
+#include <algorithm>
 
 //TODO: re-attach to MemPools. WAS: static Mem::Allocator *pconn_fds_pool = nullptr;
 PconnModule * PconnModule::instance = nullptr;
 CBDATA_CLASS_INIT(IdleConnList);
 
+/* ========== PconnKey ============================================ */
+
+PconnKey::PconnKey(const Comm::ConnectionPointer &destLink, const char *aDomain):
+    remote(destLink->remote)
+{
+    // when connecting through a cache_peer, ignore the final destination
+    if (aDomain && !destLink->getPeer())
+        domain.assign(aDomain);
+}
+
+size_t
+PconnKeyHash::operator()(const PconnKey &key) const
+{
+    return IdleConnAddressHash(key.remote) ^ (std::hash<SBuf>()(key.domain) * 31);
+}
+
 /* ========== IdleConnList ============================================ */
 
-IdleConnList::IdleConnList(const char *aKey, PconnPool *thePool) :
-    capacity_(PCONN_FDS_SZ),
-    size_(0),
+IdleConnList::IdleConnList(const PconnKey &aKey, PconnPool *thePool) :
+    key(aKey),
     parent_(thePool)
 {
-    //Initialize hash_link members
-    key = xstrdup(aKey);
-    next = nullptr;
-
-    theList_ = new Comm::ConnectionPointer[capacity_];
+    char buf[MAX_IPSTRLEN];
+    description_.assign(key.remote.toUrl(buf, sizeof(buf)));
+    if (!key.domain.isEmpty()) {
+        description_.append('/');
+        description_.append(key.domain);
+    }
 
     registerRunner();
+}
 
-// TODO: re-attach to MemPools. WAS: theList = (?? *)pconn_fds_pool->alloc();
+IdleConnList::IdleConnList(const char *aDescription, PconnPool *thePool) :
+    parent_(thePool)
+{
+    description_.assign(aDescription);
+    registerRunner();
 }
 
 IdleConnList::~IdleConnList()
@@ -52,106 +74,46 @@ IdleConnList::~IdleConnList()
     if (parent_)
         parent_->unlinkList(this);
 
-    if (size_) {
+    if (!index.empty()) {
         parent_ = nullptr; // prevent reentrant notifications and deletions
-        closeN(size_);
-    }
-
-    delete[] theList_;
-
-    xfree(key);
-}
-
-/** Search the list. Matches by FD socket number.
- * Performed from the end of list where newest entries are.
- *
- * \retval <0   The connection is not listed
- * \retval >=0  The connection array index
- */
-int
-IdleConnList::findIndexOf(const Comm::ConnectionPointer &conn) const
-{
-    for (int index = size_ - 1; index >= 0; --index) {
-        if (conn->fd == theList_[index]->fd) {
-            debugs(48, 3, "found " << conn << " at index " << index);
-            return index;
-        }
+        closeN(index.size());
     }
-
-    debugs(48, 2, conn << " NOT FOUND!");
-    return -1;
 }
 
-/** Remove the entry at specified index.
- * May perform a shuffle of list entries to fill the gap.
- * \retval false The index is not an in-use entry.
- */
-bool
-IdleConnList::removeAt(int index)
+/// Updates stats after a connection was removed from the index.
+/// Deletes us if we have no connections left.
+void
+IdleConnList::noteRemoval()
 {
-    if (index < 0 || index >= size_)
-        return false;
-
-    // shuffle the remaining entries to fill the new gap.
-    for (; index < size_ - 1; ++index)
-        theList_[index] = theList_[index + 1];
-    theList_[--size_] = nullptr;
-
     if (parent_) {
         parent_->noteConnectionRemoved();
-        if (size_ == 0) {
-            debugs(48, 3, "deleting " << hashKeyStr(this));
+        if (index.empty()) {
+            debugs(48, 3, "deleting " << description_);
             delete this;
         }
     }
-
-    return true;
 }
 
-// almost a duplicate of removeFD. But drops multiple entries.
+/// closes the oldest n connections
 void
 IdleConnList::closeN(size_t n)
 {
     if (n < 1) {
         debugs(48, 2, "Nothing to do.");
         return;
-    } else if (n >= (size_t)size_) {
-        debugs(48, 2, "Closing all entries.");
-        while (size_ > 0) {
-            const Comm::ConnectionPointer conn = theList_[--size_];
-            theList_[size_] = nullptr;
-            clearHandlers(conn);
-            conn->close();
-            if (parent_)
-                parent_->noteConnectionRemoved();
-        }
-    } else { //if (n < size_)
-        debugs(48, 2, "Closing " << n << " of " << size_ << " entries.");
-
-        size_t index;
-        // ensure the first N entries are closed
-        for (index = 0; index < n; ++index) {
-            const Comm::ConnectionPointer conn = theList_[index];
-            theList_[index] = nullptr;
-            clearHandlers(conn);
-            conn->close();
-            if (parent_)
-                parent_->noteConnectionRemoved();
-        }
-        // shuffle the list N down.
-        for (index = 0; index < (size_t)size_ - n; ++index) {
-            theList_[index] = theList_[index + n];
-        }
-        // ensure the last N entries are unset
-        while (index < ((size_t)size_)) {
-            theList_[index] = nullptr;
-            ++index;
-        }
-        size_ -= n;
     }
 
-    if (parent_ && size_ == 0) {
-        debugs(48, 3, "deleting " << hashKeyStr(this));
+    debugs(48, 2, "Closing " << std::min(n, index.size()) << " of " << index.size() << " entries.");
+    for (size_t i = 0; i < n && !index.empty(); ++i) {
+        const auto conn = index.popOldest();
+        clearHandlers(conn);
+        conn->close();
+        if (parent_)
+            parent_->noteConnectionRemoved();
+    }
+
+    if (parent_ && index.empty()) {
+        debugs(48, 3, "deleting " << description_);
         delete this;
     }
 }
@@ -167,22 +129,11 @@ IdleConnList::clearHandlers(const Comm::ConnectionPointer &conn)
 void
 IdleConnList::push(const Comm::ConnectionPointer &conn)
 {
-    if (size_ == capacity_) {
-        debugs(48, 3, "growing idle Connection array");
-        capacity_ <<= 1;
-        const Comm::ConnectionPointer *oldList = theList_;
-        theList_ = new Comm::ConnectionPointer[capacity_];
-        for (int index = 0; index < size_; ++index)
-            theList_[index] = oldList[index];
-
-        delete[] oldList;
-    }
+    index.push(conn);
 
     if (parent_)
         parent_->noteConnectionAdded();
 
-    theList_[size_] = conn;
-    ++size_;
     AsyncCall::Pointer readCall = commCbCall(5,4, "IdleConnList::Read",
                                   CommIoCbPtrFun(IdleConnList::Read, this));
     comm_read(conn, fakeReadBuf_, sizeof(fakeReadBuf_), readCall);
@@ -191,13 +142,11 @@ IdleConnList::push(const Comm::ConnectionPointer &conn)
     commSetConnTimeout(conn, conn->timeLeft(Config.Timeout.serverIdlePconn), timeoutCall);
 }
 
-/// Determine whether an entry in the idle list is available for use.
-/// Returns false if the entry is unset, closed or closing.
+/// Determine whether a listed connection can be used now.
+/// Returns false if the connection is closed or closing.
 bool
-IdleConnList::isAvailable(int i) const
+IdleConnList::isAvailable(const Comm::ConnectionPointer &conn) const
 {
-    const Comm::ConnectionPointer &conn = theList_[i];
-
     // connection already closed. useless.
     if (!Comm::IsConnOpen(conn))
         return false;
@@ -206,92 +155,66 @@ IdleConnList::isAvailable(int i) const
     if (!COMMIO_FD_READCB(conn->fd)->active())
         return false;
 
+    // our connection timeout handler is scheduled to run already. unsafe for now.
+    // TODO: cancel the pending timeout callback and allow re-use of the conn.
+    if (fd_table[conn->fd].timeoutHandler == nullptr)
+        return false;
+
     return true;
 }
 
 Comm::ConnectionPointer
 IdleConnList::pop()
 {
-    for (int i=size_-1; i>=0; --i) {
-
-        if (!isAvailable(i))
-            continue;
-
-        // our connection timeout handler is scheduled to run already. unsafe for now.
-        // TODO: cancel the pending timeout callback and allow re-use of the conn.
-        if (fd_table[theList_[i]->fd].timeoutHandler == nullptr)
-            continue;
-
-        // finally, a match. pop and return it.
-        Comm::ConnectionPointer result = theList_[i];
-        clearHandlers(result);
-        /* may delete this */
-        removeAt(i);
-        return result;
-    }
+    const Ip::Address anyLocalAddress;
+    return popUseable(anyLocalAddress);
+}
 
-    return Comm::ConnectionPointer();
+Comm::ConnectionPointer
+IdleConnList::findUseable(const Comm::ConnectionPointer &aKey)
+{
+    assert(!index.empty());
+    return popUseable(aKey->local);
 }
 
 /*
- * XXX this routine isn't terribly efficient - if there's a pending
- * read event (which signifies the fd will close in the next IO loop!)
- * we ignore the FD and move onto the next one. This means, as an example,
- * if we have a lot of FDs open to a very popular server and we get a bunch
- * of requests JUST as they timeout (say, it shuts down) we'll be wasting
- * quite a bit of CPU. Just keep it in mind.
+ * Returns the most recently pushed usable connection. Unusable connections
+ * (i.e. connections with scheduled closure or timeout handlers) are skipped,
+ * but they are rare because their handlers remove them soon.
  */
 Comm::ConnectionPointer
-IdleConnList::findUseable(const Comm::ConnectionPointer &aKey)
+IdleConnList::popUseable(const Ip::Address &local)
 {
-    assert(size_);
+    const auto result = index.popNewest(local, [this](const Comm::ConnectionPointer &conn) {
+        return isAvailable(conn);
+    });
 
-    // small optimization: do the constant bool tests only once.
-    const bool keyCheckAddr = !aKey->local.isAnyAddr();
-    const bool keyCheckPort = aKey->local.port() > 0;
-
-    for (int i=size_-1; i>=0; --i) {
-
-        if (!isAvailable(i))
-            continue;
-
-        // local end port is required, but do not match.
-        if (keyCheckPort && aKey->local.port() != theList_[i]->local.port())
-            continue;
-
-        // local address is required, but does not match.
-        if (keyCheckAddr && aKey->local.matchIPAddr(theList_[i]->local) != 0)
-            continue;
-
-        // our connection timeout handler is scheduled to run already. unsafe for now.
-        // TODO: cancel the pending timeout callback and allow re-use of the conn.
-        if (fd_table[theList_[i]->fd].timeoutHandler == nullptr)
-            continue;
-
-        // finally, a match. pop and return it.
-        Comm::ConnectionPointer result = theList_[i];
-        clearHandlers(result);
-        /* may delete this */
-        removeAt(i);
-        return result;
-    }
+    if (!result)
+        return Comm::ConnectionPointer();
 
-    return Comm::ConnectionPointer();
+    // finally, a match. pop and return it.
+    clearHandlers(result);
+    /* may delete this */
+    noteRemoval();
+    return result;
 }
 
 /* might delete list */
 void
 IdleConnList::findAndClose(const Comm::ConnectionPointer &conn)
 {
-    const int index = findIndexOf(conn);
-    if (index >= 0) {
+    if (index.remove(conn)) {
+        debugs(48, 3, "found " << conn);
         if (parent_)
             parent_->notifyManager("idle conn closure");
         clearHandlers(conn);
         /* might delete this */
-        removeAt(index);
+        noteRemoval();
         conn->close();
+        return;
     }
+
+    debugs(48, 2, conn << " NOT FOUND!");
 }
 
 void
@@ -322,31 +245,11 @@ IdleConnList::Timeout(const CommTimeoutCbParams &io)
 void
 IdleConnList::endingShutdown()
 {
-    closeN(size_);
+    closeN(index.size());
 }
 
 /* ========== PconnPool PRIVATE FUNCTIONS ============================================ */
 
-const char *
-PconnPool::key(const Comm::ConnectionPointer &destLink, const char *domain)
-{
-    LOCAL_ARRAY(char, buf, SQUIDHOSTNAMELEN * 3 + 10);
-
-    destLink->remote.toUrl(buf, SQUIDHOSTNAMELEN * 3 + 10);
-
-    // when connecting through a cache_peer, ignore the final destination
-    if (destLink->getPeer())
-        domain = nullptr;
-
-    if (domain) {
-        const int used = strlen(buf);
-        snprintf(buf+used, SQUIDHOSTNAMELEN * 3 + 10-used, "/%s", domain);
-    }
-
-    debugs(48,6,"PconnPool::key(" << destLink << ", " << (domain?domain:"[no domain]") << ") is {" << buf << "}" );
-    return buf;
-}
-
 void
 PconnPool::dumpHist(StoreEntry * e) const
 {
@@ -368,12 +271,9 @@ PconnPool::dumpHist(StoreEntry * e) const
 void
 PconnPool::dumpHash(StoreEntry *e) const
 {
-    hash_table *hid = table;
-    hash_first(hid);
-
     int i = 0;
-    for (hash_link *walker = hash_next(hid); walker; walker = hash_next(hid)) {
-        storeAppendPrintf(e, "\t item %d:\t%s\n", i, (char *)(walker->key));
+    for (const auto &item: lists) {
+        storeAppendPrintf(e, "\t item %d:\t" SQUIDSBUFPH "\n", i, SQUIDSBUFPRINT(item.second->description()));
         ++i;
     }
 }
@@ -381,30 +281,22 @@ PconnPool::dumpHash(StoreEntry *e) const
 /* ========== PconnPool PUBLIC FUNCTIONS ============================================ */
 
 PconnPool::PconnPool(const char *aDescr, const CbcPointer<PeerPoolMgr> &aMgr):
-    table(nullptr), descr(aDescr),
+    descr(aDescr),
     mgr(aMgr),
     theCount(0)
 {
     int i;
-    table = hash_create((HASHCMP *) strcmp, 229, hash_string);
-
     for (i = 0; i < PCONN_HIST_SZ; ++i)
         hist[i] = 0;
 
     PconnModule::GetInstance()->add(this);
 }
 
-static void
-DeleteIdleConnList(void *hashItem)
-{
-    delete static_cast<IdleConnList*>(hashItem);
-}
-
 PconnPool::~PconnPool()
 {
     PconnModule::GetInstance()->remove(this);
-    hashFreeItems(table, &DeleteIdleConnList);
-    hashFreeMemory(table);
+    while (!lists.empty())
+        delete lists.begin()->second; // unlinks itself
     descr = nullptr;
 }
 
@@ -422,24 +314,23 @@ PconnPool::push(const Comm::ConnectionPointer &conn, const char *domain)
     }
     // TODO: also close used pconns if we exceed peer max-conn limit
 
-    const char *aKey = key(conn, domain);
-    IdleConnList *list = (IdleConnList *) hash_lookup(table, aKey);
+    const PconnKey aKey(conn, domain);
+    auto &list = lists[aKey];
 
     if (list == nullptr) {
         list = new IdleConnList(aKey, this);
-        debugs(48, 3, "new IdleConnList for {" << hashKeyStr(list) << "}" );
-        hash_join(table, list);
+        debugs(48, 3, "new IdleConnList for {" << list->description() << "}" );
     } else {
-        debugs(48, 3, "found IdleConnList for {" << hashKeyStr(list) << "}" );
+        debugs(48, 3, "found IdleConnList for {" << list->description() << "}" );
     }
 
     list->push(conn);
     assert(!comm_has_incomplete_write(conn->fd));
 
     LOCAL_ARRAY(char, desc, FD_DESC_SZ);
-    snprintf(desc, FD_DESC_SZ, "Idle server: %s", aKey);
+    snprintf(desc, FD_DESC_SZ, "Idle server: " SQUIDSBUFPH, SQUIDSBUFPRINT(list->description()));
     fd_note(conn->fd, desc);
-    debugs(48, 3, "pushed " << conn << " for " << aKey);
+    debugs(48, 3, "pushed " << conn << " for " << list->description());
 
     // successful push notifications resume multi-connection opening sequence
     notifyManager("push");
@@ -467,19 +358,18 @@ PconnPool::pop(const Comm::ConnectionPointer &dest, const char *domain, bool kee
 Comm::ConnectionPointer
 PconnPool::popStored(const Comm::ConnectionPointer &dest, const char *domain, const bool keepOpen)
 {
-    const char * aKey = key(dest, domain);
-
-    IdleConnList *list = (IdleConnList *)hash_lookup(table, aKey);
-    if (list == nullptr) {
-        debugs(48, 3, "lookup for key {" << aKey << "} failed.");
+    const auto found = lists.find(PconnKey(dest, domain));
+    if (found == lists.end()) {
+        debugs(48, 3, "lookup for " << dest << " and " << (domain ? domain : "[no domain]") << " failed.");
         // failure notifications resume standby conn creation after fdUsageHigh
         notifyManager("pop lookup failure");
         return Comm::ConnectionPointer();
-    } else {
-        debugs(48, 3, "found " << hashKeyStr(list) <<
-               (keepOpen ? " to use" : " to kill"));
     }
 
+    const auto list = found->second;
+    debugs(48, 3, "found " << list->description() <<
+           (keepOpen ? " to use" : " to kill"));
+
     if (const auto popped = list->findUseable(dest)) { // may delete list
         // successful pop notifications replenish standby connections pool
         notifyManager("pop");
@@ -496,6 +386,13 @@ PconnPool::popStored(const Comm::ConnectionPointer &dest, const char *domain, co
     return Comm::ConnectionPointer();
 }
 
+int
+PconnPool::count(const Comm::ConnectionPointer &dest, const char *domain) const
+{
+    const auto found = lists.find(PconnKey(dest, domain));
+    return found == lists.end() ? 0 : found->second->count();
+}
+
 void
 PconnPool::notifyManager(const char *reason)
 {
@@ -506,21 +403,18 @@ PconnPool::notifyManager(const char *reason)
 void
 PconnPool::closeN(int n)
 {
-    hash_table *hid = table;
-    hash_first(hid);
-
     // close N connections, one per list, to treat all lists "fairly"
+    auto current = lists.begin();
     for (int i = 0; i < n && count(); ++i) {
-
-        hash_link *current = hash_next(hid);
-        if (!current) {
-            hash_first(hid);
-            current = hash_next(hid);
-            Must(current); // must have one because the count() was positive
+        if (current == lists.end()) {
+            current = lists.begin();
+            Must(current != lists.end()); // must have one because the count() was positive
         }
 
-        // may delete current
-        static_cast<IdleConnList*>(current)->closeN(1);
+        const auto list = current->second;
+        ++current; // before closeN() erases the current list
+        // may delete list
+        list->closeN(1);
     }
 }
 
@@ -529,7 +423,7 @@ PconnPool::unlinkList(IdleConnList *list)
 {
     theCount -= list->count();
     assert(theCount >= 0);
-    hash_remove_link(table, list);
+    lists.erase(list->key);
 }
 
 void
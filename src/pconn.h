@@ -24,22 +24,51 @@ class PconnPool;
 class PeerPoolMgr;
 
 #include "cbdata.h"
-#include "hash.h"
 /* for IOCB */
 #include "comm.h"
+#include "IdleConnIndex.h"
+#include "sbuf/SBuf.h"
+
+#include <unordered_map>
 
 /// \ingroup PConnAPI
 #define PCONN_HIST_SZ (1<<16)
 
+/** \ingroup PConnAPI
+ * Identifies a destination end-point of interchangeable connections.
+ */
+class PconnKey
+{
+public:
+    PconnKey() = default;
+    PconnKey(const Comm::ConnectionPointer &destLink, const char *domain);
+
+    bool operator ==(const PconnKey &other) const {
+        return remote.compareWhole(other.remote) == 0 && domain == other.domain;
+    }
+
+    Ip::Address remote; ///< server IP address and port
+    SBuf domain; ///< origin server name; empty for cache_peer connections
+};
+
+/// std::hash replacement for PconnKey
+class PconnKeyHash
+{
+public:
+    size_t operator()(const PconnKey &) const;
+};
+
 /** \ingroup PConnAPI
  * A list of connections currently open to a particular destination end-point.
  */
-class IdleConnList: public hash_link, private IndependentRunner
+class IdleConnList: private IndependentRunner
 {
     CBDATA_CLASS(IdleConnList);
 
 public:
-    IdleConnList(const char *key, PconnPool *parent);
+    IdleConnList(const PconnKey &key, PconnPool *parent);
+    /// creates a list of connections to a destination described by the caller
+    IdleConnList(const char *description, PconnPool *parent);
     ~IdleConnList() override;
 
     /// Pass control of the connection to the idle list.
@@ -58,31 +87,35 @@ public:
 
     void clearHandlers(const Comm::ConnectionPointer &conn);
 
-    int count() const { return size_; }
+    int count() const { return index.size(); }
     void closeN(size_t count);
 
+    /// the destination end-point in a human-friendly form
+    const SBuf &description() const { return description_; }
+
     // IndependentRunner API
     void endingShutdown() override;
+
+    /// the destination end-point of listed connections
+    const PconnKey key;
+
 private:
-    bool isAvailable(int i) const;
-    bool removeAt(int index);
-    int findIndexOf(const Comm::ConnectionPointer &conn) const;
+    bool isAvailable(const Comm::ConnectionPointer &conn) const;
+    Comm::ConnectionPointer popUseable(const Ip::Address &local);
+    void noteRemoval();
     void findAndClose(const Comm::ConnectionPointer &conn);
     static IOCB Read;
     static CTCB Timeout;
 
 private:
-    /** List of connections we are holding.
-     * Sorted as FIFO list for most efficient speeds on pop() and findUsable()
-     * The worst-case pop() and scans occur on timeout and link closure events
-     * where timing is less critical. Occasional slow additions are okay.
+    /** Connections we are holding.
+     * Indexed for constant-time pop(), findUseable(), and removals upon
+     * timeout and link closure events.
      */
-    Comm::ConnectionPointer *theList_;
+    IdleConnIndex<Comm::Connection> index;
 
-    /// Number of entries theList can currently hold without re-allocating (capacity).
-    int capacity_;
-    ///< Number of in-use entries in theList
-    int size_;
+    /// cached description()
+    SBuf description_;
 
     /** The pool containing this sub-list.
      * The parent performs all stats accounting, and
@@ -99,9 +132,6 @@ private:
 class StoreEntry;
 class IdleConnLimit;
 
-/* for hash_table */
-#include "hash.h"
-
 /** \ingroup PConnAPI
  * Manages idle persistent connections to a caller-defined set of
  * servers (e.g., all HTTP servers). Uses a collection of IdleConnLists
@@ -140,6 +170,8 @@ public:
     /// closes any n connections, regardless of their destination
     void closeN(int n);
     int count() const { return theCount; }
+    /// the number of idle connections to the given destination
+    int count(const Comm::ConnectionPointer &dest, const char *domain) const;
     void noteConnectionAdded() { ++theCount; }
     void noteConnectionRemoved() { assert(theCount > 0); --theCount; }
 
@@ -148,12 +180,13 @@ public:
 
 private:
 
-    static const char *key(const Comm::ConnectionPointer &destLink, const char *domain);
-
     Comm::ConnectionPointer popStored(const Comm::ConnectionPointer &dest, const char *domain, const bool keepOpen);
 
+    /// idle connection lists indexed by their destination end-points
+    typedef std::unordered_map<PconnKey, IdleConnList*, PconnKeyHash> Lists;
+
     int hist[PCONN_HIST_SZ];
-    hash_table *table;
+    Lists lists;
     const char *descr;
     CbcPointer<PeerPoolMgr> mgr; ///< optional pool manager (for notifications)
     int theCount; ///< the number of pooled connections
@@ -851,6 +851,8 @@ PeerSelector::selectSomeParent()
         code = ROUNDROBIN_PARENT;
     } else if ((p = getWeightedRoundRobinParent(this))) {
         code = ROUNDROBIN_PARENT;
+    } else if ((p = getLatencyAwareParent(this))) {
+        code = LATENCY_PARENT;
     } else if ((p = getFirstUpParent(this))) {
         code = FIRSTUP_PARENT;
     } else if ((p = getDefaultParent(this))) {
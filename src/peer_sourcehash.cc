@@ -15,6 +15,7 @@
 #include "mgr/Registration.h"
 #include "neighbors.h"
 #include "peer_sourcehash.h"
+#include "PeerHashTable.h"
 #include "PeerSelectState.h"
 #include "SquidConfig.h"
 #include "Store.h"
@@ -31,6 +32,14 @@ SourceHashPeers()
     return *hashPeers;
 }
 
+/// consistent hashing table for sourcehash cache_peers (if enabled)
+static auto &
+SourceHashTable()
+{
+    static const auto hashTable = new PeerHashTable();
+    return *hashTable;
+}
+
 static OBJH peerSourceHashCachemgr;
 static void peerSourceHashRegisterWithCacheManager(void);
 
@@ -51,6 +60,7 @@ peerSourceHashInit(void)
     /* Clean up */
 
     SourceHashPeers().clear();
+    SourceHashTable().clear();
     /* find out which peers we have */
 
     RawCachePeers rawSourceHashPeers;
@@ -75,6 +85,11 @@ peerSourceHashInit(void)
     if (rawSourceHashPeers.empty())
         return;
 
+    if (PeerHashTable::Enabled()) {
+        SourceHashTable().reset(rawSourceHashPeers);
+        debugs(39, DBG_IMPORTANT, "Using consistent hashing for " << rawSourceHashPeers.size() << " sourcehash cache_peer(s)");
+    }
+
     /* calculate hashes and load factors */
     for (const auto &p: rawSourceHashPeers) {
         /* calculate this peers hash */
@@ -160,6 +175,13 @@ peerSourceHashSelectParent(PeerSelector *ps)
     for (c = key; *c != 0; ++c)
         user_hash += ROTATE_LEFT(user_hash, 19) + *c;
 
+    if (!SourceHashTable().isEmpty()) {
+        p = SourceHashTable().select(user_hash, ps);
+        if (p)
+            debugs(39, 2, "selected " << *p);
+        return p;
+    }
+
     /* select CachePeer */
     for (const auto &tp: SourceHashPeers()) {
         if (!tp)
@@ -210,5 +232,7 @@ peerSourceHashCachemgr(StoreEntry * sentry)
                           p->sourcehash.load_factor,
                           sumfetches ? (double) p->stats.fetches / sumfetches : -1.0);
     }
+
+    SourceHashTable().dump(sentry);
 }
 
@@ -20,6 +20,7 @@
 #include "mgr/Registration.h"
 #include "neighbors.h"
 #include "peer_userhash.h"
+#include "PeerHashTable.h"
 #include "PeerSelectState.h"
 #include "SquidConfig.h"
 #include "Store.h"
@@ -36,6 +37,14 @@ UserHashPeers()
     return *hashPeers;
 }
 
+/// consistent hashing table for userhash cache_peers (if enabled)
+static auto &
+UserHashTable()
+{
+    static const auto hashTable = new PeerHashTable();
+    return *hashTable;
+}
+
 static OBJH peerUserHashCachemgr;
 static void peerUserHashRegisterWithCacheManager(void);
 
@@ -56,6 +65,7 @@ peerUserHashInit(void)
     /* Clean up */
 
     UserHashPeers().clear();
+    UserHashTable().clear();
     /* find out which peers we have */
 
     peerUserHashRegisterWithCacheManager();
@@ -80,6 +90,11 @@ peerUserHashInit(void)
     if (rawUserHashPeers.empty())
         return;
 
+    if (PeerHashTable::Enabled()) {
+        UserHashTable().reset(rawUserHashPeers);
+        debugs(39, DBG_IMPORTANT, "Using consistent hashing for " << rawUserHashPeers.size() << " userhash cache_peer(s)");
+    }
+
     /* calculate hashes and load factors */
     for (const auto &p: rawUserHashPeers) {
         /* calculate this peers hash */
@@ -168,6 +183,13 @@ peerUserHashSelectParent(PeerSelector *ps)
     for (c = key; *c != 0; ++c)
         user_hash += ROTATE_LEFT(user_hash, 19) + *c;
 
+    if (!UserHashTable().isEmpty()) {
+        p = UserHashTable().select(user_hash, ps);
+        if (p)
+            debugs(39, 2, "selected " << *p);
+        return p;
+    }
+
     /* select CachePeer */
     for (const auto &tp: UserHashPeers()) {
         if (!tp)
@@ -218,6 +240,8 @@ peerUserHashCachemgr(StoreEntry * sentry)
                           p->userhash.load_factor,
                           sumfetches ? (double) p->stats.fetches / sumfetches : -1.0);
     }
+
+    UserHashTable().dump(sentry);
 }
 
 #endif /* USE_AUTH */
@@ -62,6 +62,7 @@ enum {
     FRESH_MIN_RULE,
     FRESH_OVERRIDE_EXPIRES,
     FRESH_OVERRIDE_LASTMOD,
+    FRESH_STALE_WHILE_REVALIDATE,
     STALE_MUST_REVALIDATE = 200,
     STALE_RELOAD_INTO_IMS,
     STALE_FORCED_RELOAD,
@@ -238,6 +239,7 @@ refreshStaleness(const StoreEntry * entry, time_t check_time, const time_t age,
  *  - FRESH_MIN_RULE
  *  - FRESH_OVERRIDE_EXPIRES
  *  - FRESH_OVERRIDE_LASTMOD
+ *  - FRESH_STALE_WHILE_REVALIDATE
  *  - STALE_MUST_REVALIDATE
  *  - STALE_RELOAD_INTO_IMS
  *  - STALE_FORCED_RELOAD
@@ -252,9 +254,12 @@ refreshStaleness(const StoreEntry * entry, time_t check_time, const time_t age,
  *
  * \note the store entry being examined is not necessarily cached (e.g. if
  *       this response is being evaluated for the first time)
+ *
+ * \param mayRevalidateInBackground whether a stale response may be served
+ *        while it is being revalidated in the background (RFC 5861)
  */
 static int
-refreshCheck(const StoreEntry * entry, HttpRequest * request, time_t delta)
+refreshCheck(const StoreEntry * entry, HttpRequest * request, time_t delta, const bool mayRevalidateInBackground = false)
 {
     time_t age = 0;
     time_t check_time = squid_curtime + delta;
@@ -475,6 +480,16 @@ refreshCheck(const StoreEntry * entry, HttpRequest * request, time_t delta)
         return STALE_MAX_STALE;
     }
 
+    // RFC 5861: Cache-Control: stale-while-revalidate=N allows serving a
+    // stale response while it is being revalidated in the background
+    int staleWhileRevalidate = -1;
+    if (mayRevalidateInBackground && reply && reply->cache_control &&
+            reply->cache_control->hasStaleWhileRevalidate(&staleWhileRevalidate) &&
+            staleness <= staleWhileRevalidate) {
+        debugs(22, 3, "NO: Serving stale response while revalidating it - 'Cache-Control: stale-while-revalidate=" << staleWhileRevalidate << "'");
+        return FRESH_STALE_WHILE_REVALIDATE;
+    }
+
     if (sf.expires) {
 #if USE_HTTP_VIOLATIONS
 
@@ -563,6 +578,36 @@ refreshIsStaleIfHit(const int reason)
     }
 }
 
+/// whether a hit on the given entry should trigger its background revalidation
+/// (i.e. whether refresh_ahead and the freshness check outcome allow it)
+static bool
+refreshIsWantedAhead(const StoreEntry * entry, const int reason)
+{
+    if (!Config.refreshAhead.limit)
+        return false;
+
+    switch (reason) {
+    case FRESH_STALE_WHILE_REVALIDATE:
+        // the origin server asked for revalidation, regardless of popularity
+        return true;
+
+    case FRESH_MIN_RULE:
+    case FRESH_LMFACTOR_RULE:
+    case FRESH_EXPIRES:
+        break; // check popularity and remaining freshness lifetime below
+
+    default:
+        return false;
+    }
+
+    if (!Config.refreshAhead.window || entry->refcount < Config.refreshAhead.hits)
+        return false;
+
+    // will this popular entry become stale soon?
+    const auto futureReason = refreshCheck(entry, nullptr, Config.refreshAhead.window);
+    return futureReason >= STALE_MUST_REVALIDATE;
+}
+
 /**
  * Protocol-specific wrapper around refreshCheck() function.
  *
@@ -574,10 +619,12 @@ refreshIsStaleIfHit(const int reason)
 int
 refreshCheckHTTP(const StoreEntry * entry, HttpRequest * request)
 {
-    int reason = refreshCheck(entry, request, 0);
+    int reason = refreshCheck(entry, request, 0, Config.refreshAhead.limit > 0);
     ++ refreshCounts[rcHTTP].total;
     ++ refreshCounts[rcHTTP].status[reason];
     request->flags.staleIfHit = refreshIsStaleIfHit(reason);
+    request->flags.refreshAhead = refreshIsWantedAhead(entry, reason);
+    request->flags.staleWhileRevalidate = (reason == FRESH_STALE_WHILE_REVALIDATE);
     // TODO: Treat collapsed responses as fresh but second-hand.
     return (Config.onoff.offline || reason < 200) ? 0 : 1;
 }
@@ -664,6 +711,7 @@ refreshCountsStats(StoreEntry * sentry, struct RefreshCounts &rc)
     refreshCountsStatsEntry(sentry, rc, FRESH_MIN_RULE, "Fresh: refresh_pattern min value");
     refreshCountsStatsEntry(sentry, rc, FRESH_OVERRIDE_EXPIRES, "Fresh: refresh_pattern override-expires");
     refreshCountsStatsEntry(sentry, rc, FRESH_OVERRIDE_LASTMOD, "Fresh: refresh_pattern override-lastmod");
+    refreshCountsStatsEntry(sentry, rc, FRESH_STALE_WHILE_REVALIDATE, "Fresh: response stale-while-revalidate");
     refreshCountsStatsEntry(sentry, rc, STALE_MUST_REVALIDATE, "Stale: response has must-revalidate");
     refreshCountsStatsEntry(sentry, rc, STALE_RELOAD_INTO_IMS, "Stale: changed reload into IMS");
     refreshCountsStatsEntry(sentry, rc, STALE_FORCED_RELOAD, "Stale: request has no-cache directive");
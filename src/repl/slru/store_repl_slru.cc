@@ -0,0 +1,444 @@
+/*
+ * Copyright (C) 1996-2023 The Squid Software Foundation and contributors
+ *
+ * Squid software is distributed under GPLv2+ license and includes
+ * contributions from numerous individuals and organizations.
+ * Please see the COPYING and CONTRIBUTORS files for details.
+ */
+
+/* DEBUG: section 81    Store SLRU Removal Policy */
+
+/*
+ * Segmented LRU (SLRU) removal policy.
+ *
+ * New entries enter the "probationary" segment. An entry referenced again
+ * while on probation is promoted to the "protected" segment. When the
+ * protected segment grows beyond its configured share of all entries, its
+ * least recently used entries are demoted back to probation, where they
+ * get another chance before eviction. Entries are evicted from probation
+ * first, so a burst of entries referenced just once (e.g., a crawler
+ * scanning the site) cannot flush popular entries out of the cache.
+ *
+ * All operations except eviction of locked entries are O(1).
+ */
+
+#include "squid.h"
+#include "debug/Stream.h"
+#include "MemObject.h"
+#include "Store.h"
+#include "wordlist.h"
+
+REMOVALPOLICYCREATE createRemovalPolicy_slru;
+
+/// the default maximum share of entries in the protected segment
+static const int DefaultProtectedPercent = 80;
+
+struct SlruPolicyData {
+    void setPolicyNode (StoreEntry *, void *) const;
+    /// the maximum number of entries in the protected segment
+    int64_t protectedLimit() const { return (int64_t(probationCount) + protectedCount) * protectedPercent / 100; }
+    RemovalPolicy *policy;
+    dlink_list probation; ///< entries referenced once since (re)admission
+    dlink_list protectedList; ///< entries referenced again while on probation
+    int probationCount;
+    int protectedCount;
+    int protectedPercent; ///< maximum protected segment share, in percents
+    int nwalkers;
+    enum heap_entry_type {
+        TYPE_UNKNOWN = 0, TYPE_STORE_ENTRY, TYPE_STORE_MEM
+    } type;
+};
+
+/* Hack to avoid having to remember the RemovalPolicyNode location.
+ * Needed by the purge walker to clear the policy information
+ */
+static enum SlruPolicyData::heap_entry_type
+repl_guessType(StoreEntry * entry, RemovalPolicyNode * node)
+{
+    if (node == &entry->repl)
+        return SlruPolicyData::TYPE_STORE_ENTRY;
+
+    if (entry->mem_obj && node == &entry->mem_obj->repl)
+        return SlruPolicyData::TYPE_STORE_MEM;
+
+    fatal("SLRU Replacement: Unknown StoreEntry node type");
+
+    return SlruPolicyData::TYPE_UNKNOWN;
+}
+
+void
+SlruPolicyData::setPolicyNode (StoreEntry *entry, void *value) const
+{
+    switch (type) {
+
+    case TYPE_STORE_ENTRY:
+        entry->repl.data = value;
+        break ;
+
+    case TYPE_STORE_MEM:
+        entry->mem_obj->repl.data = value ;
+        break ;
+
+    default:
+        break;
+    }
+}
+
+class SlruNode
+{
+    MEMPROXY_CLASS(SlruNode);
+
+public:
+    /* Note: the dlink_node MUST be the first member of the SlruNode
+     * structure. This member is later pointer typecasted to SlruNode *.
+     */
+    dlink_node node;
+    bool isProtected = false; ///< whether the node is in the protected segment
+};
+
+/// the segment list the node belongs to
+static dlink_list &
+slru_segment(SlruPolicyData *slru, const SlruNode *slru_node)
+{
+    return slru_node->isProtected ? slru->protectedList : slru->probation;
+}
+
+/// moves least recently used protected entries to probation as needed
+static void
+slru_rebalance(SlruPolicyData *slru)
+{
+    while (slru->protectedCount > slru->protectedLimit()) {
+        SlruNode *victim = (SlruNode *) slru->protectedList.head;
+        assert(victim);
+        dlinkDelete(&victim->node, &slru->protectedList);
+        --slru->protectedCount;
+        victim->isProtected = false;
+        dlinkAddTail(victim->node.data, &victim->node, &slru->probation);
+        ++slru->probationCount;
+    }
+}
+
+static void
+slru_add(RemovalPolicy * policy, StoreEntry * entry, RemovalPolicyNode * node)
+{
+    SlruPolicyData *slru = (SlruPolicyData *)policy->_data;
+    SlruNode *slru_node;
+    assert(!node->data);
+    node->data = slru_node = new SlruNode;
+    dlinkAddTail(entry, &slru_node->node, &slru->probation);
+    slru->probationCount += 1;
+
+    if (!slru->type)
+        slru->type = repl_guessType(entry, node);
+}
+
+static void
+slru_remove(RemovalPolicy * policy, StoreEntry * entry, RemovalPolicyNode * node)
+{
+    SlruPolicyData *slru = (SlruPolicyData *)policy->_data;
+    SlruNode *slru_node = (SlruNode *)node->data;
+
+    if (!slru_node)
+        return;
+
+    // see lru_remove()
+    if (nullptr == slru_node->node.data)
+        return;
+
+    assert(slru_node->node.data == entry);
+
+    node->data = nullptr;
+
+    dlinkDelete(&slru_node->node, &slru_segment(slru, slru_node));
+
+    if (slru_node->isProtected)
+        slru->protectedCount -= 1;
+    else
+        slru->probationCount -= 1;
+
+    delete slru_node;
+}
+
+/// a cache hit: promotes probationary entries to the protected segment
+static void
+slru_referenced(RemovalPolicy * policy, const StoreEntry * entry,
+                RemovalPolicyNode * node)
+{
+    SlruPolicyData *slru = (SlruPolicyData *)policy->_data;
+    SlruNode *slru_node = (SlruNode *)node->data;
+
+    if (!slru_node)
+        return;
+
+    dlinkDelete(&slru_node->node, &slru_segment(slru, slru_node));
+
+    if (!slru_node->isProtected) {
+        slru_node->isProtected = true;
+        slru->probationCount -= 1;
+        slru->protectedCount += 1;
+    }
+
+    dlinkAddTail((void *) entry, &slru_node->node, &slru->protectedList);
+    slru_rebalance(slru);
+}
+
+/// the entry became idle: refreshes its recency within its current segment
+static void
+slru_dereferenced(RemovalPolicy * policy, const StoreEntry * entry,
+                  RemovalPolicyNode * node)
+{
+    SlruPolicyData *slru = (SlruPolicyData *)policy->_data;
+    SlruNode *slru_node = (SlruNode *)node->data;
+
+    if (!slru_node)
+        return;
+
+    dlink_list &segment = slru_segment(slru, slru_node);
+    dlinkDelete(&slru_node->node, &segment);
+    dlinkAddTail((void *) entry, &slru_node->node, &segment);
+}
+
+/** RemovalPolicyWalker **/
+
+typedef struct _SlruWalkData SlruWalkData;
+
+struct _SlruWalkData {
+    SlruNode *current;
+    bool walkingProtected;
+};
+
+static const StoreEntry *
+slru_walkNext(RemovalPolicyWalker * walker)
+{
+    SlruWalkData *slru_walk = (SlruWalkData *)walker->_data;
+    SlruPolicyData *slru = (SlruPolicyData *)walker->_policy->_data;
+
+    if (!slru_walk->current && !slru_walk->walkingProtected) {
+        slru_walk->walkingProtected = true;
+        slru_walk->current = (SlruNode *) slru->protectedList.head;
+    }
+
+    SlruNode *slru_node = slru_walk->current;
+
+    if (!slru_node)
+        return nullptr;
+
+    slru_walk->current = (SlruNode *) slru_node->node.next;
+
+    return (StoreEntry *) slru_node->node.data;
+}
+
+static void
+slru_walkDone(RemovalPolicyWalker * walker)
+{
+    RemovalPolicy *policy = walker->_policy;
+    SlruPolicyData *slru = (SlruPolicyData *)policy->_data;
+    assert(strcmp(policy->_type, "slru") == 0);
+    assert(slru->nwalkers > 0);
+    slru->nwalkers -= 1;
+    safe_free(walker->_data);
+    delete walker;
+}
+
+static RemovalPolicyWalker *
+slru_walkInit(RemovalPolicy * policy)
+{
+    SlruPolicyData *slru = (SlruPolicyData *)policy->_data;
+    RemovalPolicyWalker *walker;
+    SlruWalkData *slru_walk;
+    slru->nwalkers += 1;
+    walker = new RemovalPolicyWalker;
+    slru_walk = (SlruWalkData *)xcalloc(1, sizeof(*slru_walk));
+    walker->_policy = policy;
+    walker->_data = slru_walk;
+    walker->Next = slru_walkNext;
+    walker->Done = slru_walkDone;
+    slru_walk->current = (SlruNode *) slru->probation.head;
+    slru_walk->walkingProtected = false;
+    return walker;
+}
+
+/** RemovalPurgeWalker **/
+
+typedef struct _SlruPurgeData SlruPurgeData;
+
+struct _SlruPurgeData {
+    SlruNode *current;
+    SlruNode *start;
+    bool purgingProtected;
+};
+
+/// Evicts probationary entries first, in LRU order. Evicts protected entries
+/// only when no unlocked probationary entries are left.
+static StoreEntry *
+slru_purgeNext(RemovalPurgeWalker * walker)
+{
+    SlruPurgeData *slru_walker = (SlruPurgeData *)walker->_data;
+    RemovalPolicy *policy = walker->_policy;
+    SlruPolicyData *slru = (SlruPolicyData *)policy->_data;
+    SlruNode *slru_node;
+    StoreEntry *entry;
+
+try_again:
+    slru_node = slru_walker->current;
+
+    if (!slru_node && !slru_walker->purgingProtected) {
+        slru_walker->purgingProtected = true;
+        slru_walker->start = slru_walker->current = (SlruNode *) slru->protectedList.head;
+        slru_node = slru_walker->current;
+    }
+
+    if (!slru_node || walker->scanned >= walker->max_scan)
+        return nullptr;
+
+    walker->scanned += 1;
+
+    slru_walker->current = (SlruNode *) slru_node->node.next;
+
+    if (slru_walker->current == slru_walker->start) {
+        /* Last node found */
+        slru_walker->current = nullptr;
+    }
+
+    entry = (StoreEntry *) slru_node->node.data;
+    dlink_list &segment = slru_segment(slru, slru_node);
+    dlinkDelete(&slru_node->node, &segment);
+
+    if (entry->locked()) {
+        /* we cannot return a locked entry */
+        ++ walker->locked;
+        dlinkAddTail(entry, &slru_node->node, &segment);
+        goto try_again;
+    }
+
+    if (slru_node->isProtected)
+        slru->protectedCount -= 1;
+    else
+        slru->probationCount -= 1;
+
+    delete slru_node;
+    slru->setPolicyNode(entry, nullptr);
+    return entry;
+}
+
+static void
+slru_purgeDone(RemovalPurgeWalker * walker)
+{
+    RemovalPolicy *policy = walker->_policy;
+    SlruPolicyData *slru = (SlruPolicyData *)policy->_data;
+    assert(strcmp(policy->_type, "slru") == 0);
+    assert(slru->nwalkers > 0);
+    slru->nwalkers -= 1;
+    safe_free(walker->_data);
+    delete walker;
+}
+
+static RemovalPurgeWalker *
+slru_purgeInit(RemovalPolicy * policy, int max_scan)
+{
+    SlruPolicyData *slru = (SlruPolicyData *)policy->_data;
+    RemovalPurgeWalker *walker;
+    SlruPurgeData *slru_walk;
+    slru->nwalkers += 1;
+    walker = new RemovalPurgeWalker;
+    slru_walk = (SlruPurgeData *)xcalloc(1, sizeof(*slru_walk));
+    walker->_policy = policy;
+    walker->_data = slru_walk;
+    walker->max_scan = max_scan;
+    walker->Next = slru_purgeNext;
+    walker->Done = slru_purgeDone;
+    slru_walk->start = slru_walk->current = (SlruNode *) slru->probation.head;
+    slru_walk->purgingProtected = false;
+    return walker;
+}
+
+/// reports the reference age of the oldest unlocked entry in the segment
+static void
+slru_segmentStats(const dlink_list &segment, const char *name, StoreEntry * sentry)
+{
+    for (SlruNode *slru_node = (SlruNode *) segment.head; slru_node; slru_node = (SlruNode *) slru_node->node.next) {
+        StoreEntry *entry = (StoreEntry *) slru_node->node.data;
+
+        if (entry->locked())
+            continue;
+
+        storeAppendPrintf(sentry, "SLRU %s reference age: %.2f days\n", name, (double) (squid_curtime - entry->lastref) / (double) (24 * 60 * 60));
+        return;
+    }
+}
+
+static void
+slru_stats(RemovalPolicy * policy, StoreEntry * sentry)
+{
+    SlruPolicyData *slru = (SlruPolicyData *)policy->_data;
+    storeAppendPrintf(sentry, "SLRU probationary entries: %d\n", slru->probationCount);
+    storeAppendPrintf(sentry, "SLRU protected entries: %d (limit: %d%%)\n", slru->protectedCount, slru->protectedPercent);
+    slru_segmentStats(slru->probation, "probationary", sentry);
+    slru_segmentStats(slru->protectedList, "protected", sentry);
+}
+
+static void
+slru_free(RemovalPolicy * policy)
+{
+    SlruPolicyData *slru = (SlruPolicyData *)policy->_data;
+    /* Make some verification of the policy state */
+    assert(strcmp(policy->_type, "slru") == 0);
+    assert(slru->nwalkers);
+    assert(slru->probationCount + slru->protectedCount);
+    /* Ok, time to destroy this policy */
+    safe_free(slru);
+    memset(policy, 0, sizeof(*policy));
+    delete policy;
+}
+
+RemovalPolicy *
+createRemovalPolicy_slru(wordlist * args)
+{
+    RemovalPolicy *policy;
+    SlruPolicyData *slru_data;
+
+    /* Allocate the needed structures */
+    slru_data = (SlruPolicyData *)xcalloc(1, sizeof(*slru_data));
+    slru_data->protectedPercent = DefaultProtectedPercent;
+
+    /* an optional maximum protected segment share, in percents */
+    if (args) {
+        const int percent = atoi(args->key);
+
+        if (percent <= 0 || percent >= 100 || args->next) {
+            debugs(81, DBG_CRITICAL, "ERROR: SLRU removal policy expects a protected segment percentage " <<
+                   "between 1 and 99; using " << DefaultProtectedPercent << " instead of " << args->key);
+        } else {
+            slru_data->protectedPercent = percent;
+        }
+    }
+
+    policy = new RemovalPolicy;
+
+    /* Initialize the URL data */
+    slru_data->policy = policy;
+
+    /* Populate the policy structure */
+    policy->_type = "slru";
+
+    policy->_data = slru_data;
+
+    policy->Free = slru_free;
+
+    policy->Add = slru_add;
+
+    policy->Remove = slru_remove;
+
+    policy->Referenced = slru_referenced;
+
+    policy->Dereferenced = slru_dereferenced;
+
+    policy->WalkInit = slru_walkInit;
+
+    policy->PurgeInit = slru_purgeInit;
+
+    policy->Stats = slru_stats;
+
+    return policy;
+}
+
@@ -80,9 +80,7 @@ Security::NegotiationHistory::retrieveNegotiatedInfo(const Security::SessionPoin
     }
 
     if (Debug::Enabled(83, 5)) {
-        BIO *b = SSL_get_rbio(session.get());
-        Ssl::Bio *bio = static_cast<Ssl::Bio *>(BIO_get_data(b));
-        debugs(83, 5, "SSL connection info on FD " << bio->fd() <<
+        debugs(83, 5, "SSL connection info on FD " << SSL_get_fd(session.get()) <<
                " SSL version " << version_ <<
                " negotiated cipher " << cipherName());
     }
@@ -141,7 +141,7 @@ Security::PeerConnector::initialize(Security::SessionPointer &serverSession)
     Security::ContextPointer ctx(getTlsContext());
     debugs(83, 5, serverConnection() << ", ctx=" << (void*)ctx.get());
 
-    if (!ctx || !Security::CreateClientSession(ctx, serverConnection(), "server https start")) {
+    if (!ctx || !Security::CreateClientSession(ctx, serverConnection(), "server https start", mayUseKernelTls())) {
         const auto xerrno = errno;
         if (!ctx) {
             debugs(83, DBG_IMPORTANT, "ERROR: initializing TLS connection: No security context.");
@@ -201,9 +201,11 @@ Security::PeerConnector::recordNegotiationDetails()
 #if USE_OPENSSL
     // retrieve TLS parsed extra info
     BIO *b = SSL_get_rbio(session.get());
-    Ssl::ServerBio *bio = static_cast<Ssl::ServerBio *>(BIO_get_data(b));
-    if (const Security::TlsDetails::Pointer &details = bio->receivedHelloDetails())
-        serverConnection()->tlsNegotiations()->retrieveParsedInfo(details);
+    // kernel TLS connections use OpenSSL socket BIOs that do not parse
+    if (const auto bio = static_cast<Ssl::ServerBio *>(BIO_get_data(b))) {
+        if (const Security::TlsDetails::Pointer &details = bio->receivedHelloDetails())
+            serverConnection()->tlsNegotiations()->retrieveParsedInfo(details);
+    }
 #endif
 }
 
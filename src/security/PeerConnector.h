@@ -134,6 +134,10 @@ protected:
     /// for building the encryption context objects.
     virtual Security::ContextPointer getTlsContext() = 0;
 
+    /// whether the connection may offload TLS record encryption to the kernel
+    /// (i.e. Squid does not need to inspect TLS handshake bytes)
+    virtual bool mayUseKernelTls() const { return true; }
+
     /// mimics FwdState to minimize changes to FwdState::initiate/negotiateSsl
     Comm::ConnectionPointer const &serverConnection() const { return serverConn; }
 
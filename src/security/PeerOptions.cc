@@ -93,6 +93,12 @@ Security::PeerOptions::parse(const char *token)
         sslDomain = SBuf(token + 7);
     } else if (strncmp(token, "no-npn", 6) == 0) {
         flags.tlsNpn = false;
+    } else if (strcmp(token, "ktls") == 0) {
+#if USE_OPENSSL && defined(SSL_OP_ENABLE_KTLS)
+        flags.tlsKernel = true;
+#else
+        debugs(3, DBG_PARSE_NOTE(1), "WARNING: Ignoring ktls option. Kernel TLS requires OpenSSL v3.0 or later.");
+#endif
     } else {
         debugs(3, DBG_CRITICAL, "ERROR: Unknown TLS option '" << token << "'");
         return;
@@ -147,6 +153,9 @@ Security::PeerOptions::dumpCfg(std::ostream &os, const char *pfx) const
 
     if (!flags.tlsNpn)
         os << ' ' << pfx << "no-npn";
+
+    if (flags.tlsKernel)
+        os << ' ' << pfx << "ktls";
 }
 
 void
@@ -68,6 +68,9 @@ public:
     /// setup any library-specific options that can be set for the given session
     void updateSessionOptions(Security::SessionPointer &);
 
+    /// whether to offload TLS record encryption to the kernel when possible
+    bool kernelTls() const { return flags.tlsKernel; }
+
     /// output squid.conf syntax with 'pfx' prefix on parameters for the stored settings
     virtual void dumpCfg(std::ostream &, const char *pfx) const;
 
@@ -131,7 +134,7 @@ protected:
 
     /// flags governing Squid internal TLS operations
     struct flags_ {
-        flags_() : tlsDefaultCa(true), tlsNpn(true) {}
+        flags_() : tlsDefaultCa(true), tlsNpn(true), tlsKernel(false) {}
         flags_(const flags_ &) = default;
         flags_ &operator =(const flags_ &) = default;
 
@@ -140,6 +143,9 @@ protected:
 
         /// whether to use the TLS NPN extension on these connections
         bool tlsNpn;
+
+        /// whether to offload TLS record encryption to the kernel (kTLS)
+        bool tlsKernel;
     } flags;
 
 public:
@@ -17,8 +17,10 @@
 #include "fde.h"
 #include "ipc/MemMap.h"
 #include "security/Session.h"
+#include "security/TicketKeys.h"
 #include "SquidConfig.h"
 #include "ssl/bio.h"
+#include "StatCounters.h"
 
 #define SSL_SESSION_ID_SIZE 32
 #define SSL_SESSION_MAX_SIZE 10*1024
@@ -80,6 +82,11 @@ tls_write_method(int fd, const char *buf, int len)
 
     if (i > 0) {
         debugs(83, 8, "TLS FD " << fd << " session=" << (void*)session << " " << i << " bytes");
+        statCounter.tls.kbytes_out += i;
+#if USE_OPENSSL && defined(BIO_get_ktls_send)
+        if (BIO_get_ktls_send(SSL_get_wbio(session)))
+            statCounter.tls.ktls_kbytes_out += i;
+#endif
     }
     return i;
 }
@@ -98,8 +105,38 @@ Security::NewSessionObject(const Security::ContextPointer &ctx)
 }
 #endif
 
+#if USE_OPENSSL
+/// sets up Squid BIO (capable of TLS handshake inspection) for TLS I/O
+static bool
+LinkSquidBio(const Security::SessionPointer &session, const int fd, const Security::Io::Type type)
+{
+    // without BIO, we would call SSL_set_fd(ssl.get(), fd) instead
+    if (BIO *bio = Ssl::Bio::Create(fd, type)) {
+        Ssl::Bio::Link(session.get(), bio); // cannot fail
+        return true;
+    }
+    return false;
+}
+
+/// sets up an OpenSSL socket BIO for TLS I/O; OpenSSL installs kernel TLS
+/// keys after the handshake if the kernel supports the negotiated cipher
+static bool
+LinkKernelTlsSocket(const Security::SessionPointer &session, const int fd)
+{
+#if defined(SSL_OP_ENABLE_KTLS)
+    // Squid BIO limits client-initiated renegotiations; socket BIOs cannot
+    SSL_set_options(session.get(), SSL_OP_ENABLE_KTLS | SSL_OP_NO_RENEGOTIATION);
+    return SSL_set_fd(session.get(), fd) == 1;
+#else
+    (void)session;
+    (void)fd;
+    return false; // PeerOptions::parse() rejects kernel TLS configurations
+#endif
+}
+#endif
+
 static bool
-CreateSession(const Security::ContextPointer &ctx, const Comm::ConnectionPointer &conn, Security::PeerOptions &opts, Security::Io::Type type, const char *squidCtx)
+CreateSession(const Security::ContextPointer &ctx, const Comm::ConnectionPointer &conn, Security::PeerOptions &opts, Security::Io::Type type, const char *squidCtx, const bool mayUseKernelTls)
 {
     if (!Comm::IsConnOpen(conn)) {
         debugs(83, DBG_IMPORTANT, "Gone connection");
@@ -136,9 +173,9 @@ CreateSession(const Security::ContextPointer &ctx, const Comm::ConnectionPointer
         const int fd = conn->fd;
 
 #if USE_OPENSSL
-        // without BIO, we would call SSL_set_fd(ssl.get(), fd) instead
-        if (BIO *bio = Ssl::Bio::Create(fd, type)) {
-            Ssl::Bio::Link(session.get(), bio); // cannot fail
+        const auto useKernelTls = mayUseKernelTls && opts.kernelTls();
+        if (useKernelTls ? LinkKernelTlsSocket(session, fd) : LinkSquidBio(session, fd, type)) {
+            debugs(83, 5, "kernel TLS allowed: " << useKernelTls);
 #elif USE_GNUTLS
         errCode = gnutls_credentials_set(session.get(), GNUTLS_CRD_CERTIFICATE, ctx.get());
         if (errCode == GNUTLS_E_SUCCESS) {
@@ -176,23 +213,24 @@ CreateSession(const Security::ContextPointer &ctx, const Comm::ConnectionPointer
     (void)type;
     (void)squidCtx;
 #endif /* USE_OPENSSL || USE_GNUTLS */
+    (void)mayUseKernelTls;
     return false;
 }
 
 bool
-Security::CreateClientSession(const Security::ContextPointer &ctx, const Comm::ConnectionPointer &c, const char *squidCtx)
+Security::CreateClientSession(const Security::ContextPointer &ctx, const Comm::ConnectionPointer &c, const char *squidCtx, const bool mayUseKernelTls)
 {
     if (!c || !c->getPeer())
-        return CreateSession(ctx, c, Security::ProxyOutgoingConfig, Security::Io::BIO_TO_SERVER, squidCtx);
+        return CreateSession(ctx, c, Security::ProxyOutgoingConfig, Security::Io::BIO_TO_SERVER, squidCtx, mayUseKernelTls);
 
     auto *peer = c->getPeer();
-    return CreateSession(ctx, c, peer->secure, Security::Io::BIO_TO_SERVER, squidCtx);
+    return CreateSession(ctx, c, peer->secure, Security::Io::BIO_TO_SERVER, squidCtx, mayUseKernelTls);
 }
 
 bool
-Security::CreateServerSession(const Security::ContextPointer &ctx, const Comm::ConnectionPointer &c, Security::PeerOptions &o, const char *squidCtx)
+Security::CreateServerSession(const Security::ContextPointer &ctx, const Comm::ConnectionPointer &c, Security::PeerOptions &o, const char *squidCtx, const bool mayUseKernelTls)
 {
-    return CreateSession(ctx, c, o, Security::Io::BIO_TO_CLIENT, squidCtx);
+    return CreateSession(ctx, c, o, Security::Io::BIO_TO_CLIENT, squidCtx, mayUseKernelTls);
 }
 
 void
@@ -380,6 +418,7 @@ Security::SetSessionCacheCallbacks(Security::ContextPointer &ctx)
         SSL_CTX_sess_set_remove_cb(ctx.get(), remove_session_cb);
         SSL_CTX_sess_set_get_cb(ctx.get(), get_session_cb);
     }
+    Security::TicketKeys::Install(ctx);
 }
 #endif /* USE_OPENSSL */
 
@@ -0,0 +1,350 @@
+/*
+ * Copyright (C) 1996-2023 The Squid Software Foundation and contributors
+ *
+ * Squid software is distributed under GPLv2+ license and includes
+ * contributions from numerous individuals and organizations.
+ * Please see the COPYING and CONTRIBUTORS files for details.
+ */
+
+/* DEBUG: section 83    TLS session management */
+
+#include "squid.h"
+#include "anyp/PortCfg.h"
+#include "base/PackableStream.h"
+#include "base/RunnersRegistry.h"
+#include "base/TextException.h"
+#include "globals.h"
+#include "ipc/mem/Pointer.h"
+#include "mgr/Registration.h"
+#include "security/Session.h"
+#include "security/TicketKeys.h"
+#include "SquidConfig.h"
+#include "Store.h"
+#include "tools.h"
+
+#include <atomic>
+#include <cstring>
+
+#if USE_OPENSSL
+#include <openssl/rand.h>
+#if OPENSSL_VERSION_MAJOR >= 3
+#include <openssl/core_names.h>
+#else
+#include <openssl/hmac.h>
+#endif
+
+namespace Security
+{
+namespace TicketKeys
+{
+
+/// secrets protecting session tickets issued during one key lifetime
+class Key
+{
+public:
+    unsigned char name[16]; ///< identifies the key in issued tickets
+    unsigned char hmacSecret[32]; ///< ticket HMAC-SHA256 secret
+    unsigned char aesSecret[32]; ///< ticket AES-256-CBC secret
+};
+
+/// a fixed-size ring of rotating ticket keys in shared memory
+class SharedKeys
+{
+public:
+    /// the number of keys that can decrypt tickets: the current key and
+    /// the two keys it replaced; the remaining slot is (re)written next
+    static const uint32_t Decrypting = 3;
+
+    SharedKeys();
+
+    static size_t SharedMemorySize() { return sizeof(SharedKeys); }
+    size_t sharedMemorySize() const { return SharedMemorySize(); }
+
+    /// copies the key for encrypting new tickets, rotating keys if needed
+    void current(Key &, time_t lifetime);
+
+    /// Copies the key with the given name if it may still decrypt tickets.
+    /// \returns whether that key exists; sets isCurrent
+    bool find(const unsigned char *name, Key &, bool &isCurrent) const;
+
+    /// the number of rotations since creation
+    uint32_t rotations() const { return generation.load(); }
+
+    /// the time of the last rotation (or creation)
+    time_t rotatedAt() const { return lastRotation.load(); }
+
+private:
+    /// a key guarded by a sequence lock
+    class Slot
+    {
+    public:
+        std::atomic<uint32_t> version; ///< odd while being written
+        Key key;
+    };
+
+    static const uint32_t Size = Decrypting + 1;
+
+    void generate(uint32_t gen);
+    bool copy(uint32_t gen, Key &) const;
+
+    std::atomic<uint32_t> generation; ///< current key is slots[generation % Size]
+    std::atomic<time_t> lastRotation; ///< when the current key was generated
+    Slot slots[Size];
+};
+
+/// shared memory segment label
+static const char * const ShmLabel = "tls_ticket_keys";
+
+/// the ticket keys shared by all workers (if enabled)
+static Ipc::Mem::Pointer<SharedKeys> Keys;
+
+/// this worker statistics for the tls_ticket_keys report
+static struct {
+    uint64_t issued = 0; ///< tickets encrypted with the current key
+    uint64_t resumed = 0; ///< tickets decrypted with the current key
+    uint64_t renewed = 0; ///< tickets decrypted with an older key
+    uint64_t unknown = 0; ///< tickets with an unknown or expired key
+} Stats;
+
+static OBJH Report;
+
+/// whether some port may accept TLS connections
+static bool
+Needed()
+{
+    for (AnyP::PortCfgPointer s = HttpPortList; s != nullptr; s = s->next) {
+        if (s->secure.encryptTransport || s->flags.tunnelSslBumping)
+            return true;
+    }
+    return false;
+}
+
+/// prepares HMAC computation using the given key
+static bool
+#if OPENSSL_VERSION_MAJOR >= 3
+InitHmac(EVP_MAC_CTX *hmacCtx, const Key &key)
+{
+    char digest[] = "SHA256";
+    OSSL_PARAM params[] = {
+        OSSL_PARAM_construct_octet_string(OSSL_MAC_PARAM_KEY, const_cast<unsigned char *>(key.hmacSecret), sizeof(key.hmacSecret)),
+        OSSL_PARAM_construct_utf8_string(OSSL_MAC_PARAM_DIGEST, digest, 0),
+        OSSL_PARAM_construct_end()
+    };
+    return EVP_MAC_CTX_set_params(hmacCtx, params);
+}
+#else
+InitHmac(HMAC_CTX *hmacCtx, const Key &key)
+{
+    return HMAC_Init_ex(hmacCtx, key.hmacSecret, sizeof(key.hmacSecret), EVP_sha256(), nullptr);
+}
+#endif
+
+/// OpenSSL session ticket key callback
+/// \returns -1 on errors, 0 for unknown keys, 1 on success, or 2 when the
+/// decrypted ticket should be renewed
+static int
+#if OPENSSL_VERSION_MAJOR >= 3
+HandleTicket(SSL *, unsigned char *keyName, unsigned char *iv, EVP_CIPHER_CTX *cipherCtx, EVP_MAC_CTX *hmacCtx, const int encrypt)
+#else
+HandleTicket(SSL *, unsigned char *keyName, unsigned char *iv, EVP_CIPHER_CTX *cipherCtx, HMAC_CTX *hmacCtx, const int encrypt)
+#endif
+{
+    if (!Keys)
+        return -1;
+
+    Key key;
+    if (encrypt) {
+        Keys->current(key, ::Config.SSL.ticketKeyLifetime);
+        if (RAND_bytes(iv, EVP_CIPHER_iv_length(EVP_aes_256_cbc())) <= 0)
+            return -1;
+        memcpy(keyName, key.name, sizeof(key.name));
+        if (!EVP_EncryptInit_ex(cipherCtx, EVP_aes_256_cbc(), nullptr, key.aesSecret, iv) || !InitHmac(hmacCtx, key))
+            return -1;
+        ++Stats.issued;
+        return 1;
+    }
+
+    bool isCurrent = false;
+    if (!Keys->find(keyName, key, isCurrent)) {
+        debugs(83, 5, "unknown or expired ticket key");
+        ++Stats.unknown;
+        return 0; // a full handshake and a new ticket
+    }
+
+    if (!InitHmac(hmacCtx, key) || !EVP_DecryptInit_ex(cipherCtx, EVP_aes_256_cbc(), nullptr, key.aesSecret, iv))
+        return -1;
+
+    if (isCurrent) {
+        ++Stats.resumed;
+        return 1;
+    }
+    ++Stats.renewed;
+    return 2;
+}
+
+} // namespace TicketKeys
+} // namespace Security
+
+Security::TicketKeys::SharedKeys::SharedKeys():
+    generation(0),
+    lastRotation(squid_curtime)
+{
+    for (auto &slot: slots)
+        slot.version = 0;
+    generate(0);
+}
+
+void
+Security::TicketKeys::SharedKeys::generate(const uint32_t gen)
+{
+    Key key;
+    if (RAND_bytes(key.name, sizeof(key.name)) <= 0 ||
+            RAND_bytes(key.hmacSecret, sizeof(key.hmacSecret)) <= 0 ||
+            RAND_bytes(key.aesSecret, sizeof(key.aesSecret)) <= 0)
+        throw TextException("cannot generate a TLS session ticket key", Here());
+
+    auto &slot = slots[gen % Size];
+    ++slot.version; // odd: readers must retry
+    std::atomic_thread_fence(std::memory_order_release);
+    slot.key = key;
+    std::atomic_thread_fence(std::memory_order_release);
+    ++slot.version; // even: the key is ready
+}
+
+bool
+Security::TicketKeys::SharedKeys::copy(const uint32_t gen, Key &key) const
+{
+    const auto &slot = slots[gen % Size];
+    for (int attempts = 0; attempts < 100; ++attempts) {
+        const auto before = slot.version.load(std::memory_order_acquire);
+        if (before % 2)
+            continue; // being rotated
+        key = slot.key;
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (slot.version.load(std::memory_order_relaxed) == before)
+            return true;
+    }
+    return false;
+}
+
+void
+Security::TicketKeys::SharedKeys::current(Key &key, const time_t lifetime)
+{
+    auto rotated = lastRotation.load();
+    // the worker that updates lastRotation first generates the next key;
+    // others keep using the current key until the generation changes
+    if (lifetime > 0 && rotated + lifetime <= squid_curtime &&
+            lastRotation.compare_exchange_strong(rotated, squid_curtime)) {
+        const auto next = generation.load() + 1;
+        generate(next);
+        generation = next;
+        debugs(83, 3, "rotated to ticket key generation " << next);
+    }
+
+    // slots do not change faster than lifetime so retries should succeed
+    while (!copy(generation.load(), key)) {}
+}
+
+bool
+Security::TicketKeys::SharedKeys::find(const unsigned char *name, Key &key, bool &isCurrent) const
+{
+    const auto gen = generation.load();
+    for (uint32_t age = 0; age < Decrypting && age <= gen; ++age) {
+        if (copy(gen - age, key) && memcmp(key.name, name, sizeof(key.name)) == 0) {
+            isCurrent = !age;
+            return true;
+        }
+    }
+    return false;
+}
+
+void
+Security::TicketKeys::Install(Security::ContextPointer &ctx)
+{
+    if (!Keys || !ctx)
+        return;
+
+#if OPENSSL_VERSION_MAJOR >= 3
+    SSL_CTX_set_tlsext_ticket_key_evp_cb(ctx.get(), &HandleTicket);
+#else
+    SSL_CTX_set_tlsext_ticket_key_cb(ctx.get(), &HandleTicket);
+#endif
+}
+
+/// reports shared key state and this worker ticket statistics
+void
+Security::TicketKeys::Report(StoreEntry *sentry)
+{
+    PackableStream os(*sentry);
+
+    if (!Keys) {
+        os << "Shared TLS session ticket keys are disabled.\n";
+        return;
+    }
+
+    os << "key rotations:\t" << Keys->rotations() << "\n" <<
+       "current key age:\t" << (squid_curtime - Keys->rotatedAt()) << " seconds\n" <<
+       "issued tickets:\t" << Stats.issued << "\n" <<
+       "resumed with the current key:\t" << Stats.resumed << "\n" <<
+       "resumed with an older key:\t" << Stats.renewed << "\n" <<
+       "unknown or expired keys:\t" << Stats.unknown << "\n";
+}
+
+/// initializes shared memory segment used by Security::TicketKeys
+class SharedTicketKeysRr: public Ipc::Mem::RegisteredRunner
+{
+public:
+    /* RegisteredRunner API */
+    ~SharedTicketKeysRr() override { delete owner; }
+    void useConfig() override;
+
+protected:
+    void create() override;
+    void open() override;
+
+private:
+    Ipc::Mem::Owner<Security::TicketKeys::SharedKeys> *owner = nullptr;
+};
+
+DefineRunnerRegistrator(SharedTicketKeysRr);
+
+void
+SharedTicketKeysRr::useConfig()
+{
+    if (Security::TicketKeys::Keys || !Security::TicketKeys::Needed())
+        return;
+
+    Ipc::Mem::RegisteredRunner::useConfig();
+
+    if (!Security::TicketKeys::Keys)
+        return;
+
+    Mgr::RegisterAction("tls_ticket_keys", "Shared TLS session ticket keys", Security::TicketKeys::Report, 0, 1);
+
+    // static contexts were created before we could attach to shared keys
+    for (AnyP::PortCfgPointer s = HttpPortList; s != nullptr; s = s->next) {
+        if (s->secure.staticContext)
+            Security::TicketKeys::Install(s->secure.staticContext);
+    }
+}
+
+void
+SharedTicketKeysRr::create()
+{
+    if (::Config.SSL.ticketKeyLifetime <= 0 || !Security::TicketKeys::Needed())
+        return;
+
+    Must(!owner);
+    owner = shm_new(Security::TicketKeys::SharedKeys)(Security::TicketKeys::ShmLabel);
+}
+
+void
+SharedTicketKeysRr::open()
+{
+    if (::Config.SSL.ticketKeyLifetime <= 0 || !IamWorkerProcess() || !Security::TicketKeys::Needed())
+        return;
+
+    Security::TicketKeys::Keys = shm_old(Security::TicketKeys::SharedKeys)(Security::TicketKeys::ShmLabel);
+}
+#endif /* USE_OPENSSL */
+
@@ -0,0 +1,38 @@
+/*
+ * Copyright (C) 1996-2023 The Squid Software Foundation and contributors
+ *
+ * Squid software is distributed under GPLv2+ license and includes
+ * contributions from numerous individuals and organizations.
+ * Please see the COPYING and CONTRIBUTORS files for details.
+ */
+
+#ifndef SQUID_SRC_SECURITY_TICKETKEYS_H
+#define SQUID_SRC_SECURITY_TICKETKEYS_H
+
+#if USE_OPENSSL
+
+#include "security/Context.h"
+
+namespace Security
+{
+
+/// TLS session ticket (RFC 5077) keys shared by all SMP workers. Tickets
+/// issued by one worker can be decrypted by any other worker, including
+/// workers started after a reconfiguration or a kid restart. Keys are
+/// rotated every sslproxy_session_ticket_key_lifetime, and recently
+/// retired keys still decrypt (and trigger renewal of) older tickets.
+namespace TicketKeys
+{
+
+/// Makes the given server context encrypt and decrypt session tickets
+/// using shared keys. Does nothing if shared ticket keys are disabled.
+void Install(Security::ContextPointer &);
+
+} // namespace TicketKeys
+
+} // namespace Security
+
+#endif /* USE_OPENSSL */
+
+#endif /* SQUID_SRC_SECURITY_TICKETKEYS_H */
+
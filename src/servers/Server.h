@@ -82,6 +82,20 @@ public:
         Comm::Write(clientConnection, buf, len, writer, nullptr);
     }
 
+    /// schedule a vectored Comm::Write() of the given buffers
+    void write(const Comm::IoVectorPointer &buffers) {
+        typedef CommCbMemFunT<Server, CommIoCbParams> Dialer;
+        writer = JobCallback(33, 5, Dialer, this, Server::clientWriteDone);
+        Comm::Write(clientConnection, buffers, writer);
+    }
+
+    /// schedule a Comm::Write() of size bytes of the given file at offset
+    void write(const Comm::SendableFilePointer &file, off_t offset, int size) {
+        typedef CommCbMemFunT<Server, CommIoCbParams> Dialer;
+        writer = JobCallback(33, 5, Dialer, this, Server::clientWriteDone);
+        Comm::Write(clientConnection, file, offset, size, writer);
+    }
+
     /// processing to sync state after a Comm::Write()
     virtual void afterClientWrite(size_t) {}
 
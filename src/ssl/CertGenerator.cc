@@ -0,0 +1,412 @@
+/*
+ * Copyright (C) 1996-2023 The Squid Software Foundation and contributors
+ *
+ * Squid software is distributed under GPLv2+ license and includes
+ * contributions from numerous individuals and organizations.
+ * Please see the COPYING and CONTRIBUTORS files for details.
+ */
+
+/* DEBUG: section 83    TLS session management */
+
+#include "squid.h"
+#include "anyp/PortCfg.h"
+#include "base/PackableStream.h"
+#include "base/RunnersRegistry.h"
+#include "cbdata.h"
+#include "comm.h"
+#include "comm/Loops.h"
+#include "fd.h"
+#include "fde.h"
+#include "globals.h"
+#include "mgr/Registration.h"
+#include "SquidConfig.h"
+#include "ssl/CertGenerator.h"
+#include "Store.h"
+#include "tools.h"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace Ssl
+{
+namespace CertGenerator
+{
+
+using Clock = std::chrono::steady_clock;
+
+/// a single certificate generation request
+class Job
+{
+public:
+    Job(const CertificateProperties &, Callback *, void *data);
+
+    CertificateProperties properties; ///< a thread-owned copy of the request
+    Callback *callback; ///< the requestor callback
+    CallbackData data; ///< the requestor callback data
+    Clock::time_point queued; ///< when the job was submitted
+    std::string certAndKey; ///< the generated certificate and key (PEM)
+};
+
+/// recent certificate generation latencies for one signing algorithm
+class Latencies
+{
+public:
+    /// the number of remembered (i.e. most recent) latencies
+    static const size_t MaxSamples = 1024;
+
+    void note(double milliseconds);
+
+    /// \returns the given percentile (0-100) of remembered latencies
+    double percentile(double) const;
+
+    uint64_t count = 0; ///< the total number of generated certificates
+    uint64_t failures = 0; ///< the number of failed generation attempts
+
+private:
+    std::vector<double> samples; ///< a circular buffer of latencies
+};
+
+/// the sslproxy_cert_gen_threads value in effect
+static size_t ConfiguredThreads = 0;
+static std::vector<std::thread> Threads; ///< running generator threads
+
+/// protects all thread-shared state below
+static std::mutex Mutex;
+/// wakes up threads when there is more work (or they must stop)
+static std::condition_variable Wakeup;
+static bool Stopping = false; ///< whether the threads must quit
+static std::deque<Job *> Pending; ///< submitted jobs
+static std::deque<Job *> Done; ///< generated (or failed) jobs
+static std::deque<Security::PrivateKeyPointer> Keys; ///< pre-generated keys
+static size_t KeysWanted = 0; ///< sslproxy_cert_gen_key_pool value
+static size_t KeysInProgress = 0; ///< keys being generated right now
+
+/// whether we have written a not yet read byte to the notification pipe
+static std::atomic<bool> Notified(false);
+static int NotificationReadFd = -1;
+static int NotificationWriteFd = -1;
+
+/// per-algorithm latency statistics for the ssl_cert_generator report
+static std::array<Latencies, algSignEnd> Stats;
+
+static OBJH Report;
+
+/// whether some port generates certificates
+static bool
+Needed()
+{
+    for (AnyP::PortCfgPointer s = HttpPortList; s != nullptr; s = s->next) {
+        if (s->secure.generateHostCertificates)
+            return true;
+    }
+    return false;
+}
+
+} // namespace CertGenerator
+} // namespace Ssl
+
+Ssl::CertGenerator::Job::Job(const CertificateProperties &aProperties, Callback *aCallback, void *aData):
+    callback(aCallback),
+    data(aData),
+    queued(Clock::now())
+{
+    // CertificateProperties are not copyable
+    properties.mimicCert.resetAndLock(aProperties.mimicCert.get());
+    properties.signWithX509.resetAndLock(aProperties.signWithX509.get());
+    properties.signWithPkey.resetAndLock(aProperties.signWithPkey.get());
+    properties.setValidAfter = aProperties.setValidAfter;
+    properties.setValidBefore = aProperties.setValidBefore;
+    properties.setCommonName = aProperties.setCommonName;
+    properties.commonName = aProperties.commonName;
+    properties.signAlgorithm = aProperties.signAlgorithm;
+    properties.signHash = aProperties.signHash;
+}
+
+void
+Ssl::CertGenerator::Latencies::note(const double milliseconds)
+{
+    if (samples.size() < MaxSamples)
+        samples.push_back(milliseconds);
+    else
+        samples[count % MaxSamples] = milliseconds;
+    ++count;
+}
+
+double
+Ssl::CertGenerator::Latencies::percentile(const double p) const
+{
+    if (samples.empty())
+        return 0;
+    auto sorted = samples;
+    const auto nth = std::min(sorted.size() - 1, static_cast<size_t>(p * sorted.size() / 100));
+    std::nth_element(sorted.begin(), sorted.begin() + nth, sorted.end());
+    return sorted[nth];
+}
+
+namespace Ssl
+{
+namespace CertGenerator
+{
+
+/// signs the job certificate (in a generator thread)
+static void
+Generate(Job &job)
+{
+    if (!job.properties.signWithPkey) {
+        std::lock_guard<std::mutex> lock(Mutex);
+        if (!Keys.empty()) {
+            job.properties.newPkey = std::move(Keys.front());
+            Keys.pop_front();
+        }
+    }
+
+    Security::CertPointer cert;
+    Security::PrivateKeyPointer pkey;
+    if (!generateSslCertificate(cert, pkey, job.properties) || !cert || !pkey ||
+            !writeCertAndPrivateKeyToMemory(cert, pkey, job.certAndKey))
+        job.certAndKey.clear();
+}
+
+/// tells the main thread that some jobs are done (in a generator thread)
+static void
+Notify()
+{
+    if (!Notified.exchange(true)) {
+        const auto written = write(NotificationWriteFd, "!", 1);
+        (void)written; // a full pipe already has unread notifications
+    }
+}
+
+/// a generator thread main loop
+static void
+Work()
+{
+    std::unique_lock<std::mutex> lock(Mutex);
+    while (!Stopping) {
+        if (!Pending.empty()) {
+            const auto job = Pending.front();
+            Pending.pop_front();
+            lock.unlock();
+            Generate(*job);
+            lock.lock();
+            Done.push_back(job);
+            Notify();
+            continue;
+        }
+
+        // replenish the key pool while there are no certificates to sign
+        if (Keys.size() + KeysInProgress < KeysWanted) {
+            ++KeysInProgress;
+            lock.unlock();
+            auto key = CreateRsaPrivateKey();
+            lock.lock();
+            --KeysInProgress;
+            if (key)
+                Keys.push_back(std::move(key));
+            continue;
+        }
+
+        Wakeup.wait(lock);
+    }
+}
+
+/// calls back requestors of done jobs (in the main thread)
+static void
+HandleNotification(int fd, void *)
+{
+    char buf[256];
+    (void)FD_READ_METHOD(fd, buf, sizeof(buf));
+    Notified = false;
+    Comm::SetSelect(fd, COMM_SELECT_READ, HandleNotification, nullptr, 0);
+
+    std::deque<Job *> done;
+    {
+        std::lock_guard<std::mutex> lock(Mutex);
+        done.swap(Done);
+    }
+
+    for (const auto job: done) {
+        const std::chrono::duration<double, std::milli> latency = Clock::now() - job->queued;
+        auto &stats = Stats[job->properties.signAlgorithm];
+        if (job->certAndKey.empty())
+            ++stats.failures;
+        else
+            stats.note(latency.count());
+        debugs(83, 5, "generated " << job->properties.commonName << " certificate in " << latency.count() << "ms");
+
+        if (const auto cbdata = job->data.validDone())
+            job->callback(cbdata, job->certAndKey);
+        delete job;
+    }
+}
+
+/// starts the configured number of generator threads
+static void
+Start()
+{
+    if (NotificationReadFd < 0) {
+        int fds[2];
+        if (pipe(fds) != 0) {
+            const auto savedErrno = errno;
+            debugs(83, DBG_CRITICAL, "ERROR: Cannot start certificate generator threads: " << xstrerr(savedErrno));
+            return;
+        }
+        NotificationReadFd = fds[0];
+        NotificationWriteFd = fds[1];
+        fd_open(NotificationReadFd, FD_PIPE, "certificate generator notifications: main");
+        fd_open(NotificationWriteFd, FD_PIPE, "certificate generator notifications: threads");
+        commSetNonBlocking(NotificationReadFd);
+        commSetNonBlocking(NotificationWriteFd);
+        Comm::SetSelect(NotificationReadFd, COMM_SELECT_READ, HandleNotification, nullptr, 0);
+    }
+
+    KeysWanted = ::Config.SSL.certGenKeyPool;
+    Stopping = false;
+    for (size_t i = 0; i < ConfiguredThreads; ++i)
+        Threads.emplace_back(Work);
+    debugs(83, 3, "started " << Threads.size() << " certificate generator threads");
+}
+
+/// stops all generator threads; pending jobs wait for restarted threads
+static void
+Stop()
+{
+    {
+        std::lock_guard<std::mutex> lock(Mutex);
+        Stopping = true;
+    }
+    Wakeup.notify_all();
+    for (auto &thread: Threads)
+        thread.join();
+    Threads.clear();
+}
+
+/// fails jobs that no thread is going to pick up
+static void
+AbandonPending()
+{
+    std::deque<Job *> abandoned;
+    {
+        std::lock_guard<std::mutex> lock(Mutex);
+        abandoned.swap(Pending);
+    }
+
+    for (const auto job: abandoned) {
+        debugs(83, 3, "abandoning " << job->properties.commonName << " certificate generation");
+        if (const auto cbdata = job->data.validDone())
+            job->callback(cbdata, std::string());
+        delete job;
+    }
+}
+
+} // namespace CertGenerator
+} // namespace Ssl
+
+bool
+Ssl::CertGenerator::Enabled()
+{
+    return !Threads.empty();
+}
+
+void
+Ssl::CertGenerator::Submit(const CertificateProperties &properties, Callback *callback, void *data)
+{
+    assert(Enabled());
+    const auto job = new Job(properties, callback, data);
+    {
+        std::lock_guard<std::mutex> lock(Mutex);
+        Pending.push_back(job);
+    }
+    Wakeup.notify_one();
+}
+
+/// reports per-algorithm certificate generation latencies
+void
+Ssl::CertGenerator::Report(StoreEntry *sentry)
+{
+    PackableStream os(*sentry);
+
+    if (!Enabled()) {
+        os << "In-process certificate generation is disabled (sslproxy_cert_gen_threads 0).\n";
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(Mutex);
+        os << "Generator threads:\t" << Threads.size() << "\n" <<
+           "Pending certificates:\t" << Pending.size() << "\n" <<
+           "Pre-generated keys:\t" << Keys.size() << " of " << KeysWanted << "\n";
+    }
+
+    os << "\nGeneration latency (milliseconds, last " << Latencies::MaxSamples << " certificates):\n" <<
+       "Algorithm\tGenerated\tFailed\tp50\tp90\tp99\tp100\n";
+    for (int alg = 0; alg < algSignEnd; ++alg) {
+        const auto &stats = Stats[alg];
+        os << certSignAlgorithm(alg) << '\t' <<
+           stats.count << '\t' <<
+           stats.failures << '\t' <<
+           stats.percentile(50) << '\t' <<
+           stats.percentile(90) << '\t' <<
+           stats.percentile(99) << '\t' <<
+           stats.percentile(100) << "\n";
+    }
+}
+
+/// manages in-process certificate generator threads
+class CertGeneratorRr: public RegisteredRunner
+{
+public:
+    /* RegisteredRunner API */
+    void useConfig() override;
+    void syncConfig() override;
+    void finishShutdown() override;
+
+private:
+    /// (re)starts threads if their configuration has changed
+    void sync();
+};
+
+DefineRunnerRegistrator(CertGeneratorRr);
+
+void
+CertGeneratorRr::useConfig()
+{
+    Mgr::RegisterAction("ssl_cert_generator", "In-process TLS certificate generation", Ssl::CertGenerator::Report, 0, 1);
+    sync();
+}
+
+void
+CertGeneratorRr::syncConfig()
+{
+    sync();
+}
+
+void
+CertGeneratorRr::finishShutdown()
+{
+    Ssl::CertGenerator::Stop();
+}
+
+void
+CertGeneratorRr::sync()
+{
+    const size_t threads = (IamWorkerProcess() && Ssl::CertGenerator::Needed()) ? ::Config.SSL.certGenThreads : 0;
+    const size_t keys = ::Config.SSL.certGenKeyPool;
+    if (threads == Ssl::CertGenerator::ConfiguredThreads && keys == Ssl::CertGenerator::KeysWanted)
+        return;
+
+    Ssl::CertGenerator::Stop();
+    Ssl::CertGenerator::ConfiguredThreads = threads;
+    if (threads > 0)
+        Ssl::CertGenerator::Start();
+    else
+        Ssl::CertGenerator::AbandonPending();
+}
+
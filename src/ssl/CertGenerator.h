@@ -0,0 +1,47 @@
+/*
+ * Copyright (C) 1996-2023 The Squid Software Foundation and contributors
+ *
+ * Squid software is distributed under GPLv2+ license and includes
+ * contributions from numerous individuals and organizations.
+ * Please see the COPYING and CONTRIBUTORS files for details.
+ */
+
+#ifndef SQUID_SSL_CERTGENERATOR_H
+#define SQUID_SSL_CERTGENERATOR_H
+
+#if USE_OPENSSL
+
+#include "ssl/gadgets.h"
+
+#include <string>
+
+namespace Ssl
+{
+
+/// In-process generation of SslBump certificates. Certificates are signed by
+/// a small pool of worker threads, avoiding certificate generator helper
+/// queuing and on-disk certificate database locking. The threads also
+/// maintain a pool of pre-generated private keys for certificates that need
+/// a new key (i.e. when there is no signing key to reuse).
+/// \sa sslproxy_cert_gen_threads
+namespace CertGenerator
+{
+
+/// receives the generated certificate and private key in PEM format, the
+/// format used by certificate generator helper replies; empty on failures
+typedef void Callback(void *data, const std::string &certAndKey);
+
+/// whether sslproxy_cert_gen_threads enabled in-process generation
+bool Enabled();
+
+/// asynchronously generates a certificate with the given properties
+void Submit(const CertificateProperties &, Callback *, void *data);
+
+} // namespace CertGenerator
+
+} // namespace Ssl
+
+#endif /* USE_OPENSSL */
+
+#endif /* SQUID_SSL_CERTGENERATOR_H */
+
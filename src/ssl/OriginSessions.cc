@@ -0,0 +1,259 @@
+/*
+ * Copyright (C) 1996-2023 The Squid Software Foundation and contributors
+ *
+ * Squid software is distributed under GPLv2+ license and includes
+ * contributions from numerous individuals and organizations.
+ * Please see the COPYING and CONTRIBUTORS files for details.
+ */
+
+/* DEBUG: section 83    TLS session management */
+
+#include "squid.h"
+#include "anyp/PortCfg.h"
+#include "base/PackableStream.h"
+#include "base/RunnersRegistry.h"
+#include "globals.h"
+#include "ipc/MemMap.h"
+#include "mgr/Registration.h"
+#include "sbuf/SBuf.h"
+#include "sbuf/Stream.h"
+#include "security/PeerOptions.h"
+#include "security/Session.h"
+#include "SquidConfig.h"
+#include "ssl/Config.h"
+#include "ssl/OriginSessions.h"
+#include "Store.h"
+#include "tools.h"
+
+#include <cstring>
+#if HAVE_OPENSSL_EVP_H
+#include <openssl/evp.h>
+#endif
+
+namespace Ssl
+{
+namespace OriginSessions
+{
+
+/// shared memory segment label
+static const char * const MapLabel = "tls_origin_sessions";
+
+/// this worker view of the shared origin session cache (if enabled)
+static Ipc::MemMap *Map = nullptr;
+
+/// SSL ex_data index of the Key of sessions that should be cached
+static int KeyIndex = -1;
+
+/// this worker statistics for the tls_origin_sessions report
+static struct {
+    uint64_t offered = 0; ///< cached sessions offered to origin servers
+    uint64_t misses = 0; ///< lookups that found no usable cached session
+    uint64_t stores = 0; ///< sessions added to the shared cache
+    uint64_t failures = 0; ///< sessions that could not be stored or loaded
+} Stats;
+
+/// MemMap key for a given origin and tls_outgoing_options
+class Key
+{
+public:
+    explicit Key(const SBuf &origin);
+
+    const cache_key *raw() const { return reinterpret_cast<const cache_key *>(bytes); }
+
+    unsigned char bytes[MEMMAP_SLOT_KEY_SIZE];
+};
+
+static OBJH Report;
+
+/// whether some port may bump connections to origin servers
+static bool
+Needed()
+{
+    for (AnyP::PortCfgPointer s = HttpPortList; s != nullptr; s = s->next) {
+        if (s->flags.tunnelSslBumping)
+            return true;
+    }
+    return false;
+}
+
+/// the number of shared cache slots configured by sslproxy_origin_session_cache_size
+static int
+ConfiguredSlots()
+{
+    return ::Config.SSL.originSessionCacheSize / sizeof(Ipc::MemMap::Slot);
+}
+
+/// frees a Key stored as SSL ex_data
+static void
+FreeKey(void *, void *ptr, CRYPTO_EX_DATA *, int, long, void *)
+{
+    delete static_cast<Key *>(ptr);
+}
+
+/// SSL_CTX_sess_set_new_cb() callback that shares new origin sessions
+static int
+StoreSession(SSL *ssl, SSL_SESSION *session)
+{
+    const auto key = static_cast<const Key *>(SSL_get_ex_data(ssl, KeyIndex));
+    if (!Map || !key)
+        return 0; // not a bumped connection to an origin server
+
+    // Do not let future connections skip certificate checks that found
+    // problems (that were ignored due to sslproxy_cert_error, for example).
+    if (SSL_get_ex_data(ssl, ssl_ex_index_ssl_errors)) {
+        debugs(83, 5, "not sharing a session with certificate errors");
+        return 0;
+    }
+
+#if OPENSSL_VERSION_NUMBER >= 0x10101000L
+    if (!SSL_SESSION_is_resumable(session))
+        return 0;
+#endif
+
+    const auto size = i2d_SSL_SESSION(session, nullptr);
+    if (size <= 0 || size > MEMMAP_SLOT_DATA_SIZE) {
+        debugs(83, 3, "cannot share an origin session of " << size << " bytes");
+        ++Stats.failures;
+        return 0;
+    }
+
+    sfileno pos = -1;
+    if (const auto slot = Map->openForWriting(key->raw(), pos)) {
+        auto bytes = slot->p;
+        i2d_SSL_SESSION(session, &bytes);
+        slot->set(key->bytes, nullptr, size, squid_curtime + SSL_SESSION_get_timeout(session));
+        Map->closeForWriting(pos);
+        debugs(83, 5, "shared an origin session of " << size << " bytes at " << pos);
+        ++Stats.stores;
+    }
+    return 0; // we did not keep a session reference
+}
+
+} // namespace OriginSessions
+} // namespace Ssl
+
+Ssl::OriginSessions::Key::Key(const SBuf &origin)
+{
+    // Sessions negotiated with different client TLS settings may be
+    // unacceptable to (or rejected by) our future handshakes.
+    const auto &options = ::Security::ProxyOutgoingConfig;
+    const auto fullKey = ToSBuf(origin, ' ', options.sslOptions, ' ', options.tlsMinVersion, ' ',
+                                options.sslCipher, ' ', options.sslFlags);
+
+    static_assert(MEMMAP_SLOT_KEY_SIZE >= 32, "a MemMap key can hold a SHA-256 digest");
+    memset(bytes, 0, sizeof(bytes));
+    unsigned int digestSize = 0;
+    if (!EVP_Digest(fullKey.rawContent(), fullKey.length(), bytes, &digestSize, EVP_sha256(), nullptr))
+        throw TextException("cannot hash origin TLS session key", Here());
+}
+
+bool
+Ssl::OriginSessions::Enabled()
+{
+    return Map;
+}
+
+void
+Ssl::OriginSessions::Resume(Security::ContextPointer &ctx, const Security::SessionPointer &session, const SBuf &serverName, const unsigned short port)
+{
+    if (!Map || !ctx || !session)
+        return;
+
+    // Resumed sessions do not carry the server certificate chain that a
+    // certificate validator helper expects to see.
+    if (Ssl::TheConfig.ssl_crt_validator)
+        return;
+
+    if (KeyIndex < 0)
+        KeyIndex = SSL_get_ex_new_index(0, (void *) "origin_session_key", nullptr, nullptr, &FreeKey);
+
+    if (SSL_CTX_sess_get_new_cb(ctx.get()) != &StoreSession) {
+        SSL_CTX_set_session_cache_mode(ctx.get(), SSL_SESS_CACHE_CLIENT | SSL_SESS_CACHE_NO_INTERNAL_STORE);
+        SSL_CTX_sess_set_new_cb(ctx.get(), &StoreSession);
+    }
+
+    const auto key = new Key(ToSBuf(serverName, ':', port));
+    SSL_set_ex_data(session.get(), KeyIndex, key);
+
+    Security::SessionStatePointer data;
+    sfileno pos = -1;
+    if (const auto slot = Map->openForReading(key->raw(), pos)) {
+        if (slot->expire > squid_curtime) {
+            const unsigned char *bytes = slot->p;
+            data.reset(d2i_SSL_SESSION(nullptr, &bytes, slot->pSize));
+            if (!data)
+                ++Stats.failures;
+        }
+        Map->closeForReading(pos);
+    }
+
+    if (!data) {
+        debugs(83, 5, "no shared session for " << serverName << ':' << port);
+        ++Stats.misses;
+        return;
+    }
+
+    debugs(83, 5, "offering shared session for " << serverName << ':' << port << " from " << pos);
+    Security::SetSessionResumeData(session, data);
+    ++Stats.offered;
+}
+
+/// reports shared cache state and this worker cache statistics
+void
+Ssl::OriginSessions::Report(StoreEntry *sentry)
+{
+    PackableStream os(*sentry);
+
+    if (!Map) {
+        os << "Shared origin TLS session cache is disabled.\n";
+        return;
+    }
+
+    os << "cached sessions:\t" << Map->entryCount() << " of " << Map->entryLimit() << "\n" <<
+       "offered sessions:\t" << Stats.offered << "\n" <<
+       "misses:\t" << Stats.misses << "\n" <<
+       "stores:\t" << Stats.stores << "\n" <<
+       "failures:\t" << Stats.failures << "\n";
+}
+
+/// initializes shared memory segment used by Ssl::OriginSessions
+class SharedOriginSessionsRr: public Ipc::Mem::RegisteredRunner
+{
+public:
+    /* RegisteredRunner API */
+    ~SharedOriginSessionsRr() override { delete owner; }
+    void useConfig() override;
+
+protected:
+    void create() override;
+
+private:
+    Ipc::MemMap::Owner *owner = nullptr;
+};
+
+DefineRunnerRegistrator(SharedOriginSessionsRr);
+
+void
+SharedOriginSessionsRr::useConfig()
+{
+    if (Ssl::OriginSessions::Map || !Ssl::OriginSessions::Needed())
+        return;
+
+    Ipc::Mem::RegisteredRunner::useConfig();
+
+    if (IamWorkerProcess() && Ssl::OriginSessions::ConfiguredSlots() > 0) {
+        Ssl::OriginSessions::Map = new Ipc::MemMap(Ssl::OriginSessions::MapLabel);
+        Mgr::RegisterAction("tls_origin_sessions", "Shared TLS sessions with origin servers", Ssl::OriginSessions::Report, 0, 1);
+    }
+}
+
+void
+SharedOriginSessionsRr::create()
+{
+    if (!Ssl::OriginSessions::Needed())
+        return;
+
+    if (const auto slots = Ssl::OriginSessions::ConfiguredSlots())
+        owner = Ipc::MemMap::Init(Ssl::OriginSessions::MapLabel, slots);
+}
+
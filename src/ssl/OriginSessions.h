@@ -0,0 +1,45 @@
+/*
+ * Copyright (C) 1996-2023 The Squid Software Foundation and contributors
+ *
+ * Squid software is distributed under GPLv2+ license and includes
+ * contributions from numerous individuals and organizations.
+ * Please see the COPYING and CONTRIBUTORS files for details.
+ */
+
+#ifndef SQUID_SSL_ORIGINSESSIONS_H
+#define SQUID_SSL_ORIGINSESSIONS_H
+
+#if USE_OPENSSL
+
+#include "sbuf/forward.h"
+#include "security/Session.h"
+
+namespace Ssl
+{
+
+/// A cache of TLS sessions that SslBump established with origin servers,
+/// shared by all SMP workers. Sessions are indexed by a hash of the server
+/// name, server port, and tls_outgoing_options settings affecting the
+/// session, allowing bumped connections to the same origin to resume
+/// earlier sessions instead of performing full TLS handshakes.
+/// \sa sslproxy_origin_session_cache_size
+namespace OriginSessions
+{
+
+/// whether sslproxy_origin_session_cache_size enabled the shared cache
+bool Enabled();
+
+/// Offers a cached session (if any) for resumption by the given not yet
+/// negotiated session and arranges for the sessions the server issues to
+/// that session to be cached. The given TLS context must be the one that
+/// created the session.
+void Resume(Security::ContextPointer &, const Security::SessionPointer &, const SBuf &serverName, unsigned short port);
+
+} // namespace OriginSessions
+
+} // namespace Ssl
+
+#endif /* USE_OPENSSL */
+
+#endif /* SQUID_SSL_ORIGINSESSIONS_H */
+
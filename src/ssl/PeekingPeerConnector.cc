@@ -19,6 +19,7 @@
 #include "security/NegotiationHistory.h"
 #include "SquidConfig.h"
 #include "ssl/bio.h"
+#include "ssl/OriginSessions.h"
 #include "ssl/PeekingPeerConnector.h"
 #include "ssl/ServerBump.h"
 #include "tunnel.h"
@@ -208,6 +209,13 @@ Ssl::PeekingPeerConnector::initialize(Security::SessionPointer &serverSession)
                                     hostName->c_str();
             if (sniServer)
                 setClientSNI(serverSession.get(), sniServer);
+
+            // Unlike peeking and staring, which mimic the client handshake,
+            // these bumping modes send our own handshake and may resume.
+            char ipBuf[MAX_IPSTRLEN];
+            const auto origin = sniServer ? SBuf(sniServer) : SBuf(serverConnection()->remote.toStr(ipBuf, sizeof(ipBuf)));
+            auto ctx = getTlsContext();
+            Ssl::OriginSessions::Resume(ctx, serverSession, origin, serverConnection()->remote.port());
         }
 
         if (Ssl::ServerBump *serverBump = csd->serverBump()) {
@@ -30,6 +30,7 @@ public:
     /* Security::PeerConnector API */
     bool initialize(Security::SessionPointer &) override;
     Security::ContextPointer getTlsContext() override;
+    bool mayUseKernelTls() const override { return false; }
     void noteWantWrite() override;
     void noteNegotiationError(const Security::ErrorDetailPointer &) override;
     void noteNegotiationDone(ErrorState *error) override;
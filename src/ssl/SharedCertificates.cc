@@ -0,0 +1,242 @@
+/*
+ * Copyright (C) 1996-2023 The Squid Software Foundation and contributors
+ *
+ * Squid software is distributed under GPLv2+ license and includes
+ * contributions from numerous individuals and organizations.
+ * Please see the COPYING and CONTRIBUTORS files for details.
+ */
+
+/* DEBUG: section 83    TLS session management */
+
+#include "squid.h"
+#include "anyp/PortCfg.h"
+#include "base/RunnersRegistry.h"
+#include "ipc/MemMap.h"
+#include "sbuf/SBuf.h"
+#include "security/ServerOptions.h"
+#include "SquidConfig.h"
+#include "ssl/SharedCertificates.h"
+#include "ssl/support.h"
+
+#include <cstring>
+#include <ostream>
+#if HAVE_OPENSSL_EVP_H
+#include <openssl/evp.h>
+#endif
+
+namespace Ssl
+{
+namespace SharedCertificates
+{
+
+/// shared memory segment label
+static const char * const MapLabel = "tls_generated_certs";
+
+/// this worker view of the shared certificate cache (if enabled)
+static Ipc::MemMap *Map = nullptr;
+
+/// this worker shared cache statistics for the cached_ssl_cert report
+static struct {
+    uint64_t hits = 0; ///< certificates found in the shared cache
+    uint64_t misses = 0; ///< certificates missing from the shared cache
+    uint64_t stores = 0; ///< certificates added to the shared cache
+    uint64_t failures = 0; ///< certificates that could not be stored or loaded
+} Stats;
+
+/// MemMap key for the given certificate properties key
+class Key
+{
+public:
+    explicit Key(const SBuf &certKey);
+
+    const cache_key *raw() const { return reinterpret_cast<const cache_key *>(bytes); }
+
+    unsigned char bytes[MEMMAP_SLOT_KEY_SIZE];
+};
+
+/// whether some port generates certificates that may use the shared cache
+static bool
+Needed()
+{
+    for (AnyP::PortCfgPointer s = HttpPortList; s != nullptr; s = s->next) {
+        if (s->secure.generateHostCertificates)
+            return true;
+    }
+    return false;
+}
+
+/// the number of shared cache slots configured by sslproxy_cert_shared_cache_size
+static int
+ConfiguredSlots()
+{
+    return ::Config.SSL.certCacheSize / sizeof(Ipc::MemMap::Slot);
+}
+
+} // namespace SharedCertificates
+} // namespace Ssl
+
+Ssl::SharedCertificates::Key::Key(const SBuf &certKey)
+{
+    static_assert(MEMMAP_SLOT_KEY_SIZE >= 32, "a MemMap key can hold a SHA-256 digest");
+    memset(bytes, 0, sizeof(bytes));
+    unsigned int digestSize = 0;
+    if (!EVP_Digest(certKey.rawContent(), certKey.length(), bytes, &digestSize, EVP_sha256(), nullptr))
+        throw TextException("cannot hash generated certificate properties", Here());
+}
+
+bool
+Ssl::SharedCertificates::Enabled()
+{
+    return Map;
+}
+
+Security::ContextPointer
+Ssl::SharedCertificates::Find(const SBuf &certKey, Security::ServerOptions &options, const bool trusted)
+{
+    if (!Map)
+        return Security::ContextPointer();
+
+    const Key key(certKey);
+    Security::CertPointer cert;
+    Security::PrivateKeyPointer pkey;
+    sfileno pos = -1;
+    if (const auto slot = Map->openForReading(key.raw(), pos)) {
+        uint32_t certSize = 0;
+        if (slot->pSize > sizeof(certSize)) {
+            memcpy(&certSize, slot->p, sizeof(certSize));
+            if (certSize < slot->pSize - sizeof(certSize)) {
+                const unsigned char *certBytes = slot->p + sizeof(certSize);
+                cert.resetWithoutLocking(d2i_X509(nullptr, &certBytes, certSize));
+                const unsigned char *keyBytes = slot->p + sizeof(certSize) + certSize;
+                const auto keySize = slot->pSize - sizeof(certSize) - certSize;
+                pkey.resetWithoutLocking(d2i_AutoPrivateKey(nullptr, &keyBytes, keySize));
+            }
+        }
+        Map->closeForReading(pos);
+
+        if (!cert || !pkey) {
+            debugs(83, 2, "ERROR: Cannot load a shared generated certificate from slot " << pos);
+            ++Stats.failures;
+            Forget(certKey);
+            return Security::ContextPointer();
+        }
+    }
+
+    if (!cert) {
+        debugs(83, 5, "no shared generated certificate for " << certKey);
+        ++Stats.misses;
+        return Security::ContextPointer();
+    }
+
+    Security::ContextPointer ctx(createSSLContext(cert, pkey, options));
+    if (ctx && trusted)
+        chainCertificatesToSSLContext(ctx, options);
+    debugs(83, 5, "shared generated certificate for " << certKey << " at " << pos << ": " << ctx);
+    ++Stats.hits;
+    return ctx;
+}
+
+void
+Ssl::SharedCertificates::Remember(const SBuf &certKey, const Security::ContextPointer &ctx)
+{
+    if (!Map || !ctx)
+        return;
+
+    const auto cert = SSL_CTX_get0_certificate(ctx.get());
+    const auto pkey = SSL_CTX_get0_privatekey(ctx.get());
+    if (!cert || !pkey)
+        return;
+
+    const auto certSize = i2d_X509(cert, nullptr);
+    const auto keySize = i2d_PrivateKey(pkey, nullptr);
+    if (certSize <= 0 || keySize <= 0 ||
+            sizeof(uint32_t) + certSize + keySize > MEMMAP_SLOT_DATA_SIZE) {
+        debugs(83, 3, "cannot share a generated certificate of " << certSize << '+' << keySize << " bytes");
+        ++Stats.failures;
+        return;
+    }
+
+    const Key key(certKey);
+    sfileno pos = -1;
+    if (const auto slot = Map->openForWriting(key.raw(), pos)) {
+        const uint32_t storedCertSize = certSize;
+        memcpy(slot->p, &storedCertSize, sizeof(storedCertSize));
+        auto bytes = slot->p + sizeof(storedCertSize);
+        i2d_X509(cert, &bytes); // advances bytes
+        i2d_PrivateKey(pkey, &bytes);
+        slot->set(key.bytes, nullptr, bytes - slot->p);
+        Map->closeForWriting(pos);
+        debugs(83, 5, "shared generated certificate for " << certKey << " at " << pos);
+        ++Stats.stores;
+    }
+}
+
+void
+Ssl::SharedCertificates::Forget(const SBuf &certKey)
+{
+    if (!Map)
+        return;
+
+    const Key key(certKey);
+    sfileno pos = -1;
+    if (Map->openForReading(key.raw(), pos)) {
+        Map->closeForReading(pos);
+        Map->free(pos);
+    }
+}
+
+void
+Ssl::SharedCertificates::Report(std::ostream &os)
+{
+    if (!Map) {
+        os << "Shared generated certificates cache is disabled.\n";
+        return;
+    }
+
+    os << "Shared generated certificates cache:\n" <<
+       "\tcached certificates:\t" << Map->entryCount() << " of " << Map->entryLimit() << "\n" <<
+       "\thits:\t" << Stats.hits << "\n" <<
+       "\tmisses:\t" << Stats.misses << "\n" <<
+       "\tstores:\t" << Stats.stores << "\n" <<
+       "\tfailures:\t" << Stats.failures << "\n";
+}
+
+/// initializes shared memory segment used by Ssl::SharedCertificates
+class SharedCertificatesRr: public Ipc::Mem::RegisteredRunner
+{
+public:
+    /* RegisteredRunner API */
+    ~SharedCertificatesRr() override { delete owner; }
+    void useConfig() override;
+
+protected:
+    void create() override;
+
+private:
+    Ipc::MemMap::Owner *owner = nullptr;
+};
+
+DefineRunnerRegistrator(SharedCertificatesRr);
+
+void
+SharedCertificatesRr::useConfig()
+{
+    if (Ssl::SharedCertificates::Map || !Ssl::SharedCertificates::Needed())
+        return;
+
+    Ipc::Mem::RegisteredRunner::useConfig();
+
+    if (IamWorkerProcess() && Ssl::SharedCertificates::ConfiguredSlots() > 0)
+        Ssl::SharedCertificates::Map = new Ipc::MemMap(Ssl::SharedCertificates::MapLabel);
+}
+
+void
+SharedCertificatesRr::create()
+{
+    if (!Ssl::SharedCertificates::Needed())
+        return;
+
+    if (const auto slots = Ssl::SharedCertificates::ConfiguredSlots())
+        owner = Ipc::MemMap::Init(Ssl::SharedCertificates::MapLabel, slots);
+}
+
@@ -0,0 +1,55 @@
+/*
+ * Copyright (C) 1996-2023 The Squid Software Foundation and contributors
+ *
+ * Squid software is distributed under GPLv2+ license and includes
+ * contributions from numerous individuals and organizations.
+ * Please see the COPYING and CONTRIBUTORS files for details.
+ */
+
+#ifndef SQUID_SSL_SHAREDCERTIFICATES_H
+#define SQUID_SSL_SHAREDCERTIFICATES_H
+
+#if USE_OPENSSL
+
+#include "sbuf/forward.h"
+#include "security/Context.h"
+#include "security/forward.h"
+
+#include <iosfwd>
+
+namespace Ssl
+{
+
+/// A cache of generated SslBump certificates (and their private keys) shared
+/// by all SMP workers. Each certificate is stored in DER format and indexed
+/// by a hash of the certificate properties key (see InRamCertificateDbKey()),
+/// so that one certificate generation serves all workers and restarted
+/// workers do not have to regenerate certificates.
+/// \sa sslproxy_cert_shared_cache_size
+namespace SharedCertificates
+{
+
+/// whether sslproxy_cert_shared_cache_size enabled the shared cache
+bool Enabled();
+
+/// \returns a new TLS context using the cached certificate for the given
+/// certificate properties key or, if there is no such certificate, nil
+Security::ContextPointer Find(const SBuf &certKey, Security::ServerOptions &, bool trusted);
+
+/// shares the certificate and the private key of a generated TLS context
+void Remember(const SBuf &certKey, const Security::ContextPointer &);
+
+/// purges the certificate (e.g., because it is no longer valid)
+void Forget(const SBuf &certKey);
+
+/// reports shared cache state and this worker cache statistics
+void Report(std::ostream &);
+
+} // namespace SharedCertificates
+
+} // namespace Ssl
+
+#endif /* USE_OPENSSL */
+
+#endif /* SQUID_SSL_SHAREDCERTIFICATES_H */
+
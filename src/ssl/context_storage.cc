@@ -10,6 +10,7 @@
 #include "base/PackableStream.h"
 #include "mgr/Registration.h"
 #include "ssl/context_storage.h"
+#include "ssl/SharedCertificates.h"
 #include "Store.h"
 
 #include <limits>
@@ -53,6 +54,7 @@ void Ssl::CertificateStorageAction::dump (StoreEntry *sentry)
         stream << ssl_store_policy.freeMem() / 1024 << endString;
     }
     stream << endString;
+    Ssl::SharedCertificates::Report(stream);
     stream.flush();
 }
 
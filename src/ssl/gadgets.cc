@@ -48,8 +48,8 @@ ThrowErrors(const char * const problem, const int savedErrno, const SourceLocati
                         where);
 }
 
-static Security::PrivateKeyPointer
-CreateRsaPrivateKey()
+Security::PrivateKeyPointer
+Ssl::CreateRsaPrivateKey()
 {
     Ssl::EVP_PKEY_CTX_Pointer rsa(EVP_PKEY_CTX_new_id(EVP_PKEY_RSA, nullptr));
     if (!rsa)
@@ -588,7 +588,9 @@ static bool buildCertificate(Security::CertPointer & cert, Ssl::CertificatePrope
 static bool generateFakeSslCertificate(Security::CertPointer & certToStore, Security::PrivateKeyPointer & pkeyToStore, Ssl::CertificateProperties const &properties,  Ssl::BIGNUM_Pointer const &serial)
 {
     // Use signing certificates private key as generated certificate private key
-    const auto pkey = properties.signWithPkey ? properties.signWithPkey : CreateRsaPrivateKey();
+    // or, if there is no signing key, a pre-generated or a brand new key
+    const auto pkey = properties.signWithPkey ? properties.signWithPkey :
+                      properties.newPkey ? properties.newPkey : Ssl::CreateRsaPrivateKey();
     if (!pkey)
         return false;
 
@@ -232,6 +232,7 @@ public:
     Security::CertPointer mimicCert; ///< Certificate to mimic
     Security::CertPointer signWithX509; ///< Certificate to sign the generated request
     Security::PrivateKeyPointer signWithPkey; ///< The key of the signing certificate
+    Security::PrivateKeyPointer newPkey; ///< A pre-generated key to use when there is no signing key
     bool setValidAfter; ///< Do not mimic "Not Valid After" field
     bool setValidBefore; ///< Do not mimic "Not Valid Before" field
     bool setCommonName; ///< Replace the CN field of the mimicking subject with the given
@@ -247,6 +248,10 @@ private:
 /// \returns certificate database key
 std::string & OnDiskCertificateDbKey(const CertificateProperties &);
 
+/// \ingroup SslCrtdSslAPI
+/// \returns a new 2048-bit RSA private key or, on errors, nil
+Security::PrivateKeyPointer CreateRsaPrivateKey();
+
 /**
  \ingroup SslCrtdSslAPI
  * Decide on the kind of certificate and generate a CA- or self-signed one.
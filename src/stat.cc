@@ -1392,6 +1392,9 @@ GetCountersStats(Mgr::CountersActionData& stats)
     stats.server_other_kbytes_in = f->server.other.kbytes_in.kb;
     stats.server_other_kbytes_out = f->server.other.kbytes_out.kb;
 
+    stats.tls_kbytes_out = f->tls.kbytes_out.kb;
+    stats.tls_ktls_kbytes_out = f->tls.ktls_kbytes_out.kb;
+
     stats.icp_pkts_sent = f->icp.pkts_sent;
     stats.icp_pkts_recv = f->icp.pkts_recv;
     stats.icp_queries_sent = f->icp.queries_sent;
@@ -1492,6 +1495,13 @@ DumpCountersStats(Mgr::CountersActionData& stats, StoreEntry* sentry)
     storeAppendPrintf(sentry, "server.other.kbytes_out = %.0f\n",
                       stats.server_other_kbytes_out);
 
+    storeAppendPrintf(sentry, "tls.kbytes_out = %.0f\n",
+                      stats.tls_kbytes_out);
+    storeAppendPrintf(sentry, "tls.ktls_kbytes_out = %.0f\n",
+                      stats.tls_ktls_kbytes_out);
+    storeAppendPrintf(sentry, "tls.ktls_kbytes_out_ratio = %.1f%%\n",
+                      Math::doublePercent(stats.tls_ktls_kbytes_out, stats.tls_kbytes_out));
+
     storeAppendPrintf(sentry, "icp.pkts_sent = %.0f\n",
                       stats.icp_pkts_sent);
     storeAppendPrintf(sentry, "icp.pkts_recv = %.0f\n",
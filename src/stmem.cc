@@ -15,6 +15,8 @@
 #include "MemObject.h"
 #include "stmem.h"
 
+#include <algorithm>
+
 /*
  * NodeGet() is called to get the data buffer to pass to storeIOWrite().
  * By setting the write_pending flag here we are assuming that there
@@ -33,10 +35,8 @@ mem_hdr::NodeGet(mem_node * aNode)
 int64_t
 mem_hdr::lowestOffset () const
 {
-    const SplayNode<mem_node *> *theStart = nodes.start();
-
-    if (theStart)
-        return theStart->data->nodeBuffer.offset;
+    if (!nodes.empty())
+        return nodes.front()->nodeBuffer.offset;
 
     return 0;
 }
@@ -45,20 +45,33 @@ int64_t
 mem_hdr::endOffset () const
 {
     int64_t result = 0;
-    const SplayNode<mem_node *> *theEnd = nodes.finish();
 
-    if (theEnd)
-        result = theEnd->data->dataRange().end;
+    if (!nodes.empty())
+        result = nodes.back()->dataRange().end;
 
     assert (result == inmem_hi);
 
     return result;
 }
 
+/// destroys a node unless it is borrowed; borrowed nodes are destroyed by
+/// their last borrower instead
+void
+mem_hdr::FreeNode(mem_node *aNode)
+{
+    if (aNode->borrowers) {
+        debugs(19, 5, "orphaning borrowed " << aNode);
+        aNode->orphaned = true;
+        return;
+    }
+    delete aNode;
+}
+
 void
 mem_hdr::freeContent()
 {
-    nodes.destroy();
+    std::for_each(nodes.begin(), nodes.end(), &FreeNode);
+    nodes.clear();
     inmem_hi = 0;
     debugs(19, 9, this << " hi: " << inmem_hi);
 }
@@ -71,8 +84,15 @@ mem_hdr::unlink(mem_node *aNode)
         return false;
     }
 
+    if (aNode->borrowers) {
+        debugs(19, 5, "cannot unlink borrowed mem_node " << aNode);
+        return false;
+    }
+
     debugs(19, 8, this << " removing " << aNode);
-    nodes.remove (aNode, NodeCompare);
+    const auto pos = firstNodeEndingAfter(aNode->start());
+    assert(pos != nodes.end() && *pos == aNode);
+    nodes.erase(pos);
     delete aNode;
     return true;
 }
@@ -82,16 +102,13 @@ mem_hdr::freeDataUpto(int64_t target_offset)
 {
     debugs(19, 8, this << " up to " << target_offset);
     /* keep the last one to avoid change to other part of code */
-    SplayNode<mem_node*> const * theStart;
+    while (nodes.size() > 1) {
+        mem_node *theStart = nodes.front();
 
-    while ((theStart = nodes.start())) {
-        if (theStart == nodes.finish())
+        if (theStart->end() > target_offset )
             break;
 
-        if (theStart->data->end() > target_offset )
-            break;
-
-        if (!unlink(theStart->data))
+        if (!unlink(theStart))
             break;
     }
 
@@ -124,10 +141,36 @@ mem_hdr::writeAvailable(mem_node *aNode, int64_t location, size_t amount, char c
     return copyLen;
 }
 
+/// adds a node that does not overlap with existing ones, preserving order
 void
-mem_hdr::appendNode (mem_node *aNode)
+mem_hdr::insertNode(mem_node *aNode)
 {
-    nodes.insert (aNode, NodeCompare);
+    if (nodes.empty() || nodes.back()->end() <= aNode->start()) {
+        nodes.push_back(aNode); // the common case
+        return;
+    }
+
+    const auto pos = firstNodeEndingAfter(aNode->start());
+    assert(pos == nodes.end() || (*pos)->start() >= aNode->end());
+    nodes.insert(pos, aNode);
+}
+
+/// \returns the position of the first node with data after the given location
+/// or, if there are no such nodes, nodes.end()
+mem_hdr::Nodes::const_iterator
+mem_hdr::firstNodeEndingAfter(const int64_t location) const
+{
+    if (nodes.empty() || location < nodes.front()->start())
+        return nodes.begin();
+
+    // dense content consists of full pages; just compute the position
+    const auto guess = static_cast<uint64_t>(location - nodes.front()->start()) / SM_PAGE_SIZE;
+    if (guess < nodes.size() && nodes[guess]->contains(location))
+        return nodes.begin() + guess;
+
+    // sparse content or partially filled pages
+    return std::upper_bound(nodes.begin(), nodes.end(), location,
+    [](const int64_t loc, const mem_node *aNode) { return loc < aNode->end(); });
 }
 
 /* returns a mem_node that contains location..
@@ -136,13 +179,10 @@ mem_hdr::appendNode (mem_node *aNode)
 mem_node *
 mem_hdr::getBlockContainingLocation (int64_t location) const
 {
-    // Optimize: do not create a whole mem_node just to store location
-    mem_node target (location);
-    target.nodeBuffer.length = 1;
-    mem_node *const *result = nodes.find (&target, NodeCompare);
+    const auto pos = firstNodeEndingAfter(location);
 
-    if (result)
-        return *result;
+    if (pos != nodes.end() && (*pos)->contains(location))
+        return *pos;
 
     return nullptr;
 }
@@ -172,7 +212,7 @@ mem_hdr::debugDump() const
     debugs (19, 0, "mem_hdr::debugDump: lowest offset: " << lowestOffset() << " highest offset + 1: " << endOffset() << ".");
     std::ostringstream result;
     PointerPrinter<mem_node *> foo(result, " - ");
-    getNodes().visit(foo);
+    std::for_each(nodes.begin(), nodes.end(), foo);
     debugs (19, 0, "mem_hdr::debugDump: Current available data is: " << result.str() << ".");
 }
 
@@ -203,9 +243,9 @@ mem_hdr::copy(StoreIOBuffer const &target) const
     assert(target.length > 0);
 
     /* Seek our way into store */
-    mem_node *p = getBlockContainingLocation(target.offset);
+    auto pos = firstNodeEndingAfter(target.offset);
 
-    if (!p) {
+    if (pos == nodes.end() || !(*pos)->contains(target.offset)) {
         debugs(19, DBG_IMPORTANT, "ERROR: memCopy: could not find start of " << target.range() <<
                " in memory.");
         debugDump();
@@ -220,8 +260,8 @@ mem_hdr::copy(StoreIOBuffer const &target) const
     /* Start copying beginning with this block until
      * we're satiated */
 
-    while (p && bytes_to_go > 0) {
-        size_t bytes_to_copy = copyAvailable (p,
+    while (pos != nodes.end() && bytes_to_go > 0) {
+        size_t bytes_to_copy = copyAvailable (*pos,
                                               location, bytes_to_go, ptr_to_buf);
 
         /* hit a sparse patch */
@@ -235,19 +275,43 @@ mem_hdr::copy(StoreIOBuffer const &target) const
 
         bytes_to_go -= bytes_to_copy;
 
-        p = getBlockContainingLocation(location);
+        ++pos;
     }
 
     return target.length - bytes_to_go;
 }
 
+MemLoan::Pointer
+mem_hdr::lend(int64_t offset, size_t maxSize)
+{
+    debugs(19, 6, this << " " << maxSize << " bytes at " << offset);
+    MemLoan::Pointer loan = new MemLoan();
+
+    for (auto pos = firstNodeEndingAfter(offset); pos != nodes.end() && maxSize > 0; ++pos) {
+        mem_node *p = *pos;
+        if (!p->contains(offset))
+            break; // a sparse patch
+
+        const size_t pageOffset = offset - p->nodeBuffer.offset;
+        const auto size = std::min(maxSize, p->nodeBuffer.length - pageOffset);
+        loan->borrow(*p, pageOffset, size);
+        offset += size;
+        maxSize -= size;
+    }
+
+    return loan;
+}
+
 bool
 mem_hdr::hasContigousContentRange(Range<int64_t> const & range) const
 {
     int64_t currentStart = range.start;
 
-    while (mem_node *curr = getBlockContainingLocation(currentStart)) {
-        currentStart = curr->end();
+    for (auto pos = firstNodeEndingAfter(currentStart); pos != nodes.end(); ++pos) {
+        if (!(*pos)->contains(currentStart))
+            break; // a sparse patch
+
+        currentStart = (*pos)->end();
 
         if (currentStart >= range.end)
             return true;
@@ -260,9 +324,10 @@ bool
 mem_hdr::unionNotEmpty(StoreIOBuffer const &candidate)
 {
     assert (candidate.offset >= 0);
-    mem_node target(candidate.offset);
-    target.nodeBuffer.length = candidate.length;
-    return nodes.find (&target, NodeCompare);
+    if (!candidate.length)
+        return false;
+    const auto pos = firstNodeEndingAfter(candidate.offset);
+    return pos != nodes.end() && (*pos)->start() < candidate.range().end;
 }
 
 mem_node *
@@ -271,21 +336,15 @@ mem_hdr::nodeToRecieve(int64_t offset)
     /* case 1: Nothing in memory */
 
     if (!nodes.size()) {
-        appendNode (new mem_node(offset));
-        return nodes.start()->data;
+        nodes.push_back(new mem_node(offset));
+        return nodes.front();
     }
 
     mem_node *candidate = nullptr;
     /* case 2: location fits within an extant node */
 
-    if (offset > 0) {
-        mem_node search (offset - 1);
-        search.nodeBuffer.length = 1;
-        mem_node *const *leadup =  nodes.find (&search, NodeCompare);
-
-        if (leadup)
-            candidate = *leadup;
-    }
+    if (offset > 0)
+        candidate = getBlockContainingLocation(offset - 1);
 
     if (candidate && candidate->canAccept(offset))
         return candidate;
@@ -293,7 +352,7 @@ mem_hdr::nodeToRecieve(int64_t offset)
     /* candidate can't accept, so we need a new node */
     candidate = new mem_node(offset);
 
-    appendNode (candidate);
+    insertNode(candidate);
 
     /* simpler to write than a indented if */
     return candidate;
@@ -339,27 +398,11 @@ mem_hdr::~mem_hdr()
     freeContent();
 }
 
-/* splay of mem nodes:
- * conditions:
- * a = b if a.intersection(b).size > 0;
- * a < b if a < b
- */
-int
-mem_hdr::NodeCompare(mem_node * const &left, mem_node * const &right)
-{
-    // possibly Range can help us at some point.
-
-    if (left->dataRange().intersection(right->dataRange()).size() > 0)
-        return 0;
-
-    return *left < *right ? -1 : 1;
-}
-
 void
 mem_hdr::dump() const
 {
-    debugs(20, DBG_IMPORTANT, "mem_hdr: " << (void *)this << " nodes.start() " << nodes.start());
-    debugs(20, DBG_IMPORTANT, "mem_hdr: " << (void *)this << " nodes.finish() " << nodes.finish());
+    debugs(20, DBG_IMPORTANT, "mem_hdr: " << (void *)this << " nodes.front() " << (nodes.empty() ? nullptr : nodes.front()));
+    debugs(20, DBG_IMPORTANT, "mem_hdr: " << (void *)this << " nodes.back() " << (nodes.empty() ? nullptr : nodes.back()));
 }
 
 size_t
@@ -368,9 +411,32 @@ mem_hdr::size() const
     return nodes.size();
 }
 
-const Splay<mem_node *> &
+const mem_hdr::Nodes &
 mem_hdr::getNodes() const
 {
     return nodes;
 }
 
+
+/* MemLoan */
+
+MemLoan::~MemLoan()
+{
+    for (const auto page: pages) {
+        assert(page->borrowers > 0);
+        --page->borrowers;
+        if (!page->borrowers && page->orphaned) {
+            debugs(19, 5, "destroying returned orphan " << page);
+            delete page;
+        }
+    }
+}
+
+void
+MemLoan::borrow(mem_node &page, const size_t offset, const size_t size)
+{
+    assert(offset + size <= page.nodeBuffer.length);
+    ++page.borrowers;
+    pages.push_back(&page);
+    append(page.nodeBuffer.data + offset, size);
+}
@@ -10,16 +10,48 @@
 #define SQUID_STMEM_H
 
 #include "base/Range.h"
-#include "splay.h"
+#include "comm/IoVector.h"
+#include "mem/forward.h"
+
+#include <deque>
+#include <vector>
 
 class mem_node;
 
 class StoreIOBuffer;
 
+/// mem_hdr pages lent to a writer that exports their content without
+/// copying it. Borrowed pages stay in memory, unchanged, until the loan
+/// object is destroyed, even if their mem_hdr frees or forgets them.
+class MemLoan: public Comm::IoVector
+{
+    MEMPROXY_CLASS(MemLoan);
+
+public:
+    typedef RefCount<MemLoan> Pointer;
+
+    ~MemLoan() override;
+
+    /// pins the given page and adds its [offset, offset+size) bytes
+    void borrow(mem_node &, size_t offset, size_t size);
+
+private:
+    std::vector<mem_node *> pages; ///< pinned pages
+};
+
+/// In-memory content of a store entry, stored in mem_node pages. Pages
+/// are indexed by their offsets: Dense content (the common case) is found
+/// in constant time, while sparse content (e.g., partial responses to
+/// Range requests) is found using a binary search. Lookups do not modify
+/// the index.
 class mem_hdr
 {
 
 public:
+    /// pages ordered by their offsets; pages do not overlap, but there
+    /// may be gaps between them
+    typedef std::deque<mem_node *> Nodes;
+
     mem_hdr();
     ~mem_hdr();
     void freeContent();
@@ -27,6 +59,10 @@ public:
     int64_t endOffset () const;
     int64_t freeDataUpto (int64_t);
     ssize_t copy (StoreIOBuffer const &) const;
+    /// Lends up to maxSize contiguous bytes starting at the given offset,
+    /// without copying them. The returned loan is empty if the offset is
+    /// not in memory.
+    MemLoan::Pointer lend(int64_t offset, size_t maxSize);
     bool hasContigousContentRange(Range<int64_t> const &range) const;
     /* success or fail */
     bool write (StoreIOBuffer const &);
@@ -36,21 +72,21 @@ public:
     /* access the contained nodes - easier than punning
      * as a container ourselves
      */
-    const Splay<mem_node *> &getNodes() const;
+    const Nodes &getNodes() const;
     char * NodeGet(mem_node * aNode);
 
-    static Splay<mem_node *>::SPLAYCMP NodeCompare;
-
 private:
+    static void FreeNode(mem_node *);
+    Nodes::const_iterator firstNodeEndingAfter(int64_t location) const;
     void debugDump() const;
     bool unlink(mem_node *aNode);
-    void appendNode (mem_node *aNode);
+    void insertNode(mem_node *aNode);
     size_t copyAvailable(mem_node *aNode, int64_t location, size_t amount, char *target) const;
     bool unionNotEmpty (StoreIOBuffer const &);
     mem_node *nodeToRecieve(int64_t offset);
     size_t writeAvailable(mem_node *aNode, int64_t location, size_t amount, char const *source);
     int64_t inmem_hi;
-    Splay<mem_node *> nodes;
+    Nodes nodes;
 };
 
 #endif /* SQUID_STMEM_H */
@@ -337,6 +337,8 @@ StoreEntry::StoreEntry() :
     ping_status(PING_NONE),
     store_status(STORE_PENDING),
     swap_status(SWAPOUT_NONE),
+    digestedOnDisk(false),
+    digestedInMemory(false),
     lock_count(0),
     shareableWhenPrivate(false)
 {
@@ -420,6 +422,9 @@ void
 StoreEntry::hashDelete()
 {
     if (key) { // some test cases do not create keys and do not hashInsert()
+        // the digest cannot forget entries once it cannot find their keys
+        storeDigestDelDiskEntry(*this);
+        storeDigestDelMemEntry(*this);
         hash_remove_link(store_table, this);
         storeKeyFree((const cache_key *)key);
         key = nullptr;
@@ -1535,6 +1540,7 @@ StoreEntry::setMemStatus(mem_status_t new_status)
         }
 
         ++hot_obj_count; // TODO: maintain for the shared hot cache as well
+        storeDigestAddMemEntry(*this);
     } else {
         if (EBIT_TEST(flags, ENTRY_SPECIAL)) {
             debugs(20, 4, "not removing special " << *this << " from policy");
@@ -1544,6 +1550,7 @@ StoreEntry::setMemStatus(mem_status_t new_status)
         }
 
         --hot_obj_count;
+        storeDigestDelMemEntry(*this);
     }
 
     mem_status = new_status;
@@ -1939,6 +1946,7 @@ StoreEntry::attachToDisk(const sdirno dirn, const sfileno fno, const swap_status
 void
 StoreEntry::detachFromDisk()
 {
+    storeDigestDelDiskEntry(*this);
     swap_dirn = -1;
     swap_filen = -1;
     swap_status = SWAPOUT_NONE;
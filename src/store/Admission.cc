@@ -0,0 +1,221 @@
+/*
+ * Copyright (C) 1996-2023 The Squid Software Foundation and contributors
+ *
+ * Squid software is distributed under GPLv2+ license and includes
+ * contributions from numerous individuals and organizations.
+ * Please see the COPYING and CONTRIBUTORS files for details.
+ */
+
+/* DEBUG: section 20    Storage Manager */
+
+#include "squid.h"
+#include "base/PackableStream.h"
+#include "base/RunnersRegistry.h"
+#include "HttpRequest.h"
+#include "ipc/mem/Pointer.h"
+#include "MemObject.h"
+#include "mgr/Registration.h"
+#include "SquidConfig.h"
+#include "Store.h"
+#include "store/Admission.h"
+#include "store/Disk.h"
+#include "store/FrequencySketch.h"
+#include "store_key_md5.h"
+
+#include <algorithm>
+#include <limits>
+
+namespace Store
+{
+namespace Admission
+{
+
+/// admission decisions for one cache type
+class Counters
+{
+public:
+    /// records an admission decision for an entry of the given size
+    void note(const bool admitted, const int64_t size) {
+        auto &objects = admitted ? admittedObjects : rejectedObjects;
+        auto &bytes = admitted ? admittedBytes : rejectedBytes;
+        ++objects;
+        if (size > 0)
+            bytes += size;
+    }
+
+    uint64_t admittedObjects = 0;
+    uint64_t admittedBytes = 0;
+    uint64_t rejectedObjects = 0;
+    uint64_t rejectedBytes = 0;
+};
+
+/// this worker admission decisions for the store_admission report
+static struct {
+    Counters memory; ///< shared memory cache decisions
+    Counters disk; ///< cache_dir decisions
+} Stats;
+
+/// shared memory segment label
+static const char * const ShmLabel = "store_admission";
+
+/// the request frequency estimator shared by all workers (if enabled)
+static Ipc::Mem::Pointer<FrequencySketch> Sketch;
+
+static OBJH Report;
+
+/// the sketch key for the given entry, matching NoteRequest() keys
+static const cache_key *
+KeyFor(const StoreEntry &e)
+{
+    assert(e.mem_obj);
+    return storeKeyPublic(e.mem_obj->storeId(), e.mem_obj->method);
+}
+
+/// the current size estimate used for admission statistics
+static int64_t
+SizeOf(const StoreEntry &e)
+{
+    assert(e.mem_obj);
+    return std::max(e.mem_obj->endOffset(), e.mem_obj->expectedReplySize());
+}
+
+} // namespace Admission
+} // namespace Store
+
+bool
+Store::Admission::Enabled()
+{
+    return bool(Sketch);
+}
+
+void
+Store::Admission::NoteRequest(HttpRequest &request)
+{
+    if (!Enabled())
+        return;
+
+    // Vary-specific lookups repeat the same request; the sketch tracks
+    // the base (i.e. Vary-agnostic) resource key only
+    if (!request.vary_headers.isEmpty())
+        return;
+
+    Sketch->add(storeKeyPublicByRequest(&request));
+}
+
+uint32_t
+Store::Admission::Frequency(const StoreEntry &e)
+{
+    if (!Enabled() || !e.mem_obj)
+        return 0;
+    return Sketch->frequency(KeyFor(e));
+}
+
+bool
+Store::Admission::Admits(const StoreEntry &e, const int minFrequency)
+{
+    if (!Enabled() || minFrequency <= 1)
+        return true; // every requested resource has been requested once
+
+    const auto frequency = Frequency(e);
+    debugs(20, 7, "frequency " << frequency << " vs. " << minFrequency << " for " << e);
+    return frequency >= static_cast<uint32_t>(minFrequency);
+}
+
+bool
+Store::Admission::AdmitToMemory(const StoreEntry &e)
+{
+    if (!Enabled())
+        return true;
+
+    const auto admitted = Admits(e, Config.admission.memMinFrequency);
+    Stats.memory.note(admitted, SizeOf(e));
+    return admitted;
+}
+
+bool
+Store::Admission::AdmitToDisk(const StoreEntry &e)
+{
+    if (!Enabled())
+        return true;
+
+    // a cache_dir with the lowest threshold decides
+    auto minFrequency = std::numeric_limits<int>::max();
+    for (int i = 0; i < Config.cacheSwap.n_configured; ++i)
+        minFrequency = std::min(minFrequency, INDEXSD(i)->minFrequency());
+
+    const auto admitted = Admits(e, minFrequency);
+    Stats.disk.note(admitted, SizeOf(e));
+    return admitted;
+}
+
+/// reports sketch state and this worker admission decisions
+void
+Store::Admission::Report(StoreEntry *sentry)
+{
+    PackableStream os(*sentry);
+
+    if (!Enabled()) {
+        os << "Frequency-based cache admission is disabled (cache_admission_entries 0).\n";
+        return;
+    }
+
+    os << "Frequency sketch (cache_admission_entries " << Config.admission.entries << "):\n" <<
+       "\tshared memory size:\t" << Sketch->sharedMemorySize() << " bytes\n" <<
+       "\taccesses since aging:\t" << Sketch->sampled() << " of " << Sketch->sampleSize() << "\n" <<
+       "\tagings:\t" << Sketch->agings() << "\n";
+
+    const auto reportCounters = [&os](const char *name, const Counters &counters) {
+        os << name << ":\n" <<
+           "\tadmitted objects:\t" << counters.admittedObjects << "\n" <<
+           "\tadmitted bytes:\t" << counters.admittedBytes << "\n" <<
+           "\trejected objects:\t" << counters.rejectedObjects << "\n" <<
+           "\trejected bytes:\t" << counters.rejectedBytes << "\n";
+    };
+    reportCounters("Shared memory cache admission", Stats.memory);
+    reportCounters("Disk cache admission", Stats.disk);
+}
+
+/// initializes shared memory segment used by Store::Admission
+class StoreAdmissionRr: public Ipc::Mem::RegisteredRunner
+{
+public:
+    /* RegisteredRunner API */
+    ~StoreAdmissionRr() override { delete owner; }
+    void useConfig() override;
+
+protected:
+    void create() override;
+    void open() override;
+
+private:
+    Ipc::Mem::Owner<Store::FrequencySketch> *owner = nullptr;
+};
+
+DefineRunnerRegistrator(StoreAdmissionRr);
+
+void
+StoreAdmissionRr::useConfig()
+{
+    Ipc::Mem::RegisteredRunner::useConfig();
+    Mgr::RegisterAction("store_admission", "Frequency-based Cache Admission", Store::Admission::Report, 0, 1);
+}
+
+void
+StoreAdmissionRr::create()
+{
+    if (Config.admission.entries <= 0)
+        return;
+
+    Must(!owner);
+    owner = shm_new(Store::FrequencySketch)(Store::Admission::ShmLabel, Config.admission.entries);
+}
+
+void
+StoreAdmissionRr::open()
+{
+    if (Config.admission.entries <= 0)
+        return;
+
+    Store::Admission::Sketch = shm_old(Store::FrequencySketch)(Store::Admission::ShmLabel);
+}
+
@@ -0,0 +1,52 @@
+/*
+ * Copyright (C) 1996-2023 The Squid Software Foundation and contributors
+ *
+ * Squid software is distributed under GPLv2+ license and includes
+ * contributions from numerous individuals and organizations.
+ * Please see the COPYING and CONTRIBUTORS files for details.
+ */
+
+#ifndef SQUID_STORE_ADMISSION_H
+#define SQUID_STORE_ADMISSION_H
+
+#include "http/forward.h"
+#include "store/forward.h"
+
+namespace Store
+{
+
+/// Frequency-based cache admission: Responses for resources requested less
+/// often than the configured memory_cache_min_frequency or cache_dir
+/// min-frequency thresholds are not cached. Request frequencies are estimated
+/// using a FrequencySketch shared by all SMP workers.
+/// \sa cache_admission_entries
+namespace Admission
+{
+
+/// whether cache_admission_entries enables frequency-based admission
+bool Enabled();
+
+/// remembers that a client has requested the given resource
+void NoteRequest(HttpRequest &);
+
+/// \returns the estimated number of recent requests for the entry resource
+/// or zero when frequency-based admission is disabled
+uint32_t Frequency(const StoreEntry &);
+
+/// whether the entry is popular enough for the given minimum frequency
+bool Admits(const StoreEntry &, int minFrequency);
+
+/// whether the shared memory cache should admit the entry;
+/// updates memory cache admission statistics
+bool AdmitToMemory(const StoreEntry &);
+
+/// whether at least one cache_dir could admit the entry;
+/// updates disk cache admission statistics
+bool AdmitToDisk(const StoreEntry &);
+
+} // namespace Admission
+
+} // namespace Store
+
+#endif /* SQUID_STORE_ADMISSION_H */
+
@@ -17,12 +17,17 @@
 #include "Parsing.h"
 #include "SquidConfig.h"
 #include "Store.h"
+#include "store/Admission.h"
 #include "store/Disk.h"
 #include "StoreFileSystem.h"
 #include "tools.h"
 
+/// the default cache_dir min-frequency option value
+static const int DefaultMinFrequency = 2;
+
 Store::Disk::Disk(char const *aType): theType(aType),
     max_size(0), min_objsize(-1), max_objsize (-1),
+    min_frequency(DefaultMinFrequency),
     path(nullptr), index(-1), disker(-1),
     repl(nullptr), removals(0), scanned(0),
     cleanLog(nullptr)
@@ -175,6 +180,9 @@ Store::Disk::canStore(const StoreEntry &e, int64_t diskSpaceNeeded, int &load) c
     if (flags.read_only)
         return false; // cannot write at all
 
+    if (!Store::Admission::Admits(e, min_frequency))
+        return false; // not popular enough for this cache_dir
+
     if (currentSize() > maxSize())
         return false; // already overflowing
 
@@ -260,6 +268,7 @@ Store::Disk::getOptionTree() const
     ConfigOptionVector *result = new ConfigOptionVector;
     result->options.push_back(new ConfigOptionAdapter<Disk>(*const_cast<Disk*>(this), &Store::Disk::optionReadOnlyParse, &Store::Disk::optionReadOnlyDump));
     result->options.push_back(new ConfigOptionAdapter<Disk>(*const_cast<Disk*>(this), &Store::Disk::optionObjectSizeParse, &Store::Disk::optionObjectSizeDump));
+    result->options.push_back(new ConfigOptionAdapter<Disk>(*const_cast<Disk*>(this), &Store::Disk::optionMinFrequencyParse, &Store::Disk::optionMinFrequencyDump));
     return result;
 }
 
@@ -269,6 +278,9 @@ Store::Disk::parseOptions(int isaReconfig)
     const bool old_read_only = flags.read_only;
     char *name, *value;
 
+    // unlike size limits, the admission threshold may simply be removed
+    min_frequency = DefaultMinFrequency;
+
     ConfigOption *newOption = getOptionTree();
 
     while ((name = ConfigParser::NextToken()) != nullptr) {
@@ -388,6 +400,34 @@ Store::Disk::optionObjectSizeDump(StoreEntry * e) const
         storeAppendPrintf(e, " max-size=%" PRId64, max_objsize);
 }
 
+bool
+Store::Disk::optionMinFrequencyParse(char const *option, const char *value, int)
+{
+    if (strcmp(option, "min-frequency") != 0)
+        return false;
+
+    if (!value) {
+        self_destruct();
+        return false;
+    }
+
+    min_frequency = xatoi(value);
+    if (min_frequency < 1) {
+        debugs(3, DBG_CRITICAL, "ERROR: cache_dir '" << path << "' min-frequency must be positive: " << value);
+        self_destruct();
+        return false;
+    }
+
+    return true;
+}
+
+void
+Store::Disk::optionMinFrequencyDump(StoreEntry * e) const
+{
+    if (min_frequency != DefaultMinFrequency)
+        storeAppendPrintf(e, " min-frequency=%d", min_frequency);
+}
+
 // some SwapDirs may maintain their indexes and be able to lookup an entry key
 StoreEntry *
 Store::Disk::get(const cache_key *)
@@ -67,6 +67,10 @@ public:
     /// negative objSize means the object size is currently unknown
     bool objectSizeIsAcceptable(int64_t objSize) const;
 
+    /// the minimum estimated request frequency of entries admitted here
+    /// \sa Store::Admission
+    int minFrequency() const { return min_frequency; }
+
     /// called when the entry is about to forget its association with cache_dir
     virtual void disconnect(StoreEntry &) {}
 
@@ -78,6 +82,12 @@ public:
     /// whether this cache dir has an entry with `e.key`
     virtual bool hasReadableEntry(const StoreEntry &e) const = 0;
 
+    /// Opens the file storing a swapped out entry for reading by sendfile(2).
+    /// The file must contain the entry swap_file_sz bytes in order, starting
+    /// with the swap metadata. The caller must file_close() the descriptor.
+    /// \returns an open file descriptor or -1 if that file is not available
+    virtual int openForSending(const StoreEntry &) const { return -1; }
+
 protected:
     void parseOptions(int reconfiguring);
     void dumpOptions(StoreEntry * e) const;
@@ -91,12 +101,15 @@ private:
     void optionReadOnlyDump(StoreEntry * e) const;
     bool optionObjectSizeParse(char const *option, const char *value, int reconfiguring);
     void optionObjectSizeDump(StoreEntry * e) const;
+    bool optionMinFrequencyParse(char const *option, const char *value, int reconfiguring);
+    void optionMinFrequencyDump(StoreEntry * e) const;
     char const *theType;
 
 protected:
     uint64_t max_size;        ///< maximum allocatable size of the storage area
     int64_t min_objsize;      ///< minimum size of any object stored here (-1 for no limit)
     int64_t max_objsize;      ///< maximum size of any object stored here (-1 for no limit)
+    int min_frequency;        ///< min-frequency option value
 
 public:
     char *path;
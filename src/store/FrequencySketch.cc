@@ -0,0 +1,218 @@
+/*
+ * Copyright (C) 1996-2023 The Squid Software Foundation and contributors
+ *
+ * Squid software is distributed under GPLv2+ license and includes
+ * contributions from numerous individuals and organizations.
+ * Please see the COPYING and CONTRIBUTORS files for details.
+ */
+
+/* DEBUG: section 20    Storage Manager */
+
+#include "squid.h"
+#include "debug/Stream.h"
+#include "store/FrequencySketch.h"
+
+#include <algorithm>
+#include <cstring>
+
+/// count-min sketch rows (i.e. independent hash functions)
+static const int SketchDepth = 4;
+
+/// doorkeeper Bloom filter hash functions
+static const int DoorkeeperHashes = 3;
+
+/// 4-bit counters per sketch word
+static const int CountersPerWord = 16;
+
+/// the maximum value of a single sketch counter
+static const uint32_t CounterMax = 15;
+
+/// doorkeeper bits allocated per expected entry (~2% false positives)
+static const int DoorkeeperBitsPerEntry = 8;
+
+/// recorded accesses (per expected entry) between two agings
+static const int SampleFactor = 10;
+
+/// \returns the smallest power of two that is not smaller than n
+static uint64_t
+PowerOfTwoCeiling(const uint64_t n)
+{
+    uint64_t result = 1;
+    while (result < n)
+        result <<= 1;
+    return result;
+}
+
+Store::FrequencySketch::FrequencySketch(const int64_t anEntries):
+    entries(anEntries),
+    countersPerRow(CountersPerRow(anEntries)),
+    counterWords(countersPerRow * SketchDepth / CountersPerWord),
+    doorkeeperBits(DoorkeeperBits(anEntries)),
+    sampleSize_(std::max<int64_t>(anEntries, 1) * SampleFactor),
+    additions(0),
+    agings_(0),
+    words(WordsFor(anEntries))
+{
+    const auto wordCount = WordsFor(entries);
+    for (uint64_t i = 0; i < wordCount; ++i)
+        word(i).store(0);
+}
+
+uint64_t
+Store::FrequencySketch::CountersPerRow(const int64_t entries)
+{
+    // at least one full word per row, for simpler index math
+    return std::max<uint64_t>(PowerOfTwoCeiling(std::max<int64_t>(entries, 1)), CountersPerWord);
+}
+
+uint64_t
+Store::FrequencySketch::DoorkeeperBits(const int64_t entries)
+{
+    return std::max<uint64_t>(PowerOfTwoCeiling(std::max<int64_t>(entries, 1) * DoorkeeperBitsPerEntry), 64);
+}
+
+uint64_t
+Store::FrequencySketch::WordsFor(const int64_t entries)
+{
+    return CountersPerRow(entries) * SketchDepth / CountersPerWord + DoorkeeperBits(entries) / 64;
+}
+
+size_t
+Store::FrequencySketch::sharedMemorySize() const
+{
+    return SharedMemorySize(entries);
+}
+
+size_t
+Store::FrequencySketch::SharedMemorySize(const int64_t entries)
+{
+    return sizeof(FrequencySketch) + WordsFor(entries) * sizeof(Word);
+}
+
+/// a well-mixed 64-bit hash for the given key, different for each seed
+uint64_t
+Store::FrequencySketch::hashFor(const cache_key *key, const int seed) const
+{
+    // cache keys are MD5 digests; use them for cheap double hashing
+    uint64_t a = 0;
+    uint64_t b = 0;
+    memcpy(&a, key, sizeof(a));
+    memcpy(&b, key + sizeof(a), sizeof(b));
+
+    // the splitmix64 finalizer
+    auto h = a + static_cast<uint64_t>(seed) * (b | 1);
+    h = (h ^ (h >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    h = (h ^ (h >> 27)) * 0x94d049bb133111ebULL;
+    return h ^ (h >> 31);
+}
+
+/// the position of the given key counter in the given sketch row
+uint64_t
+Store::FrequencySketch::counterIndex(const cache_key *key, const int row) const
+{
+    return row * countersPerRow + (hashFor(key, row) & (countersPerRow - 1));
+}
+
+uint32_t
+Store::FrequencySketch::counterAt(const uint64_t index) const
+{
+    const auto shift = (index % CountersPerWord) * 4;
+    return (word(index / CountersPerWord).load(std::memory_order_relaxed) >> shift) & CounterMax;
+}
+
+/// increments the given sketch counter unless it is already saturated
+void
+Store::FrequencySketch::incrementCounter(const uint64_t index)
+{
+    const auto shift = (index % CountersPerWord) * 4;
+    auto &w = word(index / CountersPerWord);
+    auto current = w.load(std::memory_order_relaxed);
+    while (((current >> shift) & CounterMax) < CounterMax) {
+        if (w.compare_exchange_weak(current, current + (uint64_t(1) << shift), std::memory_order_relaxed))
+            return;
+    }
+}
+
+/// whether the doorkeeper has seen the given key since the last aging
+bool
+Store::FrequencySketch::admittedByDoorkeeper(const cache_key *key) const
+{
+    for (int i = 0; i < DoorkeeperHashes; ++i) {
+        const auto bit = hashFor(key, SketchDepth + i) & (doorkeeperBits - 1);
+        const auto mask = uint64_t(1) << (bit % 64);
+        if (!(word(counterWords + bit / 64).load(std::memory_order_relaxed) & mask))
+            return false;
+    }
+    return true;
+}
+
+/// remembers the given key in the doorkeeper
+/// \returns whether the key has been remembered before
+bool
+Store::FrequencySketch::admitByDoorkeeper(const cache_key *key)
+{
+    bool seen = true;
+    for (int i = 0; i < DoorkeeperHashes; ++i) {
+        const auto bit = hashFor(key, SketchDepth + i) & (doorkeeperBits - 1);
+        const auto mask = uint64_t(1) << (bit % 64);
+        if (!(word(counterWords + bit / 64).fetch_or(mask, std::memory_order_relaxed) & mask))
+            seen = false;
+    }
+    return seen;
+}
+
+void
+Store::FrequencySketch::add(const cache_key *key)
+{
+    if (admitByDoorkeeper(key)) {
+        // conservative update: only increment the smallest counters
+        uint64_t indexes[SketchDepth];
+        uint32_t minimum = CounterMax;
+        for (int row = 0; row < SketchDepth; ++row) {
+            indexes[row] = counterIndex(key, row);
+            minimum = std::min(minimum, counterAt(indexes[row]));
+        }
+        for (int row = 0; row < SketchDepth; ++row) {
+            if (counterAt(indexes[row]) == minimum)
+                incrementCounter(indexes[row]);
+        }
+    }
+
+    // only the worker reaching the sample size ages the sketch
+    if (++additions == sampleSize_)
+        age();
+}
+
+uint32_t
+Store::FrequencySketch::frequency(const cache_key *key) const
+{
+    uint32_t minimum = CounterMax;
+    for (int row = 0; row < SketchDepth; ++row)
+        minimum = std::min(minimum, counterAt(counterIndex(key, row)));
+    // the doorkeeper remembers the first access since the last aging, while
+    // aged counters still remember the earlier popularity of the key
+    return minimum + (admittedByDoorkeeper(key) ? 1 : 0);
+}
+
+/// halves all counters and clears the doorkeeper
+void
+Store::FrequencySketch::age()
+{
+    debugs(20, 3, "after " << sampleSize_ << " accesses; previous agings: " << agings_.load());
+
+    for (uint64_t i = 0; i < counterWords; ++i) {
+        auto &w = word(i);
+        auto current = w.load(std::memory_order_relaxed);
+        while (!w.compare_exchange_weak(current, (current >> 1) & 0x7777777777777777ULL, std::memory_order_relaxed)) {
+            // retry with the updated current value
+        }
+    }
+
+    const auto wordCount = WordsFor(entries);
+    for (auto i = counterWords; i < wordCount; ++i)
+        word(i).store(0, std::memory_order_relaxed);
+
+    additions -= sampleSize_;
+    ++agings_;
+}
+
@@ -0,0 +1,89 @@
+/*
+ * Copyright (C) 1996-2023 The Squid Software Foundation and contributors
+ *
+ * Squid software is distributed under GPLv2+ license and includes
+ * contributions from numerous individuals and organizations.
+ * Please see the COPYING and CONTRIBUTORS files for details.
+ */
+
+#ifndef SQUID_STORE_FREQUENCYSKETCH_H
+#define SQUID_STORE_FREQUENCYSKETCH_H
+
+#include "ipc/mem/FlexibleArray.h"
+#include "store/forward.h"
+
+#include <atomic>
+#include <cstdint>
+
+namespace Store
+{
+
+/// An approximate, shared-memory popularity estimator for cache keys. A
+/// TinyLFU-style count-min sketch of small saturating counters is fronted by a
+/// "doorkeeper" Bloom filter that absorbs the first access to every key, so
+/// that one-time requests do not pollute the counters. After every "sample"
+/// worth of recorded accesses, all counters are halved and the doorkeeper is
+/// cleared, so that old popularity fades away.
+///
+/// All methods may be called concurrently by several SMP workers. Concurrent
+/// updates may be lost (or aging may slightly overlap), which is acceptable
+/// for an estimator but keeps the sketch lock-free.
+class FrequencySketch
+{
+public:
+    typedef std::atomic<uint64_t> Word;
+
+    /// \param entries the approximate number of keys worth remembering
+    explicit FrequencySketch(int64_t entries);
+
+    /// records an access to the given key
+    void add(const cache_key *);
+
+    /// \returns estimated number of (recent) accesses to the given key
+    uint32_t frequency(const cache_key *) const;
+
+    /// the number of recorded accesses since the last aging
+    uint64_t sampled() const { return additions.load(); }
+    /// the number of recorded accesses that trigger aging
+    uint64_t sampleSize() const { return sampleSize_; }
+    /// the number of times the sketch has been aged
+    uint64_t agings() const { return agings_.load(); }
+
+    size_t sharedMemorySize() const;
+    static size_t SharedMemorySize(int64_t entries);
+
+private:
+    static uint64_t CountersPerRow(int64_t entries);
+    static uint64_t DoorkeeperBits(int64_t entries);
+    static uint64_t WordsFor(int64_t entries);
+
+    uint64_t hashFor(const cache_key *, int seed) const;
+    uint64_t counterIndex(const cache_key *, int row) const;
+    uint32_t counterAt(uint64_t index) const;
+    void incrementCounter(uint64_t index);
+
+    bool admittedByDoorkeeper(const cache_key *) const;
+    bool admitByDoorkeeper(const cache_key *);
+
+    void age();
+
+    Word &word(const uint64_t idx) { return words[idx]; }
+    const Word &word(const uint64_t idx) const { return const_cast<FrequencySketch*>(this)->words[idx]; }
+
+    const int64_t entries; ///< the configured number of entries (for sizing)
+    const uint64_t countersPerRow; ///< a power of two
+    const uint64_t counterWords; ///< words[] devoted to the count-min sketch
+    const uint64_t doorkeeperBits; ///< a power of two
+    const uint64_t sampleSize_; ///< additions between agings
+
+    std::atomic<uint64_t> additions; ///< recorded accesses since the last aging
+    std::atomic<uint64_t> agings_; ///< the number of age() calls
+
+    /// count-min sketch counters (4 bits each) followed by doorkeeper bits
+    Ipc::Mem::FlexibleArray<Word> words;
+};
+
+} // namespace Store
+
+#endif /* SQUID_STORE_FREQUENCYSKETCH_H */
+
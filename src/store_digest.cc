@@ -22,15 +22,22 @@
 #include "store_digest.h"
 
 #if USE_CACHE_DIGESTS
+#include "base/RunnersRegistry.h"
+#include "base/TextException.h"
 #include "CacheDigest.h"
 #include "HttpReply.h"
 #include "HttpRequest.h"
 #include "internal.h"
+#include "ipc/mem/Pointer.h"
+#include "ipc/StoreMap.h"
 #include "MemObject.h"
 #include "PeerDigest.h"
 #include "refresh.h"
+#include "sbuf/Stream.h"
 #include "SquidConfig.h"
 #include "Store.h"
+#include "store/Disk.h"
+#include "StoreDigestShards.h"
 #include "StoreSearch.h"
 #include "util.h"
 
@@ -64,10 +71,30 @@ public:
     int rej_coll_count = 0;     /* #not accepted entries that collided with existing ones */
 };
 
+/// maintains the digest shard of a shared memory cache index
+class StoreDigestMapShard: public Ipc::StoreMapDigester
+{
+public:
+    explicit StoreDigestMapShard(const uint32_t aShard): shard(aShard) {}
+
+    /* Ipc::StoreMapDigester API */
+    bool noteReadableEntry(const Ipc::StoreMapAnchor &) override;
+    void noteFreedEntry(const Ipc::StoreMapAnchor &) override;
+
+private:
+    const uint32_t shard; ///< StoreDigestShards shard number
+};
+
 /* local vars */
 static StoreDigestState sd_state;
 static StoreDigestStats sd_stats;
 
+/// digest shards maintained incrementally (if digest_incremental is on)
+static StoreDigestShards *TheShards = nullptr;
+
+/// the shared memory segment name for digest shards
+static const char *const ShardsShmLabel = "store_digest_shards";
+
 /* local prototypes */
 static void storeDigestRebuildStart(void *datanotused);
 static void storeDigestRebuildResume(void);
@@ -80,6 +107,27 @@ static EVH storeDigestSwapOutStep;
 static void storeDigestCBlockSwapOut(StoreEntry * e);
 static void storeDigestAdd(const StoreEntry *);
 
+/// limits digest capacity to what CacheDigest can handle
+static uint64_t
+storeDigestLimitCap(uint64_t cap)
+{
+    // Bug 4534: we still have to set an upper-limit at some reasonable value though.
+    // this matches cacheDigestCalcMaskSize doing (cap*bpe)+7 < INT_MAX
+    const uint64_t absolute_max = (INT_MAX -8) / Config.digest.bits_per_entry;
+    if (cap > absolute_max) {
+        static time_t last_loud = 0;
+        if (last_loud < squid_curtime - 86400) {
+            debugs(71, DBG_IMPORTANT, "WARNING: Cache Digest cannot store " << cap << " entries. Limiting to " << absolute_max);
+            last_loud = squid_curtime;
+        } else {
+            debugs(71, 3, "WARNING: Cache Digest cannot store " << cap << " entries. Limiting to " << absolute_max);
+        }
+        cap = absolute_max;
+    }
+
+    return cap;
+}
+
 /// calculates digest capacity
 static uint64_t
 storeDigestCalcCap()
@@ -104,22 +152,138 @@ storeDigestCalcCap()
      *  cap = hi_cap;
      */
 
-    // Bug 4534: we still have to set an upper-limit at some reasonable value though.
-    // this matches cacheDigestCalcMaskSize doing (cap*bpe)+7 < INT_MAX
-    const uint64_t absolute_max = (INT_MAX -8) / Config.digest.bits_per_entry;
-    if (cap > absolute_max) {
-        static time_t last_loud = 0;
-        if (last_loud < squid_curtime - 86400) {
-            debugs(71, DBG_IMPORTANT, "WARNING: Cache Digest cannot store " << cap << " entries. Limiting to " << absolute_max);
-            last_loud = squid_curtime;
-        } else {
-            debugs(71, 3, "WARNING: Cache Digest cannot store " << cap << " entries. Limiting to " << absolute_max);
-        }
-        cap = absolute_max;
+    return storeDigestLimitCap(cap);
+}
+
+/// the number of incrementally maintained digest shards: one per cache_dir
+/// and one for the memory cache
+static uint32_t
+storeDigestShardCount()
+{
+    return Config.cacheSwap.n_configured + 1;
+}
+
+/// the digest shard of the (shared or local) memory cache
+static uint32_t
+storeDigestMemShard()
+{
+    return Config.cacheSwap.n_configured;
+}
+
+/// Calculates digest capacity for incrementally maintained shards. Unlike
+/// storeDigestCalcCap(), this capacity cannot depend on the current number
+/// of cached entries because shards are never resized.
+static uint64_t
+storeDigestCalcShardsCap()
+{
+    uint64_t maxSize = Config.memMaxSize;
+    for (int i = 0; i < Config.cacheSwap.n_configured; ++i)
+        maxSize += INDEXSD(i)->maxSize();
+    auto cap = storeDigestLimitCap(1 + maxSize / Config.Store.avgObjectSize);
+
+    // shards are stored in one FlexibleArray with int indexes
+    const auto maxWords = static_cast<uint64_t>(INT_MAX) / storeDigestShardCount();
+    if (CacheDigest::CalcMaskSize(cap, Config.digest.bits_per_entry) > maxWords) {
+        cap = maxWords * 8 / Config.digest.bits_per_entry - 1;
+        debugs(71, DBG_IMPORTANT, "WARNING: Cache Digest shards cannot store that many entries. Limiting to " << cap);
     }
 
+    debugs(71, 2, "shards: " << storeDigestShardCount() << " for " << maxSize << " bytes; capacity: " << cap);
     return cap;
 }
+
+/// whether an entry belongs to the incrementally maintained digest; unlike
+/// storeDigestAddable(), ignores entry freshness because shards cannot
+/// re-evaluate it as time passes
+static bool
+storeDigestShardable(const uint16_t flags, const uint64_t swapFileSz)
+{
+    return !EBIT_TEST(flags, KEY_PRIVATE) &&
+           !EBIT_TEST(flags, ENTRY_NEGCACHED) &&
+           !EBIT_TEST(flags, RELEASE_REQUEST) &&
+           !EBIT_TEST(flags, ENTRY_BAD_LENGTH) &&
+           swapFileSz <= static_cast<uint64_t>(Config.Store.maxObjectSize);
+}
+
+/// \returns the digester for the shared memory index of the given shard
+static Ipc::StoreMapDigester *
+storeDigestMapDigester(const uint32_t shard)
+{
+    if (!TheShards || shard >= TheShards->shardCount())
+        return nullptr;
+
+    static StoreDigestMapShard *digesters[StoreDigestShards::MaxShards] = {};
+    if (!digesters[shard])
+        digesters[shard] = new StoreDigestMapShard(shard);
+    return digesters[shard];
+}
+
+bool
+StoreDigestMapShard::noteReadableEntry(const Ipc::StoreMapAnchor &anchor)
+{
+    if (!TheShards || !storeDigestShardable(anchor.basics.flags, anchor.basics.swap_file_sz))
+        return false;
+
+    TheShards->add(shard, reinterpret_cast<const cache_key *>(anchor.key));
+    return true;
+}
+
+void
+StoreDigestMapShard::noteFreedEntry(const Ipc::StoreMapAnchor &anchor)
+{
+    if (TheShards)
+        TheShards->remove(shard, reinterpret_cast<const cache_key *>(anchor.key));
+}
+
+/// whether the store digest should be maintained incrementally
+static bool
+storeDigestShardsNeeded()
+{
+    return Config.onoff.digest_generation && Config.digest.incremental;
+}
+
+/// creates and opens the shared memory segment with digest shards
+class StoreDigestShardsRr: public Ipc::Mem::RegisteredRunner
+{
+public:
+    /* RegisteredRunner API */
+    ~StoreDigestShardsRr() override { delete owner; }
+
+protected:
+    void create() override;
+    void open() override;
+
+private:
+    Ipc::Mem::Owner<StoreDigestShards> *owner = nullptr;
+    Ipc::Mem::Pointer<StoreDigestShards> shards; ///< keeps the segment attached
+};
+
+DefineRunnerRegistrator(StoreDigestShardsRr);
+
+void
+StoreDigestShardsRr::create()
+{
+    if (!storeDigestShardsNeeded())
+        return;
+
+    if (storeDigestShardCount() > StoreDigestShards::MaxShards)
+        throw TextException(ToSBuf("digest_incremental supports up to ", StoreDigestShards::MaxShards - 1, " cache_dirs"), Here());
+
+    Must(!owner);
+    owner = shm_new(StoreDigestShards)(ShardsShmLabel, storeDigestShardCount(),
+                                       storeDigestCalcShardsCap(),
+                                       static_cast<uint8_t>(Config.digest.bits_per_entry));
+}
+
+void
+StoreDigestShardsRr::open()
+{
+    if (!storeDigestShardsNeeded())
+        return;
+
+    shards = shm_old(StoreDigestShards)(ShardsShmLabel);
+    TheShards = shards.getRaw();
+}
 #endif /* USE_CACHE_DIGESTS */
 
 void
@@ -134,6 +298,16 @@ storeDigestInit(void)
         return;
     }
 
+    if (TheShards) {
+        // the exported digest buffer; filled from shards when rewriting
+        store_digest = new CacheDigest(TheShards->capacity(), TheShards->bitsPerEntry());
+        debugs(71, DBG_IMPORTANT, "Local cache digest enabled; maintained incrementally in " <<
+               TheShards->shardCount() << " shards; rewrite every " <<
+               (int) Config.digest.rewrite_period << " sec");
+        sd_state = StoreDigestState();
+        return;
+    }
+
     const uint64_t cap = storeDigestCalcCap();
     store_digest = new CacheDigest(cap, Config.digest.bits_per_entry);
     debugs(71, DBG_IMPORTANT, "Local cache digest enabled; rebuild/rewrite every " <<
@@ -154,7 +328,8 @@ storeDigestNoteStoreReady(void)
 #if USE_CACHE_DIGESTS
 
     if (Config.onoff.digest_generation) {
-        storeDigestRebuildStart(nullptr);
+        if (!TheShards) // incrementally maintained shards need no rebuilds
+            storeDigestRebuildStart(nullptr);
         storeDigestRewriteStart(nullptr);
     }
 
@@ -189,6 +364,97 @@ storeDigestDel(const StoreEntry * entry)
 #endif //USE_CACHE_DIGESTS
 }
 
+void
+storeDigestAddDiskEntry(StoreEntry &e)
+{
+#if USE_CACHE_DIGESTS
+    if (!TheShards || e.digestedOnDisk || !e.key || !e.swappedOut())
+        return;
+
+    // shared cache_dirs digest their own index; see storeDigestDirDigester()
+    if (e.disk().smpAware())
+        return;
+
+    if (!storeDigestShardable(e.flags, e.swap_file_sz) || static_cast<uint32_t>(e.swap_dirn) >= TheShards->shardCount())
+        return;
+
+    TheShards->add(e.swap_dirn, static_cast<const cache_key *>(e.key));
+    e.digestedOnDisk = true;
+#else
+    (void)e;
+#endif
+}
+
+void
+storeDigestDelDiskEntry(StoreEntry &e)
+{
+#if USE_CACHE_DIGESTS
+    if (!e.digestedOnDisk)
+        return;
+
+    e.digestedOnDisk = false;
+    assert(e.key);
+    if (TheShards)
+        TheShards->remove(e.swap_dirn, static_cast<const cache_key *>(e.key));
+#else
+    (void)e;
+#endif
+}
+
+void
+storeDigestAddMemEntry(StoreEntry &e)
+{
+#if USE_CACHE_DIGESTS
+    if (!TheShards || e.digestedInMemory || !e.key)
+        return;
+
+    if (!storeDigestShardable(e.flags, e.swap_file_sz) || storeDigestMemShard() >= TheShards->shardCount())
+        return;
+
+    TheShards->add(storeDigestMemShard(), static_cast<const cache_key *>(e.key));
+    e.digestedInMemory = true;
+#else
+    (void)e;
+#endif
+}
+
+void
+storeDigestDelMemEntry(StoreEntry &e)
+{
+#if USE_CACHE_DIGESTS
+    if (!e.digestedInMemory)
+        return;
+
+    e.digestedInMemory = false;
+    assert(e.key);
+    if (TheShards)
+        TheShards->remove(storeDigestMemShard(), static_cast<const cache_key *>(e.key));
+#else
+    (void)e;
+#endif
+}
+
+Ipc::StoreMapDigester *
+storeDigestDirDigester(const int dirn)
+{
+#if USE_CACHE_DIGESTS
+    return storeDigestMapDigester(dirn);
+#else
+    (void)dirn;
+    return nullptr;
+#endif
+}
+
+Ipc::StoreMapDigester *
+storeDigestMemDigester()
+{
+#if USE_CACHE_DIGESTS
+    return storeDigestMapDigester(storeDigestMemShard());
+#else
+    return nullptr;
+#endif
+}
+
 void
 storeDigestReport(StoreEntry * e)
 {
@@ -212,6 +478,24 @@ storeDigestReport(StoreEntry * e)
     } else {
         storeAppendPrintf(e, "store digest: disabled.\n");
     }
+
+    if (TheShards) {
+        storeAppendPrintf(e, "\nincremental shards: %u, capacity: %" PRIu64 ", shared memory: %zu bytes\n",
+                          TheShards->shardCount(), TheShards->capacity(), TheShards->sharedMemorySize());
+        storeAppendPrintf(e, "\t%-10s %12s %12s %12s %10s %10s\n",
+                          "shard", "entries", "added", "removed", "saturated", "underflows");
+        for (uint32_t shard = 0; shard < TheShards->shardCount(); ++shard) {
+            const auto &stats = TheShards->stats(shard);
+            auto label = shard == storeDigestMemShard() ? SBuf("memory") : ToSBuf("dir ", shard);
+            storeAppendPrintf(e, "\t%-10s %12" PRId64 " %12" PRIu64 " %12" PRIu64 " %10" PRIu64 " %10" PRIu64 "\n",
+                              label.c_str(),
+                              stats.entries.load(),
+                              stats.additions.load(),
+                              stats.removals.load(),
+                              stats.saturations.load(),
+                              stats.underflows.load());
+        }
+    }
 #else
     (void)e;
 #endif //USE_CACHE_DIGESTS
@@ -457,6 +741,13 @@ storeDigestRewriteResume(void)
     }
     assert(e->locked());
     sd_state.publicEntry = e;
+    if (TheShards) {
+        // the mask itself is exported chunk by chunk in storeDigestSwapOutStep()
+        store_digest->count = TheShards->entries();
+        store_digest->del_count = 0;
+        for (uint32_t shard = 0; shard < TheShards->shardCount(); ++shard)
+            store_digest->del_count += TheShards->stats(shard).removals.load();
+    }
     /* fake reply */
     HttpReply *rep = new HttpReply;
     rep->setHeaders(Http::scOkay, "Cache Digest OK",
@@ -505,6 +796,9 @@ storeDigestSwapOutStep(void *data)
     if (static_cast<uint32_t>(sd_state.rewrite_offset + chunk_size) > store_digest->mask_size)
         chunk_size = store_digest->mask_size - sd_state.rewrite_offset;
 
+    if (TheShards)
+        TheShards->exportMask(store_digest->mask, sd_state.rewrite_offset, chunk_size);
+
     e->append(store_digest->mask + sd_state.rewrite_offset, chunk_size);
 
     debugs(71, 3, "storeDigestSwapOutStep: size: " << store_digest->mask_size <<
@@ -12,11 +12,31 @@
 #define SQUID_STORE_DIGEST_H_
 
 class StoreEntry;
+namespace Ipc
+{
+class StoreMapDigester;
+}
 
 void storeDigestInit(void);
 void storeDigestNoteStoreReady(void);
 void storeDigestDel(const StoreEntry * entry);
 void storeDigestReport(StoreEntry *);
 
+/* incremental digest maintenance (digest_incremental); no-ops if disabled */
+
+/// counts a swapped out entry in the shard of its non-shared cache_dir
+void storeDigestAddDiskEntry(StoreEntry &);
+/// forgets an entry counted by storeDigestAddDiskEntry() (if any)
+void storeDigestDelDiskEntry(StoreEntry &);
+/// counts an entry in the shard of the non-shared memory cache
+void storeDigestAddMemEntry(StoreEntry &);
+/// forgets an entry counted by storeDigestAddMemEntry() (if any)
+void storeDigestDelMemEntry(StoreEntry &);
+
+/// \returns the digester for the shared index of the given cache_dir or nil
+Ipc::StoreMapDigester *storeDigestDirDigester(int dirn);
+/// \returns the digester for the shared memory cache index or nil
+Ipc::StoreMapDigester *storeDigestMemDigester();
+
 #endif /* SQUID_STORE_DIGEST_H_ */
 
@@ -20,8 +20,10 @@
 #include "MemObject.h"
 #include "SquidConfig.h"
 #include "StatCounters.h"
+#include "store/Admission.h"
 #include "store/Disk.h"
 #include "store/Disks.h"
+#include "store_digest.h"
 #include "store_log.h"
 #include "swap_log_op.h"
 
@@ -305,6 +307,7 @@ storeSwapOutFileClosed(void *data, int errflag, StoreIOState::Pointer self)
         e->swap_file_sz = e->objectLen() + mem->swap_hdr_sz;
         e->swap_status = SWAPOUT_DONE;
         e->disk().finalizeSwapoutSuccess(*e);
+        storeDigestAddDiskEntry(*e);
 
         // XXX: For some Stores, it is pointless to re-check cachability here
         // and it leads to double counts in store_check_cachable_hist. We need
@@ -441,6 +444,12 @@ StoreEntry::mayStartSwapOut()
         }
     }
 
+    if (!Store::Admission::AdmitToDisk(*this)) {
+        debugs(20, 3, "not popular enough");
+        swapOutDecision(MemObject::SwapOut::swImpossible);
+        return false;
+    }
+
     swapOutDecision(MemObject::SwapOut::swPossible);
     return true;
 }
@@ -46,6 +46,8 @@ Comm::ConnOpener::ConnOpener(const Comm::ConnectionPointer &, const AsyncCall::P
 
 #include "comm/IoCallback.h"
     void Comm::IoCallback::setCallback(iocb_type, AsyncCall::Pointer &, char *, FREE *, int) STUB
+    void Comm::IoCallback::setCallback(iocb_type, AsyncCall::Pointer &, const IoVectorPointer &) STUB
+    void Comm::IoCallback::setCallback(iocb_type, AsyncCall::Pointer &, const SendableFilePointer &, off_t, int) STUB
     void Comm::IoCallback::selectOrQueueWrite() STUB
     void Comm::IoCallback::cancel(const char *) STUB
     void Comm::IoCallback::finish(Comm::Flag, int) STUB
@@ -82,6 +84,11 @@ void Comm::ApplyTcpKeepAlive(int, const TcpKeepAlive &) STUB
 #include "comm/Write.h"
 void Comm::Write(const Comm::ConnectionPointer &, const char *, int, AsyncCall::Pointer &, FREE *) STUB
 void Comm::Write(const Comm::ConnectionPointer &, MemBuf *, AsyncCall::Pointer &) STUB
+void Comm::Write(const Comm::ConnectionPointer &, const IoVectorPointer &, AsyncCall::Pointer &) STUB
+void Comm::Write(const Comm::ConnectionPointer &, const SendableFilePointer &, off_t, int, AsyncCall::Pointer &) STUB
+
+#include "comm/SendableFile.h"
+bool Comm::SendableFile::Supported() STUB_RETVAL(false)
 void Comm::WriteCancel(const Comm::ConnectionPointer &, const char *) STUB
 /*PF*/ void Comm::HandleWrite(int, void*) STUB
 
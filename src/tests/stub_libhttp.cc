@@ -97,6 +97,7 @@ void StatusLine::packInto(Packable *) const STUB
 bool StatusLine::parse(const String &, const char *, const char *) STUB_RETVAL(false)
 }
 
+#include "comm/SendableFile.h"
 #include "http/Stream.h"
 namespace Http
 {
@@ -106,6 +107,8 @@ void Stream::registerWithConn() STUB
 bool Stream::startOfOutput() const STUB
 void Stream::writeComplete(size_t) STUB
 void Stream::pullData() STUB
+bool Stream::sendBodyFromMemory() STUB_RETVAL(false)
+bool Stream::sendBodyFromDisk() STUB_RETVAL(false)
 bool Stream::multipartRangeRequest() const STUB_RETVAL(false)
 int64_t Stream::getNextRangeOffset() const STUB_RETVAL(-1)
 bool Stream::canPackMoreRanges() const STUB_RETVAL(false)
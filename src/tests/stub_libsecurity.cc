@@ -147,8 +147,8 @@ void Security::ServerOptions::updateContextSessionId(Security::ContextPointer &)
 
 #include "security/Session.h"
 namespace Security {
-bool CreateClientSession(const Security::ContextPointer &, const Comm::ConnectionPointer &, const char *) STUB_RETVAL(false)
-bool CreateServerSession(const Security::ContextPointer &, const Comm::ConnectionPointer &, Security::PeerOptions &, const char *) STUB_RETVAL(false)
+bool CreateClientSession(const Security::ContextPointer &, const Comm::ConnectionPointer &, const char *, bool) STUB_RETVAL(false)
+bool CreateServerSession(const Security::ContextPointer &, const Comm::ConnectionPointer &, Security::PeerOptions &, const char *, bool) STUB_RETVAL(false)
 void SessionSendGoodbye(const Security::SessionPointer &) STUB
 bool SessionIsResumed(const Security::SessionPointer &) STUB_RETVAL(false)
 void MaybeGetSessionResumeData(const Security::SessionPointer &, Security::SessionStatePointer &) STUB
@@ -159,3 +159,8 @@ Security::SessionPointer NewSessionObject(const Security::ContextPointer &) STUB
 #endif
 } // namespace Security
 
+#if USE_OPENSSL
+#include "security/TicketKeys.h"
+void Security::TicketKeys::Install(Security::ContextPointer &) STUB
+#endif
+
@@ -42,6 +42,21 @@ Ssl::LocalContextStorage *Ssl::GlobalContextStorage::getLocalStorage(Ip::Address
 void Ssl::GlobalContextStorage::reconfigureStart() STUB
 //Ssl::GlobalContextStorage Ssl::TheGlobalContextStorage;
 
+#include "ssl/CertGenerator.h"
+bool Ssl::CertGenerator::Enabled() STUB_RETVAL(false)
+void Ssl::CertGenerator::Submit(const CertificateProperties &, Callback *, void *) STUB
+
+#include "ssl/OriginSessions.h"
+bool Ssl::OriginSessions::Enabled() STUB_RETVAL(false)
+void Ssl::OriginSessions::Resume(Security::ContextPointer &, const Security::SessionPointer &, const SBuf &, unsigned short) STUB
+
+#include "ssl/SharedCertificates.h"
+bool Ssl::SharedCertificates::Enabled() STUB_RETVAL(false)
+Security::ContextPointer Ssl::SharedCertificates::Find(const SBuf &, Security::ServerOptions &, bool) STUB_RETVAL(Security::ContextPointer())
+void Ssl::SharedCertificates::Remember(const SBuf &, const Security::ContextPointer &) STUB
+void Ssl::SharedCertificates::Forget(const SBuf &) STUB
+void Ssl::SharedCertificates::Report(std::ostream &) STUB
+
 #include "ssl/ErrorDetail.h"
 #include "ssl/support.h"
 namespace Ssl
@@ -61,6 +61,20 @@ void Init(Controller *) STUB
 void FreeMemory() STUB
 }
 
+#include "store/Admission.h"
+namespace Store
+{
+namespace Admission
+{
+bool Enabled() STUB_RETVAL(false)
+void NoteRequest(HttpRequest &) STUB
+uint32_t Frequency(const StoreEntry &) STUB_RETVAL(0)
+bool Admits(const StoreEntry &, int) STUB_RETVAL(true)
+bool AdmitToMemory(const StoreEntry &) STUB_RETVAL(true)
+bool AdmitToDisk(const StoreEntry &) STUB_RETVAL(true)
+}
+}
+
 #include "store/Disk.h"
 namespace Store
 {
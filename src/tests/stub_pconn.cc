@@ -16,6 +16,9 @@
 #define STUB_API "pconn.cc"
 #include "tests/STUB.h"
 
+PconnKey::PconnKey(const Comm::ConnectionPointer &, const char *) STUB
+size_t PconnKeyHash::operator()(const PconnKey &) const STUB_RETVAL(0)
+IdleConnList::IdleConnList(const PconnKey &aKey, PconnPool *): key(aKey) STUB
 IdleConnList::IdleConnList(const char *, PconnPool *) STUB
 IdleConnList::~IdleConnList() STUB
 void IdleConnList::push(const Comm::ConnectionPointer &) STUB
@@ -28,6 +31,7 @@ void PconnPool::moduleInit() STUB
 void PconnPool::push(const Comm::ConnectionPointer &, const char *) STUB
 Comm::ConnectionPointer PconnPool::pop(const Comm::ConnectionPointer &, const char *, bool) STUB_RETVAL(Comm::ConnectionPointer())
 void PconnPool::count(int) STUB
+int PconnPool::count(const Comm::ConnectionPointer &, const char *) const STUB_RETVAL(0)
 void PconnPool::noteUses(int) STUB
 void PconnPool::dumpHist(StoreEntry *) const STUB
 void PconnPool::dumpHash(StoreEntry *) const STUB
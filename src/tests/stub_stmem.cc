@@ -17,4 +17,7 @@ mem_hdr::~mem_hdr() STUB
 size_t mem_hdr::size() const STUB_RETVAL(0)
 int64_t mem_hdr::endOffset () const STUB_RETVAL(0)
 bool mem_hdr::write (StoreIOBuffer const &) STUB_RETVAL(false)
+MemLoan::Pointer mem_hdr::lend(int64_t, size_t) STUB_RETVAL(nullptr)
+MemLoan::~MemLoan() STUB
+void MemLoan::borrow(mem_node &, size_t, size_t) STUB
 
@@ -22,6 +22,12 @@ void StoreEntry::invokeHandlers() STUB_NOP
 void storeLog(int, const StoreEntry *) STUB_NOP
 void storeLogOpen(void) STUB
 void storeDigestInit(void) STUB
+void storeDigestAddDiskEntry(StoreEntry &) STUB_NOP
+void storeDigestDelDiskEntry(StoreEntry &) STUB_NOP
+void storeDigestAddMemEntry(StoreEntry &) STUB_NOP
+void storeDigestDelMemEntry(StoreEntry &) STUB_NOP
+Ipc::StoreMapDigester *storeDigestDirDigester(int) STUB_RETVAL_NOP(nullptr)
+Ipc::StoreMapDigester *storeDigestMemDigester() STUB_RETVAL_NOP(nullptr)
 void storeRebuildStart(void) STUB
 void storeReplSetup(void) STUB
 void store_client::noteSwapInDone(bool) STUB
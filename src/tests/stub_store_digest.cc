@@ -17,4 +17,10 @@ void storeDigestInit(void) STUB
 void storeDigestNoteStoreReady(void) STUB
 void storeDigestDel(const StoreEntry *) STUB
 void storeDigestReport(StoreEntry *) STUB
+void storeDigestAddDiskEntry(StoreEntry &) STUB_NOP
+void storeDigestDelDiskEntry(StoreEntry &) STUB_NOP
+void storeDigestAddMemEntry(StoreEntry &) STUB_NOP
+void storeDigestDelMemEntry(StoreEntry &) STUB_NOP
+Ipc::StoreMapDigester *storeDigestDirDigester(int) STUB_RETVAL_NOP(nullptr)
+Ipc::StoreMapDigester *storeDigestMemDigester() STUB_RETVAL_NOP(nullptr)
 
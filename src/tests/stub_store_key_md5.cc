@@ -0,0 +1,25 @@
+/*
+ * Copyright (C) 1996-2023 The Squid Software Foundation and contributors
+ *
+ * Squid software is distributed under GPLv2+ license and includes
+ * contributions from numerous individuals and organizations.
+ * Please see the COPYING and CONTRIBUTORS files for details.
+ */
+
+#include "squid.h"
+
+#define STUB_API "store_key_md5.cc"
+#include "tests/STUB.h"
+
+#include "store_key_md5.h"
+
+cache_key *storeKeyDup(const cache_key *) STUB_RETVAL(nullptr)
+cache_key *storeKeyCopy(cache_key *, const cache_key *) STUB_RETVAL(nullptr)
+void storeKeyFree(const cache_key *) STUB
+const cache_key *storeKeyScan(const char *) STUB_RETVAL(nullptr)
+const char *storeKeyText(const cache_key *) STUB_RETVAL(nullptr)
+const cache_key *storeKeyPublic(const char *, const HttpRequestMethod&, const KeyScope) STUB_RETVAL(nullptr)
+const cache_key *storeKeyPublicByRequest(HttpRequest *, const KeyScope) STUB_RETVAL(nullptr)
+const cache_key *storeKeyPublicByRequestMethod(HttpRequest *, const HttpRequestMethod&, const KeyScope) STUB_RETVAL(nullptr)
+const cache_key *storeKeyPrivate() STUB_RETVAL(nullptr)
+int storeKeyHashBuckets(int) STUB_RETVAL(0)
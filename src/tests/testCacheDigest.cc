@@ -0,0 +1,121 @@
+/*
+ * Copyright (C) 1996-2023 The Squid Software Foundation and contributors
+ *
+ * Squid software is distributed under GPLv2+ license and includes
+ * contributions from numerous individuals and organizations.
+ * Please see the COPYING and CONTRIBUTORS files for details.
+ */
+
+#include "squid.h"
+#include "CacheDigest.h"
+#include "compat/cppunit.h"
+#include "md5.h"
+#include "unitTestMain.h"
+
+#include <cstring>
+
+class TestCacheDigest : public CPPUNIT_NS::TestFixture
+{
+    CPPUNIT_TEST_SUITE(TestCacheDigest);
+    CPPUNIT_TEST(testMaskSize);
+    CPPUNIT_TEST(testRoundTrip);
+    CPPUNIT_TEST(testUpdateCapacity);
+    CPPUNIT_TEST_SUITE_END();
+
+protected:
+    void testMaskSize();
+    void testRoundTrip();
+    void testUpdateCapacity();
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION( TestCacheDigest );
+
+/// a cache key with MD5-like (i.e. well-mixed) bytes derived from the given number
+class Key
+{
+public:
+    explicit Key(uint64_t n) {
+        for (size_t i = 0; i < sizeof(bytes); i += sizeof(n)) {
+            // the splitmix64 generator
+            n += 0x9E3779B97F4A7C15ULL;
+            auto h = n;
+            h = (h ^ (h >> 30)) * 0xbf58476d1ce4e5b9ULL;
+            h = (h ^ (h >> 27)) * 0x94d049bb133111ebULL;
+            h ^= h >> 31;
+            memcpy(bytes + i, &h, sizeof(h));
+        }
+    }
+
+    operator const cache_key *() const { return bytes; }
+
+private:
+    cache_key bytes[SQUID_MD5_DIGEST_LENGTH];
+};
+
+void
+TestCacheDigest::testMaskSize()
+{
+    // masks are rounded up to whole bytes
+    CPPUNIT_ASSERT_EQUAL(uint32_t(625), CacheDigest::CalcMaskSize(1000, 5));
+    CPPUNIT_ASSERT_EQUAL(uint32_t(1), CacheDigest::CalcMaskSize(1, 5));
+    CPPUNIT_ASSERT_EQUAL(uint32_t(1024), CacheDigest::CalcMaskSize(1024, 8));
+}
+
+/// checks that added keys are found and that most other keys are not
+void
+TestCacheDigest::testRoundTrip()
+{
+    const uint64_t capacity = 1000;
+    CacheDigest digest(capacity, 5);
+
+    for (uint64_t n = 0; n < capacity; ++n)
+        CPPUNIT_ASSERT(!digest.contains(Key(n)));
+
+    for (uint64_t n = 0; n < capacity; ++n)
+        digest.add(Key(n));
+    CPPUNIT_ASSERT_EQUAL(capacity, digest.count);
+
+    for (uint64_t n = 0; n < capacity; ++n)
+        CPPUNIT_ASSERT(digest.contains(Key(n)));
+
+    // a full digest with 5 bits per entry has about 10% false positives
+    int falsePositives = 0;
+    for (uint64_t n = capacity; n < 11 * capacity; ++n) {
+        if (digest.contains(Key(n)))
+            ++falsePositives;
+    }
+    CPPUNIT_ASSERT(falsePositives < 2000);
+
+    // a copy has the same bits
+    const auto copy = digest.clone();
+    for (uint64_t n = 0; n < capacity; ++n)
+        CPPUNIT_ASSERT(copy->contains(Key(n)));
+    delete copy;
+
+    digest.clear();
+    CPPUNIT_ASSERT_EQUAL(uint64_t(0), digest.count);
+    for (uint64_t n = 0; n < capacity; ++n)
+        CPPUNIT_ASSERT(!digest.contains(Key(n)));
+}
+
+void
+TestCacheDigest::testUpdateCapacity()
+{
+    CacheDigest digest(100, 5);
+    digest.add(Key(1));
+
+    // resizing fits the new capacity and resets all bits
+    digest.updateCapacity(1000);
+    CPPUNIT_ASSERT_EQUAL(uint64_t(1000), digest.capacity);
+    CPPUNIT_ASSERT_EQUAL(uint32_t(625), digest.mask_size);
+    CPPUNIT_ASSERT(!digest.contains(Key(1)));
+
+    digest.add(Key(1));
+    CPPUNIT_ASSERT(digest.contains(Key(1)));
+}
+
+int
+main(int argc, char *argv[])
+{
+    return TestProgram().run(argc, argv);
+}
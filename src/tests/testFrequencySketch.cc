@@ -0,0 +1,175 @@
+/*
+ * Copyright (C) 1996-2023 The Squid Software Foundation and contributors
+ *
+ * Squid software is distributed under GPLv2+ license and includes
+ * contributions from numerous individuals and organizations.
+ * Please see the COPYING and CONTRIBUTORS files for details.
+ */
+
+#include "squid.h"
+#include "compat/cppunit.h"
+#include "md5.h"
+#include "store/FrequencySketch.h"
+#include "unitTestMain.h"
+
+#include <cstring>
+#include <memory>
+#include <vector>
+
+class TestFrequencySketch : public CPPUNIT_NS::TestFixture
+{
+    CPPUNIT_TEST_SUITE(TestFrequencySketch);
+    CPPUNIT_TEST(testDoorkeeper);
+    CPPUNIT_TEST(testConservativeIncrements);
+    CPPUNIT_TEST(testSaturation);
+    CPPUNIT_TEST(testAging);
+    CPPUNIT_TEST_SUITE_END();
+
+protected:
+    void testDoorkeeper();
+    void testConservativeIncrements();
+    void testSaturation();
+    void testAging();
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION( TestFrequencySketch );
+
+/// a FrequencySketch in (non-shared) memory sized for the given entries
+class Sketch
+{
+public:
+    explicit Sketch(const int64_t entries):
+        raw(new char[Store::FrequencySketch::SharedMemorySize(entries)]),
+        sketch(new (raw.get()) Store::FrequencySketch(entries))
+    {}
+
+    ~Sketch() { sketch->~FrequencySketch(); }
+
+    Store::FrequencySketch *operator ->() { return sketch; }
+
+private:
+    std::unique_ptr<char[]> raw;
+    Store::FrequencySketch *sketch;
+};
+
+/// a cache key with MD5-like (i.e. well-mixed) bytes derived from the given number
+class Key
+{
+public:
+    explicit Key(uint64_t n) {
+        for (size_t i = 0; i < sizeof(bytes); i += sizeof(n)) {
+            // the splitmix64 generator
+            n += 0x9E3779B97F4A7C15ULL;
+            auto h = n;
+            h = (h ^ (h >> 30)) * 0xbf58476d1ce4e5b9ULL;
+            h = (h ^ (h >> 27)) * 0x94d049bb133111ebULL;
+            h ^= h >> 31;
+            memcpy(bytes + i, &h, sizeof(h));
+        }
+    }
+
+    operator const cache_key *() const { return bytes; }
+
+private:
+    cache_key bytes[SQUID_MD5_DIGEST_LENGTH];
+};
+
+void
+TestFrequencySketch::testDoorkeeper()
+{
+    Sketch sketch(1000);
+    const Key key(1);
+
+    CPPUNIT_ASSERT_EQUAL(uint32_t(0), sketch->frequency(key));
+
+    // the first access is only remembered by the doorkeeper
+    sketch->add(key);
+    CPPUNIT_ASSERT_EQUAL(uint32_t(1), sketch->frequency(key));
+    CPPUNIT_ASSERT_EQUAL(uint64_t(1), sketch->sampled());
+
+    sketch->add(key);
+    CPPUNIT_ASSERT_EQUAL(uint32_t(2), sketch->frequency(key));
+
+    // other keys are not affected
+    CPPUNIT_ASSERT_EQUAL(uint32_t(0), sketch->frequency(Key(2)));
+}
+
+void
+TestFrequencySketch::testConservativeIncrements()
+{
+    // a crowded sketch where counters of different keys collide
+    const int64_t entries = 16;
+    Sketch sketch(entries);
+    std::vector<uint32_t> counts;
+    for (uint64_t k = 0; k < 32; ++k)
+        counts.push_back(k % 5);
+
+    // stay below the aging threshold
+    uint64_t additions = 0;
+    for (uint64_t k = 0; k < counts.size(); ++k) {
+        for (uint32_t i = 0; i < counts[k]; ++i) {
+            sketch->add(Key(k));
+            ++additions;
+        }
+    }
+    CPPUNIT_ASSERT(additions < sketch->sampleSize());
+    CPPUNIT_ASSERT_EQUAL(uint64_t(0), sketch->agings());
+
+    // colliding counters may inflate estimates, but updating just the
+    // smallest counters of a key never makes its estimate too small
+    for (uint64_t k = 0; k < counts.size(); ++k) {
+        const auto estimate = sketch->frequency(Key(k));
+        CPPUNIT_ASSERT(estimate >= counts[k]);
+        CPPUNIT_ASSERT(estimate <= additions);
+    }
+
+    // a roomy sketch counts each access once
+    Sketch roomy(1000);
+    for (uint32_t i = 1; i <= 10; ++i) {
+        roomy->add(Key(100));
+        CPPUNIT_ASSERT_EQUAL(i, roomy->frequency(Key(100)));
+    }
+}
+
+void
+TestFrequencySketch::testSaturation()
+{
+    Sketch sketch(1000);
+    const Key key(1);
+    for (int i = 0; i < 100; ++i)
+        sketch->add(key);
+
+    // 4-bit counters plus the doorkeeper bit
+    CPPUNIT_ASSERT_EQUAL(uint32_t(16), sketch->frequency(key));
+}
+
+void
+TestFrequencySketch::testAging()
+{
+    Sketch sketch(64);
+    const Key key(1);
+
+    // saturate the counters and trigger aging at the last addition
+    const auto sampleSize = sketch->sampleSize();
+    for (uint64_t i = 0; i < sampleSize; ++i)
+        sketch->add(key);
+    CPPUNIT_ASSERT_EQUAL(uint64_t(1), sketch->agings());
+    CPPUNIT_ASSERT_EQUAL(uint64_t(0), sketch->sampled());
+
+    // counters were halved, and the doorkeeper was cleared, but the key
+    // is still known to be popular
+    CPPUNIT_ASSERT_EQUAL(uint32_t(7), sketch->frequency(key));
+
+    // the first access after aging is remembered by the doorkeeper
+    sketch->add(key);
+    CPPUNIT_ASSERT_EQUAL(uint32_t(8), sketch->frequency(key));
+
+    sketch->add(key);
+    CPPUNIT_ASSERT_EQUAL(uint32_t(9), sketch->frequency(key));
+}
+
+int
+main(int argc, char *argv[])
+{
+    return TestProgram().run(argc, argv);
+}
@@ -0,0 +1,215 @@
+/*
+ * Copyright (C) 1996-2023 The Squid Software Foundation and contributors
+ *
+ * Squid software is distributed under GPLv2+ license and includes
+ * contributions from numerous individuals and organizations.
+ * Please see the COPYING and CONTRIBUTORS files for details.
+ */
+
+#include "squid.h"
+#include "base/AsyncCallbacks.h"
+#include "base/AsyncCallQueue.h"
+#include "comm/Connection.h"
+#include "compat/cppunit.h"
+#include "HappyConnOpener.h"
+#include "HttpRequest.h"
+#include "MasterXaction.h"
+#include "ResolvedPeers.h"
+#include "SquidConfig.h"
+#include "time/gadgets.h"
+
+/*
+ * test happy_eyeballs_attempt_delay and happy_eyeballs_attempt_limit
+ */
+
+class TestHappyConnOpener : public CPPUNIT_NS::TestFixture
+{
+    CPPUNIT_TEST_SUITE(TestHappyConnOpener);
+    CPPUNIT_TEST(testStaggeringDisabled);
+    CPPUNIT_TEST(testAttemptDelay);
+    CPPUNIT_TEST(testExpiredAttemptDelay);
+    CPPUNIT_TEST(testAttemptLimit);
+    CPPUNIT_TEST(testStaggeredAttemptLimit);
+    CPPUNIT_TEST_SUITE_END();
+
+public:
+    void setUp() override;
+    void tearDown() override;
+
+protected:
+    void testStaggeringDisabled();
+    void testAttemptDelay();
+    void testExpiredAttemptDelay();
+    void testAttemptLimit();
+    void testStaggeredAttemptLimit();
+
+    void addPaths(int count);
+    void startJob();
+    void advanceClock(double seconds);
+
+    ResolvedPeers::Pointer paths;
+    HttpRequest::Pointer request;
+    AsyncCall::Pointer answerCall; ///< the job callback (used to stop the job)
+    HappyConnOpener *job = nullptr;
+    int pathCount = 0; ///< the number of addPaths() addresses
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION( TestHappyConnOpener );
+
+/// HappyConnOpener callback; the test cases stop jobs before they answer
+static void
+NoteAnswer(HappyConnOpener::Answer &)
+{
+    CPPUNIT_FAIL("unexpected HappyConnOpener answer");
+}
+
+void
+TestHappyConnOpener::setUp()
+{
+    Config.happyEyeballs.attempt_delay = 100;
+    Config.happyEyeballs.attempt_limit = 4;
+    Config.happyEyeballs.connect_limit = 0; // no spare track
+    Config.forward_max_tries = 25;
+    Config.Timeout.forward = 240;
+    Config.Timeout.connect = 60;
+
+    squid_curtime = 1000;
+    current_dtime = squid_curtime;
+    current_time.tv_sec = squid_curtime;
+    current_time.tv_usec = 0;
+
+    const auto mx = MasterXaction::MakePortless<XactionInitiator::initHtcp>();
+    request = HttpRequest::FromUrl(SBuf("http://happy.example.com/"), mx);
+    CPPUNIT_ASSERT(request);
+
+    paths = new ResolvedPeers();
+    pathCount = 0;
+}
+
+void
+TestHappyConnOpener::tearDown()
+{
+    // Stop the job: It quits because its initiator is gone, and its
+    // Comm::ConnOpener jobs quit without opening sockets when they start.
+    if (answerCall)
+        answerCall->cancel("test case is over");
+    while (AsyncCallQueue::Instance().fire()) {}
+    answerCall = nullptr;
+    job = nullptr;
+
+    paths = nullptr;
+    request = nullptr;
+    Config.happyEyeballs.attempt_delay = 0;
+}
+
+/// adds the given number of direct same-family paths and tells the job (if any)
+void
+TestHappyConnOpener::addPaths(const int count)
+{
+    for (int i = 0; i < count; ++i) {
+        const Comm::ConnectionPointer conn = new Comm::Connection();
+        conn->remote = Ip::Address("192.0.2.100");
+        conn->remote.port(80 + pathCount++);
+        paths->addPath(conn);
+    }
+    if (job)
+        job->noteCandidatesChange();
+}
+
+/// starts a job that opens connections to paths
+void
+TestHappyConnOpener::startJob()
+{
+    const auto callback = asyncCallbackFun(17, 5, NoteAnswer);
+    answerCall = callback;
+    job = new HappyConnOpener(paths, callback, request, squid_curtime, 0, nullptr);
+    job->allowPersistent(false);
+    AsyncJob::Start(job);
+
+    // The tests do not wait for the asynchronous start and keep connection
+    // attempts "in progress" by not firing AsyncCallQueue until tearDown().
+    job->noteCandidatesChange();
+}
+
+void
+TestHappyConnOpener::advanceClock(const double seconds)
+{
+    current_dtime += seconds;
+    squid_curtime = static_cast<time_t>(current_dtime);
+}
+
+void
+TestHappyConnOpener::testStaggeringDisabled()
+{
+    Config.happyEyeballs.attempt_delay = 0;
+    addPaths(3);
+    startJob();
+    CPPUNIT_ASSERT_EQUAL(ResolvedPeers::size_type(2), paths->size());
+
+    // the prime attempt is still in progress
+    advanceClock(10);
+    addPaths(1);
+    CPPUNIT_ASSERT_EQUAL(ResolvedPeers::size_type(3), paths->size());
+}
+
+void
+TestHappyConnOpener::testAttemptDelay()
+{
+    addPaths(3);
+    startJob();
+    CPPUNIT_ASSERT_EQUAL(ResolvedPeers::size_type(2), paths->size());
+
+    // no new attempts until the attempt delay expires
+    advanceClock(0.05);
+    addPaths(1);
+    CPPUNIT_ASSERT_EQUAL(ResolvedPeers::size_type(3), paths->size());
+
+    // the job is waiting for the attempt delay to expire rather than for
+    // new paths
+    advanceClock(0.1);
+    addPaths(1);
+    CPPUNIT_ASSERT_EQUAL(ResolvedPeers::size_type(4), paths->size());
+}
+
+void
+TestHappyConnOpener::testExpiredAttemptDelay()
+{
+    addPaths(1);
+    startJob();
+    CPPUNIT_ASSERT(paths->empty());
+
+    // the attempt delay has expired before new paths arrived; the job starts
+    // one staggered attempt at once and waits before starting another one
+    advanceClock(0.1);
+    addPaths(3);
+    CPPUNIT_ASSERT_EQUAL(ResolvedPeers::size_type(2), paths->size());
+}
+
+void
+TestHappyConnOpener::testAttemptLimit()
+{
+    // without spare attempts, a single attempt is the minimum limit
+    Config.happyEyeballs.attempt_limit = 1;
+    addPaths(1);
+    startJob();
+    advanceClock(0.1);
+    addPaths(2);
+    CPPUNIT_ASSERT_EQUAL(ResolvedPeers::size_type(2), paths->size());
+}
+
+void
+TestHappyConnOpener::testStaggeredAttemptLimit()
+{
+    Config.happyEyeballs.attempt_limit = 2;
+    addPaths(1);
+    startJob();
+    advanceClock(0.1);
+    addPaths(1);
+    CPPUNIT_ASSERT(paths->empty());
+
+    // two attempts are in progress
+    advanceClock(0.1);
+    addPaths(2);
+    CPPUNIT_ASSERT_EQUAL(ResolvedPeers::size_type(2), paths->size());
+}
+
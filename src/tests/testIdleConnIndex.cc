@@ -0,0 +1,221 @@
+/*
+ * Copyright (C) 1996-2023 The Squid Software Foundation and contributors
+ *
+ * Squid software is distributed under GPLv2+ license and includes
+ * contributions from numerous individuals and organizations.
+ * Please see the COPYING and CONTRIBUTORS files for details.
+ */
+
+#include "squid.h"
+#include "base/RefCount.h"
+#include "compat/cppunit.h"
+#include "IdleConnIndex.h"
+#include "unitTestMain.h"
+
+class TestIdleConnIndex : public CPPUNIT_NS::TestFixture
+{
+    CPPUNIT_TEST_SUITE(TestIdleConnIndex);
+    CPPUNIT_TEST(testLifo);
+    CPPUNIT_TEST(testLocalAddresses);
+    CPPUNIT_TEST(testUnusable);
+    CPPUNIT_TEST(testRemoveReusedDescriptor);
+    CPPUNIT_TEST(testPopOldest);
+    CPPUNIT_TEST(testRelisting);
+    CPPUNIT_TEST_SUITE_END();
+
+protected:
+    void testLifo();
+    void testLocalAddresses();
+    void testUnusable();
+    void testRemoveReusedDescriptor();
+    void testPopOldest();
+    void testRelisting();
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION( TestIdleConnIndex );
+
+/// a minimal stand-in for Comm::Connection
+class Conn: public RefCountable
+{
+public:
+    typedef RefCount<Conn> Pointer;
+
+    Conn(const int aFd, const char *aLocal, const unsigned short aPort): fd(aFd), local(aLocal) { local.port(aPort); }
+
+    int fd;
+    Ip::Address local;
+    IdleConnLinks<Conn> idleLinks;
+};
+
+using Index = IdleConnIndex<Conn>;
+
+/// accepts any connection
+static bool
+AnyConn(const Conn::Pointer &)
+{
+    return true;
+}
+
+void
+TestIdleConnIndex::testLifo()
+{
+    Index index;
+    CPPUNIT_ASSERT(index.empty());
+
+    const Conn::Pointer a = new Conn(10, "10.0.0.1", 1024);
+    const Conn::Pointer b = new Conn(11, "10.0.0.1", 1025);
+    const Conn::Pointer c = new Conn(12, "10.0.0.2", 1026);
+    index.push(a);
+    index.push(b);
+    index.push(c);
+    CPPUNIT_ASSERT_EQUAL(size_t(3), index.size());
+
+    const Ip::Address anyAddress;
+    CPPUNIT_ASSERT(index.popNewest(anyAddress, AnyConn) == c);
+    CPPUNIT_ASSERT(index.popNewest(anyAddress, AnyConn) == b);
+
+    // a reused connection becomes the newest one again
+    index.push(c);
+    CPPUNIT_ASSERT(index.popNewest(anyAddress, AnyConn) == c);
+    CPPUNIT_ASSERT(index.popNewest(anyAddress, AnyConn) == a);
+    CPPUNIT_ASSERT(!index.popNewest(anyAddress, AnyConn));
+    CPPUNIT_ASSERT(index.empty());
+}
+
+void
+TestIdleConnIndex::testLocalAddresses()
+{
+    Index index;
+    const Conn::Pointer a1 = new Conn(10, "10.0.0.1", 1024);
+    const Conn::Pointer b1 = new Conn(11, "10.0.0.2", 1025);
+    const Conn::Pointer a2 = new Conn(12, "10.0.0.1", 1026);
+    const Conn::Pointer b2 = new Conn(13, "10.0.0.2", 1027);
+    index.push(a1);
+    index.push(b1);
+    index.push(a2);
+    index.push(b2);
+
+    // an address without listed connections
+    CPPUNIT_ASSERT(!index.popNewest(Ip::Address("10.0.0.3"), AnyConn));
+
+    // a specific port
+    auto local = Ip::Address("10.0.0.1");
+    local.port(1024);
+    CPPUNIT_ASSERT(index.popNewest(local, AnyConn) == a1);
+    CPPUNIT_ASSERT(!index.popNewest(local, AnyConn));
+
+    // any port
+    CPPUNIT_ASSERT(index.popNewest(Ip::Address("10.0.0.1"), AnyConn) == a2);
+    CPPUNIT_ASSERT(!index.popNewest(Ip::Address("10.0.0.1"), AnyConn));
+    CPPUNIT_ASSERT_EQUAL(size_t(2), index.size());
+
+    // the other address list is intact
+    CPPUNIT_ASSERT(index.popNewest(Ip::Address("10.0.0.2"), AnyConn) == b2);
+
+    // an emptied address list is usable again
+    index.push(a1);
+    CPPUNIT_ASSERT(index.popNewest(Ip::Address("10.0.0.1"), AnyConn) == a1);
+
+    CPPUNIT_ASSERT(index.popNewest(Ip::Address(), AnyConn) == b1);
+    CPPUNIT_ASSERT(index.empty());
+}
+
+void
+TestIdleConnIndex::testUnusable()
+{
+    Index index;
+    const Conn::Pointer a = new Conn(10, "10.0.0.1", 1024);
+    const Conn::Pointer b = new Conn(11, "10.0.0.1", 1025);
+    index.push(a);
+    index.push(b);
+
+    const auto usable = [&b](const Conn::Pointer &conn) { return conn != b; };
+    CPPUNIT_ASSERT(index.popNewest(Ip::Address(), usable) == a);
+    CPPUNIT_ASSERT(!index.popNewest(Ip::Address("10.0.0.1"), usable));
+
+    // skipped connections stay listed
+    CPPUNIT_ASSERT_EQUAL(size_t(1), index.size());
+    CPPUNIT_ASSERT(index.popNewest(Ip::Address(), AnyConn) == b);
+}
+
+void
+TestIdleConnIndex::testRemoveReusedDescriptor()
+{
+    Index index;
+    const Conn::Pointer closed = new Conn(10, "10.0.0.1", 1024);
+    index.push(closed);
+    closed->fd = -1;
+
+    // a new connection got the descriptor of the closed (but still listed) one
+    const Conn::Pointer reopened = new Conn(10, "10.0.0.1", 1025);
+    index.push(reopened);
+    CPPUNIT_ASSERT_EQUAL(size_t(2), index.size());
+
+    CPPUNIT_ASSERT(index.remove(reopened));
+    CPPUNIT_ASSERT(!index.remove(reopened));
+    CPPUNIT_ASSERT_EQUAL(size_t(1), index.size());
+
+    // connections listed elsewhere are not removed
+    Index other;
+    const Conn::Pointer elsewhere = new Conn(11, "10.0.0.1", 1026);
+    other.push(elsewhere);
+    CPPUNIT_ASSERT(!index.remove(elsewhere));
+    CPPUNIT_ASSERT_EQUAL(size_t(1), other.size());
+
+    CPPUNIT_ASSERT(index.remove(closed));
+    CPPUNIT_ASSERT(index.empty());
+    CPPUNIT_ASSERT(!index.popNewest(Ip::Address("10.0.0.1"), AnyConn));
+}
+
+void
+TestIdleConnIndex::testPopOldest()
+{
+    Index index;
+    CPPUNIT_ASSERT(!index.popOldest());
+
+    const Conn::Pointer a1 = new Conn(10, "10.0.0.1", 1024);
+    const Conn::Pointer b1 = new Conn(11, "10.0.0.2", 1025);
+    const Conn::Pointer a2 = new Conn(12, "10.0.0.1", 1026);
+    index.push(a1);
+    index.push(b1);
+    index.push(a2);
+
+    CPPUNIT_ASSERT(index.popOldest() == a1);
+
+    // the address list lost its oldest member
+    CPPUNIT_ASSERT(index.popNewest(Ip::Address("10.0.0.1"), AnyConn) == a2);
+    CPPUNIT_ASSERT(!index.popNewest(Ip::Address("10.0.0.1"), AnyConn));
+
+    CPPUNIT_ASSERT(index.popOldest() == b1);
+    CPPUNIT_ASSERT(!index.popOldest());
+    CPPUNIT_ASSERT(index.empty());
+}
+
+void
+TestIdleConnIndex::testRelisting()
+{
+    const Conn::Pointer a = new Conn(10, "10.0.0.1", 1024);
+    const Conn::Pointer b = new Conn(11, "10.0.0.1", 1025);
+
+    {
+        Index index;
+        index.push(a);
+        index.push(b);
+        // a destroyed index releases its connections
+    }
+    CPPUNIT_ASSERT_EQUAL(uint32_t(1), a->LockCount());
+
+    // connections listed by a destroyed index can be listed again
+    Index index;
+    index.push(b);
+    index.push(a);
+    CPPUNIT_ASSERT(index.popNewest(Ip::Address("10.0.0.1"), AnyConn) == a);
+    CPPUNIT_ASSERT(index.popNewest(Ip::Address("10.0.0.1"), AnyConn) == b);
+    CPPUNIT_ASSERT(index.empty());
+}
+
+int
+main(int argc, char *argv[])
+{
+    return TestProgram().run(argc, argv);
+}
@@ -0,0 +1,296 @@
+/*
+ * Copyright (C) 1996-2023 The Squid Software Foundation and contributors
+ *
+ * Squid software is distributed under GPLv2+ license and includes
+ * contributions from numerous individuals and organizations.
+ * Please see the COPYING and CONTRIBUTORS files for details.
+ */
+
+#include "squid.h"
+#include "CachePeer.h"
+#include "compat/cppunit.h"
+#include "neighbors.h"
+#include "PeerHashTable.h"
+#include "SquidConfig.h"
+#include "unitTestMain.h"
+
+#include <cstdlib>
+#include <map>
+#include <memory>
+#include <set>
+#include <string>
+
+class TestPeerHashTable : public CPPUNIT_NS::TestFixture
+{
+    CPPUNIT_TEST_SUITE(TestPeerHashTable);
+    CPPUNIT_TEST(testEmpty);
+    CPPUNIT_TEST(testWeightedShares);
+    CPPUNIT_TEST(testMinimalDisruption);
+    CPPUNIT_TEST(testUnusablePeer);
+    CPPUNIT_TEST(testBoundedLoad);
+    CPPUNIT_TEST(testOverloadedFallback);
+    CPPUNIT_TEST_SUITE_END();
+
+public:
+    void setUp() override;
+    void tearDown() override;
+
+protected:
+    void testEmpty();
+    void testWeightedShares();
+    void testMinimalDisruption();
+    void testUnusablePeer();
+    void testBoundedLoad();
+    void testOverloadedFallback();
+
+    CachePeer *addPeer(const char *name, int weight);
+    RawCachePeers allPeers() const;
+    std::map<const CachePeer *, int> countSelections(const PeerHashTable &) const;
+
+    std::vector< std::unique_ptr<CachePeer> > peers;
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION( TestPeerHashTable );
+
+class SquidConfig Config;
+
+/// peers that peerHTTPOkay() rejects
+static std::set<const CachePeer *> UnusablePeers;
+
+/* stub functions to link successfully */
+
+CBDATA_CLASS_INIT(CachePeer);
+
+CachePeer::CachePeer(const char * const hostname):
+    name(xstrdup(hostname)),
+    host(xstrdup(hostname))
+{
+}
+
+CachePeer::~CachePeer()
+{
+    xfree(name);
+    xfree(host);
+}
+
+int
+peerHTTPOkay(const CachePeer *p, PeerSelector *)
+{
+    return UnusablePeers.count(p) ? 0 : 1;
+}
+
+/// the number of key hashes that tests map to peers
+static const unsigned int KeyCount = 100000;
+
+/// a CARP-style hash of the given key number
+static unsigned int
+KeyHash(const unsigned int n)
+{
+    // consecutive numbers, like hashes of similar URLs, share most bits
+    return n * 2654435761U;
+}
+
+void
+TestPeerHashTable::setUp()
+{
+    Config.peerHash.algorithm = PeerHashAlgorithm::consistent;
+    Config.peerHash.loadLimit = 0;
+    UnusablePeers.clear();
+}
+
+void
+TestPeerHashTable::tearDown()
+{
+    UnusablePeers.clear();
+    peers.clear();
+}
+
+CachePeer *
+TestPeerHashTable::addPeer(const char * const name, const int weight)
+{
+    peers.emplace_back(new CachePeer(name));
+    peers.back()->weight = weight;
+    return peers.back().get();
+}
+
+RawCachePeers
+TestPeerHashTable::allPeers() const
+{
+    RawCachePeers raw;
+    for (const auto &p: peers)
+        raw.push_back(p.get());
+    return raw;
+}
+
+/// how many of KeyCount keys are mapped to each peer
+std::map<const CachePeer *, int>
+TestPeerHashTable::countSelections(const PeerHashTable &table) const
+{
+    std::map<const CachePeer *, int> counts;
+    for (unsigned int n = 0; n < KeyCount; ++n)
+        ++counts[table.select(KeyHash(n), nullptr)];
+    return counts;
+}
+
+void
+TestPeerHashTable::testEmpty()
+{
+    PeerHashTable table;
+    CPPUNIT_ASSERT(table.isEmpty());
+    CPPUNIT_ASSERT(!table.select(KeyHash(1), nullptr));
+    CPPUNIT_ASSERT(!table.firstPeer());
+
+    // peers without weight do not get slots
+    addPeer("zero.example.com", 0);
+    table.reset(allPeers());
+    CPPUNIT_ASSERT(table.isEmpty());
+    CPPUNIT_ASSERT(!table.select(KeyHash(1), nullptr));
+
+    const auto p = addPeer("one.example.com", 1);
+    table.reset(allPeers());
+    CPPUNIT_ASSERT(!table.isEmpty());
+    CPPUNIT_ASSERT_EQUAL(p, table.firstPeer());
+    CPPUNIT_ASSERT_EQUAL(p, table.select(KeyHash(1), nullptr));
+
+    table.clear();
+    CPPUNIT_ASSERT(table.isEmpty());
+}
+
+void
+TestPeerHashTable::testWeightedShares()
+{
+    const auto a = addPeer("a.example.com", 1);
+    const auto b = addPeer("b.example.com", 1);
+    const auto c = addPeer("c.example.com", 2);
+    PeerHashTable table;
+    table.reset(allPeers());
+    CPPUNIT_ASSERT_EQUAL(a, table.firstPeer());
+
+    // every key is mapped, and shares follow weights
+    const auto counts = countSelections(table);
+    CPPUNIT_ASSERT_EQUAL(size_t(3), counts.size());
+    CPPUNIT_ASSERT(counts.find(nullptr) == counts.end());
+    const auto tolerance = KeyCount / 50;
+    CPPUNIT_ASSERT(std::abs(counts.at(a) - int(KeyCount/4)) < int(tolerance));
+    CPPUNIT_ASSERT(std::abs(counts.at(b) - int(KeyCount/4)) < int(tolerance));
+    CPPUNIT_ASSERT(std::abs(counts.at(c) - int(KeyCount/2)) < int(tolerance));
+}
+
+void
+TestPeerHashTable::testMinimalDisruption()
+{
+    for (const auto name: {"a.example.com", "b.example.com", "c.example.com", "d.example.com", "e.example.com"})
+        addPeer(name, 1);
+    PeerHashTable before;
+    before.reset(allPeers());
+
+    const auto gone = peers[2].get();
+    RawCachePeers remaining = allPeers();
+    remaining.erase(remaining.begin() + 2);
+    PeerHashTable after;
+    after.reset(remaining);
+
+    // keys of the removed peer move; most other keys stay
+    int moved = 0;
+    for (unsigned int n = 0; n < KeyCount; ++n) {
+        const auto oldPeer = before.select(KeyHash(n), nullptr);
+        const auto newPeer = after.select(KeyHash(n), nullptr);
+        CPPUNIT_ASSERT(newPeer != gone);
+        if (oldPeer != gone && oldPeer != newPeer)
+            ++moved;
+    }
+    CPPUNIT_ASSERT(moved < int(KeyCount / 20));
+}
+
+void
+TestPeerHashTable::testUnusablePeer()
+{
+    const auto a = addPeer("a.example.com", 1);
+    const auto b = addPeer("b.example.com", 1);
+    const auto c = addPeer("c.example.com", 1);
+    PeerHashTable table;
+    table.reset(allPeers());
+
+    std::vector<CachePeer *> expected;
+    for (unsigned int n = 0; n < KeyCount; ++n)
+        expected.push_back(table.select(KeyHash(n), nullptr));
+
+    // keys of an unusable peer move to other peers; other keys stay
+    UnusablePeers.insert(b);
+    for (unsigned int n = 0; n < KeyCount; ++n) {
+        const auto p = table.select(KeyHash(n), nullptr);
+        CPPUNIT_ASSERT(p == a || p == c);
+        if (expected[n] != b)
+            CPPUNIT_ASSERT_EQUAL(expected[n], p);
+    }
+
+    UnusablePeers.insert(a);
+    UnusablePeers.insert(c);
+    CPPUNIT_ASSERT(!table.select(KeyHash(1), nullptr));
+}
+
+void
+TestPeerHashTable::testBoundedLoad()
+{
+    const auto a = addPeer("a.example.com", 1);
+    const auto b = addPeer("b.example.com", 1);
+    PeerHashTable table;
+    table.reset(allPeers());
+
+    unsigned int aKey = 0;
+    while (table.select(KeyHash(aKey), nullptr) != a)
+        ++aKey;
+
+    // without a load limit, loads are ignored
+    a->latency.pending = 100;
+    CPPUNIT_ASSERT_EQUAL(a, table.select(KeyHash(aKey), nullptr));
+
+    // a peer above its share of pending requests is skipped
+    Config.peerHash.loadLimit = 125;
+    CPPUNIT_ASSERT_EQUAL(b, table.select(KeyHash(aKey), nullptr));
+
+    // a peer within its share is not
+    b->latency.pending = 100;
+    CPPUNIT_ASSERT_EQUAL(a, table.select(KeyHash(aKey), nullptr));
+
+    // an idle peer is never overloaded
+    a->latency.pending = 0;
+    b->latency.pending = 1000;
+    CPPUNIT_ASSERT_EQUAL(a, table.select(KeyHash(aKey), nullptr));
+}
+
+void
+TestPeerHashTable::testOverloadedFallback()
+{
+    const auto a = addPeer("a.example.com", 1);
+    const auto b = addPeer("b.example.com", 1);
+    const auto c = addPeer("c.example.com", 1);
+    PeerHashTable table;
+    table.reset(allPeers());
+    Config.peerHash.loadLimit = 100;
+
+    unsigned int aKey = 0;
+    while (table.select(KeyHash(aKey), nullptr) != a)
+        ++aKey;
+
+    // the only usable peer is overloaded but still used
+    a->latency.pending = 10;
+    UnusablePeers.insert(b);
+    UnusablePeers.insert(c);
+    CPPUNIT_ASSERT_EQUAL(a, table.select(KeyHash(aKey), nullptr));
+
+    // an overloaded peer is preferred to an unusable one
+    UnusablePeers.erase(c);
+    c->latency.pending = 10;
+    CPPUNIT_ASSERT_EQUAL(a, table.select(KeyHash(aKey), nullptr));
+
+    // but not to a peer with spare capacity
+    c->latency.pending = 1;
+    CPPUNIT_ASSERT_EQUAL(c, table.select(KeyHash(aKey), nullptr));
+}
+
+int
+main(int argc, char *argv[])
+{
+    return TestProgram().run(argc, argv);
+}
@@ -0,0 +1,217 @@
+/*
+ * Copyright (C) 1996-2023 The Squid Software Foundation and contributors
+ *
+ * Squid software is distributed under GPLv2+ license and includes
+ * contributions from numerous individuals and organizations.
+ * Please see the COPYING and CONTRIBUTORS files for details.
+ */
+
+#include "squid.h"
+#include "CachePeer.h"
+#include "compat/cppunit.h"
+#include "PeerLatency.h"
+#include "SquidConfig.h"
+#include "time/gadgets.h"
+#include "unitTestMain.h"
+
+#include <algorithm>
+#include <memory>
+
+class TestPeerLatency : public CPPUNIT_NS::TestFixture
+{
+    CPPUNIT_TEST_SUITE(TestPeerLatency);
+    CPPUNIT_TEST(testTwoPeers);
+    CPPUNIT_TEST(testThreePeers);
+    CPPUNIT_TEST(testFailingPeers);
+    CPPUNIT_TEST(testFewSamples);
+    CPPUNIT_TEST(testEjectionBackoff);
+    CPPUNIT_TEST_SUITE_END();
+
+public:
+    void tearDown() override;
+
+protected:
+    void testTwoPeers();
+    void testThreePeers();
+    void testFailingPeers();
+    void testFewSamples();
+    void testEjectionBackoff();
+
+    CachePeer *addPeer(const char *name, double responseTime, double errorRate = 0);
+    std::vector<CachePeer *> allPeers() const;
+
+    std::vector< std::unique_ptr<CachePeer> > peers;
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION( TestPeerLatency );
+
+class SquidConfig Config;
+
+/* stub functions to link successfully */
+
+CBDATA_CLASS_INIT(CachePeer);
+
+CachePeer::CachePeer(const char * const hostname):
+    name(xstrdup(hostname)),
+    host(xstrdup(hostname))
+{
+}
+
+CachePeer::~CachePeer()
+{
+    xfree(name);
+    xfree(host);
+}
+
+void
+TestPeerLatency::tearDown()
+{
+    peers.clear();
+}
+
+/// adds a cache_peer with enough measurements to be judged
+CachePeer *
+TestPeerLatency::addPeer(const char * const name, const double responseTime, const double errorRate)
+{
+    peers.emplace_back(new CachePeer(name));
+    const auto p = peers.back().get();
+    p->latency.responseTime = responseTime;
+    p->latency.responseSamples = 100;
+    p->latency.errorRate = errorRate;
+    p->latency.errorSamples = 100;
+    return p;
+}
+
+std::vector<CachePeer *>
+TestPeerLatency::allPeers() const
+{
+    std::vector<CachePeer *> raw;
+    for (const auto &p: peers)
+        raw.push_back(p.get());
+    return raw;
+}
+
+/// whether the candidates include the given peer
+static bool
+Contains(const std::vector<CachePeer *> &candidates, const CachePeer *p)
+{
+    return std::find(candidates.begin(), candidates.end(), p) != candidates.end();
+}
+
+void
+TestPeerLatency::testTwoPeers()
+{
+    squid_curtime = 1000;
+
+    // similar peers stay selectable
+    addPeer("a.example.com", 100);
+    const auto b = addPeer("b.example.com", 250);
+    auto candidates = allPeers();
+    peerLatencyEjectOutliers(candidates, 0);
+    CPPUNIT_ASSERT_EQUAL(size_t(2), candidates.size());
+    CPPUNIT_ASSERT_EQUAL(time_t(0), b->latency.ejectedUntil);
+
+    // the slower of two peers is compared with the faster one
+    b->latency.responseTime = 1000;
+    candidates = allPeers();
+    peerLatencyEjectOutliers(candidates, 0);
+    CPPUNIT_ASSERT_EQUAL(size_t(1), candidates.size());
+    CPPUNIT_ASSERT(!Contains(candidates, b));
+    CPPUNIT_ASSERT_EQUAL(time_t(1030), b->latency.ejectedUntil);
+    CPPUNIT_ASSERT_EQUAL(1, b->latency.ejections);
+
+    // the remaining peer is not ejected when the other one is already out
+    candidates = {peers[0].get()};
+    peerLatencyEjectOutliers(candidates, 1);
+    CPPUNIT_ASSERT_EQUAL(size_t(1), candidates.size());
+}
+
+void
+TestPeerLatency::testThreePeers()
+{
+    squid_curtime = 1000;
+
+    addPeer("a.example.com", 100);
+    addPeer("b.example.com", 120);
+    const auto c = addPeer("c.example.com", 1000);
+    auto candidates = allPeers();
+    peerLatencyEjectOutliers(candidates, 0);
+    CPPUNIT_ASSERT_EQUAL(size_t(2), candidates.size());
+    CPPUNIT_ASSERT(!Contains(candidates, c));
+
+    // when most peers are slow, the fast one is not an outlier
+    peers.clear();
+    addPeer("a.example.com", 100);
+    addPeer("b.example.com", 1000);
+    addPeer("c.example.com", 1100);
+    candidates = allPeers();
+    peerLatencyEjectOutliers(candidates, 0);
+    CPPUNIT_ASSERT_EQUAL(size_t(3), candidates.size());
+}
+
+void
+TestPeerLatency::testFailingPeers()
+{
+    squid_curtime = 1000;
+
+    addPeer("a.example.com", 100);
+    addPeer("b.example.com", 100, 0.6);
+    addPeer("c.example.com", 100, 0.7);
+    addPeer("d.example.com", 100, 0.8);
+
+    // at least half of the peers stay selectable
+    auto candidates = allPeers();
+    peerLatencyEjectOutliers(candidates, 0);
+    CPPUNIT_ASSERT_EQUAL(size_t(2), candidates.size());
+    CPPUNIT_ASSERT(Contains(candidates, peers[0].get()));
+    CPPUNIT_ASSERT(Contains(candidates, peers[3].get()));
+}
+
+void
+TestPeerLatency::testFewSamples()
+{
+    squid_curtime = 1000;
+
+    addPeer("a.example.com", 100);
+    const auto b = addPeer("b.example.com", 1000, 0.9);
+    b->latency.responseSamples = 9;
+
+    // peers are not judged by a few transactions
+    auto candidates = allPeers();
+    peerLatencyEjectOutliers(candidates, 0);
+    CPPUNIT_ASSERT_EQUAL(size_t(2), candidates.size());
+    CPPUNIT_ASSERT_EQUAL(0, b->latency.ejections);
+
+    // nor are other peers compared with them
+    const auto c = addPeer("c.example.com", 1000);
+    candidates = allPeers();
+    peerLatencyEjectOutliers(candidates, 0);
+    CPPUNIT_ASSERT(!Contains(candidates, c));
+}
+
+void
+TestPeerLatency::testEjectionBackoff()
+{
+    addPeer("a.example.com", 100);
+    const auto b = addPeer("b.example.com", 1000);
+
+    const time_t expected[] = { 30, 60, 120, 240, 300, 300 };
+    for (const auto duration: expected) {
+        squid_curtime += 1000;
+        auto candidates = allPeers();
+        peerLatencyEjectOutliers(candidates, 0);
+        CPPUNIT_ASSERT_EQUAL(squid_curtime + duration, b->latency.ejectedUntil);
+    }
+
+    // a healthy peer starts over
+    b->latency.responseTime = 100;
+    auto candidates = allPeers();
+    peerLatencyEjectOutliers(candidates, 0);
+    CPPUNIT_ASSERT_EQUAL(0, b->latency.consecutiveEjections);
+}
+
+int
+main(int argc, char *argv[])
+{
+    return TestProgram().run(argc, argv);
+}
@@ -0,0 +1,129 @@
+/*
+ * Copyright (C) 1996-2023 The Squid Software Foundation and contributors
+ *
+ * Squid software is distributed under GPLv2+ license and includes
+ * contributions from numerous individuals and organizations.
+ * Please see the COPYING and CONTRIBUTORS files for details.
+ */
+
+#include "squid.h"
+#include "compat/cppunit.h"
+#include "HttpRequest.h"
+#include "MasterXaction.h"
+#include "RefreshAhead.h"
+#include "SquidConfig.h"
+#include "Store.h"
+
+class TestRefreshAhead : public CPPUNIT_NS::TestFixture
+{
+    CPPUNIT_TEST_SUITE(TestRefreshAhead);
+    CPPUNIT_TEST(testNotWanted);
+    CPPUNIT_TEST(testFreshHit);
+    CPPUNIT_TEST(testStaleWhileRevalidateHit);
+    CPPUNIT_TEST_SUITE_END();
+
+public:
+    void setUp() override;
+    void tearDown() override;
+
+protected:
+    void testNotWanted();
+    void testFreshHit();
+    void testStaleWhileRevalidateHit();
+
+    void makeRequest(const HttpRequestMethod &);
+    void makeEntry(bool withMemObject);
+
+    HttpRequest::Pointer request;
+    StoreEntry entry;
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION( TestRefreshAhead );
+
+static const char *TestUrl = "http://refresh-ahead.example.com/";
+
+void
+TestRefreshAhead::setUp()
+{
+    Config.refreshAhead.limit = 10;
+    makeRequest(Http::METHOD_GET);
+    makeEntry(true);
+}
+
+void
+TestRefreshAhead::tearDown()
+{
+    entry.destroyMemObject();
+    request = nullptr;
+    Config.refreshAhead.limit = 0;
+}
+
+/// creates a request with flags that refreshCheckHTTP() sets for hits that
+/// should be revalidated in the background
+void
+TestRefreshAhead::makeRequest(const HttpRequestMethod &method)
+{
+    const auto mx = MasterXaction::MakePortless<XactionInitiator::initHtcp>();
+    request = HttpRequest::FromUrl(SBuf(TestUrl), mx, method);
+    CPPUNIT_ASSERT(request);
+    request->flags.refreshAhead = true;
+}
+
+/// creates a cache entry that is still being received
+void
+TestRefreshAhead::makeEntry(const bool withMemObject)
+{
+    entry.destroyMemObject();
+    if (withMemObject)
+        entry.createMemObject(TestUrl, TestUrl, request->method);
+    entry.store_status = STORE_PENDING;
+}
+
+void
+TestRefreshAhead::testNotWanted()
+{
+    // hits that need no background revalidation are served as usual
+    request->flags.refreshAhead = false;
+    CPPUNIT_ASSERT(RefreshAhead::StartForHit(entry, *request));
+    request->flags.staleWhileRevalidate = true;
+    CPPUNIT_ASSERT(RefreshAhead::StartForHit(entry, *request));
+}
+
+void
+TestRefreshAhead::testFreshHit()
+{
+    // a fresh hit is served even if it cannot be revalidated in the background
+    CPPUNIT_ASSERT(!RefreshAhead::Start(entry, *request));
+    CPPUNIT_ASSERT(RefreshAhead::StartForHit(entry, *request));
+
+    makeEntry(false);
+    CPPUNIT_ASSERT(!RefreshAhead::Start(entry, *request));
+    CPPUNIT_ASSERT(RefreshAhead::StartForHit(entry, *request));
+}
+
+void
+TestRefreshAhead::testStaleWhileRevalidateHit()
+{
+    request->flags.staleWhileRevalidate = true;
+
+    // the entry is still being received
+    CPPUNIT_ASSERT(!RefreshAhead::Start(entry, *request));
+    CPPUNIT_ASSERT(!RefreshAhead::StartForHit(entry, *request));
+
+    // the entry is not in memory
+    makeEntry(false);
+    CPPUNIT_ASSERT(!RefreshAhead::StartForHit(entry, *request));
+
+    // refresh_ahead_limit has been reached
+    makeEntry(true);
+    entry.store_status = STORE_OK;
+    Config.refreshAhead.limit = 0;
+    CPPUNIT_ASSERT(!RefreshAhead::Start(entry, *request));
+    CPPUNIT_ASSERT(!RefreshAhead::StartForHit(entry, *request));
+
+    // our internal request cannot revalidate responses to other methods
+    Config.refreshAhead.limit = 10;
+    makeRequest(Http::METHOD_POST);
+    request->flags.staleWhileRevalidate = true;
+    CPPUNIT_ASSERT(!RefreshAhead::StartForHit(entry, *request));
+}
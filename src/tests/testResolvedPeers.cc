@@ -0,0 +1,237 @@
+/*
+ * Copyright (C) 1996-2023 The Squid Software Foundation and contributors
+ *
+ * Squid software is distributed under GPLv2+ license and includes
+ * contributions from numerous individuals and organizations.
+ * Please see the COPYING and CONTRIBUTORS files for details.
+ */
+
+#include "squid.h"
+#include "comm/Connection.h"
+#include "compat/cppunit.h"
+#include "ResolvedPeers.h"
+#include "SquidConfig.h"
+#include "time/gadgets.h"
+
+#include <string>
+#include <vector>
+
+/*
+ * test ResolvedPeers path ranking by connection establishment history
+ */
+
+class TestResolvedPeers : public CPPUNIT_NS::TestFixture
+{
+    CPPUNIT_TEST_SUITE(TestResolvedPeers);
+    CPPUNIT_TEST(testRankingDisabled);
+    CPPUNIT_TEST(testFasterFirst);
+    CPPUNIT_TEST(testFailedLast);
+    CPPUNIT_TEST(testFailurePenalty);
+    CPPUNIT_TEST(testSmoothing);
+    CPPUNIT_TEST(testSameFamily);
+    CPPUNIT_TEST_SUITE_END();
+
+public:
+    void setUp() override;
+    void tearDown() override;
+
+protected:
+    void testRankingDisabled();
+    void testFasterFirst();
+    void testFailedLast();
+    void testFailurePenalty();
+    void testSmoothing();
+    void testSameFamily();
+
+    void resetPaths(const std::vector<const char *> &ips);
+    void checkExtractedInOrder(const std::vector<const char *> &expectedIps);
+
+    ResolvedPeers::Pointer paths;
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION( TestResolvedPeers );
+
+// Each test case uses its own addresses because ResolvedPeers remembers
+// connection histories of all paths, including paths of earlier test cases.
+
+/// a direct (i.e. not cache_peer) HTTP path with the given address
+static Comm::ConnectionPointer
+MakePath(const char * const ip, const unsigned short port = 80)
+{
+    const Comm::ConnectionPointer conn = new Comm::Connection();
+    conn->remote = Ip::Address(ip);
+    conn->remote.port(port);
+    return conn;
+}
+
+/// the IP address of the given path (without the port)
+static std::string
+AddressOf(const Comm::Connection &conn)
+{
+    char buf[MAX_IPSTRLEN];
+    return conn.remote.toStr(buf, sizeof(buf));
+}
+
+/// records an outcome of a connection attempt to the given address
+static void
+NoteOutcome(const char * const ip, const bool established, const int connectMsec)
+{
+    ResolvedPeers::NoteConnectOutcome(*MakePath(ip), established, connectMsec);
+}
+
+void
+TestResolvedPeers::setUp()
+{
+    Config.happyEyeballs.attempt_delay = 100;
+    squid_curtime = 1000000;
+}
+
+void
+TestResolvedPeers::tearDown()
+{
+    paths = nullptr;
+    Config.happyEyeballs.attempt_delay = 0;
+}
+
+/// replaces the tested paths with paths to the given addresses (in that order)
+void
+TestResolvedPeers::resetPaths(const std::vector<const char *> &ips)
+{
+    paths = new ResolvedPeers();
+    for (const auto ip: ips)
+        paths->addPath(MakePath(ip));
+}
+
+/// extracts all paths of the first peer and family, checking their order
+void
+TestResolvedPeers::checkExtractedInOrder(const std::vector<const char *> &expectedIps)
+{
+    const Comm::ConnectionPointer first = paths->extractFront();
+    CPPUNIT_ASSERT_EQUAL(std::string(expectedIps.at(0)), AddressOf(*first));
+    for (size_t i = 1; i < expectedIps.size(); ++i) {
+        const auto next = paths->extractPrime(*first);
+        CPPUNIT_ASSERT(next);
+        CPPUNIT_ASSERT_EQUAL(std::string(expectedIps.at(i)), AddressOf(*next));
+    }
+    CPPUNIT_ASSERT(!paths->extractPrime(*first));
+}
+
+void
+TestResolvedPeers::testRankingDisabled()
+{
+    // without happy_eyeballs_attempt_delay, outcomes are neither recorded...
+    Config.happyEyeballs.attempt_delay = 0;
+    NoteOutcome("192.0.2.1", false, 0);
+    NoteOutcome("192.0.2.2", true, 1);
+    Config.happyEyeballs.attempt_delay = 100;
+    resetPaths({"192.0.2.1", "192.0.2.2"});
+    checkExtractedInOrder({"192.0.2.1", "192.0.2.2"});
+
+    // ... nor used
+    NoteOutcome("192.0.2.1", false, 0);
+    NoteOutcome("192.0.2.2", true, 1);
+    Config.happyEyeballs.attempt_delay = 0;
+    resetPaths({"192.0.2.1", "192.0.2.2"});
+    checkExtractedInOrder({"192.0.2.1", "192.0.2.2"});
+}
+
+void
+TestResolvedPeers::testFasterFirst()
+{
+    NoteOutcome("192.0.2.12", true, 50);
+    NoteOutcome("192.0.2.13", true, 10);
+
+    // known paths come first (faster ones first), followed by unknown ones
+    resetPaths({"192.0.2.11", "192.0.2.12", "192.0.2.13"});
+    checkExtractedInOrder({"192.0.2.13", "192.0.2.12", "192.0.2.11"});
+}
+
+void
+TestResolvedPeers::testFailedLast()
+{
+    NoteOutcome("192.0.2.21", false, 0);
+    ++squid_curtime;
+    NoteOutcome("192.0.2.22", false, 0);
+    NoteOutcome("192.0.2.23", true, 5000);
+
+    // recently failed paths come last (older failures first), even after
+    // slow paths
+    resetPaths({"192.0.2.21", "192.0.2.22", "192.0.2.23"});
+    checkExtractedInOrder({"192.0.2.23", "192.0.2.21", "192.0.2.22"});
+
+    // a successful connection clears the failure history
+    NoteOutcome("192.0.2.22", true, 100);
+    resetPaths({"192.0.2.21", "192.0.2.22"});
+    checkExtractedInOrder({"192.0.2.22", "192.0.2.21"});
+}
+
+void
+TestResolvedPeers::testFailurePenalty()
+{
+    NoteOutcome("192.0.2.31", false, 0);
+    NoteOutcome("192.0.2.31", false, 0);
+    const auto failureTime = squid_curtime;
+
+    // two consecutive failures are penalized for 20 seconds
+    squid_curtime = failureTime + 19;
+    resetPaths({"192.0.2.31", "192.0.2.32"});
+    checkExtractedInOrder({"192.0.2.32", "192.0.2.31"});
+
+    // after that, the failed path is treated as a path without history
+    squid_curtime = failureTime + 20;
+    resetPaths({"192.0.2.31", "192.0.2.32"});
+    checkExtractedInOrder({"192.0.2.31", "192.0.2.32"});
+
+    // the penalty does not exceed five minutes
+    for (int i = 0; i < 20; ++i)
+        NoteOutcome("192.0.2.31", false, 0);
+    squid_curtime += 299;
+    resetPaths({"192.0.2.31", "192.0.2.32"});
+    checkExtractedInOrder({"192.0.2.32", "192.0.2.31"});
+
+    squid_curtime += 1;
+    resetPaths({"192.0.2.31", "192.0.2.32"});
+    checkExtractedInOrder({"192.0.2.31", "192.0.2.32"});
+}
+
+void
+TestResolvedPeers::testSmoothing()
+{
+    NoteOutcome("192.0.2.41", true, 100);
+    NoteOutcome("192.0.2.42", true, 90);
+    resetPaths({"192.0.2.41", "192.0.2.42"});
+    checkExtractedInOrder({"192.0.2.42", "192.0.2.41"});
+
+    // a single fast sample does not make a path the fastest one...
+    NoteOutcome("192.0.2.41", true, 70); // (3*100 + 70)/4 = 92.5
+    resetPaths({"192.0.2.41", "192.0.2.42"});
+    checkExtractedInOrder({"192.0.2.42", "192.0.2.41"});
+
+    // ... but several samples do
+    NoteOutcome("192.0.2.41", true, 70); // (3*92.5 + 70)/4 = 86.875
+    resetPaths({"192.0.2.41", "192.0.2.42"});
+    checkExtractedInOrder({"192.0.2.41", "192.0.2.42"});
+
+    // ports do not matter
+    ResolvedPeers::NoteConnectOutcome(*MakePath("192.0.2.42", 443), true, 0); // (3*90 + 0)/4 = 67.5
+    resetPaths({"192.0.2.41", "192.0.2.42"});
+    checkExtractedInOrder({"192.0.2.42", "192.0.2.41"});
+}
+
+void
+TestResolvedPeers::testSameFamily()
+{
+    NoteOutcome("2001:db8::51", true, 1);
+    NoteOutcome("192.0.2.52", true, 100);
+    NoteOutcome("2001:db8::52", true, 10);
+    resetPaths({"192.0.2.51", "2001:db8::51", "192.0.2.52", "2001:db8::52"});
+
+    // paths are only reordered within their address family
+    const Comm::ConnectionPointer first = paths->extractFront();
+    CPPUNIT_ASSERT_EQUAL(std::string("192.0.2.52"), AddressOf(*first));
+    CPPUNIT_ASSERT_EQUAL(std::string("2001:db8::51"), AddressOf(*paths->extractSpare(*first)));
+    CPPUNIT_ASSERT_EQUAL(std::string("192.0.2.51"), AddressOf(*paths->extractPrime(*first)));
+    CPPUNIT_ASSERT_EQUAL(std::string("2001:db8::52"), AddressOf(*paths->extractSpare(*first)));
+    CPPUNIT_ASSERT(paths->empty());
+}
+
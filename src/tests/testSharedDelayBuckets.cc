@@ -0,0 +1,201 @@
+/*
+ * Copyright (C) 1996-2023 The Squid Software Foundation and contributors
+ *
+ * Squid software is distributed under GPLv2+ license and includes
+ * contributions from numerous individuals and organizations.
+ * Please see the COPYING and CONTRIBUTORS files for details.
+ */
+
+#include "squid.h"
+#include "compat/cppunit.h"
+#include "SharedDelayBuckets.h"
+#include "unitTestMain.h"
+
+#include <memory>
+#include <set>
+#include <string>
+
+class TestSharedDelayBuckets : public CPPUNIT_NS::TestFixture
+{
+    CPPUNIT_TEST_SUITE(TestSharedDelayBuckets);
+    CPPUNIT_TEST(testKeys);
+    CPPUNIT_TEST(testNewBucket);
+    CPPUNIT_TEST(testLazyRefill);
+    CPPUNIT_TEST(testEviction);
+    CPPUNIT_TEST(testRecycling);
+    CPPUNIT_TEST_SUITE_END();
+
+protected:
+    void testKeys();
+    void testNewBucket();
+    void testLazyRefill();
+    void testEviction();
+    void testRecycling();
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION( TestSharedDelayBuckets );
+
+/// SharedDelayBuckets in (non-shared) memory
+class Buckets
+{
+public:
+    explicit Buckets(const uint32_t capacity):
+        raw(new char[SharedDelayBuckets::SharedMemorySize(capacity)]),
+        buckets(new (raw.get()) SharedDelayBuckets(capacity))
+    {}
+
+    ~Buckets() { buckets->~SharedDelayBuckets(); }
+
+    SharedDelayBuckets *operator ->() { return buckets; }
+
+private:
+    std::unique_ptr<char[]> raw;
+    SharedDelayBuckets *buckets;
+};
+
+static const SharedDelayBuckets::Microseconds Second = 1000000;
+
+/// a pool level refilled at 1000 bytes per second, up to 10000 bytes
+static SharedDelayBuckets::Rate
+SlowRate(const int64_t initialBytes = 0)
+{
+    SharedDelayBuckets::Rate rate;
+    rate.restoreBps = 1000;
+    rate.maxBytes = 10000;
+    rate.initialBytes = initialBytes;
+    return rate;
+}
+
+/// a key of a given client of delay pool 1
+static SharedDelayBuckets::Key
+ClientKey(const int client)
+{
+    const auto name = std::to_string(client);
+    return SharedDelayBuckets::MakeKey(1, 2, name.data(), name.size());
+}
+
+void
+TestSharedDelayBuckets::testKeys()
+{
+    std::set<SharedDelayBuckets::Key> keys;
+    const std::string name("user");
+    for (unsigned int pool = 0; pool < 4; ++pool) {
+        for (unsigned int level = 0; level < 4; ++level) {
+            const auto key = SharedDelayBuckets::MakeKey(pool, level, name.data(), name.size());
+            CPPUNIT_ASSERT(key != 0);
+            keys.insert(key);
+        }
+    }
+    CPPUNIT_ASSERT_EQUAL(size_t(16), keys.size());
+
+    // keys depend on bucket owner identity
+    CPPUNIT_ASSERT(ClientKey(1) != ClientKey(2));
+    CPPUNIT_ASSERT_EQUAL(ClientKey(1), ClientKey(1));
+}
+
+void
+TestSharedDelayBuckets::testNewBucket()
+{
+    Buckets buckets(100);
+    const auto rate = SlowRate(4000);
+
+    CPPUNIT_ASSERT_EQUAL(uint32_t(0), buckets->used());
+    const auto index = buckets->find(ClientKey(1), rate, Second);
+    CPPUNIT_ASSERT(index != SharedDelayBuckets::NoBucket);
+    CPPUNIT_ASSERT(buckets->owns(index, ClientKey(1)));
+    CPPUNIT_ASSERT_EQUAL(uint32_t(1), buckets->used());
+    CPPUNIT_ASSERT_EQUAL(int64_t(4000), buckets->level(index, rate, Second));
+
+    // finding an existing key does not reset its bucket
+    buckets->consume(index, 1000);
+    CPPUNIT_ASSERT_EQUAL(index, buckets->find(ClientKey(1), rate, Second));
+    CPPUNIT_ASSERT_EQUAL(int64_t(3000), buckets->level(index, rate, Second));
+
+    // initial levels are capped by bucket capacity
+    const auto other = buckets->find(ClientKey(2), SlowRate(20000), Second);
+    CPPUNIT_ASSERT(other != index);
+    CPPUNIT_ASSERT_EQUAL(int64_t(10000), buckets->level(other, SlowRate(20000), Second));
+}
+
+void
+TestSharedDelayBuckets::testLazyRefill()
+{
+    Buckets buckets(100);
+    const auto rate = SlowRate();
+    const auto start = 10 * Second;
+    const auto index = buckets->find(ClientKey(1), rate, start);
+    CPPUNIT_ASSERT_EQUAL(int64_t(0), buckets->level(index, rate, start));
+
+    // refilled by the time elapsed since the last refill
+    CPPUNIT_ASSERT_EQUAL(int64_t(1000), buckets->level(index, rate, start + Second));
+    CPPUNIT_ASSERT_EQUAL(int64_t(1500), buckets->level(index, rate, start + Second + Second/2));
+
+    // fractions of a byte are not lost while time accumulates
+    const auto later = start + Second + Second/2;
+    CPPUNIT_ASSERT_EQUAL(int64_t(1500), buckets->level(index, rate, later + 500));
+    CPPUNIT_ASSERT_EQUAL(int64_t(1501), buckets->level(index, rate, later + 1000));
+
+    // spending more than available leaves a debt that refills pay off
+    buckets->consume(index, 3501);
+    CPPUNIT_ASSERT_EQUAL(int64_t(-2000), buckets->level(index, rate, later + 1000));
+    CPPUNIT_ASSERT_EQUAL(int64_t(-1000), buckets->level(index, rate, later + 1000 + Second));
+
+    // refills stop at bucket capacity
+    CPPUNIT_ASSERT_EQUAL(int64_t(10000), buckets->level(index, rate, later + 100*Second));
+}
+
+void
+TestSharedDelayBuckets::testEviction()
+{
+    // every key probes all slots of a small table
+    Buckets buckets(4);
+    const auto rate = SlowRate();
+
+    uint32_t firstIndex = SharedDelayBuckets::NoBucket;
+    for (int client = 1; client <= 4; ++client) {
+        const auto index = buckets->find(ClientKey(client), rate, client * Second);
+        CPPUNIT_ASSERT(index != SharedDelayBuckets::NoBucket);
+        if (client == 1)
+            firstIndex = index;
+    }
+    CPPUNIT_ASSERT_EQUAL(uint32_t(4), buckets->used());
+
+    // the least recently used bucket goes to the new key, even though
+    // it has not refilled yet
+    const auto index = buckets->find(ClientKey(5), rate, 5 * Second);
+    CPPUNIT_ASSERT_EQUAL(firstIndex, index);
+    CPPUNIT_ASSERT(buckets->owns(index, ClientKey(5)));
+    CPPUNIT_ASSERT(!buckets->owns(index, ClientKey(1)));
+    CPPUNIT_ASSERT_EQUAL(uint64_t(1), buckets->evictions());
+    CPPUNIT_ASSERT_EQUAL(uint64_t(0), buckets->recycles());
+    CPPUNIT_ASSERT_EQUAL(uint32_t(4), buckets->used());
+
+    // the new owner starts with a new bucket
+    CPPUNIT_ASSERT_EQUAL(int64_t(0), buckets->level(index, rate, 5 * Second));
+}
+
+void
+TestSharedDelayBuckets::testRecycling()
+{
+    Buckets buckets(4);
+    const auto rate = SlowRate();
+
+    for (int client = 1; client <= 4; ++client)
+        buckets->find(ClientKey(client), rate, client * Second);
+
+    // clients 2-4 stay active; client 1 stays idle long enough to refill
+    const auto later = 1000 * Second;
+    for (int client = 2; client <= 4; ++client)
+        buckets->find(ClientKey(client), rate, later);
+
+    const auto index = buckets->find(ClientKey(5), rate, later);
+    CPPUNIT_ASSERT(buckets->owns(index, ClientKey(5)));
+    CPPUNIT_ASSERT_EQUAL(uint64_t(0), buckets->evictions());
+    CPPUNIT_ASSERT_EQUAL(uint64_t(1), buckets->recycles());
+}
+
+int
+main(int argc, char *argv[])
+{
+    return TestProgram().run(argc, argv);
+}
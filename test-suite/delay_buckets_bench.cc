@@ -0,0 +1,152 @@
+/*
+ * Copyright (C) 1996-2023 The Squid Software Foundation and contributors
+ *
+ * Squid software is distributed under GPLv2+ license and includes
+ * contributions from numerous individuals and organizations.
+ * Please see the COPYING and CONTRIBUTORS files for details.
+ */
+
+/* DEBUG: section 77    Delay Pools */
+
+/*
+ * Measures SharedDelayBuckets lookup and token accounting costs with 100k
+ * concurrently active client buckets, checks that lazy refills do not give
+ * out more bytes than the configured rate allows, and reports how many
+ * buckets had to be reused. Not a part of "make check"; run manually:
+ *   make delay_buckets_bench && ./delay_buckets_bench [clients [operations]]
+ */
+
+#include "squid.h"
+#include "SharedDelayBuckets.h"
+
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <random>
+
+typedef SharedDelayBuckets::Microseconds Microseconds;
+
+/// allocates and constructs a bucket table as if it were in shared memory
+static SharedDelayBuckets *
+MakeBuckets(const uint32_t capacity, std::unique_ptr<char[]> &space)
+{
+    space.reset(new char[SharedDelayBuckets::SharedMemorySize(capacity) + alignof(SharedDelayBuckets)]);
+    auto raw = space.get();
+    const auto misalignment = reinterpret_cast<uintptr_t>(raw) % alignof(SharedDelayBuckets);
+    if (misalignment)
+        raw += alignof(SharedDelayBuckets) - misalignment;
+    return new (raw) SharedDelayBuckets(capacity);
+}
+
+/// a single client must not get more than the initial level plus its rate
+static void
+testRateLimit()
+{
+    std::unique_ptr<char[]> space;
+    const auto buckets = MakeBuckets(16, space);
+
+    SharedDelayBuckets::Rate rate;
+    rate.restoreBps = 1000;
+    rate.maxBytes = 4000;
+    rate.initialBytes = 2000;
+
+    const auto key = SharedDelayBuckets::MakeKey(0, 0, "client", 6);
+    Microseconds now = 1000000;
+    int64_t received = 0;
+    for (int step = 0; step < 10000; ++step, now += 1000) { // 10 seconds
+        const auto index = buckets->find(key, rate, now);
+        assert(index != SharedDelayBuckets::NoBucket);
+        const auto available = buckets->level(index, rate, now);
+        if (available > 0) {
+            const auto bytes = std::min<int64_t>(available, 100);
+            buckets->consume(index, bytes);
+            received += bytes;
+        }
+    }
+
+    // initial 2000 bytes plus 10 seconds at 1000 bytes/s (minus the last step)
+    assert(received <= 2000 + 10 * 1000);
+    assert(received >= 2000 + 10 * 1000 - 100);
+    std::cout << "rate limit: received " << received << " bytes in 10s at 1000 B/s" << std::endl;
+}
+
+/// idle buckets refill up to, but not beyond, their capacity
+static void
+testIdleRefill()
+{
+    std::unique_ptr<char[]> space;
+    const auto buckets = MakeBuckets(16, space);
+
+    SharedDelayBuckets::Rate rate;
+    rate.restoreBps = 1000;
+    rate.maxBytes = 4000;
+    rate.initialBytes = 0;
+
+    const auto key = SharedDelayBuckets::MakeKey(0, 0, "idle", 4);
+    const auto index = buckets->find(key, rate, 0);
+    assert(buckets->level(index, rate, 0) == 0);
+    assert(buckets->level(index, rate, 1500000) == 1500);
+    assert(buckets->level(index, rate, 3600000000LL) == 4000);
+}
+
+/// many clients in a table sized like delay_pool_shared_buckets suggests
+static void
+benchmark(const uint32_t clients, const uint64_t operations)
+{
+    const uint32_t capacity = clients + clients / 3;
+    std::unique_ptr<char[]> space;
+    const auto buckets = MakeBuckets(capacity, space);
+
+    SharedDelayBuckets::Rate rate;
+    rate.restoreBps = 8000;
+    rate.maxBytes = 64000;
+    rate.initialBytes = 32000;
+
+    std::mt19937_64 random(42);
+    std::uniform_int_distribution<uint32_t> pick(0, clients - 1);
+
+    // activate every client first so that all buckets are in use
+    Microseconds now = 0;
+    for (uint32_t client = 0; client < clients; ++client)
+        (void)buckets->find(SharedDelayBuckets::MakeKey(1, 2, &client, sizeof(client)), rate, now);
+
+    const auto start = std::chrono::steady_clock::now();
+    int64_t transferred = 0;
+    for (uint64_t op = 0; op < operations; ++op) {
+        now += 10; // 100k operations per simulated second
+        const auto client = pick(random);
+        const auto key = SharedDelayBuckets::MakeKey(1, 2, &client, sizeof(client));
+        const auto index = buckets->find(key, rate, now);
+        if (index == SharedDelayBuckets::NoBucket)
+            continue;
+        const auto available = buckets->level(index, rate, now);
+        if (available > 0) {
+            const auto bytes = std::min<int64_t>(available, 4096);
+            buckets->consume(index, bytes);
+            transferred += bytes;
+        }
+    }
+    const std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+
+    std::cout << "clients: " << clients << "\n" <<
+              "buckets: " << buckets->used() << " of " << buckets->capacity() << " used\n" <<
+              "operations: " << operations << "\n" <<
+              "time per operation: " << (elapsed.count() / operations) << " ns\n" <<
+              "bytes allowed: " << transferred << "\n" <<
+              "recycled buckets: " << buckets->recycles() << "\n" <<
+              "evicted buckets: " << buckets->evictions() << std::endl;
+}
+
+int
+main(int argc, char *argv[])
+{
+    const uint32_t clients = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 100000;
+    const uint64_t operations = argc > 2 ? std::strtoull(argv[2], nullptr, 10) : 10000000;
+
+    testRateLimit();
+    testIdleRefill();
+    benchmark(std::max<uint32_t>(clients, 1), std::max<uint64_t>(operations, 1));
+    return EXIT_SUCCESS;
+}
+
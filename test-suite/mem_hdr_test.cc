@@ -8,13 +8,27 @@
 
 /* DEBUG: section 19    Store Memory Primitives */
 
+/*
+ * Tests mem_hdr page indexing. When given a "bench" argument, also measures
+ * mem_hdr lookup, copy, and write costs for dense and sparse content and
+ * compares page lookups with the Splay-based index mem_hdr used to have:
+ *   make mem_hdr_test && ./mem_hdr_test bench [pages [operations]]
+ */
+
 #include "squid.h"
 #include "Generic.h"
 #include "mem_node.h"
+#include "splay.h"
 #include "stmem.h"
 
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
 #include <iostream>
+#include <random>
 #include <sstream>
+#include <vector>
 
 static void
 testLowAndHigh()
@@ -40,35 +54,147 @@ testLowAndHigh()
     assert (!aHeader.hasContigousContentRange(Range<int64_t>(10,101)));
 }
 
+/// writes size bytes with the given value at the given offset
+static void
+writeBytes(mem_hdr &aHeader, const int64_t offset, const size_t size, const char value = 'x')
+{
+    std::vector<char> buf(size, value);
+    assert (aHeader.write (StoreIOBuffer(size, offset, buf.data())));
+}
+
+static void
+testDenseIndex()
+{
+    mem_hdr aHeader;
+    // three full pages and a partial one, written in small pieces
+    for (int page = 0; page < 3; ++page) {
+        for (int64_t offset = 0; offset < SM_PAGE_SIZE; offset += 128)
+            writeBytes(aHeader, page*SM_PAGE_SIZE + offset, 128, static_cast<char>('a' + page));
+    }
+    writeBytes(aHeader, 3*SM_PAGE_SIZE, 100, 'd');
+    assert (aHeader.size() == 4);
+    assert (aHeader.endOffset() == 3*SM_PAGE_SIZE + 100);
+
+    for (int64_t location = 0; location < aHeader.endOffset(); location += 37) {
+        const auto node = aHeader.getBlockContainingLocation(location);
+        assert (node);
+        assert (node->contains(location));
+        assert (node->data[location - node->start()] == 'a' + location/SM_PAGE_SIZE);
+    }
+    assert (!aHeader.getBlockContainingLocation(aHeader.endOffset()));
+
+    char buf[SM_PAGE_SIZE];
+    assert (aHeader.copy(StoreIOBuffer(sizeof(buf), SM_PAGE_SIZE - 10, buf)) == static_cast<ssize_t>(sizeof(buf)));
+    assert (buf[0] == 'a' && buf[10] == 'b');
+
+    // freeing leading pages keeps later pages reachable
+    assert (aHeader.freeDataUpto(2*SM_PAGE_SIZE) == 2*SM_PAGE_SIZE);
+    assert (aHeader.size() == 2);
+    assert (!aHeader.getBlockContainingLocation(SM_PAGE_SIZE));
+    assert (aHeader.getBlockContainingLocation(3*SM_PAGE_SIZE + 99));
+}
+
+static void
+testSparseIndex()
+{
+    mem_hdr aHeader;
+    // partial content written out of order, with gaps
+    writeBytes(aHeader, 10000, 5000, 'c');
+    writeBytes(aHeader, 0, 10, 'a');
+    writeBytes(aHeader, 5000, 10, 'b');
+    writeBytes(aHeader, 20000, 1, 'd');
+    assert (aHeader.lowestOffset() == 0);
+    assert (aHeader.endOffset() == 20001);
+
+    assert (aHeader.getBlockContainingLocation(9)->start() == 0);
+    assert (!aHeader.getBlockContainingLocation(10));
+    assert (!aHeader.getBlockContainingLocation(4999));
+    assert (aHeader.getBlockContainingLocation(5009)->start() == 5000);
+    assert (aHeader.getBlockContainingLocation(10000)->start() == 10000);
+    assert (aHeader.getBlockContainingLocation(14999));
+    assert (!aHeader.getBlockContainingLocation(15000));
+    assert (aHeader.getBlockContainingLocation(20000)->start() == 20000);
+
+    assert (aHeader.hasContigousContentRange(Range<int64_t>(10000, 15000)));
+    assert (!aHeader.hasContigousContentRange(Range<int64_t>(10000, 15001)));
+    assert (!aHeader.hasContigousContentRange(Range<int64_t>(0, 5010)));
+
+    // copying stops at the first gap
+    char buf[100];
+    assert (aHeader.copy(StoreIOBuffer(sizeof(buf), 5000, buf)) == 10);
+    assert (buf[0] == 'b' && buf[9] == 'b');
+
+    // filling a gap joins neighbors
+    writeBytes(aHeader, 10, 4990, 'e');
+    assert (aHeader.hasContigousContentRange(Range<int64_t>(0, 5010)));
+    assert (aHeader.copy(StoreIOBuffer(sizeof(buf), 4990, buf)) == 20);
+    assert (buf[9] == 'e' && buf[10] == 'b');
+
+    // lending stops at gaps too
+    const auto loan = aHeader.lend(4990, 1000);
+    assert (loan->size() == 20);
+}
+
+/// whether all loan segments hold the given byte value
+static bool
+loanHolds(const MemLoan &loan, const char value)
+{
+    for (const auto &segment: loan.segments()) {
+        const auto data = static_cast<const char *>(segment.iov_base);
+        if (std::count(data, data + segment.iov_len, value) != static_cast<ssize_t>(segment.iov_len))
+            return false;
+    }
+    return true;
+}
+
 static void
-testSplayOfNodes()
+testLoans()
 {
-    Splay<mem_node *> aSplay;
-    mem_node *temp5;
-    temp5 = new mem_node(5);
-    temp5->nodeBuffer.length = 10;
-    aSplay.insert (temp5, mem_hdr::NodeCompare);
-    assert (aSplay.start()->data == temp5);
-    assert (aSplay.finish()->data == temp5);
-
-    mem_node *temp0;
-    temp0 = new mem_node(0);
-    temp0->nodeBuffer.length = 5;
-    aSplay.insert (temp0, mem_hdr::NodeCompare);
-    assert (aSplay.start()->data == temp0);
-    assert (aSplay.finish()->data == temp5);
-
-    mem_node *temp14;
-    temp14 = new mem_node (14);
-    temp14->nodeBuffer.length = 1;
-    assert (aSplay.find(temp14,mem_hdr::NodeCompare));
-    delete temp14;
-
-    mem_node ref13  (13);
-    assert (!aSplay.find(&ref13,mem_hdr::NodeCompare));
-    ref13.nodeBuffer.length = 1;
-    assert (aSplay.find(&ref13,mem_hdr::NodeCompare));
-    aSplay.destroy();
+    {
+        mem_hdr aHeader;
+        writeBytes(aHeader, 0, 3*SM_PAGE_SIZE, 'a');
+        assert (aHeader.size() == 3);
+
+        // a pending write holds the loan
+        Comm::IoVector::Pointer pending = aHeader.lend(0, 2*SM_PAGE_SIZE);
+        assert (pending->size() == 2*SM_PAGE_SIZE);
+        assert (pending->segments().size() == 2);
+
+        // borrowed pages are not trimmed
+        assert (aHeader.freeDataUpto(3*SM_PAGE_SIZE) == 0);
+        assert (aHeader.size() == 3);
+
+        // freed borrowed pages outlive their mem_hdr index
+        aHeader.freeContent();
+        assert (aHeader.size() == 0);
+        assert (mem_node::InUseCount() == 2);
+        assert (loanHolds(dynamic_cast<const MemLoan &>(*pending), 'a'));
+
+        // the last borrower frees them
+        pending = nullptr;
+        assert (mem_node::InUseCount() == 0);
+    }
+
+    {
+        Comm::IoVector::Pointer pending;
+        Comm::IoVector::Pointer other;
+        {
+            mem_hdr aHeader;
+            writeBytes(aHeader, 0, 2*SM_PAGE_SIZE, 'b');
+            pending = aHeader.lend(SM_PAGE_SIZE/2, SM_PAGE_SIZE);
+            other = aHeader.lend(SM_PAGE_SIZE, 10);
+            // destroying a mem_hdr frees its pages
+        }
+        assert (mem_node::InUseCount() == 2);
+        assert (loanHolds(dynamic_cast<const MemLoan &>(*pending), 'b'));
+
+        // pages borrowed twice wait for both borrowers
+        pending = nullptr;
+        assert (mem_node::InUseCount() == 1);
+        assert (loanHolds(dynamic_cast<const MemLoan &>(*other), 'b'));
+        other = nullptr;
+        assert (mem_node::InUseCount() == 0);
+    }
 }
 
 static void
@@ -83,24 +209,117 @@ testHdrVisit()
     safe_free (sampleData);
     std::ostringstream result;
     PointerPrinter<mem_node *> foo(result, "\n");
-    for_each (aHeader.getNodes().end(), aHeader.getNodes().end(), foo);
-    for_each (aHeader.getNodes().begin(), aHeader.getNodes().begin(), foo);
-    for_each (aHeader.getNodes().begin(), aHeader.getNodes().end(), foo);
+    std::for_each (aHeader.getNodes().end(), aHeader.getNodes().end(), foo);
+    std::for_each (aHeader.getNodes().begin(), aHeader.getNodes().begin(), foo);
+    std::for_each (aHeader.getNodes().begin(), aHeader.getNodes().end(), foo);
     std::ostringstream expectedResult;
     expectedResult << "[100,101)" << std::endl << "[102,103)" << std::endl;
     assert (result.str() == expectedResult.str());
 }
 
+/// the Splay-based mem_hdr node comparison, for benchmark baseline
+static int
+SplayNodeCompare(mem_node * const &left, mem_node * const &right)
+{
+    if (left->dataRange().intersection(right->dataRange()).size() > 0)
+        return 0;
+
+    return *left < *right ? -1 : 1;
+}
+
+/// reports the average duration of an operation since the given start
+static void
+report(const char *name, const std::chrono::steady_clock::time_point start, const uint64_t operations, const int64_t checksum)
+{
+    const auto elapsed = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+    std::cout << name << ": " << (elapsed / operations) << " ns/op (checksum " << checksum << ")" << std::endl;
+}
+
+static void
+benchmark(const int64_t pages, const uint64_t operations)
+{
+    const int64_t objectSize = pages * SM_PAGE_SIZE;
+    std::mt19937_64 rng(42);
+    std::uniform_int_distribution<int64_t> anyOffset(0, objectSize - 1);
+    std::vector<char> buf(64*1024, 'x');
+
+    std::cout << "object size: " << objectSize << " bytes in " << pages << " pages" << std::endl;
+
+    mem_hdr dense;
+    auto start = std::chrono::steady_clock::now();
+    for (int64_t offset = 0; offset < objectSize; offset += 1460) {
+        const auto size = std::min<int64_t>(1460, objectSize - offset);
+        dense.write(StoreIOBuffer(size, offset, buf.data()));
+    }
+    report("dense append (1460-byte writes)", start, (objectSize + 1459) / 1460, dense.size());
+
+    int64_t checksum = 0;
+    start = std::chrono::steady_clock::now();
+    for (uint64_t i = 0; i < operations; ++i)
+        checksum += dense.getBlockContainingLocation(anyOffset(rng))->start();
+    report("dense random page lookup", start, operations, checksum);
+
+    checksum = 0;
+    start = std::chrono::steady_clock::now();
+    for (uint64_t i = 0; i < operations / 16; ++i) {
+        const auto offset = anyOffset(rng) / 2;
+        checksum += dense.copy(StoreIOBuffer(buf.size(), offset, buf.data()));
+    }
+    report("dense random 64KB range copy", start, operations / 16, checksum);
+
+    Splay<mem_node *> splay;
+    for (const auto node: dense.getNodes())
+        splay.insert(node, SplayNodeCompare);
+    checksum = 0;
+    start = std::chrono::steady_clock::now();
+    for (uint64_t i = 0; i < operations; ++i) {
+        mem_node target(anyOffset(rng));
+        target.nodeBuffer.length = 1;
+        checksum += (*splay.find(&target, SplayNodeCompare))->start();
+    }
+    report("baseline: Splay random page lookup", start, operations, checksum);
+    splay.destroy([](mem_node *&) {}); // dense owns the nodes
+
+    // sparse content: every other 64KB range, written in reverse order
+    mem_hdr sparse;
+    const int64_t rangeSize = buf.size();
+    start = std::chrono::steady_clock::now();
+    uint64_t writes = 0;
+    for (int64_t offset = (objectSize / rangeSize - 1) * rangeSize; offset >= 0; offset -= 2*rangeSize, ++writes)
+        sparse.write(StoreIOBuffer(rangeSize, offset, buf.data()));
+    report("sparse reverse 64KB writes", start, writes, sparse.size());
+
+    checksum = 0;
+    start = std::chrono::steady_clock::now();
+    for (uint64_t i = 0; i < operations; ++i) {
+        const auto node = sparse.getBlockContainingLocation(anyOffset(rng));
+        checksum += node ? node->start() : -1;
+    }
+    report("sparse random page lookup", start, operations, checksum);
+}
+
 int
-main(int, char *[])
+main(int argc, char *argv[])
 {
     assert (mem_node::InUseCount() == 0);
     testLowAndHigh();
     assert (mem_node::InUseCount() == 0);
-    testSplayOfNodes();
+    testDenseIndex();
+    assert (mem_node::InUseCount() == 0);
+    testSparseIndex();
+    assert (mem_node::InUseCount() == 0);
+    testLoans();
     assert (mem_node::InUseCount() == 0);
     testHdrVisit();
     assert (mem_node::InUseCount() == 0);
+
+    if (argc > 1 && strcmp(argv[1], "bench") == 0) {
+        const int64_t pages = argc > 2 ? std::strtoll(argv[2], nullptr, 10) : 64*1024;
+        const uint64_t operations = argc > 3 ? std::strtoull(argv[3], nullptr, 10) : 10000000;
+        benchmark(std::max<int64_t>(pages, 32), std::max<uint64_t>(operations, 16));
+        assert (mem_node::InUseCount() == 0);
+    }
+
     return EXIT_SUCCESS;
 }
 
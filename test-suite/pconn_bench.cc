@@ -0,0 +1,175 @@
+/*
+ * Copyright (C) 1996-2023 The Squid Software Foundation and contributors
+ *
+ * Squid software is distributed under GPLv2+ license and includes
+ * contributions from numerous individuals and organizations.
+ * Please see the COPYING and CONTRIBUTORS files for details.
+ */
+
+/* DEBUG: section 48    Persistent Connections */
+
+/*
+ * Compares IdleConnIndex with the array-based idle connection list it
+ * replaced, using many idle connections to a single destination: reusing
+ * connections with and without a specific outgoing address, looking up an
+ * outgoing address without idle connections, and removing connections closed
+ * by the server. Not a part of "make check"; run manually:
+ *   make pconn_bench && ./pconn_bench [connections [operations]]
+ */
+
+#include "squid.h"
+#include "base/RefCount.h"
+#include "IdleConnIndex.h"
+
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <vector>
+
+/// a minimal stand-in for Comm::Connection
+class Conn: public RefCountable
+{
+public:
+    typedef RefCount<Conn> Pointer;
+
+    Conn(const int aFd, const Ip::Address &aLocal): fd(aFd), local(aLocal) {}
+
+    int fd;
+    Ip::Address local;
+    IdleConnLinks<Conn> idleLinks;
+};
+
+/// the IdleConnList algorithms replaced by IdleConnIndex
+class ArrayList
+{
+public:
+    void push(const Conn::Pointer &conn) {
+        list.push_back(conn);
+    }
+
+    /// IdleConnList::findUseable() scan
+    template <class Predicate>
+    Conn::Pointer popNewest(const Ip::Address &local, Predicate usable) {
+        const bool keyCheckAddr = !local.isAnyAddr();
+        const bool keyCheckPort = local.port() > 0;
+        for (int i = list.size() - 1; i >= 0; --i) {
+            if (keyCheckPort && local.port() != list[i]->local.port())
+                continue;
+            if (keyCheckAddr && local.matchIPAddr(list[i]->local) != 0)
+                continue;
+            if (!usable(list[i]))
+                continue;
+            return removeAt(i);
+        }
+        return nullptr;
+    }
+
+    /// IdleConnList::findIndexOf() and removeAt()
+    bool remove(const Conn::Pointer &conn) {
+        for (int i = list.size() - 1; i >= 0; --i) {
+            if (list[i] == conn)
+                return removeAt(i) != nullptr;
+        }
+        return false;
+    }
+
+    size_t size() const { return list.size(); }
+
+private:
+    Conn::Pointer removeAt(const size_t index) {
+        const auto conn = list[index];
+        // IdleConnList shuffled the remaining entries to fill the gap
+        for (auto i = index; i + 1 < list.size(); ++i)
+            list[i] = list[i + 1];
+        list.pop_back();
+        return conn;
+    }
+
+    std::vector<Conn::Pointer> list;
+};
+
+/// the number of distinct outgoing addresses used by connections
+static const int LocalAddressCount = 4;
+
+static Ip::Address
+LocalAddress(const int i)
+{
+    return Ip::Address((std::string("10.0.0.") + std::to_string(i + 1)).c_str());
+}
+
+/// runs the given number of operations; returns operations per second
+template <class List>
+static double
+run(const char *scenario, List &list, std::vector<Conn::Pointer> &conns, const uint64_t operations)
+{
+    std::mt19937 random(1);
+    std::uniform_int_distribution<size_t> pick(0, conns.size() - 1);
+    const auto usable = [](const Conn::Pointer &) { return true; };
+    const Ip::Address anyAddress;
+    const auto missingAddress = LocalAddress(LocalAddressCount);
+    const std::string name(scenario);
+
+    uint64_t misses = 0;
+    const auto start = std::chrono::steady_clock::now();
+    for (uint64_t i = 0; i < operations; ++i) {
+        Conn::Pointer conn;
+        if (name == "closures") {
+            conn = conns[pick(random)];
+            if (!list.remove(conn))
+                conn = nullptr;
+        } else if (name == "any-address") {
+            conn = list.popNewest(anyAddress, usable);
+        } else if (name == "specific-address") {
+            conn = list.popNewest(LocalAddress(i % LocalAddressCount), usable);
+        } else {
+            conn = list.popNewest(missingAddress, usable);
+            continue; // always misses
+        }
+        if (!conn) {
+            ++misses;
+            continue;
+        }
+        // a reused connection becomes idle again; a closed one is replaced
+        // by a new connection (modeled by the same Conn object)
+        list.push(conn);
+    }
+    const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    if (misses)
+        std::cerr << "unexpected misses: " << misses << std::endl;
+    return operations / elapsed.count();
+}
+
+template <class List>
+static void
+benchmark(const char *listName, std::vector<Conn::Pointer> &conns, const uint64_t operations)
+{
+    std::cout << listName << ":\n";
+    for (const auto scenario: {"any-address", "specific-address", "address-miss", "closures"}) {
+        List list;
+        for (const auto &conn: conns)
+            list.push(conn);
+        const auto rate = run(scenario, list, conns, operations);
+        std::cout << "  " << scenario << " ops/sec: " << rate << "\n";
+    }
+}
+
+int
+main(int argc, char *argv[])
+{
+    const uint64_t connections = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 10000;
+    const uint64_t operations = argc > 2 ? std::strtoull(argv[2], nullptr, 10) : 100000;
+
+    std::vector<Conn::Pointer> conns;
+    for (uint64_t i = 0; i < std::max<uint64_t>(connections, 1); ++i) {
+        auto local = LocalAddress(i % LocalAddressCount);
+        local.port(1024 + i % 60000);
+        conns.push_back(new Conn(i, local));
+    }
+
+    std::cout << "idle connections: " << conns.size() << ", operations: " << operations << std::endl;
+    benchmark<ArrayList>("array", conns, operations);
+    benchmark< IdleConnIndex<Conn> >("index", conns, operations);
+    return EXIT_SUCCESS;
+}
+